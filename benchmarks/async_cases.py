@@ -58,6 +58,28 @@ def fill_scalar(scale):
     ti.benchmark(repeated_fill, repeat=5)
 
 
+@benchmark_async
+def independent_fills(scale):
+    # Each round launches one task per field, and the tasks of a round are
+    # independent of each other.
+    n = 8
+    fields = [
+        ti.field(dtype=ti.f32, shape=scale * 1024**2 // n) for _ in range(n)
+    ]
+
+    @ti.kernel
+    def fill(x: ti.template(), value: ti.f32):
+        for i in x:
+            x[i] = ti.sin(i * value)
+
+    def fill_all():
+        for _ in range(10):
+            for k, x in enumerate(fields):
+                fill(x, k + 1)
+
+    ti.benchmark(fill_all, repeat=10)
+
+
 @benchmark_async
 def sparse_saxpy(scale):
     a = ti.field(dtype=ti.f32)
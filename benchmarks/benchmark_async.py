@@ -5,9 +5,12 @@ import taichi as ti
 
 rerun = True
 
+# Run with TI_ASYNC_PARALLEL_LAUNCHES=<k> to measure the parallel launching of
+# independent tasks, e.g. in independent_fills.
 cases = [
-    chain_copy, increments, fill_array, sparse_saxpy, autodiff,
-    stencil_reduction, mpm_splitted, simple_advection, multires, deep_hierarchy
+    chain_copy, increments, fill_array, independent_fills, sparse_saxpy,
+    autodiff, stencil_reduction, mpm_splitted, simple_advection, multires,
+    deep_hierarchy
 ]
 
 if rerun:
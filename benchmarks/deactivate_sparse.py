@@ -0,0 +1,42 @@
+import time
+
+import taichi as ti
+
+
+@ti.archs_support_sparse
+def benchmark_deactivate_pointer_cells():
+    a = ti.field(dtype=ti.f32)
+    N = 1000000
+
+    # Every cell has its own node, so that deactivating a cell recycles a node
+    # through the NodeManager of the pointer SNode.
+    ti.root.pointer(ti.i, N).place(a)
+
+    @ti.kernel
+    def fill():
+        for i in range(N):
+            a[i] = 1.0
+
+    @ti.kernel
+    def clear():
+        for i in a:
+            ti.deactivate(a.parent(), i)
+
+    repeat = 10
+    # Compile and warm up
+    fill()
+    clear()
+    ti.sync()
+
+    elapsed = 0
+    for _ in range(repeat):
+        fill()
+        ti.sync()
+        t = time.time()
+        clear()
+        ti.sync()
+        elapsed += time.time() - t
+    throughput = N * repeat / elapsed
+    print(f'Deactivated {N} cells: {elapsed / repeat * 1000:.3f} ms, '
+          f'{throughput / 1e6:.2f} M cells/s')
+    ti.stat_write('deactivated_cells_per_s', throughput)
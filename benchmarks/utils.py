@@ -5,6 +5,11 @@ import taichi as ti
 
 
 def benchmark_async(func):
+    # Set TI_ASYNC_PARALLEL_LAUNCHES=k to launch up to k independent tasks
+    # concurrently on CPUs in async mode. The kernel profiler only supports
+    # serial launches, so 'exec_t' is not measured then.
+    parallel_launches = int(os.environ.get('TI_ASYNC_PARALLEL_LAUNCHES', '1'))
+
     @functools.wraps(func)
     def body():
         for arch in [ti.cpu, ti.cuda]:
@@ -12,7 +17,8 @@ def benchmark_async(func):
                 os.environ['TI_CURRENT_BENCHMARK'] = func.__name__
                 ti.init(arch=arch,
                         async_mode=async_mode,
-                        kernel_profiler=True,
+                        async_max_parallel_launches=parallel_launches,
+                        kernel_profiler=parallel_launches <= 1,
                         verbose=False)
                 if arch == ti.cpu:
                     scale = 2
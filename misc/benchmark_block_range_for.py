@@ -0,0 +1,57 @@
+# Compares memory-bound CPU range-fors with and without cpu_block_range_for,
+# i.e. with one function call per block of iterations instead of per iteration.
+
+import time
+
+import taichi as ti
+
+N = 1024**2 * 64
+
+
+def run(cpu_block_range_for):
+    ti.init(arch=ti.cpu, cpu_block_range_for=cpu_block_range_for)
+    x = ti.field(dtype=ti.f32, shape=N)
+    y = ti.field(dtype=ti.f32, shape=N)
+    z = ti.field(dtype=ti.f32, shape=N)
+
+    @ti.kernel
+    def memset():
+        for i in range(N):
+            x[i] = 1.0
+
+    @ti.kernel
+    def saxpy():
+        for i in range(N):
+            z[i] = 123 * x[i] + y[i]
+
+    @ti.kernel
+    def stencil():
+        for i in range(1, N - 1):
+            y[i] = (x[i - 1] + x[i] + x[i + 1]) * (1 / 3)
+
+    repeat = 10
+    results = {}
+    for name, kernel in [('memset', memset), ('saxpy', saxpy),
+                         ('stencil', stencil)]:
+        # Compile and warm up
+        kernel()
+        ti.sync()
+        t = time.time()
+        for _ in range(repeat):
+            kernel()
+        ti.sync()
+        results[name] = (time.time() - t) / repeat
+    return results
+
+
+def main():
+    baseline = run(False)
+    blocked = run(True)
+    for name in baseline:
+        print(f'{name:>8}: {baseline[name] * 1000:8.3f} ms -> '
+              f'{blocked[name] * 1000:8.3f} ms '
+              f'({baseline[name] / blocked[name]:.2f}x)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,79 @@
+# Measures the bandwidth of struct-for sweeps over a large dense field with and
+# without cpu_huge_pages and cpu_first_touch.
+#
+# Pass a configuration name to run only that configuration, e.g. to count the
+# TLB misses with
+#   perf stat -e dTLB-load-misses,dTLB-store-misses \
+#       python3 misc/benchmark_huge_pages.py huge_pages+first_touch
+
+import sys
+import time
+
+import taichi as ti
+
+N = 1024**2 * 256  # 1 GB per field
+
+configs = {
+    'baseline': {},
+    'huge_pages': {
+        'cpu_huge_pages': True
+    },
+    'huge_pages+first_touch': {
+        'cpu_huge_pages': True,
+        'cpu_first_touch': True,
+        'cpu_numa_aware': True
+    },
+}
+
+
+def anon_huge_pages_mb():
+    try:
+        with open('/proc/self/smaps_rollup') as f:
+            for line in f:
+                if line.startswith('AnonHugePages:'):
+                    return int(line.split()[1]) / 1024
+    except OSError:
+        pass
+    return 0
+
+
+def run(name):
+    ti.init(arch=ti.cpu, **configs[name])
+    x = ti.field(dtype=ti.f32, shape=N)
+    y = ti.field(dtype=ti.f32, shape=N)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = 1.0
+
+    @ti.kernel
+    def sweep():
+        for i in y:
+            y[i] = x[i] * 2 + y[i]
+
+    t = time.perf_counter()
+    fill()
+    ti.sync()
+    first_fill = time.perf_counter() - t
+
+    sweep()
+    ti.sync()
+    repeat = 10
+    t = time.perf_counter()
+    for _ in range(repeat):
+        sweep()
+    ti.sync()
+    sweep_time = (time.perf_counter() - t) / repeat
+
+    # Each sweep reads x and y and writes y.
+    bandwidth = 3 * N * 4 / sweep_time / 1e9
+    print(f'{name:>24}: first fill {first_fill * 1000:8.2f} ms, '
+          f'sweep {sweep_time * 1000:8.2f} ms ({bandwidth:6.2f} GB/s), '
+          f'huge pages {anon_huge_pages_mb():.0f} MB')
+    ti.reset()
+
+
+if __name__ == '__main__':
+    for name in sys.argv[1:] or configs:
+        run(name)
@@ -0,0 +1,47 @@
+# Measures the host-side latency of launching tiny kernels with different
+# numbers of scalar arguments, with and without the launch statistics.
+
+import time
+
+import taichi as ti
+
+num_launches = 100000
+
+
+def benchmark(kernel_launch_stats):
+    ti.init(arch=ti.cpu, kernel_launch_stats=kernel_launch_stats)
+    x = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def args0():
+        x[None] = 0
+
+    @ti.kernel
+    def args1(a: ti.f32):
+        x[None] = a
+
+    @ti.kernel
+    def args4(a: ti.f32, b: ti.i32, c: ti.f64, d: ti.i64):
+        x[None] = a + b + c + d
+
+    cases = [
+        ('0 args', lambda: args0()),
+        ('1 arg', lambda: args1(1.0)),
+        ('4 args', lambda: args4(1.0, 2, 3.0, 4)),
+    ]
+    print(f'kernel_launch_stats={kernel_launch_stats}:')
+    for name, launch in cases:
+        # Compile and warm up
+        launch()
+        ti.sync()
+        t = time.perf_counter()
+        for _ in range(num_launches):
+            launch()
+        ti.sync()
+        latency = (time.perf_counter() - t) / num_launches
+        print(f'  {name}: {latency * 1e6:.3f} us/launch')
+
+
+if __name__ == '__main__':
+    for kernel_launch_stats in [True, False]:
+        benchmark(kernel_launch_stats)
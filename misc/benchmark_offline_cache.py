@@ -0,0 +1,56 @@
+# Measures the cold-start vs. warm-start time of compiling kernels with the
+# offline cache of the CPU backend. Each start runs in a fresh process.
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+num_kernels = 64
+
+
+def run_child(cache_path):
+    import taichi as ti
+
+    t = time.time()
+    ti.init(arch=ti.x64, offline_cache=True, offline_cache_file_path=cache_path)
+    init_time = time.time() - t
+
+    x = ti.field(ti.f32, shape=1024)
+
+    def make_kernel(k):
+        @ti.kernel
+        def func():
+            for i in x:
+                x[i] = ti.sin(x[i] * k) + ti.sqrt(i + k)
+
+        return func
+
+    kernels = [make_kernel(k) for k in range(num_kernels)]
+    t = time.time()
+    for func in kernels:
+        func()
+    ti.sync()
+    compile_time = time.time() - t
+
+    stat = ti.core.stat()
+    print(f'  ti.init: {init_time:.3f} s, '
+          f'{num_kernels} kernels: {compile_time:.3f} s')
+    for line in stat.split('\n'):
+        if 'offline_cache' in line:
+            print(f'  {line.strip()}')
+
+
+def main():
+    with tempfile.TemporaryDirectory() as cache_path:
+        for start in ['cold', 'warm']:
+            print(f'{start} start:')
+            subprocess.run([sys.executable, __file__, cache_path], check=True)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) > 1:
+        run_child(sys.argv[1])
+    else:
+        main()
@@ -0,0 +1,75 @@
+# Compares the direct and the iterative sparse solvers on the 2D Poisson
+# equation, discretized with the 5-point stencil on an N x N grid.
+
+import time
+
+import numpy as np
+
+import taichi as ti
+
+ti.init(arch=ti.cpu)
+
+solvers = [
+    ('LLT', {}),
+    ('LDLT', {}),
+    ('LU', {}),
+    ('CG', {'preconditioner': 'jacobi'}),
+    ('CG', {'preconditioner': 'ic'}),
+    ('BICGSTAB', {'preconditioner': 'jacobi'}),
+]
+
+
+def build_poisson(N):
+    n = N * N
+    builder = ti.SparseMatrixBuilder(n, n, max_num_triplets=n * 5)
+
+    @ti.kernel
+    def fill(A: ti.sparse_matrix_builder()):
+        for i, j in ti.ndrange(N, N):
+            row = i * N + j
+            A[row, row] += 4.0
+            if i > 0:
+                A[row, row - N] -= 1.0
+            if i < N - 1:
+                A[row, row + N] -= 1.0
+            if j > 0:
+                A[row, row - 1] -= 1.0
+            if j < N - 1:
+                A[row, row + 1] -= 1.0
+
+    fill(builder)
+    t = time.perf_counter()
+    A = builder.build()
+    print(f'N={N}: built {n}x{n} in {time.perf_counter() - t:.3f} s')
+    return A
+
+
+def benchmark(N):
+    A = build_poisson(N)
+    b = np.random.rand(N * N).astype(np.float32)
+    for solver_type, options in solvers:
+        if solver_type == 'LU' and N > 512:
+            continue
+        solver = ti.SparseSolver(solver_type=solver_type, **options)
+        t = time.perf_counter()
+        solver.compute(A)
+        t_compute = time.perf_counter() - t
+        t = time.perf_counter()
+        x = solver.solve(b)
+        t_solve = time.perf_counter() - t
+        residual = np.linalg.norm(A @ x - b) / np.linalg.norm(b)
+        name = solver_type + ''.join(f' ({v})' for v in options.values())
+        print(f'  {name:<20} compute {t_compute:.3f} s, '
+              f'solve {t_solve:.3f} s, residual {residual:.2e}')
+        # Warm start from the solution, as in time-stepping simulations
+        if solver_type in ['CG', 'BICGSTAB']:
+            t = time.perf_counter()
+            solver.solve(b, x0=x)
+            print(f'  {"":<20} warm-started solve '
+                  f'{time.perf_counter() - t:.3f} s, '
+                  f'{solver.iterations()} iterations')
+
+
+if __name__ == '__main__':
+    for N in [128, 256, 512, 1024]:
+        benchmark(N)
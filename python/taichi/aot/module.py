@@ -60,6 +60,14 @@ class Module:
     serialized module can later be loaded to run on that backend, without the
     Python environment.
 
+    On CPUs, the kernels and the runtime are compiled to a shared library
+    (see ``ti.init(cpu_aot_link_cmd=...)``), which the C++
+    ``cpu::AotModuleLoaderImpl`` runs on a preallocated buffer without LLVM.
+    The library targets the baseline CPU of the architecture (e.g.
+    ``x86-64``), unless another one is chosen with
+    ``ti.init(cpu_aot_target_cpu=...)``, where ``"native"`` is the CPU of
+    this machine.
+
     Example:
       Usage::
 
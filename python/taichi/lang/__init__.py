@@ -80,9 +80,15 @@ def kernel_profiler_print():
 
 
 def print_kernel_profile_info():
-    """Print the elapsed time(min,max,avg) of Taichi kernels on devices.
+    """Print the elapsed time(min,avg,percentiles,max) of Taichi kernels on devices.
     To enable this profiler, set `kernel_profiler=True` in `ti.init`.
 
+    On LLVM backends the records are per offloaded task (e.g. listgen,
+    struct_for), grouped under their kernels. On CPUs, the busy time of each
+    thread and the fraction of idle thread time are also shown. With
+    `timeline=True` in `ti.init`, the tasks and the per-thread activity are
+    also exported by `ti.timeline_save()` as Chrome trace events.
+
     Example::
 
         >>> import taichi as ti
@@ -159,6 +165,41 @@ def clear_kernel_profile_info():
     impl.get_runtime().prog.clear_kernel_profile_info()
 
 
+def print_pass_profile_info():
+    """Prints the compilation time of each IR pass, per kernel and in total.
+    To enable this profiler, set `pass_profiler=True` in `ti.init`.
+
+    For each pass, the number of IR statements before and after it is also
+    shown. The passes run inside `full_simplify` appear as
+    `full_simplify/<pass>`, and their time is included in that of the
+    enclosing step.
+    """
+    impl.get_runtime().prog.print_pass_profile_info()
+
+
+def query_pass_profile_info():
+    """Returns the records of the pass profiler.
+
+    Returns:
+        List[dict]: One dict per pass run, with the keys `kernel`, `pass`,
+        `time` (in seconds), `num_stmts_before` and `num_stmts_after`.
+    """
+    import json
+    return json.loads(impl.get_runtime().prog.pass_profile_info_json())
+
+
+def export_pass_profile_info(filename):
+    """Saves the records of the pass profiler to a JSON file, in the format
+    of :func:`query_pass_profile_info`."""
+    with open(filename, 'w') as f:
+        f.write(impl.get_runtime().prog.pass_profile_info_json())
+
+
+def clear_pass_profile_info():
+    """Clears all the records of the pass profiler."""
+    impl.get_runtime().prog.clear_pass_profile_info()
+
+
 def kernel_profiler_total_time():
     """
     Get elapsed time of all kernels recorded in KernelProfiler.
@@ -169,6 +210,36 @@ def kernel_profiler_total_time():
     return impl.get_runtime().prog.kernel_profiler_total_time()
 
 
+def compile_kernels(*kernels):
+    """Compiles kernels ahead of their first launch.
+
+    On the LLVM backends, the code generation of the kernels runs in parallel
+    on up to ``num_compile_threads`` threads (see :func:`~taichi.lang.init`),
+    which shortens the start-up time of programs with many kernels. On the C
+    backend, the C compilers of the kernels run in parallel instead.
+
+    Args:
+        *kernels: Each item is either a kernel, or a tuple of a kernel followed
+            by the arguments it will be called with. The arguments are needed
+            for kernels with template or external array parameters.
+
+    Example::
+
+        >>> ti.compile_kernels(init, (substep, x, 0.5), render)
+    """
+    kernels_cpp = []
+    for item in kernels:
+        if isinstance(item, tuple):
+            kernel, args = item[0], item[1:]
+        else:
+            kernel, args = item, ()
+        if hasattr(kernel, '_kernel_owner'):
+            args = (kernel._kernel_owner, ) + tuple(args)
+        key = kernel._primal.ensure_compiled(*args)
+        kernels_cpp.append(kernel._primal.compiled_kernels[key])
+    impl.get_runtime().prog.compile_kernels(kernels_cpp)
+
+
 @deprecated('memory_profiler_print()', 'print_memory_profile_info()')
 def memory_profiler_print():
     return print_memory_profile_info()
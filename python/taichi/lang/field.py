@@ -257,6 +257,54 @@ class ScalarField(Field):
         ext_arr_to_tensor(arr, self)
         ti.sync()
 
+    def _batch_indices(self, indices):
+        import numpy as np
+        assert len(self.shape) > 0
+        indices = np.ascontiguousarray(indices, dtype=np.int32)
+        return indices.reshape(-1, len(self.shape))
+
+    @python_scope
+    def gather(self, indices):
+        """Reads the elements at a batch of coordinates in one call.
+
+        On CPU backends, elements are read from the host directly without
+        launching kernels.
+
+        Args:
+            indices (numpy.ndarray): Coordinates of the n elements, with shape (n, len(self.shape)).
+
+        Returns:
+            numpy.ndarray: The n elements.
+        """
+        import numpy as np
+        indices = self._batch_indices(indices)
+        n = indices.shape[0]
+        out = np.empty(n, dtype=to_numpy_type(self.dtype))
+        impl.get_runtime().materialize()
+        self.vars[0].ptr.snode().read_batch(int(indices.ctypes.data), n,
+                                            int(out.ctypes.data))
+        return out
+
+    @python_scope
+    def scatter(self, indices, values):
+        """Writes the elements at a batch of coordinates in one call.
+
+        On CPU backends, elements are written from the host directly without
+        launching kernels.
+
+        Args:
+            indices (numpy.ndarray): Coordinates of the n elements, with shape (n, len(self.shape)).
+            values (numpy.ndarray): The n values to write.
+        """
+        import numpy as np
+        indices = self._batch_indices(indices)
+        n = indices.shape[0]
+        values = np.ascontiguousarray(values, dtype=to_numpy_type(self.dtype))
+        assert values.shape == (n, )
+        impl.get_runtime().materialize()
+        self.vars[0].ptr.snode().write_batch(int(indices.ctypes.data), n,
+                                             int(values.ctypes.data))
+
     @python_scope
     def __setitem__(self, key, value):
         self.initialize_host_accessors()
@@ -1,4 +1,4 @@
-from taichi.core.primitive_types import u64
+from taichi.core.primitive_types import f64, u64
 from taichi.core.util import ti_core as _ti_core
 from taichi.lang.any_array import AnyArray
 from taichi.lang.enums import Layout
@@ -140,13 +140,15 @@ class SparseMatrixEntry:
         self.j = j
 
     def augassign(self, value, op):
-        from taichi.lang.impl import call_internal, ti_float
+        from taichi.lang.impl import call_internal
+        from taichi.lang.ops import cast
+        # Values are passed as f64 and narrowed by builders of f32.
         if op == 'Add':
             call_internal("insert_triplet", self.ptr, self.i, self.j,
-                          ti_float(value))
+                          cast(value, f64))
         elif op == 'Sub':
             call_internal("insert_triplet", self.ptr, self.i, self.j,
-                          -ti_float(value))
+                          -cast(value, f64))
         else:
             assert False, f"Only operations '+=' and '-=' are supported on sparse matrices."
 
@@ -328,6 +328,8 @@ class Kernel:
             self.compiled_functions = self.runtime.compiled_functions
         else:
             self.compiled_functions = self.runtime.compiled_grad_functions
+        # The C++ kernel of each key in |compiled_functions|.
+        self.compiled_kernels = {}
 
     def extract_arguments(self):
         sig = inspect.signature(self.func)
@@ -454,6 +456,7 @@ class Kernel:
 
         taichi_kernel = taichi_kernel.define(taichi_ast_generator)
         self.kernel_cpp = taichi_kernel
+        self.compiled_kernels[key] = taichi_kernel
 
         assert key not in self.compiled_functions
         self.compiled_functions[key] = self.get_function_body(taichi_kernel)
@@ -59,8 +59,20 @@ class SNode:
                              impl.current_cfg().packed))
 
     def hash(self, axes, dimensions):
-        """Not supported."""
-        raise RuntimeError('hash not yet supported')
+        """Adds a hash SNode as a child component of `self`.
+
+        A hash SNode stores its active cells in a hash table, so that its
+        memory footprint does not grow with the number of (inactive) cells.
+        It must be a child of the root, and only the LLVM-based backends
+        support it.
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(axes)
         return SNode(self.ptr.hash(axes, dimensions,
@@ -311,7 +323,8 @@ class SNode:
             c.deactivate_all()
         SNodeType = _ti_core.SNodeType
         from taichi.lang import meta
-        if self.ptr.type == SNodeType.pointer or self.ptr.type == SNodeType.bitmasked:
+        if self.ptr.type in (SNodeType.pointer, SNodeType.hash,
+                             SNodeType.bitmasked):
             meta.snode_deactivate(self)
         if self.ptr.type == SNodeType.dynamic:
             # Note that dynamic nodes are different from other sparse nodes:
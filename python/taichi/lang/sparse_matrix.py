@@ -1,10 +1,13 @@
+from taichi.core.primitive_types import f32
+
+
 class SparseMatrix:
-    def __init__(self, n=None, m=None, sm=None):
+    def __init__(self, n=None, m=None, sm=None, dtype=f32):
         if sm is None:
             self.n = n
             self.m = m if m else n
             from taichi.core.util import ti_core as _ti_core
-            self.matrix = _ti_core.create_sparse_matrix(n, m)
+            self.matrix = _ti_core.create_sparse_matrix(n, self.m, dtype)
         else:
             self.n = sm.num_rows()
             self.m = sm.num_cols()
@@ -67,13 +70,17 @@ class SparseMatrix:
 
 
 class SparseMatrixBuilder:
-    def __init__(self, num_rows=None, num_cols=None, max_num_triplets=0):
+    def __init__(self,
+                 num_rows=None,
+                 num_cols=None,
+                 max_num_triplets=0,
+                 dtype=f32):
         self.num_rows = num_rows
         self.num_cols = num_cols if num_cols else num_rows
         if num_rows is not None:
             from taichi.core.util import ti_core as _ti_core
             self.ptr = _ti_core.create_sparse_matrix_builder(
-                num_rows, num_cols, max_num_triplets)
+                num_rows, self.num_cols, max_num_triplets, dtype)
 
     def get_addr(self):
         return self.ptr.get_addr()
@@ -84,3 +91,11 @@ class SparseMatrixBuilder:
     def build(self):
         sm = self.ptr.build()
         return SparseMatrix(sm=sm)
+
+    def clear(self):
+        """Drops the inserted triplets so that the builder can be filled again.
+
+        Rebuilding a matrix with an unchanged sparsity pattern after clearing
+        reuses the pattern of the previous build.
+        """
+        self.ptr.clear()
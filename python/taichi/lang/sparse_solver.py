@@ -1,17 +1,50 @@
+from taichi.core.primitive_types import f32
 from taichi.lang.sparse_matrix import SparseMatrix
 
 
 class SparseSolver:
-    def __init__(self, solver_type="LLT"):
-        solver_type_list = ["LLT", "LDLT", "LU"]
+    """Solves sparse linear systems Ax = b.
+
+    Args:
+        solver_type (str): "LLT", "LDLT" and "LU" are direct solvers. "CG"
+            (conjugate gradients, for symmetric positive definite matrices)
+            and "BICGSTAB" are multithreaded iterative solvers.
+        dtype (DataType): f32 or f64, which must match the matrices.
+        preconditioner (Union[str, Callable]): For iterative solvers only.
+            One of "none", "jacobi" and "ic" (incomplete Cholesky), or a
+            function that approximates A^-1 r for a numpy array r, e.g. a
+            multigrid cycle.
+        max_iterations (int): For iterative solvers only. Defaults to twice
+            the size of the system.
+        tolerance (float): For iterative solvers only. Iterations stop when
+            ||b - Ax|| <= tolerance * ||b||.
+    """
+    def __init__(self,
+                 solver_type="LLT",
+                 dtype=f32,
+                 preconditioner="jacobi",
+                 max_iterations=None,
+                 tolerance=1e-6):
+        direct_solver_types = ["LLT", "LDLT", "LU"]
+        iterative_solver_types = ["CG", "BICGSTAB"]
+        solver_type_list = direct_solver_types + iterative_solver_types
         if solver_type in solver_type_list:
             from taichi.core.util import ti_core as _ti_core
             from taichi.lang.impl import get_runtime
             taichi_arch = get_runtime().prog.config.arch
             assert taichi_arch == _ti_core.Arch.x64 or taichi_arch == _ti_core.Arch.arm64, "SparseSolver only supports CPU for now."
-            self.solver = _ti_core.get_sparse_solver(solver_type)
+            self.iterative = solver_type in iterative_solver_types
+            self.solver = _ti_core.get_sparse_solver(
+                solver_type, dtype,
+                preconditioner if isinstance(preconditioner, str) else "none")
         else:
             assert False, f"The solver type {solver_type} is not support for now. Only {solver_type_list} are supported."
+        if self.iterative:
+            if callable(preconditioner):
+                self.solver.set_preconditioner(preconditioner)
+            if max_iterations is not None:
+                self.solver.set_max_iterations(max_iterations)
+            self.solver.set_tolerance(tolerance)
 
     @staticmethod
     def type_assert(sparse_matrix):
@@ -35,15 +68,40 @@ class SparseSolver:
         else:
             self.type_assert(sparse_matrix)
 
-    def solve(self, b):
+    @staticmethod
+    def _to_numpy(v):
         import numpy as np
         from taichi.lang import Field
-        if isinstance(b, Field):
-            return self.solver.solve(b.to_numpy())
-        elif isinstance(b, np.ndarray):
-            return self.solver.solve(b)
+        if isinstance(v, Field):
+            return v.to_numpy()
+        elif isinstance(v, np.ndarray):
+            return v
         else:
-            assert False, f"The parameter type: {type(b)} is not supported in linear solvers for now."
+            assert False, f"The parameter type: {type(v)} is not supported in linear solvers for now."
+
+    def solve(self, b, x0=None):
+        """Solves Ax = b.
+
+        Args:
+            b (Union[ti.field, numpy.ndarray]): The right-hand side.
+            x0 (Union[ti.field, numpy.ndarray]): The initial guess (warm start)
+                of iterative solvers, e.g. the solution of the last frame.
+                Direct solvers ignore it.
+        """
+        if x0 is None:
+            return self.solver.solve(self._to_numpy(b))
+        return self.solver.solve_with_guess(self._to_numpy(b),
+                                            self._to_numpy(x0))
 
     def info(self):
         return self.solver.info()
+
+    def iterations(self):
+        """The number of iterations of the last solve by iterative solvers."""
+        assert self.iterative, "Only iterative solvers count iterations."
+        return self.solver.iterations()
+
+    def error(self):
+        """The relative residual ||b - Ax|| / ||b|| of the last iterative solve."""
+        assert self.iterative, "Only iterative solvers estimate the error."
+        return self.solver.error()
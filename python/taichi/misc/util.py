@@ -238,6 +238,24 @@ def get_kernel_stats():
     return _ti_core.get_kernel_stats()
 
 
+def dump_metrics(filename=None):
+    """Dumps the counters and the compile, launch and sync latency histograms
+    in the Prometheus text exposition format.
+
+    Args:
+        filename (str, optional): The file to write to. It is replaced
+            atomically, so that a scraper polling it (e.g. the textfile
+            collector of the node exporter) never reads a partial dump.
+
+    Returns:
+        The text if `filename` is None.
+    """
+    if filename is None:
+        return _ti_core.metrics_to_prometheus()
+    _ti_core.save_metrics(filename)
+    return None
+
+
 def print_async_stats(include_kernel_profiler=False):
     import taichi as ti
     if include_kernel_profiler:
@@ -269,6 +287,7 @@ __all__ = [
     'dot_to_pdf',
     'obsolete',
     'get_kernel_stats',
+    'dump_metrics',
     'get_traceback',
     'set_gdb_trigger',
     'print_profile_info',
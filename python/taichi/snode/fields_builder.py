@@ -87,7 +87,9 @@ class FieldsBuilder:
 
     def hash(self, indices, dimensions):
         """Same as :func:`taichi.lang.SNode.hash`"""
-        raise NotImplementedError()
+        self._check_not_finalized()
+        self._empty = False
+        return self._root.hash(indices, dimensions)
 
     def dynamic(self,
                 index: Union[Sequence[_Axis], _Axis],
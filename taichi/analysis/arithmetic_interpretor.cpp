@@ -1,6 +1,8 @@
 #include "taichi/analysis/arithmetic_interpretor.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <type_traits>
 #include <vector>
 
@@ -22,6 +24,308 @@ std::vector<Stmt *> get_raw_statements(const Block *block) {
   return res;
 }
 
+// The helpers below evaluate operations exactly the way the LLVM backends
+// do (see CodeGenLLVM::visit(UnaryOpStmt/BinaryOpStmt) and the runtime
+// functions they call). Integers are handled as raw bits of their width, so
+// that e.g. wrap-around and casts match the generated code bit by bit. Any
+// operation whose result is undefined (division by zero, oversized shifts,
+// out-of-range float-to-int casts, ...) or may differ between the host and
+// the device (transcendental functions) is not evaluated.
+
+bool is_evaluable_type(DataType dt) {
+  if (dt.is_pointer() || !dt->is<PrimitiveType>()) {
+    return false;
+  }
+  return dt->is_primitive(PrimitiveTypeID::f32) ||
+         dt->is_primitive(PrimitiveTypeID::f64) || is_integral(dt);
+}
+
+uint64 bit_mask(int bits) {
+  return bits >= 64 ? ~uint64(0) : (uint64(1) << bits) - 1;
+}
+
+// The bits of an integral constant, zero-extended to 64 bits.
+uint64 get_bits(const TypedConstant &c) {
+  return c.value_bits & bit_mask(data_type_bits(c.dt));
+}
+
+// The bits of an integral constant, sign-extended to 64 bits.
+int64 get_signed_bits(const TypedConstant &c) {
+  const int bits = data_type_bits(c.dt);
+  auto val = get_bits(c);
+  if (bits < 64 && ((val >> (bits - 1)) & 1)) {
+    val |= ~bit_mask(bits);
+  }
+  return (int64)val;
+}
+
+TypedConstant make_int(DataType dt, uint64 bits) {
+  TypedConstant res(dt);
+  res.value_bits = bits & bit_mask(data_type_bits(dt));
+  return res;
+}
+
+template <typename T>
+T get_real(const TypedConstant &c) {
+  if constexpr (std::is_same_v<T, float32>) {
+    return c.val_f32;
+  } else {
+    return c.val_f64;
+  }
+}
+
+template <typename T>
+TypedConstant make_real(DataType dt, T val) {
+  TypedConstant res(dt);
+  if constexpr (std::is_same_v<T, float32>) {
+    res.val_f32 = val;
+  } else {
+    res.val_f64 = val;
+  }
+  return res;
+}
+
+template <typename T>
+std::optional<T> eval_real_binary_op(BinaryOpType op, T lhs, T rhs) {
+  switch (op) {
+    case BinaryOpType::add:
+      return lhs + rhs;
+    case BinaryOpType::sub:
+      return lhs - rhs;
+    case BinaryOpType::mul:
+      return lhs * rhs;
+    case BinaryOpType::div:
+      return lhs / rhs;
+    case BinaryOpType::floordiv:
+      return std::floor(lhs / rhs);
+    case BinaryOpType::max:
+    case BinaryOpType::min:
+      // llvm.maxnum/minnum may return either operand for NaNs and for zeros
+      // of different signs.
+      if (std::isnan(lhs) || std::isnan(rhs) || lhs == rhs) {
+        if (std::memcmp(&lhs, &rhs, sizeof(T)) != 0) {
+          return std::nullopt;
+        }
+        return lhs;
+      }
+      if (op == BinaryOpType::max) {
+        return lhs > rhs ? lhs : rhs;
+      }
+      return lhs < rhs ? lhs : rhs;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<TypedConstant> eval_int_binary_op(BinaryOpType op,
+                                                const TypedConstant &lhs,
+                                                const TypedConstant &rhs) {
+  const auto dt = lhs.dt;
+  const int bits = data_type_bits(dt);
+  const bool is_signed_type = is_signed(dt);
+  const uint64 a = get_bits(lhs), b = get_bits(rhs);
+  const int64 sa = get_signed_bits(lhs), sb = get_signed_bits(rhs);
+  switch (op) {
+    case BinaryOpType::add:
+      return make_int(dt, a + b);
+    case BinaryOpType::sub:
+      return make_int(dt, a - b);
+    case BinaryOpType::mul:
+      return make_int(dt, a * b);
+    case BinaryOpType::div:
+    case BinaryOpType::mod:
+    case BinaryOpType::floordiv: {
+      // The backends use signed division (SDiv, SRem, floordiv_i32/i64)
+      // regardless of the signedness of the operands.
+      const int64 min_val = (int64)(~bit_mask(bits - 1));
+      if (sb == 0 || (sa == min_val && sb == -1)) {
+        return std::nullopt;
+      }
+      if (op == BinaryOpType::div) {
+        return make_int(dt, sa / sb);
+      }
+      if (op == BinaryOpType::mod) {
+        return make_int(dt, sa % sb);
+      }
+      // Integer floordiv is only implemented for signed types.
+      if (!is_signed_type) {
+        return std::nullopt;
+      }
+      auto res = sa / sb;
+      if ((sa < 0) != (sb < 0) && sa != sb * res) {
+        res -= 1;
+      }
+      return make_int(dt, res);
+    }
+    case BinaryOpType::max:
+    case BinaryOpType::min: {
+      const bool lhs_greater = is_signed_type ? sa > sb : a > b;
+      if (op == BinaryOpType::max) {
+        return make_int(dt, lhs_greater ? a : b);
+      }
+      return make_int(dt, lhs_greater ? b : a);
+    }
+    case BinaryOpType::bit_and:
+      return make_int(dt, a & b);
+    case BinaryOpType::bit_or:
+      return make_int(dt, a | b);
+    case BinaryOpType::bit_xor:
+      return make_int(dt, a ^ b);
+    case BinaryOpType::bit_shl:
+    case BinaryOpType::bit_shr:
+    case BinaryOpType::bit_sar:
+      // Shifting by at least the bit width yields poison in LLVM.
+      if (b >= (uint64)bits) {
+        return std::nullopt;
+      }
+      if (op == BinaryOpType::bit_shl) {
+        return make_int(dt, a << b);
+      }
+      if (op == BinaryOpType::bit_sar && is_signed_type) {
+        return make_int(dt, (uint64)(sa >> b));
+      }
+      return make_int(dt, a >> b);
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<bool> eval_comparison(BinaryOpType op,
+                                    const TypedConstant &lhs,
+                                    const TypedConstant &rhs) {
+  const auto dt = lhs.dt;
+  // Floating-point comparisons are ordered, i.e. always false on NaNs.
+  auto compare = [op](auto a, auto b) -> std::optional<bool> {
+    switch (op) {
+      case BinaryOpType::cmp_lt:
+        return a < b;
+      case BinaryOpType::cmp_le:
+        return a <= b;
+      case BinaryOpType::cmp_gt:
+        return a > b;
+      case BinaryOpType::cmp_ge:
+        return a >= b;
+      case BinaryOpType::cmp_eq:
+        return a == b;
+      case BinaryOpType::cmp_ne:
+        return a < b || a > b;
+      default:
+        return std::nullopt;
+    }
+  };
+  if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return compare(get_real<float32>(lhs), get_real<float32>(rhs));
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return compare(get_real<float64>(lhs), get_real<float64>(rhs));
+  } else if (is_signed(dt)) {
+    return compare(get_signed_bits(lhs), get_signed_bits(rhs));
+  } else {
+    return compare(get_bits(lhs), get_bits(rhs));
+  }
+}
+
+template <typename T>
+std::optional<T> eval_real_unary_op(UnaryOpType op, T val) {
+  switch (op) {
+    case UnaryOpType::neg:
+      return -val;
+    case UnaryOpType::abs:
+      return std::abs(val);
+    case UnaryOpType::sgn:
+      // Matches sgn_f32/f64 in the runtime, which return 0 for NaNs.
+      if (val > 0) {
+        return T(1);
+      } else if (val < 0) {
+        return T(-1);
+      }
+      return T(0);
+    case UnaryOpType::sqrt:
+      return std::sqrt(val);
+    case UnaryOpType::rsqrt:
+      return T(1) / std::sqrt(val);
+    case UnaryOpType::floor:
+      return std::floor(val);
+    case UnaryOpType::ceil:
+      return std::ceil(val);
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<TypedConstant> eval_int_unary_op(UnaryOpType op,
+                                               const TypedConstant &val) {
+  const auto dt = val.dt;
+  const uint64 a = get_bits(val);
+  switch (op) {
+    case UnaryOpType::neg:
+      return make_int(dt, uint64(0) - a);
+    case UnaryOpType::bit_not:
+      return make_int(dt, ~a);
+    case UnaryOpType::logic_not:
+      return make_int(dt, a == 0 ? 1 : 0);
+    case UnaryOpType::abs: {
+      if (!is_signed(dt)) {
+        return std::nullopt;
+      }
+      const int64 sa = get_signed_bits(val);
+      if (sa == (int64)(~bit_mask(data_type_bits(dt) - 1))) {
+        return std::nullopt;
+      }
+      return make_int(dt, sa < 0 ? -sa : sa);
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+template <typename T>
+std::optional<TypedConstant> eval_real_to_int(T val, DataType to) {
+  // FPToSI yields poison for values that do not fit into the destination.
+  if (std::isnan(val)) {
+    return std::nullopt;
+  }
+  const auto truncated = std::trunc(val);
+  const int bits = data_type_bits(to);
+  const auto limit = std::ldexp(T(1), bits - 1);
+  if (truncated < -limit || truncated >= limit) {
+    return std::nullopt;
+  }
+  return make_int(to, (uint64)(int64)truncated);
+}
+
+std::optional<TypedConstant> eval_cast_value(const TypedConstant &val,
+                                             DataType to) {
+  const auto from = val.dt;
+  if (from == to) {
+    return val;
+  }
+  if (is_real(from) && is_real(to)) {
+    if (from->is_primitive(PrimitiveTypeID::f32)) {
+      return make_real(to, (float64)get_real<float32>(val));
+    }
+    return make_real(to, (float32)get_real<float64>(val));
+  }
+  if (is_real(from)) {
+    if (from->is_primitive(PrimitiveTypeID::f32)) {
+      return eval_real_to_int(get_real<float32>(val), to);
+    }
+    return eval_real_to_int(get_real<float64>(val), to);
+  }
+  if (is_real(to)) {
+    // SIToFP interprets the source as signed even for unsigned types.
+    const auto sa = get_signed_bits(val);
+    if (to->is_primitive(PrimitiveTypeID::f32)) {
+      return make_real(to, (float32)sa);
+    }
+    return make_real(to, (float64)sa);
+  }
+  // Integer truncation or extension according to the source signedness.
+  if (is_signed(from)) {
+    return make_int(to, (uint64)get_signed_bits(val));
+  }
+  return make_int(to, get_bits(val));
+}
+
 class EvalVisitor : public IRVisitor {
  public:
   explicit EvalVisitor() {
@@ -58,6 +362,16 @@ class EvalVisitor : public IRVisitor {
     return context_.maybe_get(cur_stmt);
   }
 
+  std::optional<TypedConstant> run(Stmt *stmt, const EvalContext &ctx) {
+    context_ = ctx;
+    failed_ = false;
+    stmt->accept(this);
+    if (failed_) {
+      return std::nullopt;
+    }
+    return context_.maybe_get(stmt);
+  }
+
   void visit(ConstStmt *stmt) override {
     TI_ASSERT(stmt->val.size() == 1);
     context_.insert(stmt, stmt->val.data[0]);
@@ -72,29 +386,76 @@ class EvalVisitor : public IRVisitor {
     }
     auto lhs = lhs_opt.value();
     auto rhs = rhs_opt.value();
-    if (lhs.dt != rhs.dt) {
+    if (lhs.dt != rhs.dt || !is_evaluable_type(lhs.dt)) {
       failed_ = true;
       return;
     }
 
     const auto op = stmt->op_type;
     const auto dt = lhs.dt;
-    // TODO: Consider using macros to avoid duplication
-    if (is_real(dt)) {
-      // Put floating point numbers first because is_signed/unsigned asserts
-      // that the data type being integral.
-      auto res_opt = eval_bin_op(lhs.val_float(), rhs.val_float(), op);
-      insert_or_failed(stmt, dt, res_opt);
-    } else if (is_signed(dt)) {
-      auto res_opt = eval_bin_op(lhs.val_int(), rhs.val_int(), op);
-      insert_or_failed(stmt, dt, res_opt);
-    } else if (is_unsigned(dt)) {
-      auto res_opt = eval_bin_op(lhs.val_uint(), rhs.val_uint(), op);
-      insert_or_failed(stmt, dt, res_opt);
+    std::optional<TypedConstant> res;
+    if (is_comparison(op)) {
+      // The i1 result of a comparison is sign-extended, i.e. true is -1.
+      const auto cmp = eval_comparison(op, lhs, rhs);
+      if (cmp && is_evaluable_type(stmt->ret_type) &&
+          is_integral(stmt->ret_type)) {
+        res = make_int(stmt->ret_type, cmp.value() ? ~uint64(0) : 0);
+      }
+    } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+      auto val = eval_real_binary_op(op, get_real<float32>(lhs),
+                                     get_real<float32>(rhs));
+      if (val) {
+        res = make_real(dt, val.value());
+      }
+    } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+      auto val = eval_real_binary_op(op, get_real<float64>(lhs),
+                                     get_real<float64>(rhs));
+      if (val) {
+        res = make_real(dt, val.value());
+      }
     } else {
-      TI_NOT_IMPLEMENTED;
+      res = eval_int_binary_op(op, lhs, rhs);
+    }
+    insert_or_failed(stmt, res);
+  }
+
+  void visit(UnaryOpStmt *stmt) override {
+    auto val_opt = context_.maybe_get(stmt->operand);
+    if (!val_opt || !is_evaluable_type(val_opt.value().dt)) {
       failed_ = true;
+      return;
+    }
+    auto val = val_opt.value();
+    const auto op = stmt->op_type;
+    const auto dt = val.dt;
+    std::optional<TypedConstant> res;
+    if (stmt->is_cast()) {
+      const auto to = stmt->cast_type;
+      if (!is_evaluable_type(to)) {
+        failed_ = true;
+        return;
+      }
+      if (op == UnaryOpType::cast_value) {
+        res = eval_cast_value(val, to);
+      } else if (data_type_size(dt) == data_type_size(to)) {
+        // cast_bits
+        res = TypedConstant(to);
+        res->value_bits = val.value_bits & bit_mask(data_type_bits(to));
+      }
+    } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+      auto real = eval_real_unary_op(op, get_real<float32>(val));
+      if (real) {
+        res = make_real(dt, real.value());
+      }
+    } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+      auto real = eval_real_unary_op(op, get_real<float64>(val));
+      if (real) {
+        res = make_real(dt, real.value());
+      }
+    } else {
+      res = eval_int_unary_op(op, val);
     }
+    insert_or_failed(stmt, res);
   }
 
   void visit(BitExtractStmt *stmt) override {
@@ -130,37 +491,13 @@ class EvalVisitor : public IRVisitor {
   }
 
  private:
-  template <typename T>
-  static std::optional<T> eval_bin_op(T lhs, T rhs, BinaryOpType op) {
-    if (op == BinaryOpType::add) {
-      return lhs + rhs;
-    }
-    if (op == BinaryOpType::sub) {
-      return lhs - rhs;
-    }
-    if (op == BinaryOpType::mul) {
-      return lhs * rhs;
-    }
-    if (op == BinaryOpType::div) {
-      return lhs / rhs;
-    }
-    if constexpr (std::is_integral_v<T>) {
-      if (op == BinaryOpType::mod) {
-        return lhs % rhs;
-      }
-    }
-    return std::nullopt;
-  }
-
-  template <typename T>
   void insert_or_failed(const Stmt *stmt,
-                        DataType dt,
-                        std::optional<T> val_opt) {
+                        const std::optional<TypedConstant> &val_opt) {
     if (!val_opt) {
       failed_ = true;
       return;
     }
-    context_.insert(stmt, TypedConstant(dt, val_opt.value()));
+    context_.insert(stmt, val_opt.value());
   }
 
   template <typename T>
@@ -181,5 +518,12 @@ std::optional<TypedConstant> ArithmeticInterpretor::evaluate(
   return ev.run(region, init_ctx);
 }
 
+std::optional<TypedConstant> ArithmeticInterpretor::evaluate(
+    Stmt *stmt,
+    const EvalContext &ctx) const {
+  EvalVisitor ev;
+  return ev.run(stmt, ctx);
+}
+
 }  // namespace lang
 }  // namespace taichi
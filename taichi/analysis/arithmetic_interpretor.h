@@ -94,6 +94,20 @@ class ArithmeticInterpretor {
    */
   std::optional<TypedConstant> evaluate(const CodeRegion &region,
                                         const EvalContext &init_ctx) const;
+
+  /**
+   * Evaluates a single statement.
+   *
+   * The result is bit-exact with what the backends compute. Statements whose
+   * result is undefined (e.g. integer division by zero) or platform-dependent
+   * (e.g. transcendental functions) are not evaluated.
+   *
+   * @param stmt: The statement to be evaluated
+   * @param ctx: Must define the values of all the operands of @param stmt
+   * @return: The evaluated value, empty if @param stmt cannot be evaluated.
+   */
+  std::optional<TypedConstant> evaluate(Stmt *stmt,
+                                        const EvalContext &ctx) const;
 };
 
 }  // namespace lang
@@ -1,32 +1,40 @@
 #pragma once
 
 #include "taichi/lang_util.h"
+#include "cc_program.h"
+#include <future>
+#include <memory>
 #include <set>
 
+TI_NAMESPACE_BEGIN
+class DynamicLoader;
+TI_NAMESPACE_END
+
 TLANG_NAMESPACE_BEGIN
 
 class Kernel;
 
 namespace cccp {
 
-class CCProgram;
-
 class CCKernel {
  public:
   CCKernel(CCProgram *program,
            Kernel *kernel,
            std::string const &source,
-           std::string const &name)
-      : program(program), kernel(kernel), name(name), source(source) {
-  }
+           std::string const &name);
+  ~CCKernel();
 
+  // Starts building the shared object of this kernel in the background.
   void compile();
+  // Waits for the shared object, then runs the kernel.
   void launch(Context *ctx);
   std::string get_object() {
     return obj_path;
   }
 
  private:
+  void build();
+
   CCProgram *program;
   Kernel *kernel;
 
@@ -35,6 +43,14 @@ class CCKernel {
 
   std::string src_path;
   std::string obj_path;
+  // Each kernel is linked with the runtime into its own shared object, named
+  // after the hash of its source and the compiler commands.
+  std::string dll_path;
+  bool cached{false};
+
+  std::shared_future<void> built;
+  std::unique_ptr<DynamicLoader> dll;
+  CCFuncEntryType *entry{nullptr};
 };
 
 }  // namespace cccp
@@ -1,8 +1,19 @@
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/SHA1.h"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+
 #include "taichi/common/core.h"
+#include "taichi/program/async_engine.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/program.h"
 #include "taichi/system/dynamic_loader.h"
+#include "taichi/system/std_filesystem.h"
 #include "taichi/util/action_recorder.h"
+#include "taichi/util/metrics.h"
+#include "taichi/util/offline_cache.h"
 #include "struct_cc.h"
 #include "cc_program.h"
 #include "cc_runtime.h"
@@ -14,6 +25,87 @@
 TLANG_NAMESPACE_BEGIN
 namespace cccp {
 
+namespace {
+
+constexpr char kOpenMPFlag[] = " -fopenmp";
+
+// Whether the C compiler can build and link an OpenMP program with the given
+// commands. Probed once per pair of commands.
+bool is_openmp_supported(const std::string &compile_cmd,
+                         const std::string &link_cmd) {
+  static std::mutex mut;
+  static std::map<std::pair<std::string, std::string>, bool> results;
+  std::lock_guard<std::mutex> _(mut);
+  auto it = results.find({compile_cmd, link_cmd});
+  if (it != results.end()) {
+    return it->second;
+  }
+  const auto src_path = fmt::format("{}/_rti_openmp.c", runtime_tmp_dir);
+  const auto obj_path = fmt::format("{}/_rti_openmp.o", runtime_tmp_dir);
+  const auto dll_path = fmt::format("{}/_rti_openmp.so", runtime_tmp_dir);
+  std::ofstream(src_path) << "#include <omp.h>\n"
+                             "int Ti_openmp_probe(void) {\n"
+                             "  return omp_get_max_threads();\n"
+                             "}\n";
+  // The compiler errors are expected when OpenMP is missing.
+  const std::string quiet = " > /dev/null 2>&1";
+  const bool supported =
+      execute(compile_cmd + quiet, obj_path, src_path) == 0 &&
+      execute(link_cmd + quiet, dll_path, obj_path) == 0;
+  results[{compile_cmd, link_cmd}] = supported;
+  return supported;
+}
+
+std::string remove_flag(std::string cmd, const std::string &flag) {
+  for (auto pos = cmd.find(flag); pos != std::string::npos;
+       pos = cmd.find(flag, pos)) {
+    cmd.erase(pos, flag.size());
+  }
+  return cmd;
+}
+
+// The "--version" output of the compilers in the given commands, so that
+// upgrading the C compiler invalidates the cached kernels. Probed once per
+// pair of commands.
+std::string probe_compiler_version(const std::string &compile_cmd,
+                                   const std::string &link_cmd) {
+  static std::mutex mut;
+  static std::map<std::pair<std::string, std::string>, std::string> results;
+  std::lock_guard<std::mutex> _(mut);
+  auto it = results.find({compile_cmd, link_cmd});
+  if (it != results.end()) {
+    return it->second;
+  }
+  std::string version;
+  for (const auto &cmd : {compile_cmd, link_cmd}) {
+    const auto compiler = cmd.substr(0, cmd.find(' '));
+    auto *pipe =
+        popen(fmt::format("{} --version 2>&1", compiler).c_str(), "r");
+    if (pipe == nullptr) {
+      continue;
+    }
+    char buf[256];
+    while (std::fgets(buf, sizeof(buf), pipe) != nullptr) {
+      version += buf;
+    }
+    pclose(pipe);
+  }
+  results[{compile_cmd, link_cmd}] = version;
+  return version;
+}
+
+}  // namespace
+
+CCKernel::CCKernel(CCProgram *program,
+                   Kernel *kernel,
+                   std::string const &source,
+                   std::string const &name)
+    : program(program), kernel(kernel), name(name), source(source) {
+}
+
+CCKernel::~CCKernel() {
+}
+
 void CCKernel::compile() {
   if (!kernel->is_evaluator)
     ActionRecorder::get_instance().record(
@@ -25,11 +117,68 @@ void CCKernel::compile() {
   obj_path = fmt::format("{}/{}.o", runtime_tmp_dir, name);
   src_path = fmt::format("{}/{}.c", runtime_tmp_dir, name);
 
-  std::ofstream(src_path) << program->get_runtime()->header << "\n"
-                          << program->get_layout()->source << "\n"
-                          << source;
+  auto full_source = fmt::format("{}\n{}\n{}",
+                                 program->get_runtime()->header,
+                                 program->get_layout()->source, source);
+  auto const &config = program->program->config;
+  llvm::SHA1 hasher;
+  hasher.update(full_source);
+  hasher.update(program->get_runtime()->source);
+  hasher.update(config.cc_compile_cmd);
+  hasher.update(config.cc_link_cmd);
+  hasher.update(program->get_compiler_version());
+  dll_path = fmt::format("{}/{}.so", program->get_cache_dir(),
+                         llvm::toHex(hasher.final(), /*LowerCase=*/true));
+
+  std::promise<void> promise;
+  built = promise.get_future().share();
+  if (stdfs::exists(dll_path)) {
+    TI_DEBUG("[cc] kernel [{}] found in cache: {}", name, dll_path);
+    cached = true;
+    // Refresh the entry for the LRU eviction.
+    touch_offline_cache_entry(dll_path);
+    promise.set_value();
+    return;
+  }
+  std::ofstream(src_path) << full_source;
+  // std::function must be copyable.
+  auto shared_promise =
+      std::make_shared<std::promise<void>>(std::move(promise));
+  program->enqueue_compilation([this, shared_promise]() {
+    try {
+      build();
+      shared_promise->set_value();
+    } catch (...) {
+      shared_promise->set_exception(std::current_exception());
+    }
+  });
+}
+
+void CCKernel::build() {
+  auto const &config = program->program->config;
   TI_DEBUG("[cc] compiling [{}] -> [{}]:\n{}\n", name, obj_path, source);
-  execute(program->program->config.cc_compile_cmd, obj_path, src_path);
+  TI_ERROR_IF(execute(config.cc_compile_cmd, obj_path, src_path) != 0,
+              "[cc] failed to compile kernel [{}]: {}", name, src_path);
+
+  // Link into a temporary file first, so that other kernels or processes
+  // sharing the cache never load a partially written shared object.
+  auto tmp_path = fmt::format("{}.{}.{}.tmp", dll_path, PID::get_pid(),
+                              fmt::ptr(this));
+  TI_DEBUG("[cc] linking shared object [{}] with [{}] [{}]", dll_path,
+           program->get_runtime()->get_object(), obj_path);
+  TI_ERROR_IF(execute(config.cc_link_cmd, tmp_path,
+                      fmt::format("{}' '{}",
+                                  program->get_runtime()->get_object(),
+                                  obj_path)) != 0,
+              "[cc] failed to link kernel [{}]: {}", name, tmp_path);
+  std::error_code ec;
+  stdfs::rename(tmp_path, dll_path, ec);
+  TI_ERROR_IF(ec, "[cc] could not move [{}] to [{}]: {}", tmp_path, dll_path,
+              ec.message());
+  if (config.offline_cache) {
+    evict_offline_cache_entries(program->get_cache_dir(), ".so",
+                                config.offline_cache_max_size_of_files);
+  }
 }
 
 void CCKernel::launch(Context *ctx) {
@@ -39,10 +188,22 @@ void CCKernel::launch(Context *ctx) {
                                               ActionArg("kernel_name", name),
                                           });
 
-  program->relink();
+  if (!entry) {
+    built.get();
+    TI_DEBUG("[cc] loading shared object: {}", dll_path);
+    dll = std::make_unique<DynamicLoader>(dll_path);
+    TI_ASSERT_INFO(dll->loaded(), "[cc] could not load shared object: {}",
+                   dll_path);
+    entry = reinterpret_cast<CCFuncEntryType *>(
+        dll->load_function("Tk_" + name));
+    TI_ASSERT(entry);
+    static auto *const hits = Metrics::get_instance().counter(
+        "cc_kernel_cache_hits", "C kernels loaded from the cache");
+    static auto *const misses = Metrics::get_instance().counter(
+        "cc_kernel_cache_misses", "C kernels compiled");
+    (cached ? hits : misses)->add();
+  }
   TI_TRACE("[cc] entering kernel [{}]", name);
-  auto entry = program->load_kernel(name);
-  TI_ASSERT(entry);
   auto *context = program->update_context(ctx);
   (*entry)(context);
   program->context_to_result_buffer();
@@ -98,31 +259,6 @@ void CCRuntime::compile() {
   execute(program->program->config.cc_compile_cmd, obj_path, src_path);
 }
 
-void CCProgram::relink() {
-  if (!need_relink)
-    return;
-
-  dll_path = fmt::format("{}/libti_program.so", runtime_tmp_dir);
-
-  std::vector<std::string> objects;
-  objects.push_back(runtime->get_object());
-  for (auto const &ker : kernels) {
-    objects.push_back(ker->get_object());
-  }
-
-  TI_DEBUG("[cc] linking shared object [{}] with [{}]", dll_path,
-           fmt::join(objects, "] ["));
-  execute(program->config.cc_link_cmd, dll_path, fmt::join(objects, "' '"));
-
-  dll = nullptr;
-  TI_DEBUG("[cc] loading shared object: {}", dll_path);
-  dll = std::make_unique<DynamicLoader>(dll_path);
-  TI_ASSERT_INFO(dll->loaded(), "[cc] could not load shared object: {}",
-                 dll_path);
-
-  need_relink = false;
-}
-
 void CCProgram::compile_layout(SNode *root) {
   CCLayoutGen gen(this, root);
   layout = gen.compile();
@@ -150,7 +286,14 @@ void CCProgram::compile_layout(SNode *root) {
 
 void CCProgram::add_kernel(std::unique_ptr<CCKernel> kernel) {
   kernels.push_back(std::move(kernel));
-  need_relink = true;
+}
+
+void CCProgram::enqueue_compilation(const std::function<void()> &task) {
+  if (!compilation_workers) {
+    compilation_workers = std::make_unique<ParallelExecutor>(
+        "cc_compiler", std::max(1, program->config.num_compile_threads));
+  }
+  compilation_workers->enqueue(task);
 }
 
 void CCProgram::init_runtime() {
@@ -162,14 +305,54 @@ void CCProgram::init_runtime() {
   runtime->compile();
 }
 
-CCFuncEntryType *CCProgram::load_kernel(std::string const &name) {
-  return reinterpret_cast<CCFuncEntryType *>(dll->load_function("Tk_" + name));
-}
-
 CCProgram::CCProgram(Program *program) : program(program) {
+  // Without the offline cache, the cache is private to this process and only
+  // deduplicates identical kernels.
+  if (program->config.offline_cache) {
+    cache_dir = (program->config.offline_cache_file_path.empty()
+                     ? get_repo_dir() + "ticache"
+                     : program->config.offline_cache_file_path) +
+                "/cc";
+  } else {
+    cache_dir = fmt::format("{}/cc_cache", runtime_tmp_dir);
+  }
+  std::error_code ec;
+  stdfs::create_directories(cache_dir, ec);
+  TI_ERROR_IF(ec, "[cc] could not create the cache directory {}: {}",
+              cache_dir, ec.message());
+
+  auto &config = program->config;
+  if ((config.cc_compile_cmd.find(kOpenMPFlag) != std::string::npos ||
+       config.cc_link_cmd.find(kOpenMPFlag) != std::string::npos) &&
+      !is_openmp_supported(config.cc_compile_cmd, config.cc_link_cmd)) {
+    TI_WARN(
+        "[cc] The C compiler does not support OpenMP, range-fors will run "
+        "serially");
+    config.cc_compile_cmd = remove_flag(config.cc_compile_cmd, kOpenMPFlag);
+    config.cc_link_cmd = remove_flag(config.cc_link_cmd, kOpenMPFlag);
+  }
+  compiler_version =
+      probe_compiler_version(config.cc_compile_cmd, config.cc_link_cmd);
+
   init_runtime();
 
   context = std::make_unique<CCContext>();
+  init_rand_states();
+}
+
+void CCProgram::init_rand_states() {
+  // The random states are shared by all the kernels, so that they draw
+  // different numbers.
+  const auto &config = program->config;
+  const int num_threads = std::max(config.cpu_max_num_threads, 1);
+  rand_states_buf.resize(3 * num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    const auto seed = (uint32)(config.random_seed * 1048576 + i);
+    rand_states_buf[3 * i] = 0x330E;
+    rand_states_buf[3 * i + 1] = (uint16_t)seed;
+    rand_states_buf[3 * i + 2] = (uint16_t)(seed >> 16);
+  }
+  context->rand_states = rand_states_buf.data();
 }
 
 CCContext *CCProgram::update_context(Context *ctx) {
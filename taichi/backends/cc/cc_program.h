@@ -1,17 +1,15 @@
 #pragma once
 
 #include "taichi/lang_util.h"
+#include <functional>
 #include <vector>
 #include <memory>
 
-TI_NAMESPACE_BEGIN
-class DynamicLoader;
-TI_NAMESPACE_END
-
 TLANG_NAMESPACE_BEGIN
 
 class SNode;
 struct Context;
+class ParallelExecutor;
 
 namespace cccp {
 
@@ -29,10 +27,19 @@ class CCProgram {
   ~CCProgram();
 
   void add_kernel(std::unique_ptr<CCKernel> kernel);
-  CCFuncEntryType *load_kernel(std::string const &name);
   void compile_layout(SNode *root);
   void init_runtime();
-  void relink();
+
+  // Runs |task| on one of the compiler threads.
+  void enqueue_compilation(const std::function<void()> &task);
+  // Where the shared objects of kernels are cached, keyed on their source.
+  std::string get_cache_dir() const {
+    return cache_dir;
+  }
+  // Part of the cache key, see CCKernel::compile().
+  std::string get_compiler_version() const {
+    return compiler_version;
+  }
 
   CCLayout *get_layout() {
     return layout.get();
@@ -43,6 +50,9 @@ class CCProgram {
   }
 
   CCContext *update_context(Context *ctx);
+  // Seeds the random state of each thread, like srand48() with
+  // random_seed * 2^20 + thread number, as the LLVM backends do.
+  void init_rand_states();
   void context_to_result_buffer();
 
   Program *const program;
@@ -51,13 +61,16 @@ class CCProgram {
   std::vector<char> args_buf;
   std::vector<char> root_buf;
   std::vector<char> gtmp_buf;
+  std::vector<uint16_t> rand_states_buf;
   std::vector<std::unique_ptr<CCKernel>> kernels;
   std::unique_ptr<CCContext> context;
   std::unique_ptr<CCRuntime> runtime;
   std::unique_ptr<CCLayout> layout;
-  std::unique_ptr<DynamicLoader> dll;
-  std::string dll_path;
-  bool need_relink{true};
+  std::string cache_dir;
+  std::string compiler_version;
+  // Declared after |kernels| so that pending compilations finish before the
+  // kernels are destroyed.
+  std::unique_ptr<ParallelExecutor> compilation_workers;
 };
 
 }  // namespace cccp
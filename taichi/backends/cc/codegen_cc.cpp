@@ -47,10 +47,12 @@ class CCTransformer : public IRVisitor {
     auto ir = kernel->ir.get();
     auto config = kernel->program->config;
     config.demote_dense_struct_fors = true;
-    irpass::compile_to_executable(ir, config, kernel,
-                                  /*vectorize=*/false, kernel->grad,
-                                  /*ad_use_stack=*/true, config.print_ir,
-                                  /*lower_global_access*/ true);
+    irpass::compile_to_executable(
+        ir, config, kernel,
+        /*vectorize=*/false, kernel->grad,
+        /*ad_use_stack=*/true, config.print_ir,
+        /*lower_global_access*/ true,
+        /*make_thread_local=*/config.make_thread_local);
   }
 
   std::string get_source() {
@@ -142,6 +144,13 @@ class CCTransformer : public IRVisitor {
     emit("{} = ({}) (ti_ctx->gtmp + {});", var, ptr_type, stmt->offset);
   }
 
+  void visit(ThreadLocalPtrStmt *stmt) override {
+    auto ptr_type =
+        cc_data_type_name(stmt->element_type().ptr_removed()) + " *";
+    auto var = define_var(ptr_type, stmt->raw_name());
+    emit("{} = ({}) (Ti_tls_base + {});", var, ptr_type, stmt->offset);
+  }
+
   void visit(LinearizeStmt *stmt) override {
     std::string val = "0";
     for (int i = 0; i < stmt->inputs.size(); i++) {
@@ -381,14 +390,20 @@ class CCTransformer : public IRVisitor {
     const auto src_name = stmt->val->raw_name();
     const auto op = cc_atomic_op_type_symbol(stmt->op_type);
     const auto type = stmt->dest->element_type().ptr_removed();
-    auto var = define_var(cc_data_type_name(type), stmt->raw_name());
-    emit("{} = *{};", var, dest_ptr);
+    const auto var_name = stmt->raw_name();
+    auto var = define_var(cc_data_type_name(type), var_name);
+    emit("{} = 0;", var);
+    // Range-fors may run in parallel, see generate_range_for_kernel().
     if (stmt->op_type == AtomicOpType::max ||
         stmt->op_type == AtomicOpType::min) {
-      emit("*{} = {};", dest_ptr,
+      // OpenMP has no atomic max/min before 5.1.
+      emit("#pragma omp critical(Ti_atomic_max_min)");
+      emit("{{ {} = *{}; *{} = {}; }}", var_name, dest_ptr, dest_ptr,
            invoke_libc(op, type, "*{}, {}", dest_ptr, src_name));
     } else {
-      emit("*{} {}= {};", dest_ptr, op, src_name);
+      emit("#pragma omp atomic capture");
+      emit("{{ {} = *{}; *{} {}= {}; }}", var_name, dest_ptr, dest_ptr, op,
+           src_name);
     }
   }
 
@@ -419,39 +434,55 @@ class CCTransformer : public IRVisitor {
     stmt->body->accept(this);
   }
 
+  // Range-fors are split among threads with OpenMP, unless they are serialized
+  // (e.g. by ti.serialize()). Compilers without OpenMP support ignore the
+  // pragmas and run the loops serially.
   void generate_range_for_kernel(OffloadedStmt *stmt) {
-    if (stmt->const_begin && stmt->const_end) {
-      ScopedIndent _s(line_appender);
-      auto begin_value = stmt->begin_value;
-      auto end_value = stmt->end_value;
-      auto var = define_var("Ti_i32", stmt->raw_name());
-      emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_value,
-           stmt->raw_name(), end_value, stmt->raw_name(), 1 /* stmt->step? */);
-      stmt->body->accept(this);
-      emit("}}");
+    std::string begin_expr, end_expr;
+    if (!stmt->const_begin) {
+      begin_expr = "tmp_begin_" + stmt->raw_name();
+      emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});",
+           define_var("Ti_i32", begin_expr), stmt->begin_offset);
     } else {
-      auto var = define_var("Ti_i32", stmt->raw_name());
-      auto begin_expr = "tmp_begin_" + stmt->raw_name();
-      auto end_expr = "tmp_end_" + stmt->raw_name();
-      auto begin_var = define_var("Ti_i32", begin_expr);
-      auto end_var = define_var("Ti_i32", end_expr);
-      if (!stmt->const_begin) {
-        emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});", begin_var,
-             stmt->begin_offset);
-      } else {
-        emit("{} = {};", begin_var, stmt->begin_value);
+      begin_expr = std::to_string(stmt->begin_value);
+    }
+    if (!stmt->const_end) {
+      end_expr = "tmp_end_" + stmt->raw_name();
+      emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});",
+           define_var("Ti_i32", end_expr), stmt->end_offset);
+    } else {
+      end_expr = std::to_string(stmt->end_value);
+    }
+
+    // Already capped by cpu_max_num_threads, see irpass::offload().
+    const bool parallel = stmt->num_cpu_threads > 1;
+    if (parallel) {
+      emit("#pragma omp parallel num_threads({})", stmt->num_cpu_threads);
+    }
+    emit("{{");
+    {
+      ScopedIndent _s(line_appender);
+      if (stmt->tls_prologue) {
+        // Thread-local storage of reductions, see irpass::make_thread_local().
+        emit("Ti_i64 Ti_tls_buffer[{}];",
+             (stmt->tls_size + sizeof(int64) - 1) / sizeof(int64));
+        emit("Ti_i8 *Ti_tls_base = (Ti_i8 *) Ti_tls_buffer;");
+        stmt->tls_prologue->accept(this);
       }
-      if (!stmt->const_end) {
-        emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});", end_var,
-             stmt->end_offset);
-      } else {
-        emit("{} = {};", end_var, stmt->end_value);
+      auto var = define_var("Ti_i32", stmt->raw_name());
+      if (parallel) {
+        emit("#pragma omp for schedule(static)");
       }
       emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_expr,
-           stmt->raw_name(), end_expr, stmt->raw_name(), 1 /* stmt->step? */);
+           stmt->raw_name(), end_expr, stmt->raw_name(),
+           1 /* stmt->step? */);
       stmt->body->accept(this);
       emit("}}");
+      if (stmt->tls_epilogue) {
+        stmt->tls_epilogue->accept(this);
+      }
     }
+    emit("}}");
   }
 
   void visit(OffloadedStmt *stmt) override {
@@ -528,7 +559,8 @@ class CCTransformer : public IRVisitor {
 
   void visit(RandStmt *stmt) override {
     auto var = define_var(cc_data_type_name(stmt->ret_type), stmt->raw_name());
-    emit("{} = Ti_rand_{}();", var, data_type_name(stmt->ret_type));
+    emit("{} = Ti_rand_{}(ti_ctx->rand_states + 3 * Ti_thread_num());", var,
+         data_type_name(stmt->ret_type));
   }
 
   void visit(AdStackAllocaStmt *stmt) override {
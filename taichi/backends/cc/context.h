@@ -33,6 +33,8 @@ struct Ti_Context {
 
   union Ti_BitCast *args;
   int *earg;
+  // Three per thread, indexed by the OpenMP thread number.
+  Ti_u16 *rand_states;
 };
 )
 
@@ -52,6 +54,8 @@ struct CCContext {
 
   uint64_t *args;
   int *earg;
+  // The erand48() states of the threads, see CCProgram::init_rand_states().
+  uint16_t *rand_states;
 };
 
 };  // namespace cccp
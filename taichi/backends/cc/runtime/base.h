@@ -4,6 +4,12 @@
 "#include <stdio.h>\n"
 "#include <stdlib.h>\n"
 "#include <math.h>\n"
+"#ifdef _OPENMP\n"
+"#include <omp.h>\n"
+"#define Ti_thread_num() omp_get_thread_num()\n"
+"#else\n"
+"#define Ti_thread_num() 0\n"
+"#endif\n"
 "\n" STR(
 
 typedef char Ti_i8;
@@ -67,20 +73,23 @@ static inline Ti_f64 Ti_rsqrt(Ti_f64 x) {
 
 ) "\n" STR(
 
-static inline Ti_i32 Ti_rand_i32(void) {
-  return mrand48();  // includes negative
+/* |state| is the 48-bit state of the erand48() family of the calling thread,
+ * see Ti_Context::rand_states. */
+static inline Ti_i32 Ti_rand_i32(Ti_u16 *state) {
+  return jrand48(state);  // includes negative
 }
 
-static inline Ti_i64 Ti_rand_i64(void) {
-  return ((Ti_i64) mrand48() << 32) | mrand48();
+static inline Ti_i64 Ti_rand_i64(Ti_u16 *state) {
+  Ti_i64 high = (Ti_i64) jrand48(state) << 32;
+  return high | (Ti_u32) jrand48(state);
 }
 
-static inline Ti_f64 Ti_rand_f64(void) {
-  return drand48();  // [0.0, 1.0)
+static inline Ti_f64 Ti_rand_f64(Ti_u16 *state) {
+  return erand48(state);  // [0.0, 1.0)
 }
 
-static inline Ti_f32 Ti_rand_f32(void) {
-  return (Ti_f32) drand48();  // [0.0, 1.0)
+static inline Ti_f32 Ti_rand_f32(Ti_u16 *state) {
+  return (Ti_f32) erand48(state);  // [0.0, 1.0)
 }
 
 // Copied from Metal:
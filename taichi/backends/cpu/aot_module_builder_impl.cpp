@@ -0,0 +1,213 @@
+#include "taichi/backends/cpu/aot_module_builder_impl.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "taichi/backends/cpu/codegen_cpu.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/llvm/llvm_program.h"
+#include "taichi/system/std_filesystem.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+namespace {
+
+// The runtime functions that AotModuleLoaderImpl calls to bootstrap the
+// runtime, in addition to the offloaded tasks.
+const std::vector<std::string> kRuntimeFunctionNames = {
+    "runtime_initialize",
+    "runtime_initialize_snodes",
+    "runtime_NodeAllocator_initialize",
+    "runtime_allocate_ambient",
+    "runtime_retrieve_and_reset_error_code",
+    "LLVMRuntime_initialize_thread_pool",
+    "LLVMRuntime_set_assert_failed",
+};
+
+}  // namespace
+
+AotModuleBuilderImpl::AotModuleBuilderImpl(
+    LlvmProgramImpl *prog,
+    const std::vector<CompiledSNodeTreeData> &snode_trees)
+    : prog_(prog) {
+  ti_aot_data_.snode_trees = snode_trees;
+  ti_aot_data_.runtime.random_seed = prog->config->random_seed;
+}
+
+AotModuleBuilderImpl::~AotModuleBuilderImpl() = default;
+
+CompiledKernelData AotModuleBuilderImpl::compile_kernel(
+    const std::string &identifier,
+    Kernel *kernel) {
+  // All the kernels go to one module, so that they share a single copy of the
+  // runtime.
+  auto module_info = CodeGenCPU(kernel, nullptr).modulegen(std::move(module_));
+  module_ = std::move(module_info->module);
+
+  CompiledKernelData compiled;
+  compiled.kernel_name = identifier;
+  compiled.tasks = module_info->name_list;
+  for (auto &arg : kernel->args) {
+    CompiledArgData arg_data;
+    arg_data.dtype_name = data_type_name(arg.dt);
+    arg_data.is_external_array = arg.is_external_array;
+    compiled.args.push_back(arg_data);
+  }
+  for (auto &ret : kernel->rets) {
+    compiled.ret_dtype_names.push_back(data_type_name(ret.dt));
+  }
+  task_names_.insert(task_names_.end(), compiled.tasks.begin(),
+                     compiled.tasks.end());
+  return compiled;
+}
+
+void AotModuleBuilderImpl::emit_object_file(llvm::Module *module,
+                                            const std::string &target_cpu,
+                                            const std::string &path) const {
+  auto triple = module->getTargetTriple();
+  if (triple.empty()) {
+    triple = llvm::sys::getProcessTriple();
+  }
+  std::string err_str;
+  const llvm::Target *target =
+      llvm::TargetRegistry::lookupTarget(triple, err_str);
+  TI_ERROR_UNLESS(target, err_str);
+
+  llvm::TargetOptions options;
+  if (prog_->config->fast_math) {
+    options.AllowFPOpFusion = llvm::FPOpFusion::Fast;
+    options.UnsafeFPMath = 1;
+    options.NoInfsFPMath = 1;
+    options.NoNaNsFPMath = 1;
+  }
+  // Position-independent, so that the object can be linked into a shared
+  // library.
+  std::unique_ptr<llvm::TargetMachine> target_machine(
+      target->createTargetMachine(triple, target_cpu, "", options,
+                                  llvm::Reloc::PIC_, llvm::CodeModel::Small,
+                                  llvm::CodeGenOpt::Aggressive));
+  TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
+
+  std::error_code ec;
+  llvm::raw_fd_ostream dest(path, ec, llvm::sys::fs::OF_None);
+  TI_ERROR_IF(ec, "Could not open {}: {}", path, ec.message());
+
+  llvm::legacy::PassManager pass_manager;
+  bool fail = target_machine->addPassesToEmitFile(pass_manager, dest, nullptr,
+                                                  llvm::CGFT_ObjectFile);
+  TI_ERROR_IF(fail, "Failed to set up passes to emit the object file");
+  pass_manager.run(*module);
+  dest.flush();
+}
+
+void AotModuleBuilderImpl::dump(const std::string &output_dir,
+                                const std::string &filename) const {
+  const stdfs::path dir{output_dir};
+  const stdfs::path obj_path = dir / fmt::format("{}.o", filename);
+  const stdfs::path lib_path = dir / fmt::format("{}.so", filename);
+  auto *tlctx = prog_->get_llvm_context(host_arch());
+
+  // Cloned so that dump() leaves the builder untouched.
+  auto module =
+      module_ ? llvm::CloneModule(*module_) : tlctx->clone_struct_module();
+
+  TaichiAotData aot_data = ti_aot_data_;
+  auto get_type_size = [&](const std::string &name) -> std::size_t {
+    auto *type = module->getTypeByName("struct." + name);
+    TI_ERROR_UNLESS(type, "LLVMRuntime type {} not found.", name);
+    return tlctx->get_type_size(type);
+  };
+  aot_data.runtime.runtime_size = get_type_size("LLVMRuntime");
+  aot_data.runtime.mem_req_queue_size = get_type_size("MemRequestQueue");
+  aot_data.runtime.list_manager_size = get_type_size("ListManager");
+  aot_data.runtime.node_manager_size = get_type_size("NodeManager");
+  aot_data.runtime.rand_state_size = get_type_size("RandState");
+
+  TaichiLLVMContext::eliminate_unused_functions(
+      module.get(), [&](const std::string &func_name) {
+        return std::find(task_names_.begin(), task_names_.end(), func_name) !=
+                   task_names_.end() ||
+               std::find(kRuntimeFunctionNames.begin(),
+                         kRuntimeFunctionNames.end(),
+                         func_name) != kRuntimeFunctionNames.end();
+      });
+  tlctx->jit->global_optimize_module(module.get());
+  // The module may be deployed to other machines than this one, so it is only
+  // compiled for the host CPU on request.
+  aot_data.target_cpu = prog_->config->cpu_aot_target_cpu;
+  if (aot_data.target_cpu == "native") {
+    aot_data.target_cpu = llvm::sys::getHostCPUName().str();
+  }
+  emit_object_file(module.get(), aot_data.target_cpu, obj_path.string());
+
+  const auto &link_cmd = prog_->config->cpu_aot_link_cmd;
+  if (link_cmd.empty()) {
+    TI_INFO("CPU AOT module saved as object file {}", obj_path.string());
+  } else if (std::system(
+                 fmt::format(link_cmd, lib_path.string(), obj_path.string())
+                     .c_str())) {
+    TI_WARN("Failed to link {}. Please link object file {} manually.",
+            lib_path.string(), obj_path.string());
+  }
+
+  const stdfs::path bin_path = dir / fmt::format("{}_metadata.tcb", filename);
+  write_to_binary_file(aot_data, bin_path.string());
+  // The txt file is mostly for debugging purpose.
+  const stdfs::path txt_path = dir / fmt::format("{}_metadata.txt", filename);
+  TextSerializer ts;
+  ts("taichi aot data", aot_data);
+  ts.write_to_file(txt_path.string());
+}
+
+void AotModuleBuilderImpl::add_per_backend(const std::string &identifier,
+                                           Kernel *kernel) {
+  ti_aot_data_.kernels.push_back(compile_kernel(identifier, kernel));
+}
+
+void AotModuleBuilderImpl::add_per_backend_field(const std::string &identifier,
+                                                 bool is_scalar,
+                                                 DataType dt,
+                                                 std::vector<int> shape,
+                                                 int row_num,
+                                                 int column_num) {
+  CompiledFieldData field_data;
+  field_data.field_name = identifier;
+  field_data.is_scalar = is_scalar;
+  field_data.dtype_name = data_type_name(dt);
+  field_data.shape = shape;
+  field_data.row_num = row_num;
+  field_data.column_num = column_num;
+  ti_aot_data_.fields.push_back(field_data);
+}
+
+void AotModuleBuilderImpl::add_per_backend_tmpl(const std::string &identifier,
+                                                const std::string &key,
+                                                Kernel *kernel) {
+  auto compiled = compile_kernel(identifier, kernel);
+  for (auto &k : ti_aot_data_.tmpl_kernels) {
+    if (k.kernel_bundle_name == identifier) {
+      k.kernel_tmpl_map.insert(std::make_pair(key, compiled));
+      return;
+    }
+  }
+  CompiledKernelTmplData tmpldata;
+  tmpldata.kernel_bundle_name = identifier;
+  tmpldata.kernel_tmpl_map.insert(std::make_pair(key, compiled));
+  ti_aot_data_.tmpl_kernels.push_back(tmpldata);
+}
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
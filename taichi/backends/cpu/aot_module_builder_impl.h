@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taichi/backends/cpu/aot_utils.h"
+#include "taichi/program/aot_module_builder.h"
+#include "taichi/program/kernel.h"
+
+namespace llvm {
+class Module;
+}  // namespace llvm
+
+namespace taichi {
+namespace lang {
+
+class LlvmProgramImpl;
+
+namespace cpu {
+
+/**
+ * Compiles the kernels, together with the LLVM runtime, to a native object
+ * file and a shared library, which AotModuleLoaderImpl runs without LLVM.
+ */
+class AotModuleBuilderImpl : public AotModuleBuilder {
+ public:
+  AotModuleBuilderImpl(LlvmProgramImpl *prog,
+                       const std::vector<CompiledSNodeTreeData> &snode_trees);
+
+  ~AotModuleBuilderImpl() override;
+
+  // Writes "<filename>.o", "<filename>.so" and "<filename>_metadata.tcb" (as
+  // well as a "<filename>_metadata.txt" for debugging) to |output_dir|.
+  void dump(const std::string &output_dir,
+            const std::string &filename) const override;
+
+ protected:
+  void add_per_backend(const std::string &identifier, Kernel *kernel) override;
+  void add_per_backend_tmpl(const std::string &identifier,
+                            const std::string &key,
+                            Kernel *kernel) override;
+  void add_per_backend_field(const std::string &identifier,
+                             bool is_scalar,
+                             DataType dt,
+                             std::vector<int> shape,
+                             int row_num,
+                             int column_num) override;
+
+ private:
+  CompiledKernelData compile_kernel(const std::string &identifier,
+                                    Kernel *kernel);
+
+  // Emits the optimized |module| as a relocatable object file for
+  // |target_cpu|.
+  void emit_object_file(llvm::Module *module,
+                        const std::string &target_cpu,
+                        const std::string &path) const;
+
+  LlvmProgramImpl *prog_;
+  std::unique_ptr<llvm::Module> module_{nullptr};
+  std::vector<std::string> task_names_;
+  TaichiAotData ti_aot_data_;
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,213 @@
+#include "taichi/backends/cpu/aot_module_loader_impl.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "taichi/math/arithmetic.h"
+#include "taichi/system/std_filesystem.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+namespace {
+
+void assert_failed_host(const char *msg) {
+  TI_ERROR("Assertion failure: {}", msg);
+}
+
+std::size_t round_up_to_page(std::size_t size) {
+  return iroundup(size, taichi_page_size);
+}
+
+// An allocation of |size| bytes from the preallocated buffer, which is
+// page-aligned by the runtime.
+std::size_t page_allocation_size(std::size_t size) {
+  return round_up_to_page(size) + taichi_page_size;
+}
+
+}  // namespace
+
+AotModuleLoaderImpl::AotModuleLoaderImpl(const std::string &output_dir,
+                                         const std::string &filename,
+                                         int num_threads)
+    : result_buffer_(taichi_result_buffer_entries, 0) {
+  const stdfs::path dir{output_dir};
+  const stdfs::path bin_path = dir / fmt::format("{}_metadata.tcb", filename);
+  const stdfs::path lib_path = dir / fmt::format("{}.so", filename);
+  read_from_binary_file(aot_data_, bin_path.string());
+  dll_ = std::make_unique<DynamicLoader>(lib_path.string());
+  TI_ERROR_UNLESS(dll_->loaded(), "Failed to load {}", lib_path.string());
+
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+
+  auto load_tasks = [&](const CompiledKernelData &kernel) {
+    for (auto &task : kernel.tasks) {
+      dll_->load_function(task, tasks_[task]);
+    }
+  };
+  for (auto &kernel : aot_data_.kernels) {
+    load_tasks(kernel);
+  }
+  for (auto &k : aot_data_.tmpl_kernels) {
+    for (auto &[key, kernel] : k.kernel_tmpl_map) {
+      load_tasks(kernel);
+    }
+  }
+  dll_->load_function("runtime_retrieve_and_reset_error_code",
+                      retrieve_and_reset_error_code_);
+  std::memset(&context_, 0, sizeof(context_));
+}
+
+std::size_t AotModuleLoaderImpl::get_root_buffer_size() const {
+  std::size_t size = 0;
+  for (auto &tree : aot_data_.snode_trees) {
+    size += tree.rounded_size;
+  }
+  return size;
+}
+
+std::size_t AotModuleLoaderImpl::get_min_buffer_size() const {
+  // Mirrors the allocations of runtime_initialize() and
+  // runtime_initialize_snodes().
+  const auto &rt = aot_data_.runtime;
+  std::size_t size = get_root_buffer_size();
+  size += round_up_to_page(rt.runtime_size);
+  size += page_allocation_size(rt.mem_req_queue_size);
+  size += page_allocation_size(taichi_global_tmp_buffer_size);
+  size += page_allocation_size(rt.rand_state_size *
+                               thread_pool_->max_num_threads);
+  for (auto &tree : aot_data_.snode_trees) {
+    size += tree.num_snodes * page_allocation_size(rt.list_manager_size);
+    for (auto &allocator : tree.allocators) {
+      // A NodeManager has a free list, a recycled list and a data list.
+      size += page_allocation_size(rt.node_manager_size) +
+              3 * page_allocation_size(rt.list_manager_size) +
+              allocator.node_size + 128;
+    }
+  }
+  return size;
+}
+
+void AotModuleLoaderImpl::bind(void *buffer, std::size_t size) {
+  TI_ERROR_IF(runtime_ != nullptr, "The AOT module is already bound");
+  TI_ERROR_IF((uint64)buffer % taichi_page_size != 0,
+              "The buffer must be aligned to {} bytes", taichi_page_size);
+  TI_ERROR_IF(size < get_min_buffer_size(),
+              "The buffer needs at least {} bytes, but only has {} bytes",
+              get_min_buffer_size(), size);
+  buffer_ = (char *)buffer;
+
+  const std::size_t root_buffer_size = get_root_buffer_size();
+  char *runtime_buffer = buffer_ + root_buffer_size;
+  const std::size_t runtime_buffer_size = size - root_buffer_size;
+  // The runtime expects zero-filled memory, as if it were fresh from the OS.
+  std::memset(runtime_buffer, 0, runtime_buffer_size);
+
+  // A non-zero preallocated size makes the runtime allocate everything from
+  // |runtime_buffer|, so that neither the memory pool nor the virtual memory
+  // allocator is needed.
+  const int num_threads = thread_pool_->max_num_threads;
+  const int starting_rand_state = aot_data_.runtime.random_seed * 1048576;
+  void (*runtime_initialize)(uint64 *, void *, std::size_t, void *, int32,
+                             int32, void *, void *, void *);
+  dll_->load_function("runtime_initialize", runtime_initialize);
+  runtime_initialize(result_buffer_.data(), nullptr, runtime_buffer_size,
+                     runtime_buffer, starting_rand_state, num_threads, nullptr,
+                     (void *)std::printf, (void *)std::vsnprintf);
+  runtime_ = taichi_union_cast_with_different_sizes<void *>(
+      result_buffer_[taichi_result_buffer_ret_value_id]);
+  context_.runtime = (LLVMRuntime *)runtime_;
+
+  void (*initialize_thread_pool)(void *, void *, void *, int32);
+  dll_->load_function("LLVMRuntime_initialize_thread_pool",
+                      initialize_thread_pool);
+  initialize_thread_pool(runtime_, thread_pool_.get(),
+                         (void *)ThreadPool::static_run, num_threads);
+  void (*set_assert_failed)(void *, void *);
+  dll_->load_function("LLVMRuntime_set_assert_failed", set_assert_failed);
+  set_assert_failed(runtime_, (void *)assert_failed_host);
+
+  void (*initialize_snodes)(void *, std::size_t, int32, int32, int32,
+                            std::size_t, void *);
+  dll_->load_function("runtime_initialize_snodes", initialize_snodes);
+  void (*initialize_allocator)(void *, int32, std::size_t);
+  dll_->load_function("runtime_NodeAllocator_initialize",
+                      initialize_allocator);
+  void (*allocate_ambient)(void *, int32, std::size_t);
+  dll_->load_function("runtime_allocate_ambient", allocate_ambient);
+  std::size_t offset = 0;
+  for (auto &tree : aot_data_.snode_trees) {
+    if (tree.tree_id >= (int)root_offsets_.size()) {
+      root_offsets_.resize(tree.tree_id + 1, 0);
+    }
+    root_offsets_[tree.tree_id] = offset;
+    initialize_snodes(runtime_, tree.root_size, tree.root_id, tree.num_snodes,
+                      tree.tree_id, tree.rounded_size, buffer_ + offset);
+    for (auto &allocator : tree.allocators) {
+      initialize_allocator(runtime_, allocator.snode_id, allocator.node_size);
+      allocate_ambient(runtime_, allocator.ambient_id, allocator.node_size);
+    }
+    offset += tree.rounded_size;
+  }
+}
+
+void *AotModuleLoaderImpl::get_snode_tree_root(int tree_id) const {
+  TI_ASSERT(buffer_ != nullptr);
+  TI_ASSERT(tree_id < (int)root_offsets_.size());
+  return buffer_ + root_offsets_[tree_id];
+}
+
+void AotModuleLoaderImpl::set_arg_external_array(
+    int i,
+    void *ptr,
+    const std::vector<int> &shape) {
+  TI_ASSERT(shape.size() <= taichi_max_num_indices);
+  set_arg<void *>(i, ptr);
+  for (int j = 0; j < (int)shape.size(); j++) {
+    context_.extra_args[i][j] = shape[j];
+  }
+}
+
+void AotModuleLoaderImpl::launch(const std::string &name) {
+  for (auto &kernel : aot_data_.kernels) {
+    if (kernel.kernel_name == name) {
+      launch_kernel(kernel);
+      return;
+    }
+  }
+  TI_ERROR("Kernel {} not found in the AOT module", name);
+}
+
+void AotModuleLoaderImpl::launch_template(const std::string &name,
+                                          const std::string &key) {
+  for (auto &k : aot_data_.tmpl_kernels) {
+    if (k.kernel_bundle_name == name) {
+      auto it = k.kernel_tmpl_map.find(key);
+      TI_ERROR_IF(it == k.kernel_tmpl_map.end(),
+                  "Kernel template {} has no instance {}", name, key);
+      launch_kernel(it->second);
+      return;
+    }
+  }
+  TI_ERROR("Kernel template {} not found in the AOT module", name);
+}
+
+void AotModuleLoaderImpl::launch_kernel(const CompiledKernelData &kernel) {
+  TI_ERROR_IF(runtime_ == nullptr, "Please bind() a buffer before launching");
+  context_.cpu_thread_id = 0;
+  for (auto &task : kernel.tasks) {
+    tasks_.at(task)(&context_);
+  }
+  retrieve_and_reset_error_code_(runtime_);
+  TI_ERROR_IF(result_buffer_[taichi_result_buffer_error_id] != 0,
+              "Assertion failure in kernel {}", kernel.kernel_name);
+}
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/backends/cpu/aot_utils.h"
+#include "taichi/system/dynamic_loader.h"
+#include "taichi/system/threading.h"
+#define TI_RUNTIME_HOST
+#include "taichi/program/context.h"
+#undef TI_RUNTIME_HOST
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+/**
+ * Runs the kernels of a module saved by AotModuleBuilderImpl, with neither
+ * LLVM nor a Program.
+ *
+ * Example:
+ *   AotModuleLoaderImpl loader(dir, "module");
+ *   // Page-aligned, and zero-filled for fresh SNode trees.
+ *   loader.bind(buffer, size);
+ *   loader.set_arg<int32>(0, 42);
+ *   loader.launch("foo");
+ */
+class AotModuleLoaderImpl {
+ public:
+  // Loads "<filename>.so" and "<filename>_metadata.tcb" from |output_dir|.
+  // The kernels run on |num_threads| threads, all threads if it is zero.
+  AotModuleLoaderImpl(const std::string &output_dir,
+                      const std::string &filename,
+                      int num_threads = 0);
+
+  // The bytes at the beginning of the buffer taken by the SNode trees.
+  std::size_t get_root_buffer_size() const;
+
+  // The smallest buffer that bind() accepts. The SNodes other than dense
+  // ones allocate their nodes from the rest of the buffer.
+  std::size_t get_min_buffer_size() const;
+
+  // Initializes the runtime and the SNode trees in |buffer|, which must be
+  // page-aligned. The SNode trees are placed at the beginning of |buffer| and
+  // keep their contents, while the rest of it is cleared for the runtime.
+  void bind(void *buffer, std::size_t size);
+
+  // The root of SNode tree |tree_id| in the bound buffer.
+  void *get_snode_tree_root(int tree_id) const;
+
+  template <typename T>
+  void set_arg(int i, T v) {
+    context_.set_arg<T>(i, v);
+  }
+
+  void set_arg_external_array(int i,
+                              void *ptr,
+                              const std::vector<int> &shape);
+
+  void launch(const std::string &name);
+
+  void launch_template(const std::string &name, const std::string &key);
+
+  // The return value of the last kernel launched.
+  template <typename T>
+  T get_ret() const {
+    return taichi_union_cast_with_different_sizes<T>(
+        result_buffer_[taichi_result_buffer_ret_value_id]);
+  }
+
+  const TaichiAotData &get_aot_data() const {
+    return aot_data_;
+  }
+
+ private:
+  using TaskFunc = int32 (*)(void *);
+
+  void launch_kernel(const CompiledKernelData &kernel);
+
+  TaichiAotData aot_data_;
+  std::unique_ptr<DynamicLoader> dll_{nullptr};
+  // The offloaded tasks by symbol.
+  std::unordered_map<std::string, TaskFunc> tasks_;
+  void (*retrieve_and_reset_error_code_)(void *){nullptr};
+  std::unique_ptr<ThreadPool> thread_pool_{nullptr};
+  std::vector<uint64> result_buffer_;
+  void *runtime_{nullptr};
+  Context context_;
+  // The offsets of the SNode trees in the bound buffer.
+  std::vector<std::size_t> root_offsets_;
+  char *buffer_{nullptr};
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
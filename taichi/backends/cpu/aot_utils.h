@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/common/serialization.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+/**
+ * The NodeManager of a pointer, hash or dynamic SNode, see
+ * LlvmProgramImpl::initialize_llvm_runtime_snodes().
+ */
+struct CompiledAllocatorData {
+  int snode_id{0};
+  // The index passed to runtime_allocate_ambient().
+  int ambient_id{0};
+  std::size_t node_size{0};
+
+  TI_IO_DEF(snode_id, ambient_id, node_size);
+};
+
+struct CompiledSNodeTreeData {
+  int tree_id{0};
+  int root_id{0};
+  int num_snodes{0};
+  std::size_t root_size{0};
+  // |root_size| rounded up to the page size. This is what the tree occupies
+  // in the root buffer.
+  std::size_t rounded_size{0};
+  std::vector<CompiledAllocatorData> allocators;
+
+  TI_IO_DEF(tree_id, root_id, num_snodes, root_size, rounded_size, allocators);
+};
+
+struct CompiledArgData {
+  std::string dtype_name;
+  bool is_external_array{false};
+
+  TI_IO_DEF(dtype_name, is_external_array);
+};
+
+struct CompiledKernelData {
+  std::string kernel_name;
+  // The symbols of the offloaded tasks, in launch order.
+  std::vector<std::string> tasks;
+  std::vector<CompiledArgData> args;
+  std::vector<std::string> ret_dtype_names;
+
+  TI_IO_DEF(kernel_name, tasks, args, ret_dtype_names);
+};
+
+struct CompiledKernelTmplData {
+  std::string kernel_bundle_name;
+  std::unordered_map<std::string, CompiledKernelData> kernel_tmpl_map;
+
+  TI_IO_DEF(kernel_bundle_name, kernel_tmpl_map);
+};
+
+struct CompiledFieldData {
+  std::string field_name;
+  std::string dtype_name;
+  std::vector<int> shape;
+  bool is_scalar{false};
+  int row_num{0};
+  int column_num{0};
+
+  TI_IO_DEF(field_name, dtype_name, shape, is_scalar, row_num, column_num);
+};
+
+/**
+ * Sizes of the LLVM runtime structs, with which the loader estimates the
+ * memory that the runtime takes from the preallocated buffer.
+ */
+struct CompiledRuntimeData {
+  std::size_t runtime_size{0};
+  std::size_t mem_req_queue_size{0};
+  std::size_t list_manager_size{0};
+  std::size_t node_manager_size{0};
+  std::size_t rand_state_size{0};
+  int random_seed{0};
+
+  TI_IO_DEF(runtime_size,
+            mem_req_queue_size,
+            list_manager_size,
+            node_manager_size,
+            rand_state_size,
+            random_seed);
+};
+
+/**
+ * AOT module data for the CPU backend. The kernels and the LLVM runtime are
+ * compiled to "<filename>.so", and this is saved to
+ * "<filename>_metadata.tcb".
+ */
+struct TaichiAotData {
+  CompiledRuntimeData runtime;
+  std::vector<CompiledSNodeTreeData> snode_trees;
+  std::vector<CompiledKernelData> kernels;
+  std::vector<CompiledKernelTmplData> tmpl_kernels;
+  std::vector<CompiledFieldData> fields;
+  // The LLVM CPU name the object file was compiled for, see
+  // CompileConfig::cpu_aot_target_cpu.
+  std::string target_cpu;
+
+  TI_IO_DEF(runtime, snode_trees, kernels, tmpl_kernels, fields, target_cpu);
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
@@ -7,7 +7,7 @@
 #include "taichi/program/program.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -15,10 +15,64 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
  public:
   using IRVisitor::visit;
 
-  CodeGenLLVMCPU(Kernel *kernel, IRNode *ir) : CodeGenLLVM(kernel, ir) {
+  CodeGenLLVMCPU(Kernel *kernel,
+                 IRNode *ir,
+                 std::unique_ptr<llvm::Module> &&module = nullptr)
+      : CodeGenLLVM(kernel, ir, std::move(module)) {
     TI_AUTO_PROF
   }
 
+  // Generates the loop of a block function of the range-for |stmt|, see
+  // create_offload_range_for().
+  void create_block_loop(OffloadedStmt *stmt) {
+    using namespace llvm;
+    BasicBlock *loop_test =
+        BasicBlock::Create(*llvm_context, "block_loop_test", func);
+    BasicBlock *body =
+        BasicBlock::Create(*llvm_context, "block_loop_body", func);
+    BasicBlock *loop_inc =
+        BasicBlock::Create(*llvm_context, "block_loop_inc", func);
+    BasicBlock *after_loop =
+        BasicBlock::Create(*llvm_context, "after_block_loop", func);
+
+    auto begin = get_arg(2);
+    auto end = get_arg(3);
+    auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+    loop_vars_llvm[stmt].push_back(loop_var);
+    if (!stmt->reversed) {
+      builder->CreateStore(begin, loop_var);
+    } else {
+      builder->CreateStore(builder->CreateSub(end, tlctx->get_constant(1)),
+                           loop_var);
+    }
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(loop_test);
+    llvm::Value *cond;
+    if (!stmt->reversed) {
+      cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
+                                 builder->CreateLoad(loop_var), end);
+    } else {
+      cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SGE,
+                                 builder->CreateLoad(loop_var), begin);
+    }
+    builder->CreateCondBr(cond, body, after_loop);
+
+    builder->SetInsertPoint(body);
+    // A top-level continue goes on with the next iteration instead of
+    // returning from the function.
+    offloaded_loop_reentry = loop_inc;
+    stmt->body->accept(this);
+    offloaded_loop_reentry = nullptr;
+    builder->CreateBr(loop_inc);
+
+    builder->SetInsertPoint(loop_inc);
+    create_increment(loop_var, tlctx->get_constant(stmt->reversed ? -1 : 1));
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(after_loop);
+  }
+
   void create_offload_range_for(OffloadedStmt *stmt) override {
     int step = 1;
 
@@ -31,34 +85,61 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
 
     auto *tls_prologue = create_xlogue(stmt->tls_prologue);
 
-    // The loop body
+    // The loop body, or with |cpu_block_range_for| the whole loop over a block
+    // of iterations [arg 2, arg 3), which LLVM can then vectorize and unroll.
+    const bool block_function = prog->config.cpu_block_range_for;
     llvm::Function *body;
     {
-      auto guard = get_function_creation_guard(
-          {llvm::PointerType::get(get_runtime_type("Context"), 0),
-           llvm::Type::getInt8PtrTy(*llvm_context),
-           tlctx->get_data_type<int>()});
-
-      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
-      loop_vars_llvm[stmt].push_back(loop_var);
-      builder->CreateStore(get_arg(2), loop_var);
-      stmt->body->accept(this);
+      std::vector<llvm::Type *> arg_types = {
+          llvm::PointerType::get(get_runtime_type("Context"), 0),
+          llvm::Type::getInt8PtrTy(*llvm_context),
+          tlctx->get_data_type<int>()};
+      if (block_function) {
+        arg_types.push_back(tlctx->get_data_type<int>());
+      }
+      auto guard = get_function_creation_guard(arg_types);
+
+      if (block_function) {
+        create_block_loop(stmt);
+      } else {
+        auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+        loop_vars_llvm[stmt].push_back(loop_var);
+        builder->CreateStore(get_arg(2), loop_var);
+        stmt->body->accept(this);
+      }
 
       body = guard.body;
     }
 
     llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
 
+    // With an adaptive block size, cpu_parallel_range_for keeps the cost of
+    // the items measured across launches in this global.
+    llvm::Value *schedule_state = llvm::ConstantPointerNull::get(
+        llvm::Type::getInt8PtrTy(*llvm_context));
+    if (stmt->block_dim == 0) {
+      auto *state_type = llvm::Type::getDoubleTy(*llvm_context);
+      auto *state = new llvm::GlobalVariable(
+          *module, state_type, false, llvm::GlobalValue::InternalLinkage,
+          llvm::ConstantFP::get(state_type, 0.0), "range_for_schedule");
+      schedule_state = builder->CreateBitCast(
+          state, llvm::Type::getInt8PtrTy(*llvm_context));
+    }
+
     auto [begin, end] = get_range_for_bounds(stmt);
     create_call(
-        "cpu_parallel_range_for",
+        block_function ? "cpu_parallel_range_for_blocks"
+                       : "cpu_parallel_range_for",
         {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin, end,
          tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
-         tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size)});
+         tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size),
+         schedule_state});
   }
 
   void visit(OffloadedStmt *stmt) override {
-    stat.add("codegen_offloaded_tasks");
+    static auto *const offloaded_tasks = Metrics::get_instance().counter(
+        "codegen_offloaded_tasks", "Offloaded tasks compiled");
+    offloaded_tasks->add();
     TI_ASSERT(current_offload == nullptr);
     current_offload = stmt;
     using Type = OffloadedStmt::TaskType;
@@ -125,4 +206,17 @@ FunctionType CodeGenCPU::codegen() {
   return CodeGenLLVMCPU(kernel, ir).gen();
 }
 
+std::unique_ptr<ModuleGenValue> CodeGenCPU::modulegen(
+    std::unique_ptr<llvm::Module> &&module) {
+  TI_AUTO_PROF
+  CodeGenLLVMCPU gen(kernel, ir, std::move(module));
+  gen.emit_to_module();
+
+  std::vector<std::string> name_list;
+  for (auto &task : gen.offloaded_tasks) {
+    name_list.push_back(task.name);
+  }
+  return std::make_unique<ModuleGenValue>(std::move(gen.module), name_list);
+}
+
 TLANG_NAMESPACE_END
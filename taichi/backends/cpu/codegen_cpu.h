@@ -12,6 +12,11 @@ class CodeGenCPU : public KernelCodeGen {
   }
 
   virtual FunctionType codegen() override;
+
+  // Emits the offloaded tasks of the kernel to |module|, or to a clone of the
+  // struct module if it is null. The task functions are the ones to export.
+  std::unique_ptr<ModuleGenValue> modulegen(
+      std::unique_ptr<llvm::Module> &&module);  // AOT Module Gen
 };
 
 TLANG_NAMESPACE_END
@@ -33,6 +33,7 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/IPO.h"
 
+#include "taichi/backends/cpu/offline_cache_cpu.h"
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
 #include "taichi/jit/jit_session.h"
@@ -87,6 +88,8 @@ class JITSessionCPU : public JITSession {
  private:
   ExecutionSession ES;
   RTDyldObjectLinkingLayer object_layer;
+  // Must be declared before |compile_layer|, whose compiler writes to it.
+  std::unique_ptr<OfflineCacheCPU> offline_cache;
   IRCompileLayer compile_layer;
   DataLayout DL;
   MangleAndInterner Mangle;
@@ -103,9 +106,12 @@ class JITSessionCPU : public JITSession {
                        memory_manager = smgr.get();
                        return smgr;
                      }),
+        offline_cache(std::make_unique<OfflineCacheCPU>()),
         compile_layer(ES,
                       object_layer,
-                      std::make_unique<ConcurrentIRCompiler>(JTMB)),
+                      std::make_unique<ConcurrentIRCompiler>(
+                          JTMB,
+                          offline_cache.get())),
         DL(DL),
         Mangle(ES, this->DL),
         module_counter(0),
@@ -133,18 +139,35 @@ class JITSessionCPU : public JITSession {
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override {
     TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
     TI_ASSERT(M);
-    global_optimize_module_cpu(M.get());
+    auto &prog = get_current_program();
+    std::unique_ptr<llvm::MemoryBuffer> cached_object;
+    if (prog.config.offline_cache) {
+      offline_cache->configure(prog.config.offline_cache_file_path,
+                               prog.config.offline_cache_max_size_of_files);
+      auto key = offline_cache->make_key(M.get(), prog.config, &prog);
+      cached_object = offline_cache->load(key);
+      if (!cached_object) {
+        OfflineCacheCPU::mark_module_for_caching(M.get(), key);
+      }
+    }
+    if (!cached_object) {
+      global_optimize_module_cpu(M.get());
+    }
     std::lock_guard<std::mutex> _(mut);
     auto &dylib = ES.createJITDylib(fmt::format("{}", module_counter));
     dylib.addGenerator(
         cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
             DL.getGlobalPrefix())));
-    auto *thread_safe_context = get_current_program()
-                                    .get_llvm_program_impl()
-                                    ->get_llvm_context(host_arch())
-                                    ->get_this_thread_thread_safe_context();
-    cantFail(compile_layer.add(dylib, llvm::orc::ThreadSafeModule(
-                                          std::move(M), *thread_safe_context)));
+    if (cached_object) {
+      cantFail(object_layer.add(dylib, std::move(cached_object)));
+    } else {
+      auto *thread_safe_context = prog.get_llvm_program_impl()
+                                      ->get_llvm_context(host_arch())
+                                      ->get_this_thread_thread_safe_context();
+      cantFail(compile_layer.add(
+          dylib,
+          llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
+    }
     all_libs.push_back(&dylib);
     auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
     auto new_module_raw_ptr = new_module.get();
@@ -154,11 +177,17 @@ class JITSessionCPU : public JITSession {
   }
 
   void *lookup(const std::string Name) override {
-    std::lock_guard<std::mutex> _(mut);
+    std::vector<llvm::orc::JITDylib *> libs;
+    {
+      std::lock_guard<std::mutex> _(mut);
+      libs = all_libs;
+    }
+    // The lookup materializes (i.e. compiles) the module, so it must not hold
+    // |mut| for modules to be compiled concurrently.
 #ifdef __APPLE__
-    auto symbol = ES.lookup(all_libs, Mangle(Name));
+    auto symbol = ES.lookup(libs, Mangle(Name));
 #else
-    auto symbol = ES.lookup(all_libs, ES.intern(Name));
+    auto symbol = ES.lookup(libs, ES.intern(Name));
 #endif
     if (!symbol)
       TI_ERROR("Function \"{}\" not found", Name);
@@ -166,7 +195,7 @@ class JITSessionCPU : public JITSession {
   }
 
   void *lookup_in_module(JITDylib *lib, const std::string Name) {
-    std::lock_guard<std::mutex> _(mut);
+    // ExecutionSession is thread-safe, see lookup().
 #ifdef __APPLE__
     auto symbol = ES.lookup({lib}, Mangle(Name));
 #else
@@ -0,0 +1,151 @@
+#include "taichi/backends/cpu/offline_cache_cpu.h"
+
+#include <fstream>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "taichi/ir/snode.h"
+#include "taichi/program/compile_config.h"
+#include "taichi/program/program.h"
+#include "taichi/system/std_filesystem.h"
+#include "taichi/util/metrics.h"
+#include "taichi/util/offline_cache.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr char kModuleIdPrefix[] = "ticache:";
+constexpr char kEntryExtension[] = ".o";
+
+void append_snode_layout(const SNode *snode, std::string &signature) {
+  signature += fmt::format("({} {} {} {} {} {} {} {}", snode->id,
+                           snode_type_name(snode->type), snode->n,
+                           snode->num_active_indices, snode->cell_size_bytes,
+                           snode->chunk_size, (int)snode->_morton,
+                           snode->dt ? snode->dt.to_string() : "");
+  for (int i = 0; i < taichi_max_num_indices; i++) {
+    auto &extractor = snode->extractors[i];
+    signature += fmt::format(" {}:{}:{}", extractor.shape, extractor.num_bits,
+                             extractor.acc_offset);
+  }
+  for (auto &ch : snode->ch) {
+    append_snode_layout(ch.get(), signature);
+  }
+  signature += ")";
+}
+
+}  // namespace
+
+void OfflineCacheCPU::configure(const std::string &path,
+                                std::size_t max_size_of_files) {
+  std::lock_guard<std::mutex> _(mut_);
+  path_ = (path.empty() ? get_repo_dir() + "ticache" : path) + "/llvm";
+  max_size_of_files_ = max_size_of_files;
+}
+
+std::string OfflineCacheCPU::make_key(llvm::Module *module,
+                                      const CompileConfig &config,
+                                      Program *prog) {
+  std::string ir;
+  llvm::raw_string_ostream ir_stream(ir);
+  module->print(ir_stream, nullptr);
+  ir_stream.flush();
+
+  std::string layout;
+  for (int i = 0; i < prog->get_snode_tree_size(); i++) {
+    append_snode_layout(prog->get_snode_root(i), layout);
+  }
+
+  // Options that affect the object code but are not visible in the IR. See
+  // JITSessionCPU::global_optimize_module_cpu.
+  auto options =
+      fmt::format("arch={} fast_math={} cpu={} llvm={} taichi={}",
+                  arch_name(config.arch), config.fast_math,
+                  llvm::sys::getHostCPUName().str(), LLVM_VERSION_STRING,
+                  get_commit_hash());
+
+  llvm::SHA1 hasher;
+  hasher.update(ir);
+  hasher.update(layout);
+  hasher.update(options);
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> OfflineCacheCPU::load(
+    const std::string &key) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto entry_path = get_entry_path(key);
+  static auto *const misses = Metrics::get_instance().counter(
+      "offline_cache_misses", "Kernels not found in the offline cache");
+  static auto *const hits = Metrics::get_instance().counter(
+      "offline_cache_hits", "Kernels loaded from the offline cache");
+  auto buffer = llvm::MemoryBuffer::getFile(entry_path);
+  if (!buffer) {
+    misses->add();
+    return nullptr;
+  }
+  // Refresh the entry for the LRU eviction.
+  touch_offline_cache_entry(entry_path);
+  hits->add();
+  TI_TRACE("Loaded object code from the offline cache: {}", entry_path);
+  return std::move(*buffer);
+}
+
+void OfflineCacheCPU::mark_module_for_caching(llvm::Module *module,
+                                              const std::string &key) {
+  module->setModuleIdentifier(kModuleIdPrefix + key);
+}
+
+void OfflineCacheCPU::notifyObjectCompiled(const llvm::Module *module,
+                                           llvm::MemoryBufferRef obj) {
+  llvm::StringRef module_id = module->getModuleIdentifier();
+  if (!module_id.startswith(kModuleIdPrefix)) {
+    return;
+  }
+  auto key = module_id.drop_front(sizeof(kModuleIdPrefix) - 1).str();
+
+  std::lock_guard<std::mutex> _(mut_);
+  std::error_code ec;
+  stdfs::create_directories(path_, ec);
+  if (ec) {
+    TI_WARN("Failed to create the offline cache directory {}: {}", path_,
+            ec.message());
+    return;
+  }
+  // Write to a temporary file first, so that other processes never see a
+  // partially written entry.
+  auto entry_path = get_entry_path(key);
+  auto tmp_path = fmt::format("{}.{}.tmp", entry_path, PID::get_pid());
+  {
+    std::ofstream os(tmp_path, std::ios::binary);
+    os.write(obj.getBufferStart(), obj.getBufferSize());
+    if (!os) {
+      TI_WARN("Failed to write the offline cache entry {}", tmp_path);
+      return;
+    }
+  }
+  stdfs::rename(tmp_path, entry_path, ec);
+  if (ec) {
+    stdfs::remove(tmp_path, ec);
+    return;
+  }
+  TI_TRACE("Stored object code to the offline cache: {}", entry_path);
+  evict();
+}
+
+std::string OfflineCacheCPU::get_entry_path(const std::string &key) const {
+  return (stdfs::path(path_) / (key + kEntryExtension)).string();
+}
+
+void OfflineCacheCPU::evict() {
+  evict_offline_cache_entries(path_, kEntryExtension, max_size_of_files_);
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+struct CompileConfig;
+class Program;
+
+// An on-disk cache of the object code JIT-compiled by JITSessionCPU, shared
+// across processes.
+//
+// A module is keyed by a hash of its (unoptimized) LLVM IR, the compile
+// options that are not reflected in the IR (e.g. fast_math and the host CPU),
+// the layout of all SNode trees, and the LLVM and Taichi versions. On a hit,
+// the cached object file is added straight to the object linking layer,
+// skipping both the LLVM optimization passes and the machine code generation.
+//
+// Each entry is a "<key>.o" file under the cache directory. Whenever a new
+// entry makes the total size of the files exceed the limit, the least recently
+// used entries are removed.
+class OfflineCacheCPU : public llvm::ObjectCache {
+ public:
+  OfflineCacheCPU() = default;
+
+  // Sets the cache directory and the size limit. The entries live in the
+  // "llvm" subdirectory of |path|, or of get_repo_dir() + "ticache" if empty.
+  void configure(const std::string &path, std::size_t max_size_of_files);
+
+  std::string make_key(llvm::Module *module,
+                       const CompileConfig &config,
+                       Program *prog);
+
+  // Returns the cached object code of |key|, or nullptr on a miss.
+  std::unique_ptr<llvm::MemoryBuffer> load(const std::string &key);
+
+  // Makes the object code of |module| be stored under |key| once compiled.
+  static void mark_module_for_caching(llvm::Module *module,
+                                      const std::string &key);
+
+  // llvm::ObjectCache interface, invoked by the IR compiler of JITSessionCPU.
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef obj) override;
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(
+      const llvm::Module *module) override {
+    // Hits are handled by load() before the module reaches the compiler.
+    return nullptr;
+  }
+
+ private:
+  std::string get_entry_path(const std::string &key) const;
+
+  // Removes the least recently used entries until the files fit in the size
+  // limit.
+  void evict();
+
+  std::mutex mut_;
+  std::string path_;
+  std::size_t max_size_of_files_{0};
+};
+
+TLANG_NAMESPACE_END
@@ -5,7 +5,7 @@
 
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/program/program.h"
@@ -425,6 +425,11 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
     }
     {
       init_offloaded_task_function(stmt, "reinit_lists");
+      if (stmt->snode->type == SNodeType::hash) {
+        // Compacting the hash table is serial, so it runs in this single
+        // thread task.
+        emit_hash_gc(stmt->snode);
+      }
       call("gc_parallel_1", get_context(), snode_id);
       finalize_offloaded_task_function();
       current_task->grid_dim = 1;
@@ -517,7 +522,9 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
   }
 
   void visit(OffloadedStmt *stmt) override {
-    stat.add("codegen_offloaded_tasks");
+    static auto *const offloaded_tasks = Metrics::get_instance().counter(
+        "codegen_offloaded_tasks", "Offloaded tasks compiled");
+    offloaded_tasks->add();
     if (stmt->bls_size > 0)
       create_bls_buffer(stmt);
 #if defined(TI_WITH_CUDA)
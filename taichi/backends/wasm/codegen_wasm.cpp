@@ -7,7 +7,7 @@
 #include "taichi/program/program.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/file_sequence_writer.h"
 
 namespace taichi {
@@ -174,7 +174,9 @@ class CodeGenLLVMWASM : public CodeGenLLVM {
   FunctionType gen() override {
     TI_AUTO_PROF
     // emit_to_module
-    stat.add("codegen_taichi_kernel_function");
+    static auto *const kernel_functions = Metrics::get_instance().counter(
+        "codegen_taichi_kernel_function", "Taichi kernel functions compiled");
+    kernel_functions->add();
     auto offloaded_task_name = init_taichi_kernel_function();
     ir->accept(this);
     finalize_taichi_kernel_function();
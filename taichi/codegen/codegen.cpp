@@ -2,7 +2,7 @@
 
 #include "codegen.h"
 
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 #include "taichi/backends/cpu/codegen_cpu.h"
 #include "taichi/backends/wasm/codegen_wasm.h"
 #if defined(TI_WITH_CUDA)
@@ -18,14 +18,23 @@ KernelCodeGen::KernelCodeGen(Kernel *kernel, IRNode *ir)
   if (ir == nullptr)
     this->ir = kernel->ir.get();
 
+  auto &metrics = Metrics::get_instance();
+  static auto *const evaluator_statements = metrics.counter(
+      "codegen_evaluator_statements", "Statements compiled in evaluators");
+  static auto *const accessor_statements = metrics.counter(
+      "codegen_accessor_statements", "Statements compiled in accessors");
+  static auto *const kernel_statements = metrics.counter(
+      "codegen_kernel_statements", "Statements compiled in kernels");
+  static auto *const statements =
+      metrics.counter("codegen_statements", "Statements compiled");
   auto num_stmts = irpass::analysis::count_statements(this->ir);
   if (kernel->is_evaluator)
-    stat.add("codegen_evaluator_statements", num_stmts);
+    evaluator_statements->add(num_stmts);
   else if (kernel->is_accessor)
-    stat.add("codegen_accessor_statements", num_stmts);
+    accessor_statements->add(num_stmts);
   else
-    stat.add("codegen_kernel_statements", num_stmts);
-  stat.add("codegen_statements", num_stmts);
+    kernel_statements->add(num_stmts);
+  statements->add(num_stmts);
 }
 
 FunctionType KernelCodeGen::compile() {
@@ -4,8 +4,22 @@
 
 #include "taichi/program/program.h"
 
+#include "llvm/IR/Module.h"
+
 TLANG_NAMESPACE_BEGIN
 
+// The LLVM module generated for AOT compilation, and the names of the
+// functions in it to be exported.
+class ModuleGenValue {
+ public:
+  ModuleGenValue(std::unique_ptr<llvm::Module> module,
+                 const std::vector<std::string> &name_list)
+      : module(std::move(module)), name_list(name_list) {
+  }
+  std::unique_ptr<llvm::Module> module;
+  std::vector<std::string> name_list;
+};
+
 class KernelCodeGen {
  protected:
   Program *prog;
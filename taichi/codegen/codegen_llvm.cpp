@@ -120,7 +120,7 @@ CodeGenStmtGuard make_while_after_loop_guard(CodeGenLLVM *cg) {
 
 // CodeGenLLVM
 
-uint64 CodeGenLLVM::task_counter = 0;
+std::atomic<uint64> CodeGenLLVM::task_counter{0};
 
 void CodeGenLLVM::visit(Block *stmt_list) {
   for (auto &stmt : stmt_list->statements) {
@@ -218,6 +218,15 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
   } else if (snode->type == SNodeType::pointer) {
     meta = std::make_unique<RuntimeObject>("PointerMeta", this, builder.get());
     emit_struct_meta_base("Pointer", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_capacity",
+               tlctx->get_constant(
+                   StructCompilerLLVM::get_hash_table_capacity(snode)));
+    meta->call("set_num_levels",
+               tlctx->get_constant(
+                   StructCompilerLLVM::get_hash_table_num_levels(snode)));
   } else if (snode->type == SNodeType::root) {
     meta = std::make_unique<RuntimeObject>("RootMeta", this, builder.get());
     emit_struct_meta_base("Root", meta->ptr, snode);
@@ -246,7 +255,8 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -799,7 +809,11 @@ void CodeGenLLVM::visit(WhileControlStmt *stmt) {
 void CodeGenLLVM::visit(ContinueStmt *stmt) {
   using namespace llvm;
   if (stmt->as_return()) {
-    builder->CreateRetVoid();
+    if (offloaded_loop_reentry != nullptr) {
+      builder->CreateBr(offloaded_loop_reentry);
+    } else {
+      builder->CreateRetVoid();
+    }
   } else {
     TI_ASSERT(current_loop_reentry != nullptr);
     builder->CreateBr(current_loop_reentry);
@@ -847,14 +861,39 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // Since there's only one container to expand, we need a special kernel for
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
+  } else if (snode_parent->type == SNodeType::hash) {
+    if (arch_is_cpu(current_arch())) {
+      call("cpu_parallel_element_listgen_hash", get_runtime(), meta_parent,
+           meta_child, tlctx->get_constant(listgen->num_cpu_threads));
+    } else {
+      call("element_listgen_hash", get_runtime(), meta_parent, meta_child);
+    }
+  } else if (arch_is_cpu(current_arch())) {
+    call("cpu_parallel_element_listgen_nonroot", get_runtime(), meta_parent,
+         meta_child, tlctx->get_constant(listgen->num_cpu_threads));
   } else {
     call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
   }
 }
 
 void CodeGenLLVM::emit_gc(OffloadedStmt *stmt) {
+  if (stmt->snode->type == SNodeType::hash) {
+    emit_hash_gc(stmt->snode);
+  }
   auto snode = stmt->snode->id;
-  call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  if (arch_is_cpu(current_arch())) {
+    call("cpu_parallel_node_gc", get_runtime(), tlctx->get_constant(snode),
+         tlctx->get_constant(stmt->num_cpu_threads));
+  } else {
+    call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  }
+}
+
+void CodeGenLLVM::emit_hash_gc(SNode *snode) {
+  // Hash SNodes are always children of the root (see SNode::create_node).
+  auto meta = cast_pointer(emit_struct_meta(snode), "StructMeta");
+  auto meta_parent = cast_pointer(emit_struct_meta(snode->parent), "StructMeta");
+  call("hash_gc", get_runtime(), meta_parent, meta);
 }
 
 llvm::Value *CodeGenLLVM::create_call(llvm::Value *func,
@@ -1357,6 +1396,7 @@ void CodeGenLLVM::visit(SNodeLookupStmt *stmt) {
     llvm_val[stmt] = builder->CreateGEP(parent, llvm_val[stmt->input_index]);
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash ||
              snode->type == SNodeType::dynamic ||
              snode->type == SNodeType::bitmasked) {
     if (stmt->activate) {
@@ -1457,9 +1497,13 @@ std::string CodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
       llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
                               {llvm::PointerType::get(context_ty, 0)}, false);
 
-  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name, task_counter,
-                                      stmt->task_name(), suffix);
-  task_counter += 1;
+  auto task_kernel_name =
+      fmt::format("{}_{}_{}{}", kernel_name, task_counter++, stmt->task_name(),
+                  suffix);
+  if (prog->config.kernel_profiler) {
+    prog->profiler->register_offloaded_task(task_kernel_name, kernel->name,
+                                            stmt->task_type);
+  }
   func = llvm::Function::Create(task_function_type,
                                 llvm::Function::ExternalLinkage,
                                 task_kernel_name, module.get());
@@ -1668,8 +1712,22 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    create_call(refine, {parent_coordinates, new_coordinates,
-                         builder->CreateLoad(loop_index)});
+    // The loop index of a hash leaf block is a slot of its table, which has
+    // to be translated to the key (i.e. cell index) first. The key is -1 for
+    // empty slots and inactive cells.
+    llvm::Value *hash_key = nullptr;
+    if (leaf_block->type == SNodeType::hash) {
+      hash_key = call(leaf_block, element.get("element"), "get_slot_key",
+                      {builder->CreateLoad(loop_index)});
+      create_call(refine, {parent_coordinates, new_coordinates,
+                           builder->CreateSelect(
+                               builder->CreateICmpSGE(
+                                   hash_key, tlctx->get_constant(0)),
+                               hash_key, tlctx->get_constant(0))});
+    } else {
+      create_call(refine, {parent_coordinates, new_coordinates,
+                           builder->CreateLoad(loop_index)});
+    }
 
     // One more refine step is needed for bit_arrays to make final coordinates
     // non-consecutive, since each thread will process multiple
@@ -1729,6 +1787,10 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       is_active =
           builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
       exec_cond = builder->CreateAnd(exec_cond, is_active);
+    } else if (snode->type == SNodeType::hash) {
+      exec_cond = builder->CreateAnd(
+          exec_cond,
+          builder->CreateICmpSGE(hash_key, tlctx->get_constant(0)));
     }
 
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
@@ -1767,9 +1829,22 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
   }
 
-  int list_element_size = std::min(leaf_block->max_num_elements(),
+  int64 leaf_block_num_elements = leaf_block->max_num_elements();
+  if (leaf_block->type == SNodeType::hash) {
+    leaf_block_num_elements =
+        StructCompilerLLVM::get_hash_table_capacity(leaf_block);
+  }
+  int list_element_size = std::min(leaf_block_num_elements,
                                    (int64)taichi_listgen_max_element_size);
   int num_splits = std::max(1, list_element_size / stmt->block_dim);
+  auto tls_buffer_size = stmt->tls_size;
+  if (!arch_is_gpu(current_arch()) && stmt->bls_prologue) {
+    // On CPUs, the BLS buffer follows the TLS buffer of the task, which lives
+    // on the stack of the thread running the block. The block is not split so
+    // that the BLS buffer is filled only once per block.
+    num_splits = 1;
+    tls_buffer_size = get_cpu_bls_buffer_offset(stmt) + stmt->bls_size;
+  }
 
   auto struct_for_func = get_runtime_function("parallel_struct_for");
 
@@ -1816,7 +1891,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       struct_for_func,
       {get_context(), tlctx->get_constant(leaf_block->id),
        tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
+       body, tlctx->get_constant(tls_buffer_size),
        tlctx->get_constant(stmt->num_cpu_threads)});
   // TODO: why do we need num_cpu_threads on GPUs?
 
@@ -1897,11 +1972,19 @@ void CodeGenLLVM::visit(ThreadLocalPtrStmt *stmt) {
 }
 
 void CodeGenLLVM::visit(BlockLocalPtrStmt *stmt) {
-  TI_ASSERT(bls_buffer);
-  auto base = bls_buffer;
   TI_ASSERT(stmt->width() == 1);
-  auto ptr = builder->CreateGEP(
-      base, {tlctx->get_constant(0), llvm_val[stmt->offset]});
+  llvm::Value *ptr = nullptr;
+  if (bls_buffer) {
+    ptr = builder->CreateGEP(bls_buffer,
+                             {tlctx->get_constant(0), llvm_val[stmt->offset]});
+  } else {
+    // See create_offload_struct_for() for the BLS buffer on CPUs.
+    TI_ASSERT(current_offload);
+    auto offset = builder->CreateAdd(
+        tlctx->get_constant((int32)get_cpu_bls_buffer_offset(current_offload)),
+        llvm_val[stmt->offset]);
+    ptr = builder->CreateGEP(get_tls_base_ptr(), offset);
+  }
   auto ptr_type = llvm::PointerType::get(
       tlctx->get_data_type(stmt->ret_type.ptr_removed()), 0);
   llvm_val[stmt] = builder->CreatePointerCast(ptr, ptr_type);
@@ -2044,6 +2127,11 @@ llvm::Value *CodeGenLLVM::get_context() {
   return get_arg(0);
 }
 
+std::size_t CodeGenLLVM::get_cpu_bls_buffer_offset(OffloadedStmt *stmt) {
+  // 8-byte aligned, as is the TLS buffer.
+  return (stmt->tls_size + 7) / 8 * 8;
+}
+
 llvm::Value *CodeGenLLVM::get_tls_base_ptr() {
   return get_arg(1);
 }
@@ -1,6 +1,7 @@
 // The LLVM backend for CPUs/NVPTX/AMDGPU
 #pragma once
 
+#include <atomic>
 #include <set>
 #include <unordered_map>
 
@@ -49,7 +50,7 @@ class FunctionCreationGuard {
 
 class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
  public:
-  static uint64 task_counter;
+  static std::atomic<uint64> task_counter;
 
   Kernel *kernel;
   IRNode *ir;
@@ -64,6 +65,10 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   llvm::GlobalVariable *bls_buffer{nullptr};
   // Mainly for supporting continue stmt
   llvm::BasicBlock *current_loop_reentry;
+  // Where a continue of the offloaded loop itself jumps to if the loop is
+  // generated inside the task function, see CodeGenLLVMCPU. If nullptr, such a
+  // continue returns from the per-iteration body function.
+  llvm::BasicBlock *offloaded_loop_reentry{nullptr};
   // Mainly for supporting break stmt
   llvm::BasicBlock *current_while_after_loop;
   llvm::FunctionType *task_function_type;
@@ -95,6 +100,9 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *get_tls_base_ptr();
 
+  // Offset of the BLS buffer of a CPU struct-for in its TLS buffer.
+  static std::size_t get_cpu_bls_buffer_offset(OffloadedStmt *stmt);
+
   llvm::Type *get_tls_buffer_type();
 
   std::vector<llvm::Type *> get_xlogue_argument_types();
@@ -136,6 +144,8 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void emit_gc(OffloadedStmt *stmt);
 
+  void emit_hash_gc(SNode *snode);
+
   llvm::Value *create_call(llvm::Value *func,
                            std::vector<llvm::Value *> args = {});
 
@@ -10,6 +10,8 @@ constexpr int taichi_max_gpu_block_dim = 1024;
 constexpr std::size_t taichi_global_tmp_buffer_size = 1024 * 1024;
 constexpr int taichi_max_num_mem_requests = 1024 * 64;
 constexpr std::size_t taichi_page_size = 4096;
+// The size of a transparent huge page on x64 and arm64 (with 4 KiB pages).
+constexpr std::size_t taichi_huge_page_size = 2 * 1024 * 1024;
 constexpr std::size_t taichi_error_message_max_length = 2048;
 constexpr std::size_t taichi_error_message_max_num_arguments = 32;
 constexpr std::size_t taichi_result_buffer_entries = 32;
@@ -21,6 +23,9 @@ constexpr std::size_t taichi_result_buffer_runtime_query_id = 2;
 
 constexpr int taichi_listgen_max_element_size = 1024;
 
+// The maximum number of levels of a hash SNode, see node_hash.h.
+constexpr int taichi_max_num_hash_levels = 24;
+
 template <typename T, typename G>
 T taichi_union_cast_with_different_sizes(G g) {
   union {
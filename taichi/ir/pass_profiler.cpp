@@ -0,0 +1,148 @@
+#include "taichi/ir/pass_profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include "taichi/ir/analysis.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+thread_local const std::string *current_kernel_name = nullptr;
+
+// Sub-passes are named "<pass>/<sub-pass>" and are already included in the
+// time of their parent passes.
+bool is_sub_pass(const std::string &pass) {
+  return pass.find('/') != std::string::npos;
+}
+
+}  // namespace
+
+PassProfiler::Scope::Scope(const std::string &kernel_name)
+    : prev_(current_kernel_name), kernel_name_(kernel_name) {
+  current_kernel_name = &kernel_name_;
+}
+
+PassProfiler::Scope::~Scope() {
+  current_kernel_name = prev_;
+}
+
+PassProfiler &PassProfiler::get_instance() {
+  static PassProfiler instance;
+  return instance;
+}
+
+int PassProfiler::count_statements(IRNode *root) {
+  return irpass::analysis::count_statements(root);
+}
+
+void PassProfiler::record(const std::string &pass,
+                          float64 time,
+                          int num_stmts_before,
+                          int num_stmts_after) {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.push_back(
+      {current_kernel_name ? *current_kernel_name : std::string("<unknown>"),
+       pass, time, num_stmts_before, num_stmts_after});
+}
+
+std::vector<PassProfiler::Record> PassProfiler::get_records() {
+  std::lock_guard<std::mutex> _(mut_);
+  return records_;
+}
+
+void PassProfiler::print() {
+  auto records = get_records();
+
+  // Group the records by kernel, in the order the kernels were compiled.
+  std::vector<std::string> kernels;
+  std::unordered_map<std::string, std::vector<const Record *>> kernel_records;
+  std::unordered_map<std::string, float64> kernel_time;
+  for (auto &rec : records) {
+    auto &recs = kernel_records[rec.kernel];
+    if (recs.empty()) {
+      kernels.push_back(rec.kernel);
+    }
+    recs.push_back(&rec);
+    if (!is_sub_pass(rec.pass)) {
+      kernel_time[rec.kernel] += rec.time;
+    }
+  }
+  float64 total_time = 0;
+  for (auto &kernel : kernels) {
+    total_time += kernel_time[kernel];
+  }
+
+  const std::string header =
+      "[      %      time |  stmts before ->  after ] Pass";
+  const auto width = header.size() + 32;
+  fmt::print("Pass profiler\n");
+  fmt::print("{}\n", std::string(width, '='));
+  fmt::print("{}\n", header);
+  for (auto &kernel : kernels) {
+    auto time = kernel_time[kernel];
+    fmt::print("[{:6.2f}% {:7.3f} ms|{:>24}] {}\n",
+               time / std::max(total_time, 1e-9) * 100, time * 1000, "",
+               kernel);
+    for (auto *rec : kernel_records[kernel]) {
+      fmt::print("[{:6.2f}% {:7.3f} ms|{:>14d} -> {:>6d} ] {}{}\n",
+                 rec->time / std::max(time, 1e-9) * 100, rec->time * 1000,
+                 rec->num_stmts_before, rec->num_stmts_after,
+                 is_sub_pass(rec->pass) ? "    - " : "  - ", rec->pass);
+    }
+  }
+
+  // Passes are aggregated by name over all kernels.
+  std::map<std::string, std::pair<float64, int>> pass_time;
+  for (auto &rec : records) {
+    auto &[time, count] = pass_time[rec.pass];
+    time += rec.time;
+    count++;
+  }
+  std::vector<std::pair<std::string, std::pair<float64, int>>> passes(
+      pass_time.begin(), pass_time.end());
+  std::sort(passes.begin(), passes.end(), [](const auto &a, const auto &b) {
+    return a.second.first > b.second.first;
+  });
+  fmt::print("{}\n", std::string(width, '-'));
+  for (auto &[pass, time_count] : passes) {
+    fmt::print("[{:6.2f}% {:7.3f} ms| {:>14d}x{:>8}] {}\n",
+               time_count.first / std::max(total_time, 1e-9) * 100,
+               time_count.first * 1000, time_count.second, "", pass);
+  }
+  fmt::print("{}\n", std::string(width, '-'));
+  fmt::print("[100.00%] Total compilation time: {:7.3f} ms   kernels: {}\n",
+             total_time * 1000, kernels.size());
+  fmt::print("{}\n", std::string(width, '='));
+}
+
+std::string PassProfiler::to_json() {
+  auto records = get_records();
+  std::string json{"["};
+  for (std::size_t i = 0; i < records.size(); i++) {
+    auto &rec = records[i];
+    if (i > 0) {
+      json += ",";
+    }
+    json += "{";
+    json += fmt::format("\"kernel\":\"{}\",", rec.kernel);
+    json += fmt::format("\"pass\":\"{}\",", rec.pass);
+    json += fmt::format("\"time\":{},", rec.time);
+    json += fmt::format("\"num_stmts_before\":{},", rec.num_stmts_before);
+    json += fmt::format("\"num_stmts_after\":{}", rec.num_stmts_after);
+    json += "}";
+  }
+  json += "]";
+  return json;
+}
+
+void PassProfiler::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.clear();
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/ir/ir.h"
+#include "taichi/system/timer.h"
+
+namespace taichi {
+namespace lang {
+
+/**
+ * Records the wall time of the IR passes run on each kernel, and the number
+ * of statements before and after each of them.
+ *
+ * The passes of a kernel are attributed to the innermost Scope of the calling
+ * thread, which the compilation pipelines open with the kernel name. Enabled
+ * by CompileConfig::pass_profiler.
+ */
+class PassProfiler {
+ public:
+  struct Record {
+    std::string kernel;
+    std::string pass;
+    float64 time;  // In seconds
+    int num_stmts_before;
+    int num_stmts_after;
+  };
+
+  // Makes the passes run by this thread count towards |kernel_name|.
+  class Scope {
+   public:
+    explicit Scope(const std::string &kernel_name);
+    ~Scope();
+
+   private:
+    const std::string *prev_;
+    std::string kernel_name_;
+  };
+
+  static PassProfiler &get_instance();
+
+  bool get_enabled() const {
+    return enabled_;
+  }
+
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  // Adds a record to the kernel of the current Scope.
+  void record(const std::string &pass,
+              float64 time,
+              int num_stmts_before,
+              int num_stmts_after);
+
+  // Runs |pass()| on |root| and records it when enabled. Returns what |pass|
+  // returns.
+  template <typename Func>
+  auto run(const std::string &pass, IRNode *root, const Func &pass_func)
+      -> decltype(pass_func()) {
+    if (!enabled_) {
+      return pass_func();
+    }
+    const int num_stmts_before = count_statements(root);
+    const auto begin = Time::get_time();
+    if constexpr (std::is_void_v<decltype(pass_func())>) {
+      pass_func();
+      record(pass, Time::get_time() - begin, num_stmts_before,
+             count_statements(root));
+    } else {
+      auto ret = pass_func();
+      record(pass, Time::get_time() - begin, num_stmts_before,
+             count_statements(root));
+      return ret;
+    }
+  }
+
+  std::vector<Record> get_records();
+
+  // Prints a table of the passes of each kernel, followed by the total time of
+  // each pass over all kernels, both sorted by time.
+  void print();
+
+  // Returns the records as a JSON array of objects.
+  std::string to_json();
+
+  void clear();
+
+ private:
+  static int count_statements(IRNode *root);
+
+  std::mutex mut_;
+  std::vector<Record> records_;
+  bool enabled_{false};
+};
+
+}  // namespace lang
+}  // namespace taichi
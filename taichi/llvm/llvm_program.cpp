@@ -1,5 +1,6 @@
 #include "llvm_program.h"
 
+#include "taichi/backends/cpu/aot_module_builder_impl.h"
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/program/arch.h"
 #include "taichi/platform/cuda/detect_cuda.h"
@@ -8,6 +9,8 @@
 #include "taichi/util/str.h"
 #include "taichi/codegen/codegen.h"
 #include "taichi/ir/statements.h"
+#include "taichi/system/timer.h"
+#include "taichi/system/virtual_memory.h"
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/codegen_cuda.h"
@@ -26,6 +29,28 @@ void *taichi_allocate_aligned(MemoryPool *memory_pool,
                               std::size_t alignment) {
   return memory_pool->allocate(size, alignment);
 }
+
+// Writes to every page of [ptr, ptr + size) from the threads of |pool|,
+// keeping the contents. Each thread touches contiguous 2 MB chunks, just like
+// the contiguous parts of range-fors it later runs.
+void first_touch(ThreadPool *pool, Ptr ptr, std::size_t size) {
+  struct FirstTouchContext {
+    Ptr ptr;
+    std::size_t size;
+  } ctx{ptr, size};
+  constexpr std::size_t chunk_size = VirtualMemoryAllocator::huge_page_size;
+  const int num_chunks = (int)((size + chunk_size - 1) / chunk_size);
+  pool->run(num_chunks, pool->max_num_threads, &ctx,
+            [](void *p, int thread_id, int i) {
+              auto *ctx = (FirstTouchContext *)p;
+              auto end = std::min(ctx->size, (i + 1) * chunk_size);
+              for (auto offset = i * chunk_size; offset < end;
+                   offset += VirtualMemoryAllocator::page_size) {
+                auto *byte = (volatile uint8 *)(ctx->ptr + offset);
+                *byte = *byte;
+              }
+            });
+}
 }  // namespace
 
 LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
@@ -53,6 +78,9 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
   snode_tree_buffer_manager = std::make_unique<SNodeTreeBufferManager>(this);
 
   thread_pool = std::make_unique<ThreadPool>(config->cpu_max_num_threads);
+  if (config->cpu_numa_aware && arch_is_cpu(config->arch)) {
+    thread_pool->enable_numa_affinity();
+  }
 
   preallocated_device_buffer = nullptr;
   llvm_runtime = nullptr;
@@ -81,6 +109,12 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
     config_.max_block_dim = 1024;
   }
 
+  if (config_.kernel_profiler && arch_is_cpu(config_.arch)) {
+    // For the per-thread busy and idle times of the offloaded tasks
+    thread_pool->set_profiling(true);
+    profiler->set_thread_pool(thread_pool.get());
+  }
+
   if (config->kernel_profiler && runtime_mem_info) {
     runtime_mem_info->set_profiler(profiler);
   }
@@ -159,18 +193,31 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
   TI_TRACE("Allocating data structure of size {} bytes", scomp->root_size);
   std::size_t rounded_size =
       taichi::iroundup(scomp->root_size, taichi_page_size);
+  Ptr root_ptr = snode_tree_buffer_manager->allocate(
+      runtime_jit, llvm_runtime, rounded_size, taichi_page_size, tree->id(),
+      result_buffer);
+  if (config->cpu_first_touch && arch_is_cpu(config->arch)) {
+    auto t = Time::get_time();
+    first_touch(thread_pool.get(), root_ptr, rounded_size);
+    TI_TRACE("First touch of {} bytes took {:.3} s", rounded_size,
+             Time::get_time() - t);
+  }
   runtime_jit->call<void *, std::size_t, int, int, int, std::size_t, Ptr>(
       "runtime_initialize_snodes", llvm_runtime, scomp->root_size, root_id,
-      (int)snodes.size(), tree->id(), rounded_size,
-      snode_tree_buffer_manager->allocate(runtime_jit, llvm_runtime,
-                                          rounded_size, taichi_page_size,
-                                          tree->id(), result_buffer));
+      (int)snodes.size(), tree->id(), rounded_size, root_ptr);
+  cpu::CompiledSNodeTreeData tree_data;
+  tree_data.tree_id = tree->id();
+  tree_data.root_id = root_id;
+  tree_data.num_snodes = (int)snodes.size();
+  tree_data.root_size = scomp->root_size;
+  tree_data.rounded_size = rounded_size;
   for (int i = 0; i < (int)snodes.size(); i++) {
     if (is_gc_able(snodes[i]->type)) {
       std::size_t node_size;
       auto element_size = snodes[i]->cell_size_bytes;
-      if (snodes[i]->type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snodes[i]->type == SNodeType::pointer ||
+          snodes[i]->type == SNodeType::hash) {
+        // pointer and hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
@@ -185,8 +232,12 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
                snodes[i]->id, node_size);
       runtime_jit->call<void *, int>("runtime_allocate_ambient", rt, i,
                                      node_size);
+      tree_data.allocators.push_back({snodes[i]->id, i, node_size});
     }
   }
+  if (arch_is_cpu(config->arch)) {
+    cpu_snode_trees[tree->id()] = tree_data;
+  }
 }
 
 void LlvmProgramImpl::materialize_snode_tree(
@@ -221,6 +272,26 @@ void LlvmProgramImpl::materialize_snode_tree(
   }
 }
 
+void LlvmProgramImpl::destroy_snode_tree(SNodeTree *snode_tree) {
+  if (arch_use_host_memory(config->arch)) {
+    // SNode ids are never reused, so the nodes of the destroyed tree can all
+    // be returned to the OS.
+    auto *const runtime_jit = llvm_context_host->runtime_jit_module;
+    std::function<void(SNode *)> release = [&](SNode *snode) {
+      if (is_gc_able(snode->type)) {
+        runtime_jit->call<void *, int>("runtime_NodeAllocator_release",
+                                       llvm_runtime, snode->id);
+      }
+      for (auto &ch : snode->ch) {
+        release(ch.get());
+      }
+    };
+    release(snode_tree->root());
+  }
+  cpu_snode_trees.erase(snode_tree->id());
+  snode_tree_buffer_manager->destroy(snode_tree);
+}
+
 void LlvmProgramImpl::materialize_snode_expr_attributes(
     SNodeGlobalVarExprMap &snode_to_glb_var_exprs_) {
   for (auto &[snode, glb_var] : snode_to_glb_var_exprs_) {
@@ -266,6 +337,18 @@ std::size_t LlvmProgramImpl::get_snode_num_dynamically_allocated(
                                            result_buffer, data_list);
 }
 
+std::vector<ThreadPool *> LlvmProgramImpl::make_thread_pool_slices(
+    int num_slices) {
+  // The pool can only be sliced once at a time.
+  thread_pool_slices.clear();
+  thread_pool_slices = thread_pool->make_slices(num_slices);
+  std::vector<ThreadPool *> slices;
+  for (auto &slice : thread_pool_slices) {
+    slices.push_back(slice.get());
+  }
+  return slices;
+}
+
 void LlvmProgramImpl::print_list_manager_info(void *list_manager,
                                               uint64 *result_buffer) {
   auto list_manager_len = runtime_query<int32>("ListManager_get_num_elements",
@@ -370,12 +453,20 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 
   if (arch_use_host_memory(config->arch)) {
-    runtime_jit->call<void *, void *, void *>(
+    runtime_jit->call<void *, void *, void *, int>(
         "LLVMRuntime_initialize_thread_pool", llvm_runtime, thread_pool.get(),
-        (void *)ThreadPool::static_run);
+        (void *)ThreadPool::static_run, thread_pool->max_num_threads);
 
     runtime_jit->call<void *, void *>("LLVMRuntime_set_assert_failed",
                                       llvm_runtime, (void *)assert_failed_host);
+    // Recycled nodes are then zero-filled by releasing the pages they cover.
+    runtime_jit->call<void *, void *>("LLVMRuntime_set_release_memory",
+                                      llvm_runtime,
+                                      (void *)release_physical_memory);
+    if (arch_is_cpu(config->arch) && config->cpu_huge_pages) {
+      runtime_jit->call<void *, uint64>("LLVMRuntime_set_release_page_size",
+                                        llvm_runtime, taichi_huge_page_size);
+    }
   }
   if (arch_is_cpu(config->arch)) {
     // Profiler functions can only be called on CPU kernels
@@ -390,6 +481,17 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 }
 
+std::unique_ptr<AotModuleBuilder> LlvmProgramImpl::make_aot_module_builder() {
+  if (arch_is_cpu(config->arch) && config->arch != Arch::wasm) {
+    std::vector<cpu::CompiledSNodeTreeData> snode_trees;
+    for (auto &[tree_id, tree_data] : cpu_snode_trees) {
+      snode_trees.push_back(tree_data);
+    }
+    return std::make_unique<cpu::AotModuleBuilderImpl>(this, snode_trees);
+  }
+  TI_NOT_IMPLEMENTED;
+}
+
 void LlvmProgramImpl::check_runtime_error(uint64 *result_buffer) {
   synchronize();
   auto tlctx = llvm_context_host.get();
@@ -1,4 +1,5 @@
 #pragma once
+#include "taichi/backends/cpu/aot_utils.h"
 #include "taichi/system/snode_tree_buffer_manager.h"
 #include "taichi/inc/constants.h"
 #include "taichi/program/compile_config.h"
@@ -16,6 +17,7 @@
 #include "taichi/program/context.h"
 #undef TI_RUNTIME_HOST
 
+#include <map>
 #include <memory>
 
 namespace taichi {
@@ -73,8 +75,16 @@ class LlvmProgramImpl : public ProgramImpl {
       SNode *snode,
       uint64 *result_buffer) override;
 
-  void destroy_snode_tree(SNodeTree *snode_tree) {
-    snode_tree_buffer_manager->destroy(snode_tree);
+  void destroy_snode_tree(SNodeTree *snode_tree);
+
+  /**
+   * Gets the root buffer of a materialized SNode tree.
+   *
+   * On CPU backends, the elements of the tree can be accessed directly
+   * through this pointer.
+   */
+  Ptr get_snode_tree_root(int snode_tree_id) {
+    return snode_tree_buffer_manager->get_root(snode_tree_id);
   }
 
   void print_memory_profiler_info(
@@ -87,6 +97,10 @@ class LlvmProgramImpl : public ProgramImpl {
 
   void finalize();
 
+  // Splits the CPU thread pool into |num_slices| slices for launching tasks
+  // concurrently. The slices are owned by this program.
+  std::vector<ThreadPool *> make_thread_pool_slices(int num_slices);
+
  private:
   std::unique_ptr<llvm::Module> clone_struct_compiler_initial_context(
       const std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
@@ -127,18 +141,20 @@ class LlvmProgramImpl : public ProgramImpl {
 
   void print_list_manager_info(void *list_manager, uint64 *result_buffer);
 
-  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override {
-    TI_NOT_IMPLEMENTED;
-  }
+  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override;
 
  private:
   std::unique_ptr<TaichiLLVMContext> llvm_context_host{nullptr};
   std::unique_ptr<TaichiLLVMContext> llvm_context_device{nullptr};
   std::unique_ptr<ThreadPool> thread_pool{nullptr};
+  std::vector<std::unique_ptr<ThreadPool>> thread_pool_slices;
   std::unique_ptr<Runtime> runtime_mem_info{nullptr};
   std::unique_ptr<SNodeTreeBufferManager> snode_tree_buffer_manager{nullptr};
   void *llvm_runtime{nullptr};
   void *preallocated_device_buffer{nullptr};  // TODO: move to memory allocator
+  // How the runtime initializes each SNode tree on CPUs, by tree id. Saved to
+  // the CPU AOT modules.
+  std::map<int, cpu::CompiledSNodeTreeData> cpu_snode_trees;
 };
 }  // namespace lang
 }  // namespace taichi
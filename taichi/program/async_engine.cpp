@@ -118,7 +118,8 @@ void ParallelExecutor::worker_loop() {
   }
 }
 
-void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
+ExecutionQueue::AsyncCompiledFunc *ExecutionQueue::compile(
+    const TaskLaunchRecord &ker) {
   auto h = ker.ir_handle.hash();
   auto *stmt = ker.stmt();
   auto kernel = ker.kernel;
@@ -164,15 +165,94 @@ void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
         });
     ir_bank_->insert_to_trash_bin(std::move(cloned_stmt));
   }
+  return async_func;
+}
 
+void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
+  auto async_func = compile(ker);
   launch_worker.enqueue(
-      [kernel_name, async_func, context = ker.context]() mutable {
+      [kernel_name = ker.kernel->name, async_func,
+       context = ker.context]() mutable {
         TI_TIMELINE(kernel_name);
         auto func = async_func->get();
         func(context);
       });
 }
 
+void ExecutionQueue::enqueue(
+    const std::vector<TaskLaunchRecord> &tasks,
+    const std::vector<std::vector<int>> &dependencies) {
+  if (!parallel_launch_enabled()) {
+    for (auto &task : tasks) {
+      enqueue(task);
+    }
+    return;
+  }
+  TI_ASSERT(dependencies.size() == tasks.size());
+  auto batch = std::make_shared<TaskBatch>((int)tasks.size());
+  for (int i = 0; i < (int)tasks.size(); i++) {
+    auto &task = batch->tasks[i];
+    task.name = tasks[i].kernel->name;
+    task.func = compile(tasks[i]);
+    task.context = tasks[i].context;
+    task.num_pending_deps = (int)dependencies[i].size();
+    for (int dep : dependencies[i]) {
+      batch->tasks[dep].successors.push_back(i);
+    }
+  }
+  launch_worker.enqueue([this, batch]() { launch_batch(batch); });
+}
+
+void ExecutionQueue::launch_batch(const std::shared_ptr<TaskBatch> &batch) {
+  for (int i = 0; i < (int)batch->tasks.size(); i++) {
+    if (batch->tasks[i].num_pending_deps == 0) {
+      task_launchers_->enqueue([this, batch, i]() { launch_task(batch, i); });
+    }
+  }
+  // A task enqueues its successors before it finishes, so this returns once
+  // the whole batch is done.
+  task_launchers_->flush();
+}
+
+void ExecutionQueue::launch_task(const std::shared_ptr<TaskBatch> &batch,
+                                 int i) {
+  auto &task = batch->tasks[i];
+  {
+    TI_TIMELINE(task.name);
+    auto func = task.func->get();
+    // There are as many slices as launchers, so one is always free.
+    ThreadPool *slice;
+    {
+      std::lock_guard<std::mutex> _(slices_mut_);
+      TI_ASSERT(!free_slices_.empty());
+      slice = free_slices_.back();
+      free_slices_.pop_back();
+    }
+    ThreadPool::set_thread_slice(slice);
+    func(task.context);
+    ThreadPool::set_thread_slice(nullptr);
+    {
+      std::lock_guard<std::mutex> _(slices_mut_);
+      free_slices_.push_back(slice);
+    }
+  }
+  for (int successor : task.successors) {
+    if (--batch->tasks[successor].num_pending_deps == 0) {
+      task_launchers_->enqueue(
+          [this, batch, successor]() { launch_task(batch, successor); });
+    }
+  }
+}
+
+void ExecutionQueue::enable_parallel_launch(
+    const std::vector<ThreadPool *> &slices) {
+  TI_ASSERT(!slices.empty());
+  launch_worker.flush();
+  free_slices_ = slices;
+  task_launchers_ =
+      std::make_unique<ParallelExecutor>("task_launcher", (int)slices.size());
+}
+
 void ExecutionQueue::synchronize() {
   TI_AUTO_PROF;
   launch_worker.flush();
@@ -187,6 +267,11 @@ ExecutionQueue::ExecutionQueue(
       compile_to_backend_(compile_to_backend) {
 }
 
+ExecutionQueue::~ExecutionQueue() {
+  // The batches being launched use |task_launchers_|.
+  launch_worker.flush();
+}
+
 AsyncEngine::AsyncEngine(const CompileConfig *const config,
                          const std::unordered_map<int, SNode *> &snodes,
                          const BackendExecCompilationFunc &compile_to_backend)
@@ -294,11 +379,11 @@ void AsyncEngine::flush() {
   debug_sfg("final");
   {
     TI_TIMELINE("enqueue");
-    auto tasks = sfg->extract_to_execute();
+    std::vector<std::vector<int>> dependencies;
+    auto tasks = sfg->extract_to_execute(
+        queue.parallel_launch_enabled() ? &dependencies : nullptr);
     TI_TRACE("Ended up with {} nodes", tasks.size());
-    for (auto &task : tasks) {
-      queue.enqueue(task);
-    }
+    queue.enqueue(tasks, dependencies);
   }
   flush_counter_++;
 }
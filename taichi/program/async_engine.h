@@ -15,6 +15,7 @@
 #include "taichi/program/async_utils.h"
 #include "taichi/program/ir_bank.h"
 #include "taichi/program/state_flow_graph.h"
+#include "taichi/system/threading.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -76,23 +77,39 @@ class ParallelExecutor {
 using BackendExecCompilationFunc =
     std::function<FunctionType(Kernel &, OffloadedStmt *)>;
 
-// In charge of (parallel) compilation to binary and (serial) kernel launching
+// In charge of (parallel) compilation to binary and kernel launching.
+//
+// By default the tasks are launched serially. With enable_parallel_launch(),
+// each batch of tasks is launched as a DAG instead: a task starts as soon as
+// the tasks it depends on have finished, so that independent tasks run
+// concurrently, each on its own slice of the CPU thread pool. Batches are
+// still launched one after another.
 class ExecutionQueue {
  public:
   std::mutex mut;
 
   ParallelExecutor compilation_workers;  // parallel compilation
-  ParallelExecutor launch_worker;        // serial launching
+  ParallelExecutor launch_worker;        // serial launching (of batches)
 
   explicit ExecutionQueue(IRBank *ir_bank,
                           const BackendExecCompilationFunc &compile_to_backend);
 
+  ~ExecutionQueue();
+
   void enqueue(const TaskLaunchRecord &ker);
 
-  void compile_task() {
-  }
+  // Enqueues a batch of tasks. dependencies[i] lists the indices of the tasks
+  // in |tasks| that must finish before tasks[i] starts.
+  void enqueue(const std::vector<TaskLaunchRecord> &tasks,
+               const std::vector<std::vector<int>> &dependencies);
+
+  // Launches up to |slices.size()| independent tasks concurrently, each with
+  // its CPU range-fors redirected to a slice (see ThreadPool::make_slices()).
+  // The slices are not owned.
+  void enable_parallel_launch(const std::vector<ThreadPool *> &slices);
 
-  void launch_task() {
+  bool parallel_launch_enabled() const {
+    return task_launchers_ != nullptr;
   }
 
   void clear_cache() {
@@ -123,8 +140,36 @@ class ExecutionQueue {
   };
   std::unordered_map<uint64, AsyncCompiledFunc> compiled_funcs_;
 
+  // The tasks of a batch being launched as a DAG.
+  struct TaskBatch {
+    struct Task {
+      std::string name;
+      AsyncCompiledFunc *func;
+      Context context;
+      std::vector<int> successors;
+      // Number of unfinished tasks this task depends on.
+      std::atomic<int> num_pending_deps{0};
+    };
+    std::vector<Task> tasks;
+
+    explicit TaskBatch(int num_tasks) : tasks(num_tasks) {
+    }
+  };
+
+  // Compiles |ker| in the background if it is not yet compiled.
+  AsyncCompiledFunc *compile(const TaskLaunchRecord &ker);
+
+  void launch_batch(const std::shared_ptr<TaskBatch> &batch);
+
+  void launch_task(const std::shared_ptr<TaskBatch> &batch, int i);
+
   IRBank *ir_bank_;  // not owned
   BackendExecCompilationFunc compile_to_backend_;
+
+  // Runs the tasks of a batch whose dependencies have finished.
+  std::unique_ptr<ParallelExecutor> task_launchers_;
+  std::mutex slices_mut_;
+  std::vector<ThreadPool *> free_slices_;  // guarded by |slices_mut_|
 };
 
 // An engine for asynchronous execution and optimization
@@ -39,7 +39,7 @@ class Callable {
 
   virtual ~Callable() = default;
 
-  int insert_arg(const DataType &dt, bool is_external_array);
+  virtual int insert_arg(const DataType &dt, bool is_external_array);
 
   int insert_ret(const DataType &dt);
 
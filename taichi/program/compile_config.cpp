@@ -30,6 +30,7 @@ CompileConfig::CompileConfig() {
   default_ip = PrimitiveType::i32;
   verbose_kernel_launches = false;
   kernel_profiler = false;
+  kernel_launch_stats = true;
   default_cpu_block_dim = 32;
   default_gpu_block_dim = 128;
   gpu_max_reg = 0;  // 0 means using the default value from the CUDA driver.
@@ -45,6 +46,11 @@ CompileConfig::CompileConfig() {
   saturating_grid_dim = 0;
   max_block_dim = 0;
   cpu_max_num_threads = std::thread::hardware_concurrency();
+  num_compile_threads = std::thread::hardware_concurrency();
+  cpu_numa_aware = false;
+  cpu_block_range_for = false;
+  cpu_huge_pages = false;
+  cpu_first_touch = false;
   random_seed = 0;
 
   // LLVM backend options:
@@ -52,6 +58,9 @@ CompileConfig::CompileConfig() {
   print_kernel_llvm_ir = false;
   print_kernel_nvptx = false;
   print_kernel_llvm_ir_optimized = false;
+  offline_cache = false;
+  offline_cache_file_path = "";
+  offline_cache_max_size_of_files = 1024 * 1024 * 1024;  // 1 GB
 
   // CUDA backend options:
 #if defined(TI_PLATFORM_WINDOWS) or defined(TI_PLATFORM_OSX)
@@ -63,8 +72,19 @@ CompileConfig::CompileConfig() {
   device_memory_fraction = 0.0;
 
   // C backend options:
-  cc_compile_cmd = "gcc -Wc99-c11-compat -c -o '{}' '{}' -O3";
-  cc_link_cmd = "gcc -shared -fPIC -o '{}' '{}'";
+  // Range-fors run in parallel with OpenMP. Without -fopenmp, they are
+  // compiled into serial loops. The C backend drops -fopenmp from both
+  // commands if the compiler turns out not to support it.
+  cc_compile_cmd = "gcc -Wc99-c11-compat -c -o '{}' '{}' -O3 -fopenmp";
+  cc_link_cmd = "gcc -shared -fPIC -fopenmp -o '{}' '{}'";
+  cpu_aot_link_cmd = "cc -shared -o '{}' '{}' -lm";
+  // The baseline of the architecture, so that the module runs on any machine
+  // of it.
+#if defined(TI_ARCH_x64)
+  cpu_aot_target_cpu = "x86-64";
+#else
+  cpu_aot_target_cpu = "generic";
+#endif
 }
 
 TLANG_NAMESPACE_END
@@ -29,7 +29,15 @@ struct CompileConfig {
   bool use_llvm;
   bool verbose_kernel_launches;
   bool kernel_profiler;
+  // Count the launched offloaded tasks in the "launched_tasks*" statistics.
+  bool kernel_launch_stats;
   bool timeline{false};
+  // Record the time and the IR size of the passes of each kernel, see
+  // PassProfiler.
+  bool pass_profiler{false};
+  // Verify the IR after every pass instead of only at the boundaries of the
+  // compilation pipelines.
+  bool verify_each_pass{false};
   bool verbose;
   bool fast_math;
   bool async_mode;
@@ -52,6 +60,20 @@ struct CompileConfig {
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // Number of threads used by Program::compile_kernels().
+  int num_compile_threads;
+  // Pin the CPU threads to cores, partition range-fors by NUMA node, and
+  // adapt the block size of range-fors from their measured cost.
+  bool cpu_numa_aware;
+  // Generate each CPU range-for as a function over a block of iterations, so
+  // that LLVM can vectorize and unroll the loop.
+  bool cpu_block_range_for;
+  // Back the memory of CPU programs with 2 MB transparent huge pages.
+  bool cpu_huge_pages;
+  // Touch the memory of each SNode tree from the CPU thread pool when it is
+  // materialized, so that with cpu_numa_aware its pages are placed on the
+  // NUMA nodes of the threads that sweep them.
+  bool cpu_first_touch;
   int random_seed;
 
   // LLVM backend options:
@@ -59,6 +81,13 @@ struct CompileConfig {
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
   bool print_kernel_nvptx;
+  // Offline cache of the JIT-compiled object code (x64/arm64 and cc). Each
+  // backend uses its own subdirectory ("llvm", "cc") of the path, and the size
+  // limit applies to each of them. An empty path means
+  // get_repo_dir() + "ticache".
+  bool offline_cache;
+  std::string offline_cache_file_path;
+  std::size_t offline_cache_max_size_of_files;
 
   // CUDA backend options:
   bool use_unified_memory;
@@ -69,6 +98,16 @@ struct CompileConfig {
   std::string cc_compile_cmd;
   std::string cc_link_cmd;
 
+  // CPU AOT options:
+  // Links the object file of a CPU AOT module into a shared library. Formatted
+  // with the paths of the library and the object file. Empty to keep the
+  // object file only.
+  std::string cpu_aot_link_cmd;
+  // The LLVM CPU name the object file of a CPU AOT module is compiled for,
+  // e.g. "x86-64" or "skylake". "native" stands for the CPU of this machine,
+  // which the module may then only run on.
+  std::string cpu_aot_target_cpu;
+
   // Async options
   int async_opt_passes{3};
   bool async_opt_fusion{true};
@@ -82,6 +121,9 @@ struct CompileConfig {
   int async_flush_every{50};
   // Setting 0 effectively means unlimited
   int async_max_fuse_per_task{1};
+  // Maximum number of independent tasks launched concurrently, each on a slice
+  // of the CPU thread pool. 1 means serial launching. CPU only.
+  int async_max_parallel_launches{1};
 
   bool quant_opt_store_fusion{true};
   bool quant_opt_atomic_demotion{true};
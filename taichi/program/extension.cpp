@@ -11,12 +11,13 @@ bool is_extension_supported(Arch arch, Extension ext) {
       {Arch::x64,
        {Extension::sparse, Extension::async_mode, Extension::quant,
         Extension::quant_basic, Extension::data64, Extension::adstack,
-        Extension::assertion, Extension::extfunc, Extension::packed,
-        Extension::dynamic_index}},
+        Extension::bls, Extension::assertion, Extension::extfunc,
+        Extension::packed, Extension::dynamic_index}},
       {Arch::arm64,
        {Extension::sparse, Extension::async_mode, Extension::quant,
         Extension::quant_basic, Extension::data64, Extension::adstack,
-        Extension::assertion, Extension::packed, Extension::dynamic_index}},
+        Extension::bls, Extension::assertion, Extension::packed,
+        Extension::dynamic_index}},
       {Arch::cuda,
        {Extension::sparse, Extension::async_mode, Extension::quant,
         Extension::quant_basic, Extension::data64, Extension::adstack,
@@ -9,12 +9,52 @@
 #include "taichi/program/extension.h"
 #include "taichi/program/program.h"
 #include "taichi/util/action_recorder.h"
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 
 TLANG_NAMESPACE_BEGIN
 
 class Function;
 
+namespace {
+
+// The counters to increment when launching a task of |task_type|.
+const std::vector<Counter *> &get_launched_task_counters(
+    OffloadedStmt::TaskType task_type) {
+  using TaskType = OffloadedStmt::TaskType;
+  static const auto counters = [] {
+    auto &metrics = Metrics::get_instance();
+    auto *launched = metrics.counter("launched_tasks", "Launched tasks");
+    auto *compute = metrics.counter("launched_tasks_compute",
+                                    "Launched serial and parallel for tasks");
+    std::map<TaskType, std::vector<Counter *>> counters;
+    counters[TaskType::listgen] = {
+        launched,
+        metrics.counter("launched_tasks_list_op", "Launched list tasks"),
+        metrics.counter("launched_tasks_list_gen",
+                        "Launched list generation tasks")};
+    // TODO: Do we need to distinguish serial tasks that contain clear lists vs
+    // those who don't?
+    counters[TaskType::serial] = {
+        launched, compute,
+        metrics.counter("launched_tasks_serial", "Launched serial tasks")};
+    counters[TaskType::range_for] = {
+        launched, compute,
+        metrics.counter("launched_tasks_range_for",
+                        "Launched range for tasks")};
+    counters[TaskType::struct_for] = {
+        launched, compute,
+        metrics.counter("launched_tasks_struct_for",
+                        "Launched struct for tasks")};
+    counters[TaskType::gc] = {
+        launched, metrics.counter("launched_tasks_garbage_collect",
+                                  "Launched garbage collection tasks")};
+    return counters;
+  }();
+  return counters.at(task_type);
+}
+
+}  // namespace
+
 Kernel::Kernel(Program &program,
                const std::function<void()> &func,
                const std::string &primal_name,
@@ -82,6 +122,11 @@ void Kernel::compile() {
   compiled_ = program->compile(*this);
 }
 
+void Kernel::compile_lowered() {
+  TI_ASSERT(lowered_);
+  compiled_ = program->compile(*this);
+}
+
 void Kernel::lower(bool to_executable) {
   TI_ASSERT(!lowered_);
   TI_ASSERT(supports_lowering(arch));
@@ -117,17 +162,21 @@ void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
     if (!compiled_) {
       compile();
     }
+    if (!launch_desc_.initialized) {
+      init_launch_descriptor();
+    }
 
-    for (auto &offloaded : ir->as<Block>()->statements) {
-      account_for_offloaded(offloaded->as<OffloadedStmt>());
+    for (auto &[counter, value] : launch_desc_.task_counters) {
+      counter->add(value);
     }
 
-    compiled_(ctx_builder.get_context());
+    {
+      Histogram::Timer _(launch_desc_.launch_latency);
+      compiled_(ctx_builder.get_context());
+    }
 
     program->sync = (program->sync && arch_is_cpu(arch));
-    // Note that Kernel::arch may be different from program.config.arch
-    if (program->config.debug && (arch_is_cpu(program->config.arch) ||
-                                  program->config.arch == Arch::cuda)) {
+    if (launch_desc_.check_runtime_error) {
       program->check_runtime_error();
     }
   } else {
@@ -141,6 +190,31 @@ void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
   }
 }
 
+void Kernel::init_launch_descriptor() {
+  const auto &config = program->config;
+  // Note that Kernel::arch may be different from program.config.arch
+  launch_desc_.check_runtime_error =
+      config.debug && (arch_is_cpu(config.arch) || config.arch == Arch::cuda);
+  launch_desc_.task_counters.clear();
+  launch_desc_.launch_latency = nullptr;
+  if (config.kernel_launch_stats && !is_evaluator && !is_accessor) {
+    std::map<Counter *, int64> task_counters;
+    for (auto &offloaded : ir->as<Block>()->statements) {
+      auto task_type = offloaded->as<OffloadedStmt>()->task_type;
+      for (auto *counter : get_launched_task_counters(task_type)) {
+        task_counters[counter]++;
+      }
+    }
+    launch_desc_.task_counters.assign(task_counters.begin(),
+                                      task_counters.end());
+    launch_desc_.launch_latency = Metrics::get_instance().histogram(
+        "kernel_launch_seconds",
+        "Time spent in launching kernels, which includes running them on "
+        "CPUs");
+  }
+  launch_desc_.initialized = true;
+}
+
 Kernel::LaunchContextBuilder Kernel::make_launch_context() {
   return LaunchContextBuilder(this);
 }
@@ -155,77 +229,68 @@ Kernel::LaunchContextBuilder::LaunchContextBuilder(Kernel *kernel)
       ctx_(owned_ctx_.get()) {
 }
 
-void Kernel::LaunchContextBuilder::set_arg_float(int arg_id, float64 d) {
+template <typename T>
+void Kernel::LaunchContextBuilder::set_arg_scalar(int arg_id, T d) {
   TI_ASSERT_INFO(!kernel_->args[arg_id].is_external_array,
                  "Assigning scalar value to external (numpy) array argument is "
                  "not allowed.");
 
-  ActionRecorder::get_instance().record(
-      "set_kernel_arg_float64",
-      {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
-       ActionArg("val", d)});
+  switch (kernel_->arg_types_[arg_id]) {
+    case PrimitiveTypeID::f32:
+      ctx_->set_arg(arg_id, (float32)d);
+      break;
+    case PrimitiveTypeID::f64:
+      ctx_->set_arg(arg_id, (float64)d);
+      break;
+    case PrimitiveTypeID::i32:
+      ctx_->set_arg(arg_id, (int32)d);
+      break;
+    case PrimitiveTypeID::i64:
+      ctx_->set_arg(arg_id, (int64)d);
+      break;
+    case PrimitiveTypeID::i8:
+      ctx_->set_arg(arg_id, (int8)d);
+      break;
+    case PrimitiveTypeID::i16:
+      ctx_->set_arg(arg_id, (int16)d);
+      break;
+    case PrimitiveTypeID::u8:
+      ctx_->set_arg(arg_id, (uint8)d);
+      break;
+    case PrimitiveTypeID::u16:
+      ctx_->set_arg(arg_id, (uint16)d);
+      break;
+    case PrimitiveTypeID::u32:
+      ctx_->set_arg(arg_id, (uint32)d);
+      break;
+    case PrimitiveTypeID::u64:
+      ctx_->set_arg(arg_id, (uint64)d);
+      break;
+    default:
+      TI_INFO(kernel_->args[arg_id].dt->to_string());
+      TI_NOT_IMPLEMENTED
+  }
+}
 
-  auto dt = kernel_->args[arg_id].dt;
-  if (dt->is_primitive(PrimitiveTypeID::f32)) {
-    ctx_->set_arg(arg_id, (float32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
-    ctx_->set_arg(arg_id, (float64)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i32)) {
-    ctx_->set_arg(arg_id, (int32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
-    ctx_->set_arg(arg_id, (int64)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
-    ctx_->set_arg(arg_id, (int8)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
-    ctx_->set_arg(arg_id, (int16)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
-    ctx_->set_arg(arg_id, (uint8)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
-    ctx_->set_arg(arg_id, (uint16)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
-    ctx_->set_arg(arg_id, (uint32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
-    ctx_->set_arg(arg_id, (uint64)d);
-  } else {
-    TI_NOT_IMPLEMENTED
+void Kernel::LaunchContextBuilder::set_arg_float(int arg_id, float64 d) {
+  // Building the ActionArgs is not free, so only do it when recording.
+  if (ActionRecorder::get_instance().is_recording()) {
+    ActionRecorder::get_instance().record(
+        "set_kernel_arg_float64",
+        {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
+         ActionArg("val", d)});
   }
+  set_arg_scalar(arg_id, d);
 }
 
 void Kernel::LaunchContextBuilder::set_arg_int(int arg_id, int64 d) {
-  TI_ASSERT_INFO(!kernel_->args[arg_id].is_external_array,
-                 "Assigning scalar value to external (numpy) array argument is "
-                 "not allowed.");
-
-  ActionRecorder::get_instance().record(
-      "set_kernel_arg_int64",
-      {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
-       ActionArg("val", d)});
-
-  auto dt = kernel_->args[arg_id].dt;
-  if (dt->is_primitive(PrimitiveTypeID::i32)) {
-    ctx_->set_arg(arg_id, (int32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
-    ctx_->set_arg(arg_id, (int64)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
-    ctx_->set_arg(arg_id, (int8)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
-    ctx_->set_arg(arg_id, (int16)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
-    ctx_->set_arg(arg_id, (uint8)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
-    ctx_->set_arg(arg_id, (uint16)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
-    ctx_->set_arg(arg_id, (uint32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
-    ctx_->set_arg(arg_id, (uint64)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
-    ctx_->set_arg(arg_id, (float32)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
-    ctx_->set_arg(arg_id, (float64)d);
-  } else {
-    TI_INFO(dt->to_string());
-    TI_NOT_IMPLEMENTED
+  if (ActionRecorder::get_instance().is_recording()) {
+    ActionRecorder::get_instance().record(
+        "set_kernel_arg_int64",
+        {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
+         ActionArg("val", d)});
   }
+  set_arg_scalar(arg_id, d);
 }
 
 void Kernel::LaunchContextBuilder::set_extra_arg_int(int i, int j, int32 d) {
@@ -239,11 +304,13 @@ void Kernel::LaunchContextBuilder::set_arg_external_array(int arg_id,
       kernel_->args[arg_id].is_external_array,
       "Assigning external (numpy) array to scalar argument is not allowed.");
 
-  ActionRecorder::get_instance().record(
-      "set_kernel_arg_ext_ptr",
-      {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
-       ActionArg("address", fmt::format("0x{:x}", ptr)),
-       ActionArg("array_size_in_bytes", (int64)size)});
+  if (ActionRecorder::get_instance().is_recording()) {
+    ActionRecorder::get_instance().record(
+        "set_kernel_arg_ext_ptr",
+        {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
+         ActionArg("address", fmt::format("0x{:x}", ptr)),
+         ActionArg("array_size_in_bytes", (int64)size)});
+  }
 
   kernel_->args[arg_id].size = size;
   ctx_->set_arg(arg_id, ptr);
@@ -254,7 +321,8 @@ void Kernel::LaunchContextBuilder::set_arg_raw(int arg_id, uint64 d) {
                  "Assigning scalar value to external (numpy) array argument is "
                  "not allowed.");
 
-  if (!kernel_->is_evaluator) {
+  if (!kernel_->is_evaluator &&
+      ActionRecorder::get_instance().is_recording()) {
     ActionRecorder::get_instance().record(
         "set_arg_raw",
         {ActionArg("kernel_name", kernel_->name), ActionArg("arg_id", arg_id),
@@ -332,27 +400,19 @@ void Kernel::set_arch(Arch arch) {
 void Kernel::account_for_offloaded(OffloadedStmt *stmt) {
   if (is_evaluator || is_accessor)
     return;
-  auto task_type = stmt->task_type;
-  stat.add("launched_tasks", 1.0);
-  if (task_type == OffloadedStmt::TaskType::listgen) {
-    stat.add("launched_tasks_list_op", 1.0);
-    stat.add("launched_tasks_list_gen", 1.0);
-  } else if (task_type == OffloadedStmt::TaskType::serial) {
-    // TODO: Do we need to distinguish serial tasks that contain clear lists vs
-    // those who don't?
-    stat.add("launched_tasks_compute", 1.0);
-    stat.add("launched_tasks_serial", 1.0);
-  } else if (task_type == OffloadedStmt::TaskType::range_for) {
-    stat.add("launched_tasks_compute", 1.0);
-    stat.add("launched_tasks_range_for", 1.0);
-  } else if (task_type == OffloadedStmt::TaskType::struct_for) {
-    stat.add("launched_tasks_compute", 1.0);
-    stat.add("launched_tasks_struct_for", 1.0);
-  } else if (task_type == OffloadedStmt::TaskType::gc) {
-    stat.add("launched_tasks_garbage_collect", 1.0);
+  for (auto *counter : get_launched_task_counters(stmt->task_type)) {
+    counter->add();
   }
 }
 
+int Kernel::insert_arg(const DataType &dt, bool is_external_array) {
+  const int arg_id = Callable::insert_arg(dt, is_external_array);
+  auto *type = args[arg_id].dt->cast<PrimitiveType>();
+  arg_types_.push_back(type && !is_external_array ? type->type
+                                                  : PrimitiveTypeID::unknown);
+  return arg_id;
+}
+
 std::string Kernel::get_name() const {
   return name;
 }
@@ -5,6 +5,7 @@
 #include "taichi/ir/ir.h"
 #include "taichi/program/arch.h"
 #include "taichi/program/callable.h"
+#include "taichi/util/metrics.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -46,6 +47,9 @@ class Kernel : public Callable {
     Context &get_context();
 
    private:
+    template <typename T>
+    void set_arg_scalar(int arg_id, T d);
+
     Kernel *kernel_;
     std::unique_ptr<Context> owned_ctx_;
     // |ctx_| *almost* always points to |owned_ctx_|. However, it is possible
@@ -71,6 +75,19 @@ class Kernel : public Callable {
 
   void compile();
 
+  /**
+   * Compiles the already lowered |ir|.
+   *
+   * Unlike compile(), this does not touch Program::current_callable, so that
+   * multiple kernels can be compiled concurrently. See
+   * Program::compile_kernels().
+   */
+  void compile_lowered();
+
+  bool is_compiled() const {
+    return compiled_ != nullptr;
+  }
+
   /**
    * Lowers |ir| to CHI IR level
    *
@@ -91,6 +108,8 @@ class Kernel : public Callable {
 
   void account_for_offloaded(OffloadedStmt *stmt);
 
+  int insert_arg(const DataType &dt, bool is_external_array) override;
+
   [[nodiscard]] std::string get_name() const override;
   /**
    * Whether the given |arch| is supported in the lower() method.
@@ -101,8 +120,28 @@ class Kernel : public Callable {
   static bool supports_lowering(Arch arch);
 
  private:
+  // What a launch needs to know about the compiled kernel, resolved on the
+  // first launch so that later launches do not have to walk the offloaded
+  // tasks or re-read the config.
+  struct LaunchDescriptor {
+    bool initialized{false};
+    bool check_runtime_error{false};
+    // The increments of the "launched_tasks*" counters per launch, and the
+    // histogram of the launch latency. Empty if |config.kernel_launch_stats|
+    // is off.
+    std::vector<std::pair<Counter *, int64>> task_counters;
+    Histogram *launch_latency{nullptr};
+  };
+
+  void init_launch_descriptor();
+
   // True if |ir| is a frontend AST. False if it's already offloaded to CHI IR.
   bool ir_is_ast_{false};
+  LaunchDescriptor launch_desc_;
+  // The primitive type of each scalar argument, or PrimitiveTypeID::unknown
+  // for the other arguments. Filled by insert_arg() so that setting an
+  // argument in LaunchContextBuilder needs a single switch.
+  std::vector<PrimitiveTypeID> arg_types_;
   // The closure that, if invoked, lauches the backend kernel (shader)
   FunctionType compiled_{nullptr};
   // A flag to record whether |ir| has been fully lowered.
@@ -1,9 +1,12 @@
 #include "kernel_profiler.h"
 
 #include "taichi/system/timer.h"
+#include "taichi/system/threading.h"
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/system/timeline.h"
 
+#include <cmath>
+
 TLANG_NAMESPACE_BEGIN
 
 void KernelProfileRecord::insert_sample(double t) {
@@ -15,12 +18,76 @@ void KernelProfileRecord::insert_sample(double t) {
   min = std::min(min, t);
   max = std::max(max, t);
   total += t;
+  if (bucket_counts.empty()) {
+    bucket_counts.resize(kBucketsPerOctave * kNumOctaves, 0);
+  }
+  bucket_counts[get_bucket(t)]++;
+}
+
+int KernelProfileRecord::get_bucket(double t) {
+  if (!(t > kMinBucketTime)) {
+    return 0;
+  }
+  const int bucket = (int)(std::log2(t / kMinBucketTime) * kBucketsPerOctave);
+  return std::min(bucket, kBucketsPerOctave * kNumOctaves - 1);
+}
+
+void KernelProfileRecord::insert_thread_busy_time(int thread_id, double t) {
+  if (thread_id >= (int)thread_busy.size()) {
+    thread_busy.resize(thread_id + 1, 0);
+  }
+  thread_busy[thread_id] += t;
+}
+
+double KernelProfileRecord::percentile(double p) const {
+  if (counter == 0) {
+    return 0;
+  }
+  // Nearest-rank method
+  auto rank = (int64)std::ceil(p / 100.0 * counter);
+  rank = std::min(std::max(rank, (int64)1), (int64)counter);
+  int bucket = 0;
+  for (int64 seen = 0; bucket < (int)bucket_counts.size(); bucket++) {
+    seen += bucket_counts[bucket];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  // The geometric midpoint of the bucket.
+  const double t =
+      kMinBucketTime * std::exp2((bucket + 0.5) / kBucketsPerOctave);
+  return std::min(std::max(t, min), max);
 }
 
 bool KernelProfileRecord::operator<(const KernelProfileRecord &o) const {
   return total > o.total;
 }
 
+KernelProfileRecord &KernelProfilerBase::get_record(const std::string &name) {
+  auto it =
+      std::find_if(records.begin(), records.end(),
+                   [&](KernelProfileRecord &r) { return r.name == name; });
+  if (it != records.end()) {
+    return *it;
+  }
+  auto &rec = records.emplace_back(name);
+  std::lock_guard<std::mutex> _(offloaded_tasks_mut_);
+  auto task = offloaded_tasks_.find(name);
+  if (task != offloaded_tasks_.end()) {
+    rec.kernel_name = task->second.kernel_name;
+    rec.task_type = task->second.task_type;
+  }
+  return rec;
+}
+
+void KernelProfilerBase::register_offloaded_task(
+    const std::string &task_name,
+    const std::string &kernel_name,
+    OffloadedTaskType task_type) {
+  std::lock_guard<std::mutex> _(offloaded_tasks_mut_);
+  offloaded_tasks_[task_name] = {kernel_name, task_type};
+}
+
 void KernelProfilerBase::profiler_start(KernelProfilerBase *profiler,
                                         const char *kernel_name) {
   TI_ASSERT(profiler);
@@ -34,31 +101,98 @@ void KernelProfilerBase::profiler_stop(KernelProfilerBase *profiler) {
 
 void KernelProfilerBase::print() {
   sync();
-  fmt::print("{}\n", title());
-  fmt::print(
-      "========================================================================"
-      "=\n");
-  fmt::print(
-      "[      %     total   count |      min       avg       max   ] Kernel "
-      "name\n");
-  std::sort(records.begin(), records.end());
-  for (auto &rec : records) {
+  const std::string header =
+      "[      %     total   count |      min       avg       p50       p90  "
+      "     p99       max   ] Kernel name";
+  const auto width = header.size();
+  auto print_record = [&](const KernelProfileRecord &rec,
+                          const std::string &name) {
     auto fraction = rec.total / total_time_ms * 100.0f;
-    fmt::print("[{:6.2f}% {:7.3f} s {:6d}x |{:9.3f} {:9.3f} {:9.3f} ms] {}\n",
-               fraction, rec.total / 1000.0f, rec.counter, rec.min,
-               rec.total / rec.counter, rec.max, rec.name);
+    fmt::print(
+        "[{:6.2f}% {:7.3f} s {:6d}x |{:9.3f} {:9.3f} {:9.3f} {:9.3f} {:9.3f} "
+        "{:9.3f} ms] {}\n",
+        fraction, rec.total / 1000.0f, rec.counter, rec.min,
+        rec.total / rec.counter, rec.percentile(50), rec.percentile(90),
+        rec.percentile(99), rec.max, name);
+    if (!rec.thread_busy.empty()) {
+      // Per launch of the task
+      auto busy_min = *std::min_element(rec.thread_busy.begin(),
+                                        rec.thread_busy.end()) /
+                      rec.counter;
+      auto busy_max = *std::max_element(rec.thread_busy.begin(),
+                                        rec.thread_busy.end()) /
+                      rec.counter;
+      double busy_total = 0;
+      for (auto t : rec.thread_busy) {
+        busy_total += t;
+      }
+      auto num_threads = rec.thread_busy.size();
+      auto idle =
+          std::max(1.0 - busy_total / (num_threads * rec.total), 0.0) * 100.0;
+      fmt::print(
+          "{:>28}threads: {:3d}, busy min/avg/max {:.3f}/{:.3f}/{:.3f} ms, "
+          "idle {:5.2f}%\n",
+          "|", num_threads, busy_min, busy_total / num_threads / rec.counter,
+          busy_max, idle);
+    }
+  };
+
+  // Group the offloaded tasks by their kernels. Other records form groups of
+  // their own.
+  struct Group {
+    std::string kernel_name;
+    double total{0};
+    int counter{0};
+    std::vector<KernelProfileRecord *> records;
+  };
+  std::vector<Group> groups;
+  std::unordered_map<std::string, int> group_ids;
+  for (auto &rec : records) {
+    Group *group;
+    if (rec.kernel_name.empty()) {
+      group = &groups.emplace_back();
+    } else {
+      auto it = group_ids.find(rec.kernel_name);
+      if (it == group_ids.end()) {
+        it = group_ids.emplace(rec.kernel_name, (int)groups.size()).first;
+        groups.emplace_back().kernel_name = rec.kernel_name;
+      }
+      group = &groups[it->second];
+    }
+    group->total += rec.total;
+    group->counter = std::max(group->counter, rec.counter);
+    group->records.push_back(&rec);
   }
-  fmt::print(
-      "------------------------------------------------------------------------"
-      "-\n");
+  std::sort(groups.begin(), groups.end(),
+            [](const Group &a, const Group &b) { return a.total > b.total; });
+
+  fmt::print("{}\n", title());
+  fmt::print("{}\n", std::string(width, '='));
+  fmt::print("{}\n", header);
+  for (auto &group : groups) {
+    if (group.kernel_name.empty()) {
+      print_record(*group.records[0], group.records[0]->name);
+      continue;
+    }
+    fmt::print("[{:6.2f}% {:7.3f} s {:6d}x |{:>62}] {}\n",
+               group.total / total_time_ms * 100.0f, group.total / 1000.0f,
+               group.counter, "", group.kernel_name);
+    std::sort(group.records.begin(), group.records.end(),
+              [](const KernelProfileRecord *a, const KernelProfileRecord *b) {
+                return *a < *b;
+              });
+    for (auto rec : group.records) {
+      print_record(*rec, fmt::format("  - [{}] {}",
+                                     offloaded_task_type_name(rec->task_type),
+                                     rec->name));
+    }
+  }
+  fmt::print("{}\n", std::string(width, '-'));
   fmt::print(
       "[100.00%] Total kernel execution time: {:7.3f} s   number of records: "
       "{}\n",
       get_total_time(), records.size());
-
-  fmt::print(
-      "========================================================================"
-      "=\n");
+  fmt::print("{}\n", std::string(width, '='));
 }
 
 void KernelProfilerBase::query(const std::string &kernel_name,
@@ -107,22 +241,51 @@ class DefaultProfiler : public KernelProfilerBase {
   }
 
   void start(const std::string &kernel_name) override {
+    if (thread_pool_) {
+      // Drops the spans of the launches outside any task.
+      thread_pool_->fetch_activity_spans();
+    }
     start_t_ = Time::get_time();
     event_name_ = kernel_name;
   }
 
   void stop() override {
-    auto t = Time::get_time() - start_t_;
-    auto ms = t * 1000.0;
-    auto it = std::find_if(
-        records.begin(), records.end(),
-        [&](KernelProfileRecord &r) { return r.name == event_name_; });
-    if (it == records.end()) {
-      records.emplace_back(event_name_);
-      it = std::prev(records.end());
-    }
-    it->insert_sample(ms);
+    auto stop_t = Time::get_time();
+    auto ms = (stop_t - start_t_) * 1000.0;
+    auto &rec = get_record(event_name_);
+    rec.insert_sample(ms);
     total_time_ms += ms;
+
+    const bool timeline_enabled = Timelines::get_instance().get_enabled();
+    auto &timeline = Timeline::get_this_thread_instance();
+    if (timeline_enabled) {
+      timeline.insert_event({event_name_, true, start_t_, "cpu"});
+      timeline.insert_event({event_name_, false, stop_t, "cpu"});
+    }
+    if (!thread_pool_) {
+      return;
+    }
+    auto spans = thread_pool_->fetch_activity_spans();
+    bool launched = false;
+    for (auto &thread_spans : spans) {
+      launched = launched || !thread_spans.empty();
+    }
+    if (!launched) {
+      // A serial task
+      return;
+    }
+    for (int t = 0; t < (int)spans.size(); t++) {
+      double busy = 0;
+      for (auto &span : spans[t]) {
+        busy += span.end - span.begin;
+        if (timeline_enabled) {
+          auto tid = fmt::format("cpu_thread_{}", t);
+          timeline.insert_event({event_name_, true, span.begin, tid});
+          timeline.insert_event({event_name_, false, span.end, tid});
+        }
+      }
+      rec.insert_thread_busy_time(t, busy * 1000.0);
+    }
   }
 
  private:
@@ -217,14 +380,7 @@ class KernelProfilerCUDA : public KernelProfilerBase {
                base_time_ + (time_since_base + kernel_time) * 1e-3, "cuda"});
         }
 
-        auto it = std::find_if(
-            records.begin(), records.end(),
-            [&](KernelProfileRecord &r) { return r.name == map_elem.first; });
-        if (it == records.end()) {
-          records.emplace_back(map_elem.first);
-          it = std::prev(records.end());
-        }
-        it->insert_sample(kernel_time);
+        get_record(map_elem.first).insert_sample(kernel_time);
         total_time_ms += kernel_time;
 
         // TODO: the following two lines seem to increases profiler overhead a
@@ -1,15 +1,22 @@
 #pragma once
 
 #include "taichi/program/arch.h"
+#include "taichi/ir/offloaded_task_type.h"
 #include "taichi/lang_util.h"
 
 #include <algorithm>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <regex>
 
+TI_NAMESPACE_BEGIN
+class ThreadPool;
+TI_NAMESPACE_END
+
 TLANG_NAMESPACE_BEGIN
 
 struct KernelProfileRecord {
@@ -18,6 +25,18 @@ struct KernelProfileRecord {
   double min;
   double max;
   double total;
+  // Histogram of the samples for the percentiles, see get_bucket(). Empty
+  // until the first sample.
+  std::vector<int> bucket_counts;
+
+  // The kernel this offloaded task belongs to, and the type of the task. Empty
+  // if |name| was not registered as an offloaded task.
+  std::string kernel_name;
+  OffloadedTaskType task_type{OffloadedTaskType::serial};
+
+  // Time each CPU thread spent working on the task, summed over the samples.
+  // Empty if the task did not run on the thread pool.
+  std::vector<double> thread_busy;
 
   KernelProfileRecord(const std::string &name)
       : name(name), counter(0), min(0), max(0), total(0) {
@@ -25,13 +44,41 @@ struct KernelProfileRecord {
 
   void insert_sample(double t);
 
+  void insert_thread_busy_time(int thread_id, double t);
+
+  // |p| in [0, 100]. Estimated from the histogram, to within about 2.2% of
+  // the exact percentile.
+  double percentile(double p) const;
+
   bool operator<(const KernelProfileRecord &o) const;
+
+ private:
+  // The buckets grow geometrically from kMinBucketTime (in ms), with the
+  // given number of buckets per doubling of time. A bucket spans about 4.4%
+  // of its times, so that its midpoint is within 2.2% of each of them.
+  static constexpr int kBucketsPerOctave = 16;
+  static constexpr int kNumOctaves = 48;
+  static constexpr double kMinBucketTime = 1e-6;
+
+  static int get_bucket(double t);
 };
 
 class KernelProfilerBase {
  protected:
   std::vector<KernelProfileRecord> records;
   double total_time_ms;
+  // Used by the CPU profiler for the per-thread timing.
+  ThreadPool *thread_pool_{nullptr};
+
+  struct OffloadedTaskInfo {
+    std::string kernel_name;
+    OffloadedTaskType task_type;
+  };
+  std::unordered_map<std::string, OffloadedTaskInfo> offloaded_tasks_;
+  std::mutex offloaded_tasks_mut_;
+
+  // Returns the record of |name|, creating it if necessary.
+  KernelProfileRecord &get_record(const std::string &name);
 
  public:
   // Needed for the CUDA backend since we need to know which task to "stop"
@@ -43,6 +90,16 @@ class KernelProfilerBase {
     records.clear();
   }
 
+  // Called by the code generators, so that the records of the offloaded task
+  // |task_name| are grouped under its kernel.
+  void register_offloaded_task(const std::string &task_name,
+                               const std::string &kernel_name,
+                               OffloadedTaskType task_type);
+
+  void set_thread_pool(ThreadPool *thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
   virtual void sync() = 0;
 
   virtual std::string title() const = 0;
@@ -2,6 +2,10 @@
 
 #include "program.h"
 
+#include <mutex>
+#include <unordered_set>
+
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/statements.h"
 #include "taichi/program/extension.h"
 #include "taichi/backends/cpu/codegen_cpu.h"
@@ -17,6 +21,8 @@
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/program/async_engine.h"
 #include "taichi/program/snode_expr_utils.h"
+#include "taichi/program/sparse_parallel.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 #include "taichi/math/arithmetic.h"
 
@@ -66,6 +72,7 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
   if (config.debug)
     config.check_out_of_bound = true;
 
+  sparse_parallel::set_max_num_threads(config.cpu_max_num_threads);
   profiler = make_profiler(config.arch);
   if (arch_uses_llvm(config.arch)) {
     program_impl_ = std::make_unique<LlvmProgramImpl>(config, profiler.get());
@@ -112,7 +119,8 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
   }
 
   // Must have handled all the arch fallback logic by this point.
-  memory_pool = std::make_unique<MemoryPool>(config.arch);
+  memory_pool = std::make_unique<MemoryPool>(
+      config.arch, arch_is_cpu(config.arch) && config.cpu_huge_pages);
   TI_ASSERT_INFO(num_instances_ == 0, "Only one instance at a time");
   total_compilation_time_ = 0;
   num_instances_ += 1;
@@ -135,6 +143,15 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
         &config, snodes, [this](Kernel &kernel, OffloadedStmt *offloaded) {
           return this->compile(kernel, offloaded);
         });
+    if (config.async_max_parallel_launches > 1 && config.kernel_profiler) {
+      // The kernel profiler times one task at a time.
+      TI_WARN("Parallel task launching is disabled by the kernel profiler.");
+    } else if (config.async_max_parallel_launches > 1 &&
+               arch_uses_llvm(config.arch) && arch_is_cpu(config.arch)) {
+      async_engine->queue.enable_parallel_launch(
+          static_cast<LlvmProgramImpl *>(program_impl_.get())
+              ->make_thread_pool_slices(config.async_max_parallel_launches));
+    }
   }
 
   if (!is_extension_supported(config.arch, Extension::assertion)) {
@@ -148,6 +165,8 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
   stat.clear();
 
   Timelines::get_instance().set_enabled(config.timeline);
+  PassProfiler::get_instance().set_enabled(config.pass_profiler);
+  PassProfiler::get_instance().clear();
 
   TI_TRACE("Program ({}) arch={} initialized.", fmt::ptr(this),
            arch_name(config.arch));
@@ -169,6 +188,9 @@ Function *Program::create_function(const FunctionKey &func_key) {
 }
 
 FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
+  static auto *const compile_latency = Metrics::get_instance().histogram(
+      "kernel_compile_seconds", "Time spent in compiling kernels");
+  Histogram::Timer compile_timer(compile_latency);
   auto start_t = Time::get_time();
   TI_AUTO_PROF;
   FunctionType ret = nullptr;
@@ -187,6 +209,67 @@ FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
   return ret;
 }
 
+void Program::compile_kernels(const std::vector<Kernel *> &kernels) {
+  if (config.async_mode) {
+    return;
+  }
+  std::vector<Kernel *> pending;
+  std::unordered_set<Kernel *> visited;
+  for (auto *kernel : kernels) {
+    if (!kernel->is_compiled() && visited.insert(kernel).second) {
+      pending.push_back(kernel);
+    }
+  }
+  bool parallel = config.num_compile_threads > 1 && pending.size() > 1;
+  for (auto *kernel : pending) {
+    if (!arch_uses_llvm(kernel->arch)) {
+      parallel = false;
+    }
+  }
+  if (!parallel) {
+    for (auto *kernel : pending) {
+      kernel->compile();
+    }
+    return;
+  }
+
+  TI_AUTO_PROF;
+  // Lowering runs the IR passes, which rely on Program::current_callable and
+  // may launch evaluator kernels. Only the codegen is thread-safe.
+  for (auto *kernel : pending) {
+    if (!kernel->lowered()) {
+      kernel->lower();
+    }
+  }
+  if (!compilation_workers_) {
+    compilation_workers_ = std::make_unique<ParallelExecutor>(
+        "compiler", config.num_compile_threads);
+  }
+  std::mutex error_mut;
+  std::exception_ptr error;
+  for (auto *kernel : pending) {
+    compilation_workers_->enqueue([kernel, &error_mut, &error]() {
+      try {
+        kernel->compile_lowered();
+      } catch (...) {
+        std::lock_guard<std::mutex> _(error_mut);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  compilation_workers_->flush();
+  static auto *const parallel_compiled_kernels =
+      Metrics::get_instance().counter(
+          "parallel_compiled_kernels",
+          "Kernels compiled on the compilation workers");
+  parallel_compiled_kernels->add(pending.size());
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 void Program::materialize_runtime() {
   if (arch_uses_llvm(config.arch) || config.arch == Arch::metal ||
       config.arch == Arch::vulkan || config.arch == Arch::opengl) {
@@ -239,6 +322,9 @@ void Program::check_runtime_error() {
 
 void Program::synchronize() {
   if (!sync) {
+    static auto *const sync_latency = Metrics::get_instance().histogram(
+        "sync_seconds", "Time spent in waiting for the launched kernels");
+    Histogram::Timer sync_timer(sync_latency);
     if (config.async_mode) {
       async_engine->synchronize();
     }
@@ -419,6 +505,7 @@ void Program::finalize() {
   if (async_engine)
     async_engine = nullptr;  // Finalize the async engine threads before
                              // anything else gets destoried.
+  compilation_workers_ = nullptr;
   TI_TRACE("Program finalizing...");
   if (config.print_benchmark_stat) {
     const char *current_test = std::getenv("PYTEST_CURRENT_TEST");
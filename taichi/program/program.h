@@ -32,48 +32,6 @@
 namespace taichi {
 namespace lang {
 
-struct JITEvaluatorId {
-  std::thread::id thread_id;
-  // Note that on certain backends (e.g. CUDA), functions created in one
-  // thread cannot be used in another. Hence the thread_id member.
-  int op;
-  DataType ret, lhs, rhs;
-  bool is_binary;
-
-  UnaryOpType unary_op() const {
-    TI_ASSERT(!is_binary);
-    return (UnaryOpType)op;
-  }
-
-  BinaryOpType binary_op() const {
-    TI_ASSERT(is_binary);
-    return (BinaryOpType)op;
-  }
-
-  bool operator==(const JITEvaluatorId &o) const {
-    return thread_id == o.thread_id && op == o.op && ret == o.ret &&
-           lhs == o.lhs && rhs == o.rhs && is_binary == o.is_binary;
-  }
-};
-
-}  // namespace lang
-}  // namespace taichi
-
-namespace std {
-template <>
-struct hash<taichi::lang::JITEvaluatorId> {
-  std::size_t operator()(
-      taichi::lang::JITEvaluatorId const &id) const noexcept {
-    return ((std::size_t)id.op | (id.ret.hash() << 8) | (id.lhs.hash() << 16) |
-            (id.rhs.hash() << 24) | ((std::size_t)id.is_binary << 31)) ^
-           (std::hash<std::thread::id>{}(id.thread_id) << 32);
-  }
-};
-}  // namespace std
-
-namespace taichi {
-namespace lang {
-
 extern Program *current_program;
 
 TI_FORCE_INLINE Program &get_current_program() {
@@ -84,6 +42,8 @@ class StructCompiler;
 
 class AsyncEngine;
 
+class ParallelExecutor;
+
 /**
  * Note [Backend-specific ProgramImpl]
  * We're working in progress to keep Program class minimal and move all backend
@@ -115,10 +75,6 @@ class Program {
 
   std::unique_ptr<KernelProfilerBase> profiler{nullptr};
 
-  std::unordered_map<JITEvaluatorId, std::unique_ptr<Kernel>>
-      jit_evaluator_cache;
-  std::mutex jit_evaluator_cache_mut;
-
   // Note: for now we let all Programs share a single TypeFactory for smooth
   // migration. In the future each program should have its own copy.
   static TypeFactory &get_type_factory();
@@ -209,6 +165,21 @@ class Program {
 
   Function *create_function(const FunctionKey &func_key);
 
+  /**
+   * Compiles the given kernels ahead of their first launch.
+   *
+   * On the LLVM backends, the kernels are lowered one after another on the
+   * calling thread, and then their code generation and JIT compilation run
+   * in parallel on up to |config.num_compile_threads| threads. On the C
+   * backend, the kernels are compiled one after another, and each of them
+   * then runs the C compiler in the background on one of these threads.
+   * Kernels that have already been compiled are skipped. This is a no-op in
+   * async mode, where the AsyncEngine compiles the offloaded tasks instead.
+   *
+   * @param kernels The kernels to compile.
+   */
+  void compile_kernels(const std::vector<Kernel *> &kernels);
+
   // TODO: This function is doing two things: 1) compiling CHI IR, and 2)
   // offloading them to each backend. We should probably separate the logic?
   // TODO: Optional offloaded is used by async mode, we might refactor it in the
@@ -310,6 +281,8 @@ class Program {
   std::unordered_map<FunctionKey, Function *> function_map_;
 
   std::unique_ptr<ProgramImpl> program_impl_;
+  // Created on the first call to compile_kernels().
+  std::unique_ptr<ParallelExecutor> compilation_workers_;
   float64 total_compilation_time_{0.0};
   static std::atomic<int> num_instances_;
   bool finalized_{false};
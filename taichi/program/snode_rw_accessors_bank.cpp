@@ -1,24 +1,78 @@
 #include "taichi/program/snode_rw_accessors_bank.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 #include "taichi/program/program.h"
 
 namespace taichi {
 namespace lang {
 
 namespace {
-void set_kernel_args(const std::vector<int> &I,
+void set_kernel_args(const int32 *I,
                      int num_active_indices,
                      Kernel::LaunchContextBuilder *launch_ctx) {
   for (int i = 0; i < num_active_indices; i++) {
     launch_ctx->set_arg_int(i, I[i]);
   }
 }
+
+#define TI_FOR_EACH_HOST_ACCESSIBLE_TYPE(F) \
+  F(f32, float32)                           \
+  F(f64, float64)                           \
+  F(i8, int8)                               \
+  F(i16, int16)                             \
+  F(i32, int32)                             \
+  F(i64, int64)                             \
+  F(u8, uint8)                              \
+  F(u16, uint16)                            \
+  F(u32, uint32)                            \
+  F(u64, uint64)
+
+bool is_host_accessible_type(DataType dt) {
+#define CHECK_TYPE(id, type)                 \
+  if (dt->is_primitive(PrimitiveTypeID::id)) \
+    return true;
+  TI_FOR_EACH_HOST_ACCESSIBLE_TYPE(CHECK_TYPE)
+#undef CHECK_TYPE
+  return false;
+}
+
+template <typename T>
+T load_as(DataType dt, const void *ptr) {
+#define LOAD_TYPE(id, type)                    \
+  if (dt->is_primitive(PrimitiveTypeID::id)) { \
+    type val;                                  \
+    std::memcpy(&val, ptr, sizeof(type));      \
+    return (T)val;                             \
+  }
+  TI_FOR_EACH_HOST_ACCESSIBLE_TYPE(LOAD_TYPE)
+#undef LOAD_TYPE
+  TI_NOT_IMPLEMENTED;
+}
+
+template <typename T>
+void store_as(DataType dt, void *ptr, T val) {
+#define STORE_TYPE(id, type)                   \
+  if (dt->is_primitive(PrimitiveTypeID::id)) { \
+    type v = (type)val;                        \
+    std::memcpy(ptr, &v, sizeof(type));        \
+    return;                                    \
+  }
+  TI_FOR_EACH_HOST_ACCESSIBLE_TYPE(STORE_TYPE)
+#undef STORE_TYPE
+  TI_NOT_IMPLEMENTED;
+}
+
+#undef TI_FOR_EACH_HOST_ACCESSIBLE_TYPE
 }  // namespace
 
 SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get(SNode *snode) {
   auto &kernels = snode_to_kernels_[snode];
   if (kernels.reader == nullptr) {
     kernels.reader = &(program_->get_snode_reader(snode));
+    kernels.host_layout = make_host_layout(snode);
   }
   if (kernels.writer == nullptr) {
     kernels.writer = &(program_->get_snode_writer(snode));
@@ -26,32 +80,135 @@ SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get(SNode *snode) {
   return Accessors(snode, kernels, program_);
 }
 
+std::unique_ptr<SNodeRwAccessorsBank::HostLayout>
+SNodeRwAccessorsBank::make_host_layout(const SNode *snode) const {
+  const auto &config = program_->config;
+  if (!arch_is_cpu(config.arch) || snode->is_bit_level ||
+      !is_host_accessible_type(snode->dt)) {
+    return nullptr;
+  }
+  // From root to leaf
+  std::vector<const SNode *> snodes;
+  for (auto *s = snode; s != nullptr; s = s->parent) {
+    snodes.push_back(s);
+  }
+  std::reverse(snodes.begin(), snodes.end());
+  if (snodes.front()->type != SNodeType::root) {
+    return nullptr;
+  }
+  for (int i = 1; i + 1 < (int)snodes.size(); i++) {
+    if (snodes[i]->type != SNodeType::dense) {
+      return nullptr;
+    }
+  }
+
+  auto layout = std::make_unique<HostLayout>();
+  layout->snode_tree_id = snodes.front()->get_snode_tree_id();
+  const int num_indices = snode->num_active_indices;
+  for (int i = 0; i < num_indices; i++) {
+    layout->shape.push_back(snode->shape_along_axis(i));
+    layout->index_offsets.push_back(
+        snode->index_offsets.empty() ? 0 : snode->index_offsets[i]);
+  }
+
+  // See ScalarPointerLowerer::run(). Bit extraction of non-negative indices
+  // is expressed as (I % (1 << end)) / (1 << begin).
+  std::array<int, taichi_max_num_indices> start_bits = {0};
+  std::array<int64, taichi_max_num_indices> total_shape;
+  total_shape.fill(1);
+  for (const auto *s : snodes) {
+    for (int j = 0; j < taichi_max_num_indices; j++) {
+      start_bits[j] += s->extractors[j].num_bits;
+      total_shape[j] *= s->extractors[j].shape;
+    }
+  }
+  for (int i = 0; i + 1 < (int)snodes.size(); i++) {
+    const auto *s = snodes[i];
+    HostLayout::Level level;
+    for (int k_ = 0; k_ < num_indices; k_++) {
+      const int k = s->physical_index_position[k_];
+      if (k < 0)
+        continue;
+      HostLayout::Axis axis;
+      axis.index = k_;
+      if (config.packed) {
+        axis.prev = total_shape[k];
+        total_shape[k] /= s->extractors[k].shape;
+        axis.next = total_shape[k];
+      } else {
+        axis.prev = int64(1) << start_bits[k];
+        start_bits[k] -= s->extractors[k].num_bits;
+        axis.next = int64(1) << start_bits[k];
+      }
+      axis.shape = s->extractors[k].shape;
+      level.axes.push_back(axis);
+    }
+    level.cell_size = s->cell_size_bytes;
+    level.child_offset = snodes[i + 1]->offset_bytes_in_parent_cell;
+    layout->levels.push_back(std::move(level));
+  }
+  return layout;
+}
+
 SNodeRwAccessorsBank::Accessors::Accessors(const SNode *snode,
                                            const RwKernels &kernels,
                                            Program *prog)
     : snode_(snode),
       prog_(prog),
       reader_(kernels.reader),
-      writer_(kernels.writer) {
+      writer_(kernels.writer),
+      host_layout_(kernels.host_layout.get()) {
   TI_ASSERT(reader_ != nullptr);
   TI_ASSERT(writer_ != nullptr);
 }
+
+uint8 *SNodeRwAccessorsBank::Accessors::get_host_address(
+    const int32 *I) const {
+  if (host_layout_ == nullptr) {
+    return nullptr;
+  }
+  int32 indices[taichi_max_num_indices];
+  for (int i = 0; i < snode_->num_active_indices; i++) {
+    indices[i] = I[i] - host_layout_->index_offsets[i];
+    // Leave out-of-bound accesses to the kernels, which check them in debug
+    // mode.
+    if (indices[i] < 0 || indices[i] >= host_layout_->shape[i]) {
+      return nullptr;
+    }
+  }
+  auto *addr = prog_->get_llvm_program_impl()->get_snode_tree_root(
+      host_layout_->snode_tree_id);
+  for (const auto &level : host_layout_->levels) {
+    int64 linearized = 0;
+    for (const auto &axis : level.axes) {
+      linearized = linearized * axis.shape +
+                   (indices[axis.index] % axis.prev) / axis.next;
+    }
+    addr += linearized * level.cell_size + level.child_offset;
+  }
+  return addr;
+}
+
 void SNodeRwAccessorsBank::Accessors::write_float(const std::vector<int> &I,
                                                   float64 val) {
-  auto launch_ctx = writer_->make_launch_context();
-  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
-  for (int i = 0; i < snode_->num_active_indices; i++) {
-    launch_ctx.set_arg_int(i, I[i]);
+  prog_->synchronize();
+  if (auto *addr = get_host_address(I.data())) {
+    store_as(snode_->dt, addr, val);
+    return;
   }
+  auto launch_ctx = writer_->make_launch_context();
+  set_kernel_args(I.data(), snode_->num_active_indices, &launch_ctx);
   launch_ctx.set_arg_float(snode_->num_active_indices, val);
-  prog_->synchronize();
   (*writer_)(launch_ctx);
 }
 
 float64 SNodeRwAccessorsBank::Accessors::read_float(const std::vector<int> &I) {
   prog_->synchronize();
+  if (auto *addr = get_host_address(I.data())) {
+    return load_as<float64>(snode_->dt, addr);
+  }
   auto launch_ctx = reader_->make_launch_context();
-  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
+  set_kernel_args(I.data(), snode_->num_active_indices, &launch_ctx);
   (*reader_)(launch_ctx);
   prog_->synchronize();
   auto ret = reader_->get_ret_float(0);
@@ -61,17 +218,24 @@ float64 SNodeRwAccessorsBank::Accessors::read_float(const std::vector<int> &I) {
 // for int32 and int64
 void SNodeRwAccessorsBank::Accessors::write_int(const std::vector<int> &I,
                                                 int64 val) {
+  prog_->synchronize();
+  if (auto *addr = get_host_address(I.data())) {
+    store_as(snode_->dt, addr, val);
+    return;
+  }
   auto launch_ctx = writer_->make_launch_context();
-  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
+  set_kernel_args(I.data(), snode_->num_active_indices, &launch_ctx);
   launch_ctx.set_arg_int(snode_->num_active_indices, val);
-  prog_->synchronize();
   (*writer_)(launch_ctx);
 }
 
 int64 SNodeRwAccessorsBank::Accessors::read_int(const std::vector<int> &I) {
   prog_->synchronize();
+  if (auto *addr = get_host_address(I.data())) {
+    return load_as<int64>(snode_->dt, addr);
+  }
   auto launch_ctx = reader_->make_launch_context();
-  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
+  set_kernel_args(I.data(), snode_->num_active_indices, &launch_ctx);
   (*reader_)(launch_ctx);
   prog_->synchronize();
   auto ret = reader_->get_ret_int(0);
@@ -82,5 +246,72 @@ uint64 SNodeRwAccessorsBank::Accessors::read_uint(const std::vector<int> &I) {
   return (uint64)read_int(I);
 }
 
+void SNodeRwAccessorsBank::Accessors::write_via_kernel(const int32 *I,
+                                                       const void *val) {
+  auto launch_ctx = writer_->make_launch_context();
+  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
+  if (is_real(snode_->dt)) {
+    launch_ctx.set_arg_float(snode_->num_active_indices,
+                             load_as<float64>(snode_->dt, val));
+  } else {
+    launch_ctx.set_arg_int(snode_->num_active_indices,
+                           load_as<int64>(snode_->dt, val));
+  }
+  (*writer_)(launch_ctx);
+}
+
+void SNodeRwAccessorsBank::Accessors::read_via_kernel(const int32 *I,
+                                                      void *out) {
+  auto launch_ctx = reader_->make_launch_context();
+  set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
+  (*reader_)(launch_ctx);
+  prog_->synchronize();
+  if (is_real(snode_->dt)) {
+    store_as(snode_->dt, out, reader_->get_ret_float(0));
+  } else {
+    store_as(snode_->dt, out, reader_->get_ret_int(0));
+  }
+}
+
+void SNodeRwAccessorsBank::Accessors::read_batch(const int32 *indices,
+                                                 int64 n,
+                                                 void *out) {
+  TI_ERROR_IF(!is_host_accessible_type(snode_->dt),
+              "Batched reads of {} are not supported.",
+              snode_->dt->to_string());
+  const int num_indices = snode_->num_active_indices;
+  const auto size = data_type_size(snode_->dt);
+  auto *dst = static_cast<uint8 *>(out);
+  prog_->synchronize();
+  for (int64 i = 0; i < n; i++) {
+    const int32 *I = indices + i * num_indices;
+    if (auto *addr = get_host_address(I)) {
+      std::memcpy(dst + i * size, addr, size);
+    } else {
+      read_via_kernel(I, dst + i * size);
+    }
+  }
+}
+
+void SNodeRwAccessorsBank::Accessors::write_batch(const int32 *indices,
+                                                  int64 n,
+                                                  const void *values) {
+  TI_ERROR_IF(!is_host_accessible_type(snode_->dt),
+              "Batched writes of {} are not supported.",
+              snode_->dt->to_string());
+  const int num_indices = snode_->num_active_indices;
+  const auto size = data_type_size(snode_->dt);
+  const auto *src = static_cast<const uint8 *>(values);
+  prog_->synchronize();
+  for (int64 i = 0; i < n; i++) {
+    const int32 *I = indices + i * num_indices;
+    if (auto *addr = get_host_address(I)) {
+      std::memcpy(addr, src + i * size, size);
+    } else {
+      write_via_kernel(I, src + i * size);
+    }
+  }
+}
+
 }  // namespace lang
 }  // namespace taichi
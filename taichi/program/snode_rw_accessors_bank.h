@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 
 #include "taichi/program/kernel.h"
@@ -15,12 +16,46 @@ class Program;
  * The main purpose of this class is to decouple the accessor kernels from the
  * SNode class itself. Ideally, SNode should be nothing more than a group of
  * plain data.
+ *
+ * On CPU backends, elements of SNodes that are only nested in dense SNodes
+ * are accessed directly on the host, without launching the kernels.
  */
 class SNodeRwAccessorsBank {
  private:
+  /**
+   * Describes how to compute the address of an element from the root buffer
+   * of its SNode tree, following ScalarPointerLowerer.
+   */
+  struct HostLayout {
+    struct Axis {
+      // Which index of the element this axis is extracted from
+      int index{0};
+      // The coordinate along this axis is (I[index] % prev) / next
+      int64 prev{1};
+      int64 next{1};
+      // The shape along this axis, used for linearization
+      int64 shape{1};
+    };
+
+    struct Level {
+      std::vector<Axis> axes;
+      std::size_t cell_size{0};
+      // Offset of the next SNode on the path within a cell
+      std::size_t child_offset{0};
+    };
+
+    std::vector<Level> levels;
+    // Elements beyond these (index offsets excluded) go through the kernels
+    std::vector<int> shape;
+    std::vector<int> index_offsets;
+    int snode_tree_id{0};
+  };
+
   struct RwKernels {
     Kernel *reader{nullptr};
     Kernel *writer{nullptr};
+    // nullptr if the elements cannot be accessed on the host
+    std::unique_ptr<HostLayout> host_layout;
   };
 
  public:
@@ -39,11 +74,36 @@ class SNodeRwAccessorsBank {
     int64 read_int(const std::vector<int> &I);
     uint64 read_uint(const std::vector<int> &I);
 
+    /**
+     * Reads the elements at a batch of indices.
+     *
+     * @param indices: |n| index tuples of |num_active_indices| each
+     * @param n: Number of elements
+     * @param out: Receives |n| values of the data type of the SNode
+     */
+    void read_batch(const int32 *indices, int64 n, void *out);
+
+    /**
+     * Writes the elements at a batch of indices.
+     *
+     * @param indices: |n| index tuples of |num_active_indices| each
+     * @param n: Number of elements
+     * @param values: |n| values of the data type of the SNode
+     */
+    void write_batch(const int32 *indices, int64 n, const void *values);
+
    private:
+    // Returns nullptr if the element must be accessed through the kernels.
+    uint8 *get_host_address(const int32 *I) const;
+
+    void write_via_kernel(const int32 *I, const void *val);
+    void read_via_kernel(const int32 *I, void *out);
+
     const SNode *snode_;
     Program *prog_;
     Kernel *reader_;
     Kernel *writer_;
+    const HostLayout *host_layout_;
   };
 
   explicit SNodeRwAccessorsBank(Program *program) : program_(program) {
@@ -52,6 +112,8 @@ class SNodeRwAccessorsBank {
   Accessors get(SNode *snode);
 
  private:
+  std::unique_ptr<HostLayout> make_host_layout(const SNode *snode) const;
+
   Program *const program_;
   std::unordered_map<const SNode *, RwKernels> snode_to_kernels_;
 };
@@ -1,122 +1,409 @@
 #include "taichi/program/sparse_matrix.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <sstream>
 
 #include "Eigen/Dense"
 #include "Eigen/SparseLU"
+#include "taichi/program/sparse_parallel.h"
 
 namespace taichi {
 namespace lang {
 
+namespace {
+
+using sparse_parallel::for_each_range;
+using sparse_parallel::num_threads_for;
+
+// Must match the stores in insert_triplet() of the runtime.
+template <typename T>
+struct Triplet {
+  int32 row;
+  int32 col;
+  T value;
+};
+
+static_assert(sizeof(Triplet<float32>) == 12, "");
+static_assert(sizeof(Triplet<float64>) == 16, "");
+
+template <typename T>
+void atomic_add(std::atomic<T> &dest, T val) {
+  T old = dest.load(std::memory_order_relaxed);
+  while (!dest.compare_exchange_weak(old, old + val,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+template <typename T>
+bool in_range(const Triplet<T> &t, int rows, int cols) {
+  return t.row >= 0 && t.row < rows && t.col >= 0 && t.col < cols;
+}
+
+}  // namespace
+
 SparseMatrixBuilder::SparseMatrixBuilder(int rows,
                                          int cols,
-                                         int max_num_triplets)
-    : rows_(rows), cols_(cols), max_num_triplets_(max_num_triplets) {
-  data_.reserve(max_num_triplets * 3);
+                                         int64 max_num_triplets,
+                                         DataType dtype)
+    : max_num_triplets_(max_num_triplets),
+      rows_(rows),
+      cols_(cols),
+      dtype_(dtype) {
+  TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32) &&
+                  !dtype->is_primitive(PrimitiveTypeID::f64),
+              "Sparse matrices of {} are not supported.", dtype->to_string());
+  value_is_f64_ = dtype->is_primitive(PrimitiveTypeID::f64);
+  const auto triplet_size =
+      value_is_f64_ ? sizeof(Triplet<float64>) : sizeof(Triplet<float32>);
+  data_.reset(new uint8[max_num_triplets * triplet_size]);
   data_base_ptr_ = get_data_base_ptr();
 }
 
 void *SparseMatrixBuilder::get_data_base_ptr() {
-  return data_.data();
+  return data_.get();
 }
 
 void SparseMatrixBuilder::print_triplets() {
   fmt::print("n={}, m={}, num_triplets={} (max={})", rows_, cols_,
              num_triplets_, max_num_triplets_);
-  for (int64 i = 0; i < num_triplets_; i++) {
-    fmt::print("({}, {}) val={}", data_[i * 3], data_[i * 3 + 1],
-               taichi_union_cast<float32>(data_[i * 3 + 2]));
+  const auto n = std::min(num_triplets_, max_num_triplets_);
+  for (int64 i = 0; i < n; i++) {
+    if (value_is_f64_) {
+      const auto &t = reinterpret_cast<Triplet<float64> *>(data_.get())[i];
+      fmt::print("({}, {}) val={}", t.row, t.col, t.value);
+    } else {
+      const auto &t = reinterpret_cast<Triplet<float32> *>(data_.get())[i];
+      fmt::print("({}, {}) val={}", t.row, t.col, t.value);
+    }
   }
   fmt::print("\n");
 }
 
 SparseMatrix SparseMatrixBuilder::build() {
+  TI_ERROR_IF(value_is_f64_, "Use build_f64() for builders of f64.");
+  return build_typed<float32>();
+}
+
+SparseMatrix64 SparseMatrixBuilder::build_f64() {
+  TI_ERROR_IF(!value_is_f64_, "Use build() for builders of f32.");
+  return build_typed<float64>();
+}
+
+void SparseMatrixBuilder::clear() {
+  num_triplets_ = 0;
+  built_ = false;
+}
+
+template <typename T>
+TypedSparseMatrix<T> SparseMatrixBuilder::build_typed() {
   TI_ASSERT(built_ == false);
+  TI_ERROR_IF(num_triplets_ > max_num_triplets_,
+              "{} triplets were inserted, exceeding max_num_triplets={}.",
+              num_triplets_, max_num_triplets_);
   built_ = true;
-  using T = Eigen::Triplet<float32>;
-  std::vector<T> triplets;
-  for (int i = 0; i < num_triplets_; i++) {
-    triplets.push_back(T(data_[i * 3], data_[i * 3 + 1],
-                         taichi_union_cast<float32>(data_[i * 3 + 2])));
+  TypedSparseMatrix<T> sm(rows_, cols_);
+  if (!build_with_pattern(sm)) {
+    build_from_scratch(sm);
   }
-  SparseMatrix sm(rows_, cols_);
-  sm.get_matrix().setFromTriplets(triplets.begin(), triplets.end());
   return sm;
 }
 
-SparseMatrix::SparseMatrix(Eigen::SparseMatrix<float32> &matrix) {
+template <typename T>
+bool SparseMatrixBuilder::build_with_pattern(TypedSparseMatrix<T> &sm) const {
+  if (pattern_outer_.empty()) {
+    return false;
+  }
+  const auto *triplets = reinterpret_cast<const Triplet<T> *>(data_.get());
+  const int64 nnz = pattern_inner_.size();
+  std::unique_ptr<std::atomic<T>[]> values(new std::atomic<T>[nnz]);
+  std::unique_ptr<std::atomic<uint8>[]> hit(new std::atomic<uint8>[nnz]);
+  for_each_range(nnz, [&](int64 begin, int64 end) {
+    for (int64 k = begin; k < end; k++) {
+      values[k].store(0, std::memory_order_relaxed);
+      hit[k].store(0, std::memory_order_relaxed);
+    }
+  });
+
+  std::atomic<bool> matched{true};
+  for_each_range(num_triplets_, [&](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      const auto &t = triplets[i];
+      if (!in_range(t, rows_, cols_)) {
+        matched = false;
+        return;
+      }
+      const auto col_begin = pattern_inner_.begin() + pattern_outer_[t.col];
+      const auto col_end = pattern_inner_.begin() + pattern_outer_[t.col + 1];
+      const auto it = std::lower_bound(col_begin, col_end, t.row);
+      if (it == col_end || *it != t.row) {
+        matched = false;
+        return;
+      }
+      const auto k = it - pattern_inner_.begin();
+      atomic_add(values[k], t.value);
+      hit[k].store(1, std::memory_order_relaxed);
+    }
+  });
+  if (!matched) {
+    return false;
+  }
+  // Nonzeros that are no longer hit change the pattern as well.
+  for_each_range(nnz, [&](int64 begin, int64 end) {
+    for (int64 k = begin; k < end; k++) {
+      if (!hit[k].load(std::memory_order_relaxed)) {
+        matched = false;
+        return;
+      }
+    }
+  });
+  if (!matched) {
+    return false;
+  }
+
+  auto &matrix = sm.get_matrix();
+  matrix.resizeNonZeros(nnz);
+  std::copy(pattern_outer_.begin(), pattern_outer_.end(),
+            matrix.outerIndexPtr());
+  for_each_range(nnz, [&](int64 begin, int64 end) {
+    for (int64 k = begin; k < end; k++) {
+      matrix.innerIndexPtr()[k] = pattern_inner_[k];
+      matrix.valuePtr()[k] = values[k].load(std::memory_order_relaxed);
+    }
+  });
+  return true;
+}
+
+template <typename T>
+void SparseMatrixBuilder::build_from_scratch(TypedSparseMatrix<T> &sm) {
+  // Eigen matrices are stored column by column, so the triplets are bucketed
+  // by column first (a counting sort, i.e. a one-digit radix sort), and then
+  // sorted by row within each column.
+  const auto *triplets = reinterpret_cast<const Triplet<T> *>(data_.get());
+  const int64 n = num_triplets_;
+
+  std::unique_ptr<std::atomic<int64>[]> col_cursor(
+      new std::atomic<int64>[cols_ + 1]);
+  for (int c = 0; c <= cols_; c++) {
+    col_cursor[c].store(0, std::memory_order_relaxed);
+  }
+  std::atomic<bool> valid{true};
+  for_each_range(n, [&](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      if (!in_range(triplets[i], rows_, cols_)) {
+        valid = false;
+        return;
+      }
+      col_cursor[triplets[i].col].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  TI_ERROR_IF(!valid, "Triplet indices are out of the {}x{} matrix.", rows_,
+              cols_);
+
+  std::vector<int64> col_begin(cols_ + 1, 0);
+  for (int c = 0; c < cols_; c++) {
+    const auto count = col_cursor[c].load(std::memory_order_relaxed);
+    col_begin[c + 1] = col_begin[c] + count;
+    col_cursor[c].store(col_begin[c], std::memory_order_relaxed);
+  }
+
+  std::vector<int64> order(n);
+  for_each_range(n, [&](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      const auto pos =
+          col_cursor[triplets[i].col].fetch_add(1, std::memory_order_relaxed);
+      order[pos] = i;
+    }
+  });
+
+  // Sorting by (row, triplet index) sums up duplicates in insertion order,
+  // regardless of how the buckets were scattered.
+  std::vector<int32> rows(n);
+  std::vector<T> values(n);
+  std::vector<int64> col_nnz(cols_ + 1, 0);
+  for_each_range(cols_, [&](int64 col_start, int64 col_end) {
+    for (int64 c = col_start; c < col_end; c++) {
+      const auto first = order.begin() + col_begin[c];
+      const auto last = order.begin() + col_begin[c + 1];
+      std::sort(first, last, [&](int64 a, int64 b) {
+        if (triplets[a].row != triplets[b].row) {
+          return triplets[a].row < triplets[b].row;
+        }
+        return a < b;
+      });
+      int64 k = col_begin[c] - 1;
+      for (auto it = first; it != last; ++it) {
+        const auto &t = triplets[*it];
+        if (k < col_begin[c] || rows[k] != t.row) {
+          k++;
+          rows[k] = t.row;
+          values[k] = t.value;
+        } else {
+          values[k] += t.value;
+        }
+      }
+      col_nnz[c + 1] = k + 1 - col_begin[c];
+    }
+  });
+
+  pattern_outer_.assign(cols_ + 1, 0);
+  for (int c = 0; c < cols_; c++) {
+    pattern_outer_[c + 1] = pattern_outer_[c] + col_nnz[c + 1];
+  }
+  const int64 nnz = pattern_outer_[cols_];
+  TI_ERROR_IF(nnz > std::numeric_limits<int32>::max(),
+              "{} nonzeros exceed the 32-bit indices of Eigen.", nnz);
+  pattern_inner_.resize(nnz);
+
+  auto &matrix = sm.get_matrix();
+  matrix.resizeNonZeros(nnz);
+  std::copy(pattern_outer_.begin(), pattern_outer_.end(),
+            matrix.outerIndexPtr());
+  for_each_range(cols_, [&](int64 col_start, int64 col_end) {
+    for (int64 c = col_start; c < col_end; c++) {
+      const auto src = col_begin[c];
+      const auto dst = pattern_outer_[c];
+      for (int64 k = 0; k < col_nnz[c + 1]; k++) {
+        pattern_inner_[dst + k] = rows[src + k];
+        matrix.innerIndexPtr()[dst + k] = rows[src + k];
+        matrix.valuePtr()[dst + k] = values[src + k];
+      }
+    }
+  });
+}
+
+template <typename T>
+TypedSparseMatrix<T>::TypedSparseMatrix(EigenMatrix &matrix) {
   this->matrix_ = matrix;
 }
 
-SparseMatrix::SparseMatrix(int rows, int cols) : matrix_(rows, cols) {
+template <typename T>
+TypedSparseMatrix<T>::TypedSparseMatrix(int rows, int cols)
+    : matrix_(rows, cols) {
 }
 
-const std::string SparseMatrix::to_string() const {
+template <typename T>
+const std::string TypedSparseMatrix<T>::to_string() const {
   Eigen::IOFormat clean_fmt(4, 0, ", ", "\n", "[", "]");
   // Note that the code below first converts the sparse matrix into a dense one.
   // https://stackoverflow.com/questions/38553335/how-can-i-print-in-console-a-formatted-sparse-matrix-with-eigen
   std::ostringstream ostr;
-  ostr << Eigen::MatrixXf(matrix_).format(clean_fmt);
+  ostr << Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(matrix_).format(
+      clean_fmt);
   return ostr.str();
 }
 
-const int SparseMatrix::num_rows() const {
+template <typename T>
+const int TypedSparseMatrix<T>::num_rows() const {
   return matrix_.rows();
 }
-const int SparseMatrix::num_cols() const {
+
+template <typename T>
+const int TypedSparseMatrix<T>::num_cols() const {
   return matrix_.cols();
 }
 
-Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() {
+template <typename T>
+typename TypedSparseMatrix<T>::EigenMatrix &
+TypedSparseMatrix<T>::get_matrix() {
   return matrix_;
 }
 
-const Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() const {
+template <typename T>
+const typename TypedSparseMatrix<T>::EigenMatrix &
+TypedSparseMatrix<T>::get_matrix() const {
   return matrix_;
 }
 
-SparseMatrix operator+(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ + sm2.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator-(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ - sm2.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator*(float scale, const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(scale * sm.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator*(const SparseMatrix &sm, float scale) {
-  return scale * sm;
-}
-
-SparseMatrix operator*(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_.cwiseProduct(sm2.matrix_));
-  return SparseMatrix(res);
-}
-
-SparseMatrix SparseMatrix::matmul(const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(matrix_ * sm.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+TypedSparseMatrix<T> TypedSparseMatrix<T>::matmul(
+    const TypedSparseMatrix &sm) {
+  EigenMatrix res(matrix_ * sm.matrix_);
+  return TypedSparseMatrix(res);
 }
 
-Eigen::VectorXf SparseMatrix::mat_vec_mul(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
-  return matrix_ * b;
+template <typename T>
+typename TypedSparseMatrix<T>::EigenVector TypedSparseMatrix<T>::mat_vec_mul(
+    const Eigen::Ref<const EigenVector> &b) {
+  TI_ASSERT(b.size() == matrix_.cols());
+  const auto num_threads = num_threads_for(matrix_.nonZeros());
+  if (num_threads == 1) {
+    return matrix_ * b;
+  }
+  const int64 rows = matrix_.rows();
+  EigenVector res(rows);
+  if (EigenMatrix::IsRowMajor) {
+    // Each thread writes the rows it owns.
+    for_each_range(rows, num_threads, [&](int64, int64 begin, int64 end) {
+      for (int64 r = begin; r < end; r++) {
+        T sum = 0;
+        for (typename EigenMatrix::InnerIterator it(matrix_, r); it; ++it) {
+          sum += it.value() * b[it.col()];
+        }
+        res[r] = sum;
+      }
+    });
+    return res;
+  }
+  // The matrix is stored column by column, so each thread accumulates the
+  // products of a block of columns. Its partial result only spans the rows
+  // that block touches, which is a narrow band for most matrices from
+  // meshes.
+  struct ColumnBlock {
+    int64 row_begin{0};
+    int64 row_end{0};
+    EigenVector y;
+  };
+  std::vector<ColumnBlock> blocks(num_threads);
+  for_each_range(
+      matrix_.outerSize(), num_threads, [&](int64 t, int64 begin, int64 end) {
+        auto &block = blocks[t];
+        block.row_begin = rows;
+        for (int64 c = begin; c < end; c++) {
+          for (typename EigenMatrix::InnerIterator it(matrix_, c); it; ++it) {
+            block.row_begin = std::min<int64>(block.row_begin, it.row());
+            block.row_end = std::max<int64>(block.row_end, it.row() + 1);
+          }
+        }
+        if (block.row_begin >= block.row_end) {
+          block.row_begin = block.row_end = 0;
+          return;
+        }
+        block.y = EigenVector::Zero(block.row_end - block.row_begin);
+        for (int64 c = begin; c < end; c++) {
+          for (typename EigenMatrix::InnerIterator it(matrix_, c); it; ++it) {
+            block.y[it.row() - block.row_begin] += it.value() * b[c];
+          }
+        }
+      });
+  for_each_range(rows, num_threads, [&](int64, int64 begin, int64 end) {
+    for (int64 r = begin; r < end; r++) {
+      T sum = 0;
+      for (const auto &block : blocks) {
+        if (block.row_begin <= r && r < block.row_end) {
+          sum += block.y[r - block.row_begin];
+        }
+      }
+      res[r] = sum;
+    }
+  });
+  return res;
 }
 
-SparseMatrix SparseMatrix::transpose() {
-  Eigen::SparseMatrix<float32> res(matrix_.transpose());
-  return SparseMatrix(res);
+template <typename T>
+TypedSparseMatrix<T> TypedSparseMatrix<T>::transpose() {
+  EigenMatrix res(matrix_.transpose());
+  return TypedSparseMatrix(res);
 }
 
-float32 SparseMatrix::get_element(int row, int col) {
+template <typename T>
+T TypedSparseMatrix<T>::get_element(int row, int col) {
   return matrix_.coeff(row, col);
 }
 
+template class TypedSparseMatrix<float32>;
+template class TypedSparseMatrix<float64>;
+
 }  // namespace lang
 }  // namespace taichi
@@ -1,62 +1,128 @@
 #pragma once
 
+#include <memory>
+
 #include "taichi/common/core.h"
 #include "taichi/inc/constants.h"
+#include "taichi/ir/type.h"
 #include "Eigen/Sparse"
 
 namespace taichi {
 namespace lang {
 
-class SparseMatrix;
+template <typename T>
+class TypedSparseMatrix;
+
+using SparseMatrix = TypedSparseMatrix<float32>;
+using SparseMatrix64 = TypedSparseMatrix<float64>;
 
 class SparseMatrixBuilder {
  public:
-  SparseMatrixBuilder(int rows, int cols, int max_num_triplets);
+  SparseMatrixBuilder(int rows,
+                      int cols,
+                      int64 max_num_triplets,
+                      DataType dtype = PrimitiveType::f32);
 
   void *get_data_base_ptr();
 
+  DataType get_dtype() const {
+    return dtype_;
+  }
+
   void print_triplets();
 
+  /**
+   * Assembles the triplets into a compressed matrix. Duplicated entries are
+   * summed up in the order they were inserted.
+   *
+   * If the triplets hit exactly the nonzeros of the previous build, the
+   * sparsity pattern of that build is reused and only the values are
+   * accumulated. The summation order of duplicated entries is unspecified in
+   * that case.
+   */
   SparseMatrix build();
+  SparseMatrix64 build_f64();
+
+  // Drops the triplets so that the builder can be filled again. The sparsity
+  // pattern of the last build is kept.
+  void clear();
 
  private:
-  uint64 num_triplets_{0};
+  template <typename T>
+  TypedSparseMatrix<T> build_typed();
+  template <typename T>
+  bool build_with_pattern(TypedSparseMatrix<T> &sm) const;
+  template <typename T>
+  void build_from_scratch(TypedSparseMatrix<T> &sm);
+
+  // The four members below are accessed by insert_triplet() in the runtime
+  // through the address of the builder. Do not reorder them.
+  int64 num_triplets_{0};
   void *data_base_ptr_{nullptr};
-  std::vector<uint32> data_;
+  int64 max_num_triplets_{0};
+  int64 value_is_f64_{0};
+
+  std::unique_ptr<uint8[]> data_;
   int rows_{0};
   int cols_{0};
-  uint64 max_num_triplets_{0};
+  DataType dtype_;
   bool built_{false};
+
+  // Sparsity pattern of the last build, in compressed column storage
+  std::vector<int64> pattern_outer_;
+  std::vector<int32> pattern_inner_;
 };
 
-class SparseMatrix {
+template <typename T>
+class TypedSparseMatrix {
  public:
-  SparseMatrix() = delete;
-  SparseMatrix(int rows, int cols);
-  SparseMatrix(Eigen::SparseMatrix<float32> &matrix);
+  using EigenMatrix = Eigen::SparseMatrix<T>;
+  using EigenVector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+  TypedSparseMatrix() = delete;
+  TypedSparseMatrix(int rows, int cols);
+  TypedSparseMatrix(EigenMatrix &matrix);
 
   const int num_rows() const;
   const int num_cols() const;
   const std::string to_string() const;
-  Eigen::SparseMatrix<float32> &get_matrix();
-  const Eigen::SparseMatrix<float32> &get_matrix() const;
-  float32 get_element(int row, int col);
-
-  friend SparseMatrix operator+(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  friend SparseMatrix operator-(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  friend SparseMatrix operator*(float scale, const SparseMatrix &sm);
-  friend SparseMatrix operator*(const SparseMatrix &sm, float scale);
-  friend SparseMatrix operator*(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  SparseMatrix matmul(const SparseMatrix &sm);
-  Eigen::VectorXf mat_vec_mul(const Eigen::Ref<const Eigen::VectorXf> &b);
-
-  SparseMatrix transpose();
+  EigenMatrix &get_matrix();
+  const EigenMatrix &get_matrix() const;
+  T get_element(int row, int col);
+
+  friend TypedSparseMatrix operator+(const TypedSparseMatrix &sm1,
+                                     const TypedSparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_ + sm2.matrix_);
+    return TypedSparseMatrix(res);
+  }
+  friend TypedSparseMatrix operator-(const TypedSparseMatrix &sm1,
+                                     const TypedSparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_ - sm2.matrix_);
+    return TypedSparseMatrix(res);
+  }
+  friend TypedSparseMatrix operator*(T scale, const TypedSparseMatrix &sm) {
+    EigenMatrix res(scale * sm.matrix_);
+    return TypedSparseMatrix(res);
+  }
+  friend TypedSparseMatrix operator*(const TypedSparseMatrix &sm, T scale) {
+    return scale * sm;
+  }
+  friend TypedSparseMatrix operator*(const TypedSparseMatrix &sm1,
+                                     const TypedSparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_.cwiseProduct(sm2.matrix_));
+    return TypedSparseMatrix(res);
+  }
+  TypedSparseMatrix matmul(const TypedSparseMatrix &sm);
+  EigenVector mat_vec_mul(const Eigen::Ref<const EigenVector> &b);
+
+  TypedSparseMatrix transpose();
 
  private:
-  Eigen::SparseMatrix<float32> matrix_;
+  EigenMatrix matrix_;
 };
+
+extern template class TypedSparseMatrix<float32>;
+extern template class TypedSparseMatrix<float64>;
+
 }  // namespace lang
 }  // namespace taichi
@@ -0,0 +1,57 @@
+#include "taichi/program/sparse_parallel.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace taichi {
+namespace lang {
+namespace sparse_parallel {
+
+namespace {
+
+std::atomic<int> max_num_threads{0};
+
+// Guards the pool. Also held for the duration of each run_tasks(), since
+// ThreadPool::run() is not reentrant.
+std::mutex pool_mutex;
+// Never destroyed, so that no worker is joined during static destruction.
+ThreadPool *pool = nullptr;
+
+}  // namespace
+
+void set_max_num_threads(int num_threads) {
+  num_threads = std::max(num_threads, 1);
+  if (max_num_threads.exchange(num_threads) == num_threads) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(pool_mutex);
+  // Spawned again with the new size on the next run_tasks().
+  delete pool;
+  pool = nullptr;
+}
+
+int get_max_num_threads() {
+  const int num_threads = max_num_threads.load(std::memory_order_relaxed);
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max((int)std::thread::hardware_concurrency(), 1);
+}
+
+void run_tasks(int num_tasks, void *context, RangeForTaskFunc *func) {
+  std::unique_lock<std::mutex> lock(pool_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    for (int t = 0; t < num_tasks; t++) {
+      func(context, 0, t);
+    }
+    return;
+  }
+  if (pool == nullptr) {
+    pool = new ThreadPool(get_max_num_threads());
+  }
+  pool->run(num_tasks, num_tasks, context, func);
+}
+
+}  // namespace sparse_parallel
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+namespace sparse_parallel {
+
+// Ranges smaller than this are not worth a thread.
+constexpr int64 kMinGrainSize = 1 << 14;
+
+// Caps the number of threads the sparse matrix operations use, normally to
+// CompileConfig::cpu_max_num_threads. Must not be called while an operation
+// is running.
+void set_max_num_threads(int max_num_threads);
+
+int get_max_num_threads();
+
+inline int64 num_threads_for(int64 n) {
+  return std::max<int64>(1, std::min<int64>(get_max_num_threads(),
+                                            (n + kMinGrainSize - 1) /
+                                                kMinGrainSize));
+}
+
+// Runs |func(context, thread_id, task_id)| on task ids [0, num_tasks) on a
+// persistent thread pool shared by all sparse matrix operations. Since the
+// pool is not reentrant, the tasks run on the calling thread if another
+// thread is using the pool.
+void run_tasks(int num_tasks, void *context, RangeForTaskFunc *func);
+
+// Splits [0, n) into |num_threads| contiguous ranges and runs
+// |body(range_id, begin, end)| on each of them in parallel. |body| must not
+// throw.
+template <typename Func>
+void for_each_range(int64 n, int64 num_threads, const Func &body) {
+  if (num_threads == 1) {
+    body(int64(0), int64(0), n);
+    return;
+  }
+  struct Ranges {
+    const Func *body;
+    int64 n;
+    int64 num_ranges;
+  } ranges{&body, n, num_threads};
+  run_tasks((int)num_threads, &ranges, [](void *context, int, int t) {
+    const auto &r = *(Ranges *)context;
+    (*r.body)(int64(t), r.n * t / r.num_ranges, r.n * (t + 1) / r.num_ranges);
+  });
+}
+
+// Runs |body(begin, end)| on contiguous ranges of [0, n) in parallel.
+template <typename Func>
+void for_each_range(int64 n, const Func &body) {
+  for_each_range(n, num_threads_for(n),
+                 [&](int64, int64 begin, int64 end) { body(begin, end); });
+}
+
+// Returns the sum of |body(begin, end)| over contiguous ranges of [0, n). The
+// partial sums are added up in a fixed order for a given n.
+template <typename Func>
+float64 sum(int64 n, const Func &body) {
+  const auto num_threads = num_threads_for(n);
+  std::vector<float64> partial_sums(num_threads, 0);
+  for_each_range(n, num_threads, [&](int64 t, int64 begin, int64 end) {
+    partial_sums[t] = body(begin, end);
+  });
+  float64 total = 0;
+  for (auto s : partial_sums) {
+    total += s;
+  }
+  return total;
+}
+
+}  // namespace sparse_parallel
+}  // namespace lang
+}  // namespace taichi
@@ -1,10 +1,164 @@
 #include "sparse_solver.h"
 
+#include <cmath>
+
+#include "Eigen/IterativeLinearSolvers"
+#include "taichi/program/sparse_parallel.h"
+
 namespace taichi {
 namespace lang {
 
+namespace {
+
+using sparse_parallel::for_each_range;
+
+template <typename T>
+using RowMajorMatrix = Eigen::SparseMatrix<T, Eigen::RowMajor>;
+template <typename T>
+using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+// y = Ax
+template <typename T>
+void spmv(const RowMajorMatrix<T> &A, const Vector<T> &x, Vector<T> &y) {
+  for_each_range(A.rows(), [&](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      T sum = 0;
+      for (typename RowMajorMatrix<T>::InnerIterator it(A, i); it; ++it) {
+        sum += it.value() * x[it.col()];
+      }
+      y[i] = sum;
+    }
+  });
+}
+
+// r = b - Ax
+template <typename T>
+void residual(const RowMajorMatrix<T> &A,
+              const Vector<T> &b,
+              const Vector<T> &x,
+              Vector<T> &r) {
+  spmv(A, x, r);
+  for_each_range(r.size(), [&](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      r[i] = b[i] - r[i];
+    }
+  });
+}
+
+template <typename T>
+float64 dot(const Vector<T> &a, const Vector<T> &b) {
+  return sparse_parallel::sum(a.size(), [&](int64 begin, int64 end) {
+    // Let Eigen vectorize the partial sums, accumulated in f64.
+    const auto size = end - begin;
+    return a.segment(begin, size)
+        .template cast<float64>()
+        .dot(b.segment(begin, size).template cast<float64>());
+  });
+}
+
+template <typename T>
+class IdentityPreconditioner : public Preconditioner<T> {
+ public:
+  using typename Preconditioner<T>::Matrix;
+  using typename Preconditioner<T>::Vector;
+
+  void compute(const Matrix &A) override {
+  }
+
+  void apply(const Vector &r, Vector &z) const override {
+    for_each_range(r.size(), [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        z[i] = r[i];
+      }
+    });
+  }
+};
+
+template <typename T>
+class JacobiPreconditioner : public Preconditioner<T> {
+ public:
+  using typename Preconditioner<T>::Matrix;
+  using typename Preconditioner<T>::Vector;
+
+  void compute(const Matrix &A) override {
+    inv_diag_.resize(A.rows());
+    for_each_range(A.rows(), [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        T d = 0;
+        for (typename Matrix::InnerIterator it(A, i); it; ++it) {
+          if (it.col() == i) {
+            d = it.value();
+            break;
+          }
+        }
+        // Rows without a diagonal entry are left as they are.
+        inv_diag_[i] = d != 0 ? T(1) / d : T(1);
+      }
+    });
+  }
+
+  void apply(const Vector &r, Vector &z) const override {
+    for_each_range(r.size(), [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        z[i] = inv_diag_[i] * r[i];
+      }
+    });
+  }
+
+ private:
+  Vector inv_diag_;
+};
+
+// Note that the triangular solves of the factors run on a single thread.
+template <typename T>
+class IncompleteCholeskyPreconditioner : public Preconditioner<T> {
+ public:
+  using typename Preconditioner<T>::Matrix;
+  using typename Preconditioner<T>::Vector;
+
+  void compute(const Matrix &A) override {
+    ic_.compute(Eigen::SparseMatrix<T>(A));
+    TI_ERROR_IF(ic_.info() != Eigen::Success,
+                "Incomplete Cholesky factorization failed. Is the matrix "
+                "symmetric positive definite?");
+  }
+
+  void apply(const Vector &r, Vector &z) const override {
+    z = ic_.solve(r);
+  }
+
+ private:
+  Eigen::IncompleteCholesky<T, Eigen::Lower, Eigen::AMDOrdering<int>> ic_;
+};
+
+template <typename T>
+class FunctionPreconditioner : public Preconditioner<T> {
+ public:
+  using typename Preconditioner<T>::Matrix;
+  using typename Preconditioner<T>::Vector;
+
+  explicit FunctionPreconditioner(std::function<Vector(const Vector &)> apply)
+      : apply_(std::move(apply)) {
+  }
+
+  void compute(const Matrix &A) override {
+  }
+
+  void apply(const Vector &r, Vector &z) const override {
+    z = apply_(r);
+    TI_ERROR_IF(z.size() != r.size(),
+                "The preconditioner returned {} elements instead of {}.",
+                z.size(), r.size());
+  }
+
+ private:
+  std::function<Vector(const Vector &)> apply_;
+};
+
+}  // namespace
+
 template <class EigenSolver>
-bool EigenSparseSolver<EigenSolver>::compute(const SparseMatrix &sm) {
+bool EigenSparseSolver<EigenSolver>::compute(const Matrix &sm) {
   solver_.compute(sm.get_matrix());
   if (solver_.info() != Eigen::Success) {
     return false;
@@ -12,18 +166,18 @@ bool EigenSparseSolver<EigenSolver>::compute(const SparseMatrix &sm) {
     return true;
 }
 template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::analyze_pattern(const SparseMatrix &sm) {
+void EigenSparseSolver<EigenSolver>::analyze_pattern(const Matrix &sm) {
   solver_.analyzePattern(sm.get_matrix());
 }
 
 template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::factorize(const SparseMatrix &sm) {
+void EigenSparseSolver<EigenSolver>::factorize(const Matrix &sm) {
   solver_.factorize(sm.get_matrix());
 }
 
 template <class EigenSolver>
-Eigen::VectorXf EigenSparseSolver<EigenSolver>::solve(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
+typename EigenSparseSolver<EigenSolver>::Vector
+EigenSparseSolver<EigenSolver>::solve(const Eigen::Ref<const Vector> &b) {
   return solver_.solve(b);
 }
 
@@ -32,20 +186,253 @@ bool EigenSparseSolver<EigenSolver>::info() {
   return solver_.info() == Eigen::Success;
 }
 
-std::unique_ptr<SparseSolver> get_sparse_solver(
-    const std::string &solver_type) {
+template <typename T>
+std::unique_ptr<Preconditioner<T>> make_preconditioner(
+    const std::string &name) {
+  if (name == "none") {
+    return std::make_unique<IdentityPreconditioner<T>>();
+  } else if (name == "jacobi") {
+    return std::make_unique<JacobiPreconditioner<T>>();
+  } else if (name == "ic") {
+    return std::make_unique<IncompleteCholeskyPreconditioner<T>>();
+  } else
+    TI_ERROR("Not supported preconditioner type: {}", name);
+}
+
+template <typename T>
+IterativeSparseSolver<T>::IterativeSparseSolver(
+    Method method,
+    std::unique_ptr<Preconditioner<T>> preconditioner)
+    : method_(method), preconditioner_(std::move(preconditioner)) {
+}
+
+template <typename T>
+bool IterativeSparseSolver<T>::compute(const Matrix &sm) {
+  analyze_pattern(sm);
+  factorize(sm);
+  return true;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::analyze_pattern(const Matrix &sm) {
+  TI_ERROR_IF(sm.num_rows() != sm.num_cols(),
+              "Iterative solvers need square matrices, got {}x{}.",
+              sm.num_rows(), sm.num_cols());
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::factorize(const Matrix &sm) {
+  matrix_ = sm.get_matrix();
+  preconditioner_->compute(matrix_);
+  factorized_ = true;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_preconditioner(
+    std::unique_ptr<Preconditioner<T>> preconditioner) {
+  preconditioner_ = std::move(preconditioner);
+  if (factorized_) {
+    preconditioner_->compute(matrix_);
+  }
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_preconditioner_function(
+    std::function<Vector(const Vector &)> apply) {
+  set_preconditioner(
+      std::make_unique<FunctionPreconditioner<T>>(std::move(apply)));
+}
+
+template <typename T>
+typename IterativeSparseSolver<T>::Vector IterativeSparseSolver<T>::solve(
+    const Eigen::Ref<const Vector> &b) {
+  return solve_with_guess(b, Vector::Zero(b.size()));
+}
+
+template <typename T>
+typename IterativeSparseSolver<T>::Vector
+IterativeSparseSolver<T>::solve_with_guess(const Eigen::Ref<const Vector> &b,
+                                           const Eigen::Ref<const Vector> &x0) {
+  TI_ERROR_IF(!factorized_, "Call compute() or factorize() before solve().");
+  TI_ERROR_IF(b.size() != matrix_.rows() || x0.size() != matrix_.rows(),
+              "Expected vectors of {} elements, got b of {} and x0 of {}.",
+              matrix_.rows(), b.size(), x0.size());
+  Vector rhs = b;
+  Vector x = x0;
+  iterations_ = 0;
+  error_ = 0;
+  converged_ = false;
+  if (method_ == Method::kCG) {
+    solve_cg(rhs, x);
+  } else {
+    solve_bicgstab(rhs, x);
+  }
+  return x;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::solve_cg(const Vector &b, Vector &x) {
+  const int64 n = b.size();
+  const int max_iterations =
+      max_iterations_ >= 0 ? max_iterations_ : 2 * int(n);
+  const float64 b_norm = std::sqrt(dot(b, b));
+  if (b_norm == 0) {
+    x.setZero();
+    converged_ = true;
+    return;
+  }
+  const float64 threshold = tolerance_ * b_norm;
+
+  Vector r(n), z(n), p(n), q(n);
+  residual(matrix_, b, x, r);
+  float64 r_norm = std::sqrt(dot(r, r));
+  preconditioner_->apply(r, z);
+  p = z;
+  float64 rz = dot(r, z);
+  while (r_norm > threshold && iterations_ < max_iterations) {
+    spmv(matrix_, p, q);
+    const T alpha = T(rz / dot(p, q));
+    r_norm = std::sqrt(sparse_parallel::sum(n, [&](int64 begin, int64 end) {
+      float64 sum = 0;
+      for (int64 i = begin; i < end; i++) {
+        x[i] += alpha * p[i];
+        r[i] -= alpha * q[i];
+        sum += float64(r[i]) * r[i];
+      }
+      return sum;
+    }));
+    iterations_++;
+    if (r_norm <= threshold) {
+      break;
+    }
+    preconditioner_->apply(r, z);
+    const float64 rz_new = dot(r, z);
+    const T beta = T(rz_new / rz);
+    rz = rz_new;
+    for_each_range(n, [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        p[i] = z[i] + beta * p[i];
+      }
+    });
+  }
+  error_ = r_norm / b_norm;
+  converged_ = r_norm <= threshold;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::solve_bicgstab(const Vector &b, Vector &x) {
+  const int64 n = b.size();
+  const int max_iterations =
+      max_iterations_ >= 0 ? max_iterations_ : 2 * int(n);
+  const float64 b_norm = std::sqrt(dot(b, b));
+  if (b_norm == 0) {
+    x.setZero();
+    converged_ = true;
+    return;
+  }
+  const float64 threshold = tolerance_ * b_norm;
+
+  Vector r(n), r0(n), p(n), v(n), y(n), s(n), z(n), t(n);
+  residual(matrix_, b, x, r);
+  r0 = r;
+  float64 r0_sq_norm = dot(r0, r0);
+  float64 r_norm = std::sqrt(r0_sq_norm);
+  p.setZero();
+  v.setZero();
+  float64 rho = 1, alpha = 1, w = 1;
+  while (r_norm > threshold && iterations_ < max_iterations) {
+    const float64 rho_old = rho;
+    rho = dot(r0, r);
+    if (std::abs(rho) <= 1e-30 * r0_sq_norm) {
+      // r is almost orthogonal to r0. Restart with r0 = r.
+      r0 = r;
+      rho = r0_sq_norm = dot(r, r);
+    }
+    const T beta = T((rho / rho_old) * (alpha / w));
+    for_each_range(n, [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        p[i] = r[i] + beta * (p[i] - T(w) * v[i]);
+      }
+    });
+    preconditioner_->apply(p, y);
+    spmv(matrix_, y, v);
+    alpha = rho / dot(r0, v);
+    for_each_range(n, [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        s[i] = r[i] - T(alpha) * v[i];
+      }
+    });
+    preconditioner_->apply(s, z);
+    spmv(matrix_, z, t);
+    const float64 tt = dot(t, t);
+    w = tt > 0 ? dot(t, s) / tt : 0;
+    r_norm = std::sqrt(sparse_parallel::sum(n, [&](int64 begin, int64 end) {
+      float64 sum = 0;
+      for (int64 i = begin; i < end; i++) {
+        x[i] += T(alpha) * y[i] + T(w) * z[i];
+        r[i] = s[i] - T(w) * t[i];
+        sum += float64(r[i]) * r[i];
+      }
+      return sum;
+    }));
+    iterations_++;
+    if (w == 0) {
+      // Breakdown
+      break;
+    }
+  }
+  error_ = r_norm / b_norm;
+  converged_ = r_norm <= threshold;
+}
+
+template <typename T>
+bool IterativeSparseSolver<T>::info() {
+  return converged_;
+}
+
+template <typename T>
+std::unique_ptr<TypedSparseSolver<T>> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &preconditioner) {
+  using Method = typename IterativeSparseSolver<T>::Method;
   if (solver_type == "LU") {
-    using LU = Eigen::SparseLU<Eigen::SparseMatrix<float32>>;
+    using LU = Eigen::SparseLU<Eigen::SparseMatrix<T>>;
     return std::make_unique<EigenSparseSolver<LU>>();
   } else if (solver_type == "LDLT") {
-    using LDLT = Eigen::SimplicialLDLT<Eigen::SparseMatrix<float32>>;
+    using LDLT = Eigen::SimplicialLDLT<Eigen::SparseMatrix<T>>;
     return std::make_unique<EigenSparseSolver<LDLT>>();
   } else if (solver_type == "LLT") {
-    using LLT = Eigen::SimplicialLLT<Eigen::SparseMatrix<float32>>;
+    using LLT = Eigen::SimplicialLLT<Eigen::SparseMatrix<T>>;
     return std::make_unique<EigenSparseSolver<LLT>>();
+  } else if (solver_type == "CG") {
+    return std::make_unique<IterativeSparseSolver<T>>(
+        Method::kCG, make_preconditioner<T>(preconditioner));
+  } else if (solver_type == "BICGSTAB") {
+    return std::make_unique<IterativeSparseSolver<T>>(
+        Method::kBiCGSTAB, make_preconditioner<T>(preconditioner));
   } else
     TI_ERROR("Not supported sparse solver type: {}", solver_type);
 }
 
+std::unique_ptr<SparseSolver> get_sparse_solver(
+    const std::string &solver_type) {
+  return make_sparse_solver<float32>(solver_type);
+}
+
+template class IterativeSparseSolver<float32>;
+template class IterativeSparseSolver<float64>;
+
+template std::unique_ptr<Preconditioner<float32>> make_preconditioner(
+    const std::string &name);
+template std::unique_ptr<Preconditioner<float64>> make_preconditioner(
+    const std::string &name);
+
+template std::unique_ptr<SparseSolver> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &preconditioner);
+template std::unique_ptr<SparseSolver64> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &preconditioner);
+
 }  // namespace lang
 }  // namespace taichi
@@ -1,36 +1,150 @@
 #pragma once
 
+#include <functional>
+
 #include "sparse_matrix.h"
 
 namespace taichi {
 namespace lang {
 
-class SparseSolver {
+template <typename T>
+class TypedSparseSolver {
  public:
-  virtual ~SparseSolver(){};
-  virtual bool compute(const SparseMatrix &sm) = 0;
-  virtual void analyze_pattern(const SparseMatrix &sm) = 0;
-  virtual void factorize(const SparseMatrix &sm) = 0;
-  virtual Eigen::VectorXf solve(const Eigen::Ref<const Eigen::VectorXf> &b) = 0;
+  using Matrix = TypedSparseMatrix<T>;
+  using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+  virtual ~TypedSparseSolver(){};
+  virtual bool compute(const Matrix &sm) = 0;
+  virtual void analyze_pattern(const Matrix &sm) = 0;
+  virtual void factorize(const Matrix &sm) = 0;
+  virtual Vector solve(const Eigen::Ref<const Vector> &b) = 0;
+  // Iterative solvers start from |x0|, while direct solvers ignore it.
+  virtual Vector solve_with_guess(const Eigen::Ref<const Vector> &b,
+                                  const Eigen::Ref<const Vector> &x0) {
+    return solve(b);
+  }
   virtual bool info() = 0;
 };
 
+using SparseSolver = TypedSparseSolver<float32>;
+using SparseSolver64 = TypedSparseSolver<float64>;
+
 template <class EigenSolver>
-class EigenSparseSolver : public SparseSolver {
+class EigenSparseSolver
+    : public TypedSparseSolver<typename EigenSolver::Scalar> {
  private:
   EigenSolver solver_;
 
  public:
+  using Base = TypedSparseSolver<typename EigenSolver::Scalar>;
+  using typename Base::Matrix;
+  using typename Base::Vector;
+
   virtual ~EigenSparseSolver(){};
-  virtual bool compute(const SparseMatrix &sm) override;
-  virtual void analyze_pattern(const SparseMatrix &sm) override;
-  virtual void factorize(const SparseMatrix &sm) override;
-  virtual Eigen::VectorXf solve(
-      const Eigen::Ref<const Eigen::VectorXf> &b) override;
+  virtual bool compute(const Matrix &sm) override;
+  virtual void analyze_pattern(const Matrix &sm) override;
+  virtual void factorize(const Matrix &sm) override;
+  virtual Vector solve(const Eigen::Ref<const Vector> &b) override;
   virtual bool info() override;
 };
 
+/**
+ * Approximates the inverse of a matrix to speed up iterative solvers.
+ *
+ * Implement this interface to plug other preconditioners, e.g. a multigrid
+ * V-cycle, into IterativeSparseSolver.
+ */
+template <typename T>
+class Preconditioner {
+ public:
+  // Iterative solvers work on rows so that products are easy to parallelize.
+  using Matrix = Eigen::SparseMatrix<T, Eigen::RowMajor>;
+  using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+  virtual ~Preconditioner() = default;
+  // Called whenever the values of the matrix change.
+  virtual void compute(const Matrix &A) = 0;
+  // Computes z = M^-1 r. |z| has the size of |r| when called.
+  virtual void apply(const Vector &r, Vector &z) const = 0;
+};
+
+// Creates "none", "jacobi" or "ic" (incomplete Cholesky) preconditioners.
+template <typename T>
+std::unique_ptr<Preconditioner<T>> make_preconditioner(const std::string &name);
+
+/**
+ * Solves linear systems with conjugate gradients (for symmetric positive
+ * definite matrices) or BiCGSTAB (for general ones).
+ *
+ * The matrix-vector products and the vector operations are split among
+ * threads. Iterations stop when ||b - Ax|| <= tolerance * ||b||.
+ */
+template <typename T>
+class IterativeSparseSolver : public TypedSparseSolver<T> {
+ public:
+  using typename TypedSparseSolver<T>::Matrix;
+  using typename TypedSparseSolver<T>::Vector;
+
+  enum class Method { kCG, kBiCGSTAB };
+
+  IterativeSparseSolver(Method method,
+                        std::unique_ptr<Preconditioner<T>> preconditioner);
+
+  bool compute(const Matrix &sm) override;
+  void analyze_pattern(const Matrix &sm) override;
+  void factorize(const Matrix &sm) override;
+  Vector solve(const Eigen::Ref<const Vector> &b) override;
+  Vector solve_with_guess(const Eigen::Ref<const Vector> &b,
+                          const Eigen::Ref<const Vector> &x0) override;
+  bool info() override;
+
+  void set_preconditioner(std::unique_ptr<Preconditioner<T>> preconditioner);
+  // Wraps |apply(r)| returning M^-1 r, e.g. a multigrid cycle in Python.
+  void set_preconditioner_function(std::function<Vector(const Vector &)> apply);
+
+  void set_max_iterations(int max_iterations) {
+    max_iterations_ = max_iterations;
+  }
+
+  void set_tolerance(float64 tolerance) {
+    tolerance_ = tolerance;
+  }
+
+  // Statistics of the last solve
+  int iterations() const {
+    return iterations_;
+  }
+
+  float64 error() const {
+    return error_;
+  }
+
+ private:
+  void solve_cg(const Vector &b, Vector &x);
+  void solve_bicgstab(const Vector &b, Vector &x);
+
+  Method method_;
+  std::unique_ptr<Preconditioner<T>> preconditioner_;
+  typename Preconditioner<T>::Matrix matrix_;
+  bool factorized_{false};
+
+  int max_iterations_{-1};  // -1 for 2 * the size of the system
+  float64 tolerance_{1e-6};
+  int iterations_{0};
+  float64 error_{0};
+  bool converged_{false};
+};
+
 std::unique_ptr<SparseSolver> get_sparse_solver(const std::string &solver_type);
 
+/**
+ * Creates a direct ("LU", "LDLT", "LLT") or an iterative ("CG", "BICGSTAB")
+ * solver. |preconditioner| only applies to the iterative ones.
+ */
+template <typename T>
+std::unique_ptr<TypedSparseSolver<T>> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &preconditioner = "jacobi");
+
 }  // namespace lang
 }  // namespace taichi
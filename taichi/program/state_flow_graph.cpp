@@ -10,7 +10,7 @@
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/program/async_engine.h"
-#include "taichi/util/statistics.h"
+#include "taichi/util/metrics.h"
 #include "taichi/system/timeline.h"
 
 // Keep this include in the end!
@@ -357,9 +357,13 @@ void StateFlowGraph::insert_tasks(const std::vector<TaskLaunchRecord> &records,
           previous_offload->body->statements[0]->cast<ClearListStmt>();
       if (!clear_list || clear_list->snode != snode)
         TI_ERROR("Invalid clear list stmt");
-      stat.add("total_list_gen");
+      static auto *const total_list_gen = Metrics::get_instance().counter(
+          "total_list_gen", "List generation tasks seen by the SFG");
+      static auto *const filtered_list_gen = Metrics::get_instance().counter(
+          "filtered_list_gen", "List generation tasks removed by the SFG");
+      total_list_gen->add();
       if (list_up_to_date_[snode]) {
-        stat.add("filtered_list_gen");
+        filtered_list_gen->add();
         // Remove the list gen task
         filtered_records.pop_back();
         // Remove the clear list task
@@ -624,7 +628,9 @@ std::unordered_set<int> StateFlowGraph::fuse_range(int begin, int end) {
     auto *node_b = nodes[b];
     TI_TRACE("Fuse: nodes[{}]({}) <- nodes[{}]({})", a, node_a->string(), b,
              node_b->string());
-    stat.add("num_fused_tasks");
+    static auto *const num_fused_tasks = Metrics::get_instance().counter(
+        "num_fused_tasks", "Tasks fused by the SFG");
+    num_fused_tasks->add();
     auto &rec_a = node_a->rec;
     auto &rec_b = node_b->rec;
     rec_a.ir_handle =
@@ -882,16 +888,55 @@ void StateFlowGraph::rebuild_graph(bool sort) {
   sort_node_edges();
 }
 
-std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute() {
+std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute(
+    std::vector<std::vector<int>> *dependencies) {
   TI_AUTO_PROF;
   auto nodes = get_pending_tasks();
   std::vector<TaskLaunchRecord> tasks;
   tasks.reserve(nodes.size());
+  std::unordered_map<const Node *, int> task_ids;
   for (auto &node : nodes) {
     if (!node->rec.empty()) {
+      task_ids[node] = (int)tasks.size();
       tasks.push_back(node->rec);
     }
   }
+  if (dependencies) {
+    dependencies->assign(tasks.size(), {});
+    // Global temporaries and return values live in buffers shared by all
+    // kernels, which the SFG does not track across kernels. Tasks using them
+    // keep their launch order.
+    int last_shared_buffer_user = -1;
+    for (auto &node : nodes) {
+      auto it = task_ids.find(node);
+      if (it == task_ids.end()) {
+        continue;
+      }
+      auto &deps = (*dependencies)[it->second];
+      for (const auto &edge : node->input_edges.get_all_edges()) {
+        auto from = task_ids.find(edge.second);
+        // Tasks of earlier flushes have finished before these start.
+        if (from != task_ids.end()) {
+          deps.push_back(from->second);
+        }
+      }
+      bool uses_shared_buffers = !node->rec.kernel->rets.empty();
+      for (auto *states : {&node->meta->input_states,
+                           &node->meta->output_states}) {
+        for (auto &state : *states) {
+          uses_shared_buffers |= !state.holds_snode();
+        }
+      }
+      if (uses_shared_buffers) {
+        if (last_shared_buffer_user != -1) {
+          deps.push_back(last_shared_buffer_user);
+        }
+        last_shared_buffer_user = it->second;
+      }
+      std::sort(deps.begin(), deps.end());
+      deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    }
+  }
   mark_pending_tasks_as_executed();
   rebuild_graph(/*sort=*/false);
   for (int i = 0; i < first_pending_task_index_; ++i) {
@@ -1304,7 +1349,9 @@ bool StateFlowGraph::optimize_dead_store() {
       }
       bool first_compute = !dse_result.second;
       if (first_compute && modified) {
-        stat.add("sfg_dse_tasks", 1.0);
+        static auto *const sfg_dse_tasks = Metrics::get_instance().counter(
+            "sfg_dse_tasks", "Tasks modified by dead store elimination");
+        sfg_dse_tasks->add();
       }
       if (first_compute && verbose) {
         // Log only for the first time, otherwise we will be overwhelmed very
@@ -297,8 +297,11 @@ class StateFlowGraph {
   // Extract all pending tasks and insert them in topological/original order.
   void rebuild_graph(bool sort);
 
-  // Extract all tasks to execute.
-  std::vector<TaskLaunchRecord> extract_to_execute();
+  // Extract all tasks to execute. If |dependencies| is not null, it receives
+  // for each extracted task the indices of the extracted tasks that must
+  // finish before it starts.
+  std::vector<TaskLaunchRecord> extract_to_execute(
+      std::vector<std::vector<int>> *dependencies = nullptr);
 
   std::size_t size() const {
     return nodes_.size();
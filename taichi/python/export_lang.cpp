@@ -12,6 +12,7 @@
 
 #include "taichi/ir/frontend.h"
 #include "taichi/ir/frontend_ir.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/statements.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/async_engine.h"
@@ -137,6 +138,11 @@ void export_lang(py::module &m) {
       .def_readwrite("print_kernel_llvm_ir_optimized",
                      &CompileConfig::print_kernel_llvm_ir_optimized)
       .def_readwrite("print_kernel_nvptx", &CompileConfig::print_kernel_nvptx)
+      .def_readwrite("offline_cache", &CompileConfig::offline_cache)
+      .def_readwrite("offline_cache_file_path",
+                     &CompileConfig::offline_cache_file_path)
+      .def_readwrite("offline_cache_max_size_of_files",
+                     &CompileConfig::offline_cache_max_size_of_files)
       .def_readwrite("simplify_before_lower_access",
                      &CompileConfig::simplify_before_lower_access)
       .def_readwrite("simplify_after_lower_access",
@@ -152,6 +158,12 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("num_compile_threads", &CompileConfig::num_compile_threads)
+      .def_readwrite("cpu_numa_aware", &CompileConfig::cpu_numa_aware)
+      .def_readwrite("cpu_block_range_for",
+                     &CompileConfig::cpu_block_range_for)
+      .def_readwrite("cpu_huge_pages", &CompileConfig::cpu_huge_pages)
+      .def_readwrite("cpu_first_touch", &CompileConfig::cpu_first_touch)
       .def_readwrite("random_seed", &CompileConfig::random_seed)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
@@ -160,7 +172,11 @@ void export_lang(py::module &m) {
                      &CompileConfig::demote_dense_struct_fors)
       .def_readwrite("use_unified_memory", &CompileConfig::use_unified_memory)
       .def_readwrite("kernel_profiler", &CompileConfig::kernel_profiler)
+      .def_readwrite("kernel_launch_stats",
+                     &CompileConfig::kernel_launch_stats)
       .def_readwrite("timeline", &CompileConfig::timeline)
+      .def_readwrite("pass_profiler", &CompileConfig::pass_profiler)
+      .def_readwrite("verify_each_pass", &CompileConfig::verify_each_pass)
       .def_readwrite("default_fp", &CompileConfig::default_fp)
       .def_readwrite("default_ip", &CompileConfig::default_ip)
       .def_readwrite("device_memory_GB", &CompileConfig::device_memory_GB)
@@ -178,6 +194,8 @@ void export_lang(py::module &m) {
       .def_readwrite("detect_read_only", &CompileConfig::detect_read_only)
       .def_readwrite("cc_compile_cmd", &CompileConfig::cc_compile_cmd)
       .def_readwrite("cc_link_cmd", &CompileConfig::cc_link_cmd)
+      .def_readwrite("cpu_aot_link_cmd", &CompileConfig::cpu_aot_link_cmd)
+      .def_readwrite("cpu_aot_target_cpu", &CompileConfig::cpu_aot_target_cpu)
       .def_readwrite("async_opt_passes", &CompileConfig::async_opt_passes)
       .def_readwrite("async_opt_fusion", &CompileConfig::async_opt_fusion)
       .def_readwrite("async_opt_fusion_max_iter",
@@ -193,6 +211,8 @@ void export_lang(py::module &m) {
       .def_readwrite("async_flush_every", &CompileConfig::async_flush_every)
       .def_readwrite("async_max_fuse_per_task",
                      &CompileConfig::async_max_fuse_per_task)
+      .def_readwrite("async_max_parallel_launches",
+                     &CompileConfig::async_max_parallel_launches)
       .def_readwrite("quant_opt_store_fusion",
                      &CompileConfig::quant_opt_store_fusion)
       .def_readwrite("quant_opt_atomic_demotion",
@@ -229,6 +249,12 @@ void export_lang(py::module &m) {
            [](Program *, const std::string &fn) {
              Timelines::get_instance().save(fn);
            })
+      .def("print_pass_profile_info",
+           [](Program *) { PassProfiler::get_instance().print(); })
+      .def("clear_pass_profile_info",
+           [](Program *) { PassProfiler::get_instance().clear(); })
+      .def("pass_profile_info_json",
+           [](Program *) { return PassProfiler::get_instance().to_json(); })
       .def("print_memory_profiler_info", &Program::print_memory_profiler_info)
       .def("finalize", &Program::finalize)
       .def("get_total_compilation_time", &Program::get_total_compilation_time)
@@ -240,6 +266,7 @@ void export_lang(py::module &m) {
              program->async_engine->sfg->benchmark_rebuild_graph();
            })
       .def("synchronize", &Program::synchronize)
+      .def("compile_kernels", &Program::compile_kernels)
       .def("async_flush", &Program::async_flush)
       .def("materialize_runtime", &Program::materialize_runtime)
       .def("make_aot_module_builder", &Program::make_aot_module_builder)
@@ -334,6 +361,16 @@ void export_lang(py::module &m) {
            [](SNode *snode, const std::vector<int> &I, float64 val) {
              get_snode_rw_accessors(snode).write_float(I, val);
            })
+      .def("read_batch",
+           [](SNode *snode, uint64 indices, int64 n, uint64 out) {
+             get_snode_rw_accessors(snode).read_batch((const int32 *)indices,
+                                                      n, (void *)out);
+           })
+      .def("write_batch",
+           [](SNode *snode, uint64 indices, int64 n, uint64 values) {
+             get_snode_rw_accessors(snode).write_batch(
+                 (const int32 *)indices, n, (const void *)values);
+           })
       .def("get_shape_along_axis", &SNode::shape_along_axis)
       .def("get_physical_index_position",
            [](SNode *snode) {
@@ -357,6 +394,7 @@ void export_lang(py::module &m) {
       .def("get_ret_int", &Kernel::get_ret_int)
       .def("get_ret_float", &Kernel::get_ret_float)
       .def("make_launch_context", &Kernel::make_launch_context)
+      .def("is_compiled", &Kernel::is_compiled)
       .def("__call__",
            [](Kernel *kernel, Kernel::LaunchContextBuilder &launch_ctx) {
              py::gil_scoped_release release;
@@ -957,46 +995,85 @@ void export_lang(py::module &m) {
 
   py::class_<SparseMatrixBuilder>(m, "SparseMatrixBuilder")
       .def("print_triplets", &SparseMatrixBuilder::print_triplets)
-      .def("build", &SparseMatrixBuilder::build)
+      .def("build",
+           [](SparseMatrixBuilder *builder) -> py::object {
+             if (builder->get_dtype()->is_primitive(PrimitiveTypeID::f64)) {
+               return py::cast(builder->build_f64());
+             }
+             return py::cast(builder->build());
+           })
+      .def("clear", &SparseMatrixBuilder::clear)
       .def("get_addr", [](SparseMatrixBuilder *mat) { return uint64(mat); });
 
   m.def("create_sparse_matrix_builder",
-        [](int n, int m, uint64 max_num_entries) {
+        [](int n, int m, uint64 max_num_entries, DataType dtype) {
           TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
                       "SparseMatrix only supports CPU for now.");
-          return SparseMatrixBuilder(n, m, max_num_entries);
+          return SparseMatrixBuilder(n, m, max_num_entries, dtype);
         });
 
-  py::class_<SparseMatrix>(m, "SparseMatrix")
-      .def("to_string", &SparseMatrix::to_string)
-      .def(py::self + py::self, py::return_value_policy::reference_internal)
-      .def(py::self - py::self, py::return_value_policy::reference_internal)
-      .def(float() * py::self, py::return_value_policy::reference_internal)
-      .def(py::self * float(), py::return_value_policy::reference_internal)
-      .def(py::self * py::self, py::return_value_policy::reference_internal)
-      .def("matmul", &SparseMatrix::matmul,
-           py::return_value_policy::reference_internal)
-      .def("mat_vec_mul", &SparseMatrix::mat_vec_mul)
-      .def("transpose", &SparseMatrix::transpose,
-           py::return_value_policy::reference_internal)
-      .def("get_element", &SparseMatrix::get_element)
-      .def("num_rows", &SparseMatrix::num_rows)
-      .def("num_cols", &SparseMatrix::num_cols);
-
-  m.def("create_sparse_matrix", [](int n, int m) {
+#define EXPORT_SPARSE_MATRIX(Matrix, T, name)                                \
+  py::class_<Matrix>(m, name)                                                \
+      .def("to_string", &Matrix::to_string)                                  \
+      .def(py::self + py::self, py::return_value_policy::reference_internal) \
+      .def(py::self - py::self, py::return_value_policy::reference_internal) \
+      .def(T() * py::self, py::return_value_policy::reference_internal)      \
+      .def(py::self * T(), py::return_value_policy::reference_internal)      \
+      .def(py::self * py::self, py::return_value_policy::reference_internal) \
+      .def("matmul", &Matrix::matmul,                                        \
+           py::return_value_policy::reference_internal)                      \
+      .def("mat_vec_mul", &Matrix::mat_vec_mul)                              \
+      .def("transpose", &Matrix::transpose,                                  \
+           py::return_value_policy::reference_internal)                      \
+      .def("get_element", &Matrix::get_element)                              \
+      .def("num_rows", &Matrix::num_rows)                                    \
+      .def("num_cols", &Matrix::num_cols);
+
+  EXPORT_SPARSE_MATRIX(SparseMatrix, float32, "SparseMatrix")
+  EXPORT_SPARSE_MATRIX(SparseMatrix64, float64, "SparseMatrix64")
+#undef EXPORT_SPARSE_MATRIX
+
+  m.def("create_sparse_matrix", [](int n, int m, DataType dtype) {
     TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
                 "SparseMatrix only supports CPU for now.");
-    return SparseMatrix(n, m);
+    if (dtype->is_primitive(PrimitiveTypeID::f64)) {
+      return py::cast(SparseMatrix64(n, m));
+    }
+    return py::cast(SparseMatrix(n, m));
   });
 
-  py::class_<SparseSolver>(m, "SparseSolver")
-      .def("compute", &SparseSolver::compute)
-      .def("analyze_pattern", &SparseSolver::analyze_pattern)
-      .def("factorize", &SparseSolver::factorize)
-      .def("solve", &SparseSolver::solve)
-      .def("info", &SparseSolver::info);
-
-  m.def("get_sparse_solver", &get_sparse_solver);
+#define EXPORT_SPARSE_SOLVER(T, name)                                         \
+  py::class_<TypedSparseSolver<T>>(m, name)                                   \
+      .def("compute", &TypedSparseSolver<T>::compute)                         \
+      .def("analyze_pattern", &TypedSparseSolver<T>::analyze_pattern)         \
+      .def("factorize", &TypedSparseSolver<T>::factorize)                     \
+      .def("solve", &TypedSparseSolver<T>::solve)                             \
+      .def("solve_with_guess", &TypedSparseSolver<T>::solve_with_guess)       \
+      .def("info", &TypedSparseSolver<T>::info);                              \
+  py::class_<IterativeSparseSolver<T>, TypedSparseSolver<T>>(                 \
+      m, "Iterative" name)                                                    \
+      .def("set_max_iterations",                                              \
+           &IterativeSparseSolver<T>::set_max_iterations)                     \
+      .def("set_tolerance", &IterativeSparseSolver<T>::set_tolerance)         \
+      .def("set_preconditioner",                                              \
+           &IterativeSparseSolver<T>::set_preconditioner_function)            \
+      .def("iterations", &IterativeSparseSolver<T>::iterations)               \
+      .def("error", &IterativeSparseSolver<T>::error);
+
+  EXPORT_SPARSE_SOLVER(float32, "SparseSolver")
+  EXPORT_SPARSE_SOLVER(float64, "SparseSolver64")
+#undef EXPORT_SPARSE_SOLVER
+
+  m.def("get_sparse_solver",
+        [](const std::string &solver_type, DataType dtype,
+           const std::string &preconditioner) -> py::object {
+          if (dtype->is_primitive(PrimitiveTypeID::f64)) {
+            return py::cast(
+                make_sparse_solver<float64>(solver_type, preconditioner));
+          }
+          return py::cast(
+              make_sparse_solver<float32>(solver_type, preconditioner));
+        });
 }
 
 TI_NAMESPACE_END
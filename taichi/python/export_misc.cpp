@@ -18,6 +18,7 @@
 #include "taichi/system/benchmark.h"
 #include "taichi/system/dynamic_loader.h"
 #include "taichi/system/profiler.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_driver.h"
@@ -181,6 +182,11 @@ void export_misc(py::module &m) {
   m.def(
       "get_kernel_stats", []() -> Statistics & { return stat; },
       py::return_value_policy::reference);
+  m.def("metrics_to_prometheus",
+        [] { return Metrics::get_instance().to_prometheus(); });
+  m.def("save_metrics", [](const std::string &filename) {
+    Metrics::get_instance().save(filename);
+  });
 }
 
 TI_NAMESPACE_END
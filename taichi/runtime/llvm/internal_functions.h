@@ -20,20 +20,35 @@ i32 refresh_counter(Context *context) {
   return 0;
 }
 
+// See SparseMatrixBuilder for the layout of |base_ptr_|.
 i32 insert_triplet(Context *context,
                    int64 base_ptr_,
                    int i,
                    int j,
-                   float value) {
+                   float64 value) {
   auto base_ptr = (int64 *)base_ptr_;
 
   int64 *num_triplets = base_ptr;
   auto data_base_ptr = *(int32 **)(base_ptr + 1);
+  auto max_num_triplets = base_ptr[2];
+  auto value_is_f64 = base_ptr[3];
 
   auto triplet_id = atomic_add_i64(num_triplets, 1);
-  data_base_ptr[triplet_id * 3] = i;
-  data_base_ptr[triplet_id * 3 + 1] = j;
-  data_base_ptr[triplet_id * 3 + 2] = taichi_union_cast<int32>(value);
+  // Overflowing triplets are counted but dropped, and reported on build.
+  if (triplet_id >= max_num_triplets) {
+    return 0;
+  }
+  if (value_is_f64) {
+    auto triplet = data_base_ptr + triplet_id * 4;
+    triplet[0] = i;
+    triplet[1] = j;
+    *(float64 *)(triplet + 2) = value;
+  } else {
+    auto triplet = data_base_ptr + triplet_id * 3;
+    triplet[0] = i;
+    triplet[1] = j;
+    triplet[2] = taichi_union_cast<int32>((float32)value);
+  }
   return 0;
 }
 
@@ -142,6 +157,46 @@ i32 test_node_allocator_gc_cpu(Context *context) {
   return 0;
 }
 
+i32 test_node_allocator_thread_cache_cpu(Context *context) {
+  auto runtime = context->runtime;
+  auto nodes = context->runtime->create<NodeManager>(runtime, sizeof(i64), 4);
+  TI_TEST_CHECK(nodes->thread_caches != nullptr, runtime);
+  constexpr int kN = 24;
+  Ptr ptrs[kN];
+  for (int i = 0; i < kN; i++) {
+    ptrs[i] = nodes->allocate(context);
+    *(i64 *)ptrs[i] = i + 1;
+  }
+  // New nodes are not cached.
+  TI_TEST_CHECK(nodes->data_list->size() == kN, runtime);
+  for (int i = 0; i < kN; i++) {
+    nodes->recycle(context, ptrs[i]);
+  }
+  // Recycled nodes stay in the thread cache until the next GC.
+  TI_TEST_CHECK(nodes->recycled_list->size() == 0, runtime);
+  nodes->gc_serial();
+  TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
+
+  // All the nodes are reused, zero-filled.
+  for (int i = 0; i < kN; i++) {
+    ptrs[i] = nodes->allocate(context);
+    TI_TEST_CHECK(*(i64 *)ptrs[i] == 0, runtime);
+  }
+  TI_TEST_CHECK(nodes->data_list->size() == kN, runtime);
+
+  // Unused nodes held by the thread cache are returned by the next GC.
+  for (int i = 0; i < kN; i++) {
+    nodes->recycle(context, ptrs[i]);
+  }
+  nodes->gc_serial();
+  ptrs[0] = nodes->allocate(context);
+  nodes->gc_serial();
+  TI_TEST_CHECK(nodes->free_list->size() == kN - 1, runtime);
+  TI_TEST_CHECK(nodes->free_list_used == 0, runtime);
+
+  return 0;
+}
+
 i32 test_active_mask(Context *context) {
   auto rt = context->runtime;
   taichi_printf(rt, "%d activemask %x\n", thread_idx(), cuda_active_mask());
@@ -0,0 +1,321 @@
+#pragma once
+
+// A hash SNode is an open-addressing hash table with linear probing, keyed by
+// the linearized index of the cell. The table is made of levels of growing
+// capacity: level 0 has |capacity| slots and lives in the node itself, and
+// level k > 0 has |capacity| << k slots and is allocated the first time a key
+// does not fit into levels [0, k). A level consists of
+//
+//   slots: HashSlot[capacity], the key (plus one, so that zero-initialized
+//          slots are empty) and a lock used for allocating the cell data.
+//   data:  Ptr[capacity], the cell data allocated by the NodeManager of the
+//          SNode, or nullptr if the cell is inactive.
+//
+// and the node is laid out as
+//
+//   aux:  HashSlot[capacity] of level 0, then HashLevels.
+//   body: Ptr[capacity] of level 0.
+//
+// So that a crowded region of one level does not slow down every lookup, a
+// key probes at most hash_max_probes slots per level before moving on to the
+// next level. The last level is large enough for all cells of the SNode and
+// is probed in full, so activation only fails when the memory runs out.
+//
+// Keys are inserted with a CAS and stay in the table when their cells are
+// deactivated, so that concurrent lookups never observe keys moving around.
+// The slots of deactivated cells are reclaimed by hash_gc.
+//
+// Note that the "element" index used by listgen and struct-fors over a hash
+// SNode is the slot index, numbered consecutively over the allocated levels,
+// not the key. Use Hash_get_slot_key to translate it.
+
+struct HashMeta : public StructMeta {
+  // The number of slots of level 0.
+  int capacity;
+  int num_levels;
+};
+
+STRUCT_FIELD(HashMeta, capacity);
+STRUCT_FIELD(HashMeta, num_levels);
+
+struct HashSlot {
+  u32 key;
+  i32 lock;
+};
+
+struct HashLevels {
+  // tables[k] holds the slots and data of level k > 0, or nullptr if the
+  // level is not allocated yet. tables[0] is unused.
+  Ptr tables[taichi_max_num_hash_levels];
+  // Serializes the allocation of the tables.
+  i32 lock;
+};
+
+constexpr int hash_max_probes = 32;
+
+struct HashLevel {
+  HashSlot *slots;
+  Ptr *data_ptrs;
+  i32 capacity;
+  // The slot index of the first slot of this level.
+  i32 base;
+};
+
+u32 hash_home_slot(i32 key, i32 capacity, int level) {
+  // A bijective integer mixer, so that keys with common low bits (e.g. cells
+  // of the same row) do not pile up in one cluster. Each level is salted
+  // differently so that keys crowding one level spread out in the next one.
+  // |capacity| is a power of two.
+  u32 h = (u32)key + (u32)level * 0x9e3779b9u;
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return h & (u32)(capacity - 1);
+}
+
+HashLevels *hash_get_levels(HashMeta *meta, Ptr node) {
+  return (HashLevels *)(node + sizeof(HashSlot) * meta->capacity);
+}
+
+i32 hash_get_level_capacity(HashMeta *meta, int level) {
+  return meta->capacity << level;
+}
+
+int hash_get_max_probes(HashMeta *meta, int level) {
+  auto capacity = hash_get_level_capacity(meta, level);
+  if (level == meta->num_levels - 1) {
+    return capacity;
+  }
+  return std::min(capacity, hash_max_probes);
+}
+
+// Returns whether |level| is allocated, and if so, sets |result| to it.
+bool hash_get_level(HashMeta *meta, Ptr node, int level, HashLevel &result) {
+  Ptr table = node;
+  auto capacity = hash_get_level_capacity(meta, level);
+  if (level == 0) {
+    result.data_ptrs = (Ptr *)(node + sizeof(HashSlot) * capacity +
+                               sizeof(HashLevels));
+  } else {
+    auto levels = hash_get_levels(meta, node);
+    table = (Ptr)(*(volatile u64 *)&levels->tables[level]);
+    if (table == nullptr) {
+      return false;
+    }
+    result.data_ptrs = (Ptr *)(table + sizeof(HashSlot) * capacity);
+  }
+  result.slots = (HashSlot *)table;
+  result.capacity = capacity;
+  result.base = meta->capacity * ((1 << level) - 1);
+  return true;
+}
+
+// Same as hash_get_level, but allocates |level| if necessary. Levels are
+// allocated in order. Returns false if the allocation failed.
+bool hash_touch_level(HashMeta *meta, Ptr node, int level, HashLevel &result) {
+  if (hash_get_level(meta, node, level, result)) {
+    return true;
+  }
+  auto levels = hash_get_levels(meta, node);
+  locked_task(&levels->lock, [&] {
+    // May have been allocated during lock contention.
+    if (!hash_get_level(meta, node, level, result)) {
+      auto size = (sizeof(HashSlot) + sizeof(Ptr)) *
+                  hash_get_level_capacity(meta, level);
+      grid_memfence();
+      auto table = meta->context->runtime->request_allocate_aligned(size, 4096);
+      grid_memfence();
+      atomic_exchange_u64((u64 *)&levels->tables[level], (u64)table);
+    }
+  });
+  return hash_get_level(meta, node, level, result);
+}
+
+// Translates slot |s| to its level and its index in that level.
+void hash_locate_slot(HashMeta *meta, i32 s, int &level, i32 &index) {
+  // Level k starts at slot capacity * (2^k - 1).
+  u32 q = (u32)s / (u32)meta->capacity + 1;
+  level = 31 - __builtin_clz(q);
+  index = s - meta->capacity * ((1 << level) - 1);
+}
+
+i32 Hash_get_num_elements(Ptr meta_, Ptr node) {
+  auto meta = (HashMeta *)meta_;
+  auto levels = hash_get_levels(meta, node);
+  int n = 1;
+  while (n < meta->num_levels && levels->tables[n] != nullptr) {
+    n++;
+  }
+  return meta->capacity * ((1 << n) - 1);
+}
+
+// Returns the slot of |key|, or -1 if |key| is not in the table.
+i32 hash_find_slot(HashMeta *meta, Ptr node, i32 key) {
+  u32 tag = (u32)key + 1;
+  for (int level = 0; level < meta->num_levels; level++) {
+    HashLevel t;
+    if (!hash_get_level(meta, node, level, t)) {
+      return -1;
+    }
+    auto max_probes = hash_get_max_probes(meta, level);
+    u32 s = hash_home_slot(key, t.capacity, level);
+    for (int probe = 0; probe < max_probes; probe++) {
+      u32 k = *(volatile u32 *)&t.slots[s].key;
+      if (k == tag)
+        return t.base + s;
+      // Note that the key may still be in a later level, e.g. if hash_gc
+      // emptied this slot after the key was inserted.
+      if (k == 0)
+        break;
+      s = (s + 1) & (u32)(t.capacity - 1);
+    }
+  }
+  return -1;
+}
+
+// Returns the slot of |key|, inserting it if necessary, or -1 if the table is
+// full.
+i32 hash_insert_slot(HashMeta *meta, Ptr node, i32 key) {
+  auto found = hash_find_slot(meta, node, key);
+  if (found != -1) {
+    return found;
+  }
+  u32 tag = (u32)key + 1;
+  for (int level = 0; level < meta->num_levels; level++) {
+    HashLevel t;
+    if (!hash_touch_level(meta, node, level, t)) {
+      return -1;
+    }
+    auto max_probes = hash_get_max_probes(meta, level);
+    u32 s = hash_home_slot(key, t.capacity, level);
+    for (int probe = 0; probe < max_probes; probe++) {
+      u32 k = *(volatile u32 *)&t.slots[s].key;
+      if (k == 0) {
+        u32 desired = tag;
+        if (__atomic_compare_exchange(&t.slots[s].key, &k, &desired, false,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+          return t.base + s;
+        }
+        // Lost the race: |k| now holds the key inserted by the other thread.
+      }
+      if (k == tag)
+        return t.base + s;
+      s = (s + 1) & (u32)(t.capacity - 1);
+    }
+  }
+  return -1;
+}
+
+// Returns the key slot and the data pointer of slot |s|.
+void hash_get_slot(HashMeta *meta,
+                   Ptr node,
+                   i32 s,
+                   HashSlot *&slot,
+                   Ptr *&data_ptr) {
+  int level;
+  i32 index;
+  hash_locate_slot(meta, s, level, index);
+  HashLevel t;
+  hash_get_level(meta, node, level, t);
+  slot = &t.slots[index];
+  data_ptr = &t.data_ptrs[index];
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (HashMeta *)meta_;
+  auto s = hash_insert_slot(meta, node, i);
+  if (s == -1) {
+    // Only happens when the memory runs out, see above. Reported even with
+    // assertions off, since the cell would silently alias the ambient element.
+    taichi_error_runtime(meta->context->runtime, "Hash table is full.");
+    return;
+  }
+  HashSlot *slot;
+  Ptr *data_ptr_;
+  hash_get_slot(meta, node, s, slot, data_ptr_);
+  volatile Ptr lock = (Ptr)&slot->lock;
+  volatile Ptr *data_ptr = data_ptr_;
+
+  if (*data_ptr == nullptr) {
+    // Unlike Pointer_activate, there is no warp-level election: the slot is
+    // only known after probing, so the threads of a warp rarely share it.
+    locked_task(
+        lock,
+        [&] {
+          auto rt = meta->context->runtime;
+          auto alloc = rt->node_allocators[meta->snode_id];
+          auto allocated = (u64)alloc->allocate(meta->context);
+          atomic_exchange_u64((u64 *)data_ptr, allocated);
+        },
+        [&]() { return *data_ptr == nullptr; });
+  }
+}
+
+void Hash_deactivate(Ptr meta_, Ptr node, int i) {
+  auto meta = (HashMeta *)meta_;
+  auto s = hash_find_slot(meta, node, i);
+  if (s == -1)
+    return;
+  HashSlot *slot;
+  Ptr *data_ptr_;
+  hash_get_slot(meta, node, s, slot, data_ptr_);
+  Ptr lock = (Ptr)&slot->lock;
+  Ptr &data_ptr = *data_ptr_;
+  if (data_ptr != nullptr) {
+    locked_task(lock, [&] {
+      if (data_ptr != nullptr) {
+        auto rt = meta->context->runtime;
+        auto alloc = rt->node_allocators[meta->snode_id];
+        alloc->recycle(meta->context, data_ptr);
+        data_ptr = nullptr;
+      }
+    });
+  }
+}
+
+i32 Hash_is_active(Ptr meta_, Ptr node, int i) {
+  auto meta = (HashMeta *)meta_;
+  auto s = hash_find_slot(meta, node, i);
+  if (s == -1)
+    return false;
+  HashSlot *slot;
+  Ptr *data_ptr;
+  hash_get_slot(meta, node, s, slot, data_ptr);
+  return *data_ptr != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta_, Ptr node, int i) {
+  auto meta = (HashMeta *)meta_;
+  auto s = hash_find_slot(meta, node, i);
+  Ptr data_ptr = nullptr;
+  if (s != -1) {
+    HashSlot *slot;
+    Ptr *slot_data_ptr;
+    hash_get_slot(meta, node, s, slot, slot_data_ptr);
+    data_ptr = *slot_data_ptr;
+  }
+  if (data_ptr == nullptr) {
+    data_ptr = (meta->context->runtime)->ambient_elements[meta->snode_id];
+  }
+  return data_ptr;
+}
+
+// Returns the key held by slot |s|, or -1 if the slot is empty or its cell is
+// inactive.
+i32 Hash_get_slot_key(Ptr meta_, Ptr node, int s) {
+  HashSlot *slot;
+  Ptr *data_ptr;
+  hash_get_slot((HashMeta *)meta_, node, s, slot, data_ptr);
+  if (*data_ptr == nullptr)
+    return -1;
+  return (i32)(slot->key - 1);
+}
+
+Ptr Hash_lookup_slot(Ptr meta_, Ptr node, int s) {
+  HashSlot *slot;
+  Ptr *data_ptr;
+  hash_get_slot((HashMeta *)meta_, node, s, slot, data_ptr);
+  return *data_ptr;
+}
@@ -53,7 +53,7 @@ void Pointer_activate(Ptr meta_, Ptr node, int i) {
           [&] {
             auto rt = meta->context->runtime;
             auto alloc = rt->node_allocators[meta->snode_id];
-            auto allocated = (u64)alloc->allocate();
+            auto allocated = (u64)alloc->allocate(meta->context);
             // TODO: Not sure if we really need atomic_exchange here,
             // just to be safe.
             atomic_exchange_u64((u64 *)data_ptr, allocated);
@@ -74,7 +74,7 @@ void Pointer_deactivate(Ptr meta, Ptr node, int i) {
         auto smeta = (StructMeta *)meta;
         auto rt = smeta->context->runtime;
         auto alloc = rt->node_allocators[smeta->snode_id];
-        alloc->recycle(data_ptr);
+        alloc->recycle(smeta->context, data_ptr);
         data_ptr = nullptr;
       }
     });
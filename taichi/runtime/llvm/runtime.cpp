@@ -34,7 +34,12 @@ using host_vsnprintf_type = int (*)(char *,
                                     const char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
+// Zero-fills whole pages by returning them to the OS.
+using release_memory_type = void (*)(void *, std::size_t);
 using RangeForTaskFunc = void(Context *, const char *tls, int i);
+// Runs the iterations [begin, end) of a range-for, see
+// cpu_parallel_range_for_blocks().
+using RangeForBlockFunc = void(Context *, const char *tls, int begin, int end);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
                                    int num_desired_threads,
@@ -372,6 +377,7 @@ constexpr bool enable_assert = true;
 
 void taichi_assert(Context *context, i32 test, const char *msg);
 void taichi_assert_runtime(LLVMRuntime *runtime, i32 test, const char *msg);
+void taichi_error_runtime(LLVMRuntime *runtime, const char *msg);
 #define TI_ASSERT_INFO(x, msg) taichi_assert(context, (int)(x), msg)
 #define TI_ASSERT(x) TI_ASSERT_INFO(x, #x)
 
@@ -404,9 +410,24 @@ struct ListManager {
   i32 num_elements;
   LLVMRuntime *runtime;
 
+  // An optional side table that makes ptr2index O(1). The address space is
+  // split into granules of 2^log2granule_size (>= chunk size) bytes, and the
+  // table maps the granule holding the beginning of each chunk to the chunk.
+  // A chunk containing a pointer therefore begins in the granule of that
+  // pointer or in the previous one. Each entry is (granule << 17 | chunk_id),
+  // and 0 means empty.
+  static constexpr i32 chunk_table_size = 8192;
+  static constexpr i32 chunk_table_max_entries = chunk_table_size / 2;
+  static constexpr i32 chunk_table_id_bits = 17;
+  static_assert(max_num_chunks <= (1 << chunk_table_id_bits));
+  u64 *chunk_table;
+  i32 chunk_table_num_entries;
+  i32 log2granule_size;
+
   ListManager(LLVMRuntime *runtime,
               std::size_t element_size,
-              std::size_t num_elements_per_chunk)
+              std::size_t num_elements_per_chunk,
+              bool use_chunk_table = false)
       : element_size(element_size),
         max_num_elements_per_chunk(num_elements_per_chunk),
         runtime(runtime) {
@@ -415,8 +436,21 @@ struct ListManager {
     lock = 0;
     num_elements = 0;
     log2chunk_num_elements = taichi::log2int(num_elements_per_chunk);
+    chunk_table = nullptr;
+    chunk_table_num_entries = 0;
+    // At least a page, so that (granule << 17) fits into 64 bits.
+    log2granule_size = 12;
+    while (((std::size_t)1 << log2granule_size) <
+           max_num_elements_per_chunk * element_size) {
+      log2granule_size++;
+    }
+    if (use_chunk_table) {
+      allocate_chunk_table();
+    }
   }
 
+  void allocate_chunk_table();
+
   void append(void *data_ptr);
 
   i32 reserve_new_element() {
@@ -426,6 +460,18 @@ struct ListManager {
     return i;
   }
 
+  // Reserves |n| consecutive elements and returns the index of the first one.
+  i32 reserve_new_elements(i32 n) {
+    auto i = atomic_add_i32(&num_elements, n);
+    if (n > 0) {
+      for (int c = i >> log2chunk_num_elements;
+           c <= ((i + n - 1) >> log2chunk_num_elements); c++) {
+        touch_chunk(c);
+      }
+    }
+    return i;
+  }
+
   template <typename T>
   void push_back(const T &t) {
     this->append((void *)&t);
@@ -470,7 +516,56 @@ struct ListManager {
     return num_elements;
   }
 
+  static u32 chunk_table_slot(u64 granule) {
+    return (u32)((granule * 0x9E3779B97F4A7C15ULL) >> 40) &
+           (chunk_table_size - 1);
+  }
+
+  // Called with |lock| held.
+  void insert_chunk_to_table(i32 chunk_id, Ptr chunk_ptr) {
+    if (chunk_table == nullptr ||
+        chunk_table_num_entries >= chunk_table_max_entries) {
+      // Chunks not in the table are found by the linear scan in ptr2index.
+      return;
+    }
+    u64 granule = (u64)chunk_ptr >> log2granule_size;
+    auto s = chunk_table_slot(granule);
+    while (chunk_table[s] != 0) {
+      s = (s + 1) & (chunk_table_size - 1);
+    }
+    chunk_table[s] = (granule << chunk_table_id_bits) | (u64)chunk_id;
+    chunk_table_num_entries++;
+  }
+
+  // Returns the index of |ptr| if its chunk is in the chunk table, or -1.
+  i32 ptr2index_from_chunk_table(Ptr ptr) {
+    auto chunk_size = max_num_elements_per_chunk * element_size;
+    u64 ptr_granule = (u64)ptr >> log2granule_size;
+    for (int d = 0; d < 2; d++) {
+      u64 granule = ptr_granule - d;
+      for (auto s = chunk_table_slot(granule); chunk_table[s] != 0;
+           s = (s + 1) & (chunk_table_size - 1)) {
+        auto entry = chunk_table[s];
+        if ((entry >> chunk_table_id_bits) != granule) {
+          continue;
+        }
+        i32 i = (i32)(entry & ((1 << chunk_table_id_bits) - 1));
+        if (chunks[i] <= ptr && ptr < chunks[i] + chunk_size) {
+          return (i << log2chunk_num_elements) +
+                 i32((ptr - chunks[i]) / element_size);
+        }
+      }
+    }
+    return -1;
+  }
+
   i32 ptr2index(Ptr ptr) {
+    if (chunk_table != nullptr) {
+      auto index = ptr2index_from_chunk_table(ptr);
+      if (index != -1 || chunk_table_num_entries < chunk_table_max_entries) {
+        return index;
+      }
+    }
     auto chunk_size = max_num_elements_per_chunk * element_size;
     for (int i = 0; i < max_num_chunks; i++) {
       taichi_assert_runtime(runtime, chunks[i] != nullptr, "ptr not found.");
@@ -522,6 +617,11 @@ struct LLVMRuntime {
   Ptr preallocated_tail;
 
   vm_allocator_type vm_allocator;
+  // Set on CPUs only.
+  release_memory_type release_memory;
+  // The granularity at which zero_fill() releases memory: taichi_page_size,
+  // or taichi_huge_page_size if the memory is backed by huge pages.
+  u64 release_page_size;
   assert_failed_type assert_failed;
   host_printf_type host_printf;
   host_vsnprintf_type host_vsnprintf;
@@ -532,6 +632,7 @@ struct LLVMRuntime {
 
   Ptr thread_pool;
   parallel_for_type parallel_for;
+  i32 num_cpu_threads;
   ListManager *element_lists[taichi_max_num_snodes];
   NodeManager *node_allocators[taichi_max_num_snodes];
   Ptr ambient_elements[taichi_max_num_snodes];
@@ -542,6 +643,7 @@ struct LLVMRuntime {
   Ptr allocate_aligned(std::size_t size, std::size_t alignment);
   Ptr request_allocate_aligned(std::size_t size, std::size_t alignment);
   Ptr allocate_from_buffer(std::size_t size, std::size_t alignment);
+  void zero_fill(Ptr ptr, std::size_t size);
   Ptr profiler;
   void (*profiler_start)(Ptr, Ptr);
   void (*profiler_stop)(Ptr);
@@ -580,12 +682,30 @@ STRUCT_FIELD_ARRAY(LLVMRuntime, roots);
 STRUCT_FIELD_ARRAY(LLVMRuntime, root_mem_sizes);
 STRUCT_FIELD(LLVMRuntime, temporaries);
 STRUCT_FIELD(LLVMRuntime, assert_failed);
+STRUCT_FIELD(LLVMRuntime, release_memory);
+STRUCT_FIELD(LLVMRuntime, release_page_size);
 STRUCT_FIELD(LLVMRuntime, host_printf);
 STRUCT_FIELD(LLVMRuntime, host_vsnprintf);
 STRUCT_FIELD(LLVMRuntime, profiler);
 STRUCT_FIELD(LLVMRuntime, profiler_start);
 STRUCT_FIELD(LLVMRuntime, profiler_stop);
 
+constexpr int node_manager_thread_cache_size = 64;
+constexpr int node_manager_thread_cache_max_bytes = 64 * 1024;
+
+// A per-thread cache of a NodeManager on CPUs. Free indices are taken from
+// the shared free list and recycled indices are appended to the shared
+// recycled list in batches, so that threads do not contend on the shared
+// counters for every node they (de)activate. New nodes are still reserved one
+// at a time, so that |data_list| only grows by the nodes actually used.
+struct NodeManagerThreadCache {
+  i32 num_free;
+  i32 num_recycled;
+  // Popped from the back.
+  i32 free[node_manager_thread_cache_size];
+  i32 recycled[node_manager_thread_cache_size];
+};
+
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
 struct NodeManager {
@@ -599,6 +719,11 @@ struct NodeManager {
   ListManager *free_list, *recycled_list, *data_list;
   i32 recycle_list_size_backup;
 
+  // One per CPU thread, or nullptr on GPUs.
+  NodeManagerThreadCache *thread_caches;
+  i32 num_thread_caches;
+  i32 thread_cache_batch_size;
+
   using list_data_type = i32;
 
   NodeManager(LLVMRuntime *runtime,
@@ -620,8 +745,33 @@ struct NodeManager {
                                              chunk_num_elements);
     recycled_list = runtime->create<ListManager>(
         runtime, sizeof(list_data_type), chunk_num_elements);
-    data_list =
-        runtime->create<ListManager>(runtime, element_size, chunk_num_elements);
+    // recycle() maps pointers back to indices, so the data list needs the
+    // chunk table for O(1) ptr2index.
+    data_list = runtime->create<ListManager>(
+        runtime, element_size, chunk_num_elements, /*use_chunk_table=*/true);
+    thread_caches = nullptr;
+    num_thread_caches = runtime->num_cpu_threads;
+    if (num_thread_caches > 0) {
+      thread_caches =
+          (NodeManagerThreadCache *)runtime->request_allocate_aligned(
+              sizeof(NodeManagerThreadCache) * num_thread_caches, 64);
+    }
+    // Bound the nodes a thread may hold unused to ~64 KB.
+    thread_cache_batch_size =
+        max_i32(min_i32(node_manager_thread_cache_size,
+                        node_manager_thread_cache_max_bytes / element_size),
+                1);
+  }
+
+  NodeManagerThreadCache *get_thread_cache(Context *context) {
+    if (thread_caches == nullptr) {
+      return nullptr;
+    }
+    auto thread_id = context->cpu_thread_id;
+    if (thread_id < 0 || thread_id >= num_thread_caches) {
+      return nullptr;
+    }
+    return &thread_caches[thread_id];
   }
 
   Ptr allocate() {
@@ -637,6 +787,40 @@ struct NodeManager {
     return data_list->get_element_ptr(l);
   }
 
+  // Allocates through the cache of the calling CPU thread.
+  Ptr allocate(Context *context) {
+    auto cache = get_thread_cache(context);
+    if (cache == nullptr) {
+      return allocate();
+    }
+    if (cache->num_free == 0 && !refill_thread_cache(cache)) {
+      // running out of free list. allocate new.
+      return data_list->get_element_ptr(data_list->reserve_new_element());
+    }
+    auto l = cache->free[--cache->num_free];
+    return data_list->get_element_ptr(l);
+  }
+
+  // Moves a batch of the free list to |cache|. Returns false if the free list
+  // is exhausted.
+  bool refill_thread_cache(NodeManagerThreadCache *cache) {
+    // Take a smaller share when few nodes are left, so that no thread holds
+    // nodes that others then have to allocate anew.
+    auto num_available = free_list->size() - free_list_used;
+    auto n = max_i32(min_i32(thread_cache_batch_size,
+                             num_available / (2 * num_thread_caches)),
+                     1);
+    auto begin = atomic_add_i32(&free_list_used, n);
+    n = min_i32(max_i32(free_list->size() - begin, 0), n);
+    // Fill in reverse order so that the nodes are handed out in the order of
+    // the free list.
+    for (int i = 0; i < n; i++) {
+      cache->free[n - 1 - i] = free_list->get<list_data_type>(begin + i);
+    }
+    cache->num_free = n;
+    return n > 0;
+  }
+
   i32 locate(Ptr ptr) {
     return data_list->ptr2index(ptr);
   }
@@ -646,8 +830,43 @@ struct NodeManager {
     recycled_list->append(&index);
   }
 
-  void gc_serial() {
-    // compact free list
+  // Recycles through the cache of the calling CPU thread. The cached indices
+  // are flushed to |recycled_list| at the latest by the next gc.
+  void recycle(Context *context, Ptr ptr) {
+    auto cache = get_thread_cache(context);
+    if (cache == nullptr) {
+      recycle(ptr);
+      return;
+    }
+    if (cache->num_recycled == node_manager_thread_cache_size) {
+      flush_recycled(cache);
+    }
+    cache->recycled[cache->num_recycled++] = locate(ptr);
+  }
+
+  void flush_recycled(NodeManagerThreadCache *cache) {
+    auto n = cache->num_recycled;
+    if (n == 0) {
+      return;
+    }
+    auto begin = recycled_list->reserve_new_elements(n);
+    for (int i = 0; i < n; i++) {
+      recycled_list->get<list_data_type>(begin + i) = cache->recycled[i];
+    }
+    cache->num_recycled = 0;
+  }
+
+  // Flushes the recycled indices of all threads.
+  void flush_thread_caches() {
+    for (int t = 0; t < num_thread_caches; t++) {
+      flush_recycled(&thread_caches[t]);
+    }
+  }
+
+  // Also returns the indices the threads hold unused to the free list, so
+  // that they are reused before any new node is allocated. Must not run
+  // concurrently with any (de)activation.
+  void compact_free_list() {
     for (int i = free_list_used; i < free_list->size(); i++) {
       free_list->get<list_data_type>(i - free_list_used) =
           free_list->get<list_data_type>(i);
@@ -655,16 +874,81 @@ struct NodeManager {
     const i32 num_unused = max_i32(free_list->size() - free_list_used, 0);
     free_list_used = 0;
     free_list->resize(num_unused);
+    for (int t = 0; t < num_thread_caches; t++) {
+      auto cache = &thread_caches[t];
+      for (int i = cache->num_free - 1; i >= 0; i--) {
+        free_list->push_back(cache->free[i]);
+      }
+      cache->num_free = 0;
+    }
+  }
 
-    // zero-fill recycled and push to free list
-    for (int i = 0; i < recycled_list->size(); i++) {
-      auto idx = recycled_list->get<list_data_type>(i);
-      auto ptr = data_list->get_element_ptr(idx);
-      std::memset(ptr, 0, element_size);
-      free_list->push_back(idx);
+  // Zero-fills the nodes of recycled_list[begin, end) and moves their indices
+  // to free_list[free_list_base, ...). Runs of adjacent nodes are zero-filled
+  // at once, so that the huge pages they fully cover can be returned to the
+  // OS instead of being written. On CPUs, the indices are sorted first to form
+  // longer runs.
+  void zero_fill_recycled(i32 begin, i32 end, i32 free_list_base) {
+    using T = list_data_type;
+#if !ARCH_cuda
+    // Sort within each chunk of |recycled_list|, which is contiguous.
+    const auto log2chunk = recycled_list->log2chunk_num_elements;
+    for (i32 i = begin; i < end;) {
+      auto chunk_end = min_i32(end, ((i >> log2chunk) + 1) << log2chunk);
+      auto first = &recycled_list->get<T>(i);
+      std::sort(first, first + (chunk_end - i));
+      i = chunk_end;
+    }
+#endif
+    const auto log2chunk_data = data_list->log2chunk_num_elements;
+    for (i32 i = begin; i < end;) {
+      auto idx = recycled_list->get<T>(i);
+      i32 run = 1;
+      while (i + run < end && recycled_list->get<T>(i + run) == idx + run &&
+             ((idx + run) >> log2chunk_data) == (idx >> log2chunk_data)) {
+        run++;
+      }
+      runtime->zero_fill(data_list->get_element_ptr(idx),
+                         (std::size_t)element_size * run);
+      for (i32 k = 0; k < run; k++) {
+        free_list->get<T>(free_list_base + i - begin + k) = idx + k;
+      }
+      i += run;
     }
+  }
+
+  void gc_serial() {
+    flush_thread_caches();
+    compact_free_list();
+
+    // zero-fill recycled and push to free list
+    auto num_recycled = recycled_list->size();
+    zero_fill_recycled(0, num_recycled,
+                       free_list->reserve_new_elements(num_recycled));
     recycled_list->clear();
   }
+
+  // Returns the pages of all the nodes to the OS. Only for SNode trees that
+  // have been destroyed: SNode ids are never reused, so the nodes need not
+  // read as zero afterwards, and nothing is written.
+  void release_all() {
+    if (runtime->release_memory == nullptr) {
+      return;
+    }
+    auto chunk_size =
+        data_list->max_num_elements_per_chunk * data_list->element_size;
+    // The chunks are page-aligned, but the page at the end of a chunk may be
+    // shared with the next allocation.
+    auto pages_size = chunk_size & ~(std::size_t)(taichi_page_size - 1);
+    if (pages_size == 0) {
+      return;
+    }
+    for (int i = 0; i < ListManager::max_num_chunks; i++) {
+      if (data_list->chunks[i] != nullptr) {
+        runtime->release_memory(data_list->chunks[i], pages_size);
+      }
+    }
+  }
 };
 
 extern "C" {
@@ -724,15 +1008,10 @@ void taichi_assert(Context *context, i32 test, const char *msg) {
   taichi_assert_runtime(context->runtime, test, msg);
 }
 
-void taichi_assert_format(LLVMRuntime *runtime,
-                          i32 test,
-                          const char *format,
-                          int num_arguments,
-                          uint64 *arguments) {
-  mark_force_no_inline();
-
-  if (!enable_assert || test != 0)
-    return;
+void taichi_set_error(LLVMRuntime *runtime,
+                      const char *format,
+                      int num_arguments,
+                      uint64 *arguments) {
   if (!runtime->error_code) {
     locked_task(&runtime->error_message_lock, [&] {
       if (!runtime->error_code) {
@@ -749,6 +1028,18 @@ void taichi_assert_format(LLVMRuntime *runtime,
       }
     });
   }
+}
+
+void taichi_assert_format(LLVMRuntime *runtime,
+                          i32 test,
+                          const char *format,
+                          int num_arguments,
+                          uint64 *arguments) {
+  mark_force_no_inline();
+
+  if (!enable_assert || test != 0)
+    return;
+  taichi_set_error(runtime, format, num_arguments, arguments);
 #if ARCH_cuda
   // Kill this CUDA thread.
   asm("exit;");
@@ -771,6 +1062,31 @@ void taichi_assert_runtime(LLVMRuntime *runtime, i32 test, const char *msg) {
   taichi_assert_format(runtime, test, msg, 0, nullptr);
 }
 
+// Unlike taichi_assert_runtime, reports the error even if assertions are
+// disabled, and lets the caller continue.
+void taichi_error_runtime(LLVMRuntime *runtime, const char *msg) {
+  taichi_set_error(runtime, msg, 0, nullptr);
+}
+
+void LLVMRuntime::zero_fill(Ptr ptr, std::size_t size) {
+  if (release_memory != nullptr) {
+    // Fresh anonymous pages read as zero, so only the parts outside the
+    // released pages need to be written. With huge pages, only whole ones are
+    // released: releasing a part of one would split it into small pages for
+    // good, which costs TLB misses on every later access.
+    const u64 page_mask = release_page_size - 1;
+    auto pages_begin = (Ptr)(((u64)ptr + page_mask) & ~page_mask);
+    auto pages_end = (Ptr)(((u64)ptr + size) & ~page_mask);
+    if (pages_begin < pages_end) {
+      std::memset(ptr, 0, pages_begin - ptr);
+      release_memory(pages_begin, pages_end - pages_begin);
+      std::memset(pages_end, 0, ptr + size - pages_end);
+      return;
+    }
+  }
+  std::memset(ptr, 0, size);
+}
+
 Ptr LLVMRuntime::allocate_aligned(std::size_t size, std::size_t alignment) {
   if (preallocated) {
     return allocate_from_buffer(size, alignment);
@@ -883,11 +1199,15 @@ void runtime_initialize(
   runtime->result_buffer = result_buffer;
   runtime->set_result(taichi_result_buffer_ret_value_id, runtime);
   runtime->vm_allocator = vm_allocator;
+  runtime->release_memory = nullptr;
+  runtime->release_page_size = taichi_page_size;
   runtime->host_printf = host_printf;
   runtime->host_vsnprintf = host_vsnprintf;
   runtime->memory_pool = memory_pool;
 
   runtime->total_requested_memory = 0;
+  // Set by LLVMRuntime_initialize_thread_pool on CPUs.
+  runtime->num_cpu_threads = 0;
 
   // runtime->allocate ready to use
   runtime->mem_req_queue = (MemRequestQueue *)runtime->allocate_aligned(
@@ -934,9 +1254,11 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
 
 void LLVMRuntime_initialize_thread_pool(LLVMRuntime *runtime,
                                         void *thread_pool,
-                                        void *parallel_for) {
+                                        void *parallel_for,
+                                        int num_threads) {
   runtime->thread_pool = (Ptr)thread_pool;
   runtime->parallel_for = (parallel_for_type)parallel_for;
+  runtime->num_cpu_threads = num_threads;
 }
 
 void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
@@ -946,6 +1268,10 @@ void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
       runtime->create<NodeManager>(runtime, node_size, 1024 * 16);
 }
 
+void runtime_NodeAllocator_release(LLVMRuntime *runtime, int snode_id) {
+  runtime->node_allocators[snode_id]->release_all();
+}
+
 void runtime_allocate_ambient(LLVMRuntime *runtime,
                               int snode_id,
                               std::size_t size) {
@@ -1217,6 +1543,215 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   }
 }
 
+i32 Hash_get_slot_key(Ptr meta, Ptr node, int s);
+Ptr Hash_lookup_slot(Ptr meta, Ptr node, int s);
+
+// Listgen for the children of a hash SNode. Same as element_listgen_nonroot,
+// except that the parent elements are iterated by slot, and the coordinates
+// are refined with the key held by each slot.
+void element_listgen_hash(LLVMRuntime *runtime,
+                          StructMeta *parent,
+                          StructMeta *child) {
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  int num_parent_elements = parent_list->size();
+  auto child_list = runtime->element_lists[child->snode_id];
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+#if ARCH_cuda
+  int i_start = block_idx();
+  int i_step = grid_dim();
+  int j_start = thread_idx();
+  int j_step = block_dim();
+#else
+  int i_start = 0;
+  int i_step = 1;
+  int j_start = 0;
+  int j_step = 1;
+#endif
+  for (int i = i_start; i < num_parent_elements; i += i_step) {
+    auto element = parent_list->get<Element>(i);
+    int j_lower = element.loop_bounds[0] + j_start;
+    int j_higher = element.loop_bounds[1];
+    for (int j = j_lower; j < j_higher; j += j_step) {
+      auto key = Hash_get_slot_key((Ptr)parent, element.element, j);
+      if (key < 0) {
+        continue;
+      }
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord, key);
+      auto ch_element = Hash_lookup_slot((Ptr)parent, element.element, j);
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        Element elem;
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+        child_list->append(&elem);
+      }
+    }
+  }
+}
+
+// On CPUs, listgen of a non-root SNode is split into tasks that each expand a
+// contiguous slice of the parent element list. The tasks run twice on the
+// thread pool: the first pass counts the child elements each slice produces,
+// and after an exclusive scan of the counts, the second pass writes every
+// slice into its own compacted range of the child list. This keeps the child
+// list in the same order as serial listgen.
+constexpr int cpu_listgen_max_num_tasks = 1024;
+// Parent lists shorter than this are expanded serially.
+constexpr int cpu_listgen_min_parallel_elements = 64;
+
+struct cpu_listgen_helper_context {
+  StructMeta *parent;
+  StructMeta *child;
+  ListManager *parent_list;
+  ListManager *child_list;
+  int num_parent_elements;
+  int num_tasks;
+  // offsets[t] is the number of child elements produced by tasks [0, t).
+  i32 *offsets;
+  i32 child_list_base;
+  bool write_elements;
+  // Whether the parent is a hash SNode, whose elements are slots.
+  bool parent_is_hash;
+};
+
+void cpu_element_listgen_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_listgen_helper_context *)ctx_;
+  auto parent = ctx->parent;
+  auto child = ctx->child;
+  auto parent_list = ctx->parent_list;
+  auto child_list = ctx->child_list;
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto parent_is_active = parent->is_active;
+  auto parent_lookup_element = parent->lookup_element;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+  const bool write_elements = ctx->write_elements;
+  const bool parent_is_hash = ctx->parent_is_hash;
+
+  int i_begin = (i64)ctx->num_parent_elements * task_id / ctx->num_tasks;
+  int i_end = (i64)ctx->num_parent_elements * (task_id + 1) / ctx->num_tasks;
+  i32 cursor = 0;
+  if (write_elements) {
+    cursor = ctx->child_list_base + ctx->offsets[task_id];
+  }
+  for (int i = i_begin; i < i_end; i++) {
+    auto element = parent_list->get<Element>(i);
+    for (int j = element.loop_bounds[0]; j < element.loop_bounds[1]; j++) {
+      int index = j;
+      Ptr ch_element;
+      if (parent_is_hash) {
+        index = Hash_get_slot_key((Ptr)parent, element.element, j);
+        if (index < 0) {
+          continue;
+        }
+        ch_element = Hash_lookup_slot((Ptr)parent, element.element, j);
+      } else {
+        if (!parent_is_active((Ptr)parent, element.element, j)) {
+          continue;
+        }
+        ch_element = parent_lookup_element((Ptr)parent, element.element, j);
+      }
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      if (!write_elements) {
+        if (ch_num_elements > 0) {
+          cursor += (ch_num_elements + ch_element_size - 1) / ch_element_size;
+        }
+        continue;
+      }
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord, index);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        auto &elem = child_list->get<Element>(cursor++);
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+      }
+    }
+  }
+  if (!write_elements) {
+    ctx->offsets[task_id + 1] = cursor;
+  }
+}
+
+void cpu_parallel_element_listgen(LLVMRuntime *runtime,
+                                  StructMeta *parent,
+                                  StructMeta *child,
+                                  int num_threads,
+                                  bool parent_is_hash) {
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  int num_parent_elements = parent_list->size();
+  if (num_threads <= 1 ||
+      num_parent_elements < cpu_listgen_min_parallel_elements) {
+    if (parent_is_hash) {
+      element_listgen_hash(runtime, parent, child);
+    } else {
+      element_listgen_nonroot(runtime, parent, child);
+    }
+    return;
+  }
+  i32 offsets[cpu_listgen_max_num_tasks + 1];
+  cpu_listgen_helper_context ctx;
+  ctx.parent = parent;
+  ctx.child = child;
+  ctx.parent_list = parent_list;
+  ctx.child_list = runtime->element_lists[child->snode_id];
+  ctx.num_parent_elements = num_parent_elements;
+  // ~8 tasks per thread for load balancing.
+  ctx.num_tasks = std::min(
+      {num_threads * 8, cpu_listgen_max_num_tasks, num_parent_elements});
+  ctx.offsets = offsets;
+  ctx.child_list_base = 0;
+  ctx.parent_is_hash = parent_is_hash;
+
+  // Pass 1: count
+  ctx.write_elements = false;
+  offsets[0] = 0;
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_element_listgen_task);
+  for (int t = 0; t < ctx.num_tasks; t++) {
+    offsets[t + 1] += offsets[t];
+  }
+
+  // Pass 2: write
+  ctx.child_list_base =
+      ctx.child_list->reserve_new_elements(offsets[ctx.num_tasks]);
+  ctx.write_elements = true;
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_element_listgen_task);
+}
+
+void cpu_parallel_element_listgen_nonroot(LLVMRuntime *runtime,
+                                          StructMeta *parent,
+                                          StructMeta *child,
+                                          int num_threads) {
+  cpu_parallel_element_listgen(runtime, parent, child, num_threads,
+                               /*parent_is_hash=*/false);
+}
+
+void cpu_parallel_element_listgen_hash(LLVMRuntime *runtime,
+                                       StructMeta *parent,
+                                       StructMeta *child,
+                                       int num_threads) {
+  cpu_parallel_element_listgen(runtime, parent, child, num_threads,
+                               /*parent_is_hash=*/true);
+}
+
 using BlockTask = void(Context *, char *, Element *, int, int);
 
 struct cpu_block_task_helper_context {
@@ -1304,18 +1839,51 @@ struct range_task_helper_context {
   Context *context;
   range_for_xlogue prologue{nullptr};
   RangeForTaskFunc *body{nullptr};
+  // Used instead of |body| if not nullptr.
+  RangeForBlockFunc *block_body{nullptr};
   range_for_xlogue epilogue{nullptr};
   std::size_t tls_size{1};
   int begin;
   int end;
   int block_size;
   int step;
+  // Sum of the cycles spent in the blocks; nullptr if not measured.
+  i64 *block_cycles{nullptr};
 };
 
+// Persistent state of a range-for task with an adaptive block size, stored in
+// a zero-initialized global of the kernel module so that it survives across
+// launches of the task. See cpu_parallel_range_for().
+struct RangeForSchedule {
+  // Smoothed cost of one iteration in cycles, or 0 if not measured yet.
+  f64 cycles_per_item;
+};
+
+// Cycles a block should take to amortize the cost of scheduling it and of
+// running the TLS prologue and epilogue.
+constexpr i64 range_for_target_block_cycles = 20000;
+// Blocks per thread needed for load balancing.
+constexpr int range_for_min_blocks_per_thread = 8;
+
+// Returns a timestamp in CPU cycles, or 0 if no cheap cycle counter is
+// available. Note that the runtime is compiled with ARCH_<arch> only, and not
+// with the TI_ARCH_* flags of the host.
+i64 cpu_cycle_counter() {
+#if defined(ARCH_x64)
+  return (i64)__builtin_readcyclecounter();
+#else
+  return 0;
+#endif
+}
+
 void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
   auto ctx = *(range_task_helper_context *)range_context;
+  i64 start_cycles = 0;
+  if (ctx.block_cycles) {
+    start_cycles = cpu_cycle_counter();
+  }
   alignas(8) char tls_buffer[ctx.tls_size];
   auto tls_ptr = &tls_buffer[0];
   if (ctx.prologue)
@@ -1326,18 +1894,77 @@ void cpu_parallel_range_for_task(void *range_context,
   if (ctx.step == 1) {
     int block_start = ctx.begin + task_id * ctx.block_size;
     int block_end = std::min(block_start + ctx.block_size, ctx.end);
-    for (int i = block_start; i < block_end; i++) {
-      ctx.body(&this_thread_context, tls_ptr, i);
+    if (ctx.block_body) {
+      ctx.block_body(&this_thread_context, tls_ptr, block_start, block_end);
+    } else {
+      for (int i = block_start; i < block_end; i++) {
+        ctx.body(&this_thread_context, tls_ptr, i);
+      }
     }
   } else if (ctx.step == -1) {
     int block_start = ctx.end - task_id * ctx.block_size;
     int block_end = std::max(ctx.begin, block_start * ctx.block_size);
-    for (int i = block_start - 1; i >= block_end; i--) {
-      ctx.body(&this_thread_context, tls_ptr, i);
+    if (ctx.block_body) {
+      // The block function visits its range in reverse by itself.
+      ctx.block_body(&this_thread_context, tls_ptr, block_end, block_start);
+    } else {
+      for (int i = block_start - 1; i >= block_end; i--) {
+        ctx.body(&this_thread_context, tls_ptr, i);
+      }
     }
   }
   if (ctx.epilogue)
     ctx.epilogue(ctx.context, tls_ptr);
+  if (ctx.block_cycles) {
+    atomic_add_i64(ctx.block_cycles, cpu_cycle_counter() - start_cycles);
+  }
+}
+
+void launch_cpu_parallel_range_for(range_task_helper_context &ctx,
+                                   int num_threads,
+                                   int block_dim,
+                                   Ptr schedule_state) {
+  auto context = ctx.context;
+  auto begin = ctx.begin, end = ctx.end, step = ctx.step;
+  if (step != 1 && step != -1) {
+    taichi_printf(context->runtime, "step must not be %d\n", step);
+    exit(-1);
+  }
+  auto num_items = (ctx.end - ctx.begin) / std::abs(step);
+  auto schedule = (RangeForSchedule *)schedule_state;
+  i64 block_cycles = 0;
+  if (block_dim == 0) {
+    // adaptive block dim
+    // ensure each thread has at least ~32 tasks for load balancing
+    // and each task has at least 512 items to amortize scheduler overhead
+    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
+    if (schedule && schedule->cycles_per_item > 0) {
+      // Size the blocks after the cost of the items measured in the previous
+      // launches, as long as every thread still gets enough blocks.
+      auto max_block_dim = std::max(
+          1, num_items / (num_threads * range_for_min_blocks_per_thread));
+      auto target_block_dim =
+          (f64)range_for_target_block_cycles / schedule->cycles_per_item;
+      block_dim = (int)std::max(
+          1.0, std::min((f64)max_block_dim, target_block_dim));
+    }
+    if (schedule) {
+      ctx.block_cycles = &block_cycles;
+    }
+  }
+  ctx.block_size = block_dim;
+  auto runtime = context->runtime;
+  runtime->parallel_for(runtime->thread_pool,
+                        (end - begin + block_dim - 1) / block_dim, num_threads,
+                        &ctx, cpu_parallel_range_for_task);
+  if (ctx.block_cycles && block_cycles > 0 && num_items > 0) {
+    auto cycles_per_item = (f64)block_cycles / num_items;
+    if (schedule->cycles_per_item > 0) {
+      // Smooth out the noise of individual launches.
+      cycles_per_item = 0.5 * (schedule->cycles_per_item + cycles_per_item);
+    }
+    schedule->cycles_per_item = cycles_per_item;
+  }
 }
 
 void cpu_parallel_range_for(Context *context,
@@ -1349,7 +1976,8 @@ void cpu_parallel_range_for(Context *context,
                             range_for_xlogue prologue,
                             RangeForTaskFunc *body,
                             range_for_xlogue epilogue,
-                            std::size_t tls_size) {
+                            std::size_t tls_size,
+                            Ptr schedule_state) {
   range_task_helper_context ctx;
   ctx.context = context;
   ctx.prologue = prologue;
@@ -1359,22 +1987,32 @@ void cpu_parallel_range_for(Context *context,
   ctx.begin = begin;
   ctx.end = end;
   ctx.step = step;
-  if (step != 1 && step != -1) {
-    taichi_printf(context->runtime, "step must not be %d\n", step);
-    exit(-1);
-  }
-  if (block_dim == 0) {
-    // adaptive block dim
-    auto num_items = (ctx.end - ctx.begin) / std::abs(step);
-    // ensure each thread has at least ~32 tasks for load balancing
-    // and each task has at least 512 items to amortize scheduler overhead
-    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
-  }
-  ctx.block_size = block_dim;
-  auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool,
-                        (end - begin + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_range_for_task);
+  launch_cpu_parallel_range_for(ctx, num_threads, block_dim, schedule_state);
+}
+
+// Same as cpu_parallel_range_for(), but each block of iterations is run by a
+// single call to |block_body|, whose loop LLVM can optimize as a whole.
+void cpu_parallel_range_for_blocks(Context *context,
+                                   int num_threads,
+                                   int begin,
+                                   int end,
+                                   int step,
+                                   int block_dim,
+                                   range_for_xlogue prologue,
+                                   RangeForBlockFunc *block_body,
+                                   range_for_xlogue epilogue,
+                                   std::size_t tls_size,
+                                   Ptr schedule_state) {
+  range_task_helper_context ctx;
+  ctx.context = context;
+  ctx.prologue = prologue;
+  ctx.tls_size = tls_size;
+  ctx.block_body = block_body;
+  ctx.epilogue = epilogue;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.step = step;
+  launch_cpu_parallel_range_for(ctx, num_threads, block_dim, schedule_state);
 }
 
 void gpu_parallel_range_for(Context *context,
@@ -1408,9 +2046,15 @@ i32 linear_thread_idx(Context *context) {
 #include "node_dense.h"
 #include "node_dynamic.h"
 #include "node_pointer.h"
+#include "node_hash.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
 
+void ListManager::allocate_chunk_table() {
+  chunk_table = (u64 *)runtime->request_allocate_aligned(
+      sizeof(u64) * chunk_table_size, 4096);
+}
+
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
                         "List manager out of chunks.");
@@ -1421,6 +2065,8 @@ void ListManager::touch_chunk(int chunk_id) {
         grid_memfence();
         auto chunk_ptr = runtime->request_allocate_aligned(
             max_num_elements_per_chunk * element_size, 4096);
+        insert_chunk_to_table(chunk_id, chunk_ptr);
+        grid_memfence();
         atomic_exchange_u64((u64 *)&chunks[chunk_id], (u64)chunk_ptr);
       }
     });
@@ -1441,6 +2087,98 @@ void node_gc(LLVMRuntime *runtime, int snode_id) {
   runtime->node_allocators[snode_id]->gc_serial();
 }
 
+// The CPU counterpart of gc_parallel_0/1/2: the free list is compacted
+// serially, then the recycled nodes are zero-filled and returned to the free
+// list in parallel over the thread pool. Each task writes a contiguous slice
+// of the free list, reserved up front.
+constexpr int cpu_gc_max_num_tasks = 1024;
+// Fewer recycled nodes than this are processed serially.
+constexpr int cpu_gc_min_parallel_elements = 1024;
+
+struct cpu_gc_helper_context {
+  NodeManager *allocator;
+  i32 num_recycled;
+  i32 free_list_base;
+  int num_tasks;
+};
+
+void cpu_gc_zero_fill_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_gc_helper_context *)ctx_;
+  auto allocator = ctx->allocator;
+  int i_begin = (i64)ctx->num_recycled * task_id / ctx->num_tasks;
+  int i_end = (i64)ctx->num_recycled * (task_id + 1) / ctx->num_tasks;
+  allocator->zero_fill_recycled(i_begin, i_end, ctx->free_list_base + i_begin);
+}
+
+void cpu_parallel_node_gc(LLVMRuntime *runtime, int snode_id, int num_threads) {
+  auto allocator = runtime->node_allocators[snode_id];
+  allocator->flush_thread_caches();
+  auto num_recycled = allocator->recycled_list->size();
+  if (num_threads <= 1 || num_recycled < cpu_gc_min_parallel_elements) {
+    allocator->gc_serial();
+    return;
+  }
+  allocator->compact_free_list();
+
+  cpu_gc_helper_context ctx;
+  ctx.allocator = allocator;
+  ctx.num_recycled = num_recycled;
+  ctx.free_list_base = allocator->free_list->reserve_new_elements(num_recycled);
+  // ~8 tasks per thread for load balancing.
+  ctx.num_tasks = std::min(num_threads * 8, cpu_gc_max_num_tasks);
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_gc_zero_fill_task);
+  allocator->recycled_list->clear();
+}
+
+// Removes the keys of deactivated cells from a hash SNode, which must be a
+// child of the root. This must run serially, and no other task may access the
+// table meanwhile.
+void hash_gc(LLVMRuntime *runtime, StructMeta *parent, StructMeta *meta_) {
+  auto meta = (HashMeta *)meta_;
+  auto root_element = runtime->element_lists[parent->snode_id]->get<Element>(0);
+  auto node = parent->lookup_element((Ptr)parent, root_element.element, 0);
+  node = meta->from_parent_element(node);
+  for (int level = 0; level < meta->num_levels; level++) {
+    HashLevel t;
+    if (!hash_get_level(meta, node, level, t)) {
+      break;
+    }
+    auto slots = t.slots;
+    auto data_ptrs = t.data_ptrs;
+    auto capacity = t.capacity;
+    auto mask = (u32)(capacity - 1);
+    // Backward-shift deletion. The slots after a removed key move back
+    // towards their home slots. They always move into slots at or after |s|
+    // (modulo wrapping into the already compacted prefix, which holds no dead
+    // keys), so a single scan that re-examines |s| after each removal
+    // suffices. Since keys only move closer to their home slots, they stay
+    // within the probing limit of their level.
+    for (u32 s = 0; s < (u32)capacity;) {
+      if (slots[s].key == 0 || data_ptrs[s] != nullptr) {
+        s++;
+        continue;
+      }
+      u32 hole = s;
+      slots[hole].key = 0;
+      for (u32 j = (hole + 1) & mask; slots[j].key != 0; j = (j + 1) & mask) {
+        u32 home = hash_home_slot((i32)(slots[j].key - 1), capacity, level);
+        // Move slot j into the hole unless its home lies cyclically in
+        // (hole, j].
+        bool stays = hole <= j ? (hole < home && home <= j)
+                               : (hole < home || home <= j);
+        if (!stays) {
+          slots[hole].key = slots[j].key;
+          data_ptrs[hole] = data_ptrs[j];
+          slots[j].key = 0;
+          data_ptrs[j] = nullptr;
+          hole = j;
+        }
+      }
+    }
+  }
+}
+
 void gc_parallel_0(Context *context, int snode_id) {
   LLVMRuntime *runtime = context->runtime;
   auto allocator = runtime->node_allocators[snode_id];
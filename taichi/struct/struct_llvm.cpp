@@ -55,6 +55,16 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
       llvm::StructType::create(*ctx, ch_types, snode.node_type_name + "_ch");
 
   snode.cell_size_bytes = tlctx_->get_type_size(ch_type);
+  {
+    auto data_layout = tlctx_->get_data_layout();
+    auto *layout = data_layout.getStructLayout(ch_type);
+    int ch_index = 0;
+    for (auto &ch : snode.ch) {
+      if (!ch->is_bit_level) {
+        ch->offset_bytes_in_parent_cell = layout->getElementOffset(ch_index++);
+      }
+    }
+  }
 
   llvm::Type *body_type = nullptr, *aux_type = nullptr;
   if (type == SNodeType::dense || type == SNodeType::bitmasked) {
@@ -126,6 +136,17 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    // Key and mutex of each slot of the first level, then the HashLevels
+    // (pointers to the other levels and a lock, see node_hash.h).
+    auto capacity = get_hash_table_capacity(&snode);
+    aux_type = llvm::StructType::get(
+        *ctx, {llvm::ArrayType::get(llvm::Type::getInt64Ty(*ctx), capacity),
+               llvm::ArrayType::get(llvm::Type::getInt8PtrTy(*ctx),
+                                    taichi_max_num_hash_levels),
+               llvm::Type::getInt64Ty(*ctx)});
+    body_type =
+        llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx), capacity);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
@@ -345,5 +366,41 @@ llvm::Type *StructCompilerLLVM::get_llvm_element_type(llvm::Module *module,
   return get_stub(module, snode, 3);
 }
 
+namespace {
+
+// The number of slots the last level of a hash table needs to hold every cell.
+int64 get_hash_table_max_capacity(const SNode *snode) {
+  const auto capacity = bit::least_pot_bound(snode->max_num_elements());
+  // Slot indices over all levels are i32, and the levels together hold less
+  // than twice the capacity of the last one.
+  TI_ERROR_IF(capacity > (1LL << 30),
+              "Hash SNode {} has too many cells ({}), at most 2^30 supported",
+              snode->get_node_type_name_hinted(), snode->max_num_elements());
+  return capacity;
+}
+
+}  // namespace
+
+int StructCompilerLLVM::get_hash_table_capacity(const SNode *snode) {
+  TI_ASSERT(snode->type == SNodeType::hash);
+  // Memory should scale with the active cells rather than with the domain, so
+  // the table starts small and grows by levels when it gets crowded.
+  // Struct-fors and listgen scan all slots of the allocated levels.
+  constexpr int64 kInitialHashTableCapacity = 1 << 12;
+  return (int)std::min(get_hash_table_max_capacity(snode),
+                       kInitialHashTableCapacity);
+}
+
+int StructCompilerLLVM::get_hash_table_num_levels(const SNode *snode) {
+  const auto max_capacity = get_hash_table_max_capacity(snode);
+  int num_levels = 1;
+  while ((int64)get_hash_table_capacity(snode) << (num_levels - 1) <
+         max_capacity) {
+    num_levels++;
+  }
+  TI_ASSERT(num_levels <= taichi_max_num_hash_levels);
+  return num_levels;
+}
+
 }  // namespace lang
 }  // namespace taichi
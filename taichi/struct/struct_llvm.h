@@ -37,6 +37,14 @@ class StructCompilerLLVM : public StructCompiler, public LLVMModuleBuilder {
 
   static llvm::Type *get_llvm_element_type(llvm::Module *module, SNode *snode);
 
+  // Number of slots of the first level of the hash table of a hash SNode,
+  // which is allocated with the SNode tree.
+  static int get_hash_table_capacity(const SNode *snode);
+
+  // Number of levels the hash table of a hash SNode may grow to. Each level
+  // doubles the capacity of the previous one.
+  static int get_hash_table_num_levels(const SNode *snode);
+
  private:
   Arch arch_;
   const CompileConfig *const config_;
@@ -4,7 +4,8 @@
 
 TLANG_NAMESPACE_BEGIN
 
-MemoryPool::MemoryPool(Arch arch) : arch_(arch) {
+MemoryPool::MemoryPool(Arch arch, bool huge_pages)
+    : arch_(arch), huge_pages_(huge_pages) {
   TI_TRACE("Memory pool created. Default buffer size per allocator = {} MB",
            default_allocator_size / 1024 / 1024);
   terminating = false;
@@ -38,8 +39,8 @@ void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
   if (!ret) {
     // allocation have failed
     auto new_buffer_size = std::max(size, default_allocator_size);
-    allocators.emplace_back(
-        std::make_unique<UnifiedAllocator>(new_buffer_size, arch_));
+    allocators.emplace_back(std::make_unique<UnifiedAllocator>(
+        new_buffer_size, arch_, huge_pages_));
     ret = allocators.back()->allocate(size, alignment);
   }
   TI_ASSERT(ret);
@@ -27,7 +27,8 @@ class MemoryPool {
   MemRequestQueue *queue;
   void *cuda_stream{nullptr};
 
-  MemoryPool(Arch arch);
+  // |huge_pages| backs the CPU allocators with transparent huge pages.
+  MemoryPool(Arch arch, bool huge_pages = false);
 
   template <typename T>
   T fetch(volatile void *ptr);
@@ -48,6 +49,7 @@ class MemoryPool {
  private:
   static constexpr bool use_cuda_stream = false;
   Arch arch_;
+  bool huge_pages_;
 };
 
 TLANG_NAMESPACE_END
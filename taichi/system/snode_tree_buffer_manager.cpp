@@ -1,5 +1,6 @@
 #include "snode_tree_buffer_manager.h"
 #include "taichi/program/program.h"
+#include "taichi/system/virtual_memory.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -71,6 +72,10 @@ void SNodeTreeBufferManager::destroy(SNodeTree *snode_tree) {
     return;
   }
   Ptr ptr = roots_[snode_tree_id];
+  if (arch_use_host_memory(prog_->config->arch)) {
+    // Also makes the range zero when it is reused by another tree.
+    release_physical_memory(ptr, size);
+  }
   merge_and_insert(ptr, size);
   TI_DEBUG("SNode tree {} destroyed.", snode_tree_id);
 }
@@ -5,11 +5,20 @@
 
 #include "taichi/system/threading.h"
 
+#include "taichi/system/timer.h"
+
 #include <algorithm>
 #include <condition_variable>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
 
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 TI_NAMESPACE_BEGIN
 
 bool test_threading() {
@@ -26,18 +35,150 @@ bool test_threading() {
   return true;
 }
 
-ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
-  exiting = false;
-  started = false;
-  running_threads = 0;
-  timestamp = 1;
-  last_finished = 0;
-  task_head = 0;
-  task_tail = 0;
-  thread_counter = 0;
-  threads.resize((std::size_t)max_num_threads);
-  for (int i = 0; i < max_num_threads; i++) {
-    threads[i] = std::thread([this] { this->target(); });
+namespace {
+
+// Polls |pred| for |spin_iterations| iterations. Returns whether |pred| became
+// true. The thread yields periodically so that oversubscribed machines still
+// make progress.
+template <typename Pred>
+bool spin_until(int spin_iterations, const Pred &pred) {
+  for (int i = 0; i < spin_iterations; i++) {
+    if (pred()) {
+      return true;
+    }
+    if ((i & 63) == 63) {
+      std::this_thread::yield();
+    }
+  }
+  return pred();
+}
+
+#if defined(TI_PLATFORM_LINUX)
+// Parses a Linux cpulist such as "0-3,8,10-11".
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") {
+      continue;
+    }
+    int first = 0, last = 0;
+    if (std::sscanf(item.c_str(), "%d-%d", &first, &last) == 2) {
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } else if (std::sscanf(item.c_str(), "%d", &first) == 1) {
+      cpus.push_back(first);
+    }
+  }
+  return cpus;
+}
+
+void pin_thread(pthread_t thread, int cpu) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  if (pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) != 0) {
+    TI_WARN("Failed to pin a thread to CPU {}", cpu);
+  }
+}
+#endif
+
+}  // namespace
+
+std::vector<std::vector<int>> get_numa_node_cpus() {
+  std::vector<std::vector<int>> nodes;
+#if defined(TI_PLATFORM_LINUX)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  bool has_affinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  for (int node = 0;; node++) {
+    std::ifstream ifs(fmt::format("/sys/devices/system/node/node{}/cpulist",
+                                  node));
+    if (!ifs) {
+      break;
+    }
+    std::string list;
+    std::getline(ifs, list);
+    std::vector<int> cpus;
+    for (int cpu : parse_cpu_list(list)) {
+      // Skip the CPUs this process may not run on, e.g. due to taskset.
+      if (!has_affinity || CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    if (!cpus.empty()) {
+      nodes.push_back(std::move(cpus));
+    }
+  }
+  if (nodes.empty() && has_affinity) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(std::move(cpus));
+  }
+#endif
+  if (nodes.empty()) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); cpu++) {
+      cpus.push_back(cpu);
+    }
+    nodes.push_back(std::move(cpus));
+  }
+  return nodes;
+}
+
+thread_local ThreadPool *ThreadPool::thread_slice_ = nullptr;
+
+ThreadPool::ThreadPool(int max_num_threads,
+                       int spin_iterations,
+                       int thread_id_base)
+    : max_num_threads(std::max(max_num_threads, 1)),
+      spin_iterations(spin_iterations),
+      thread_id_base(thread_id_base) {
+  init_threads_state();
+  slices_ = std::make_unique<std::atomic<ThreadPool *>[]>(
+      this->max_num_threads);
+  for (int t = 0; t < this->max_num_threads; t++) {
+    slices_[t].store(nullptr);
+  }
+  // The master thread acts as thread 0.
+  threads.resize((std::size_t)this->max_num_threads - 1);
+  for (int i = 1; i < this->max_num_threads; i++) {
+    threads[i - 1] = std::thread([this, i] { this->target(i); });
+  }
+}
+
+ThreadPool::ThreadPool(ThreadPool *parent, int begin, int end)
+    : max_num_threads(end - begin),
+      spin_iterations(parent->spin_iterations),
+      thread_id_base(parent->thread_id_base + begin),
+      profiling(parent->profiling),
+      parent_(parent) {
+  init_threads_state();
+  // Thread t of the slice is worker begin + t of the parent, except for the
+  // launching thread.
+  for (int t = 0; t < max_num_threads; t++) {
+    numa_nodes[t] = parent->numa_nodes[begin + t];
+  }
+  sort_steal_orders();
+}
+
+void ThreadPool::init_threads_state() {
+  func = nullptr;
+  range_for_task_context = nullptr;
+  queues = std::make_unique<WorkerQueue[]>(max_num_threads);
+  activity_spans.resize(max_num_threads);
+  numa_nodes.resize(max_num_threads, 0);
+  steal_orders.resize(max_num_threads);
+  for (int t = 0; t < max_num_threads; t++) {
+    for (int k = 1; k < max_num_threads; k++) {
+      steal_orders[t].push_back((t + k) % max_num_threads);
+    }
   }
 }
 
@@ -45,93 +186,297 @@ void ThreadPool::run(int splits,
                      int desired_num_threads,
                      void *range_for_task_context,
                      RangeForTaskFunc *func) {
-  {
-    std::lock_guard _(mutex);
-    this->range_for_task_context = range_for_task_context;
-    this->func = func;
-    this->desired_num_threads = std::min(desired_num_threads, max_num_threads);
-    TI_ASSERT(this->desired_num_threads > 0);
-    // TI_P(this->desired_num_threads);
-    started = false;
-    task_head = 0;
-    task_tail = splits;
-    timestamp++;
-    TI_ASSERT(timestamp < (1LL << 62));  // avoid overflowing here
-  }
-
-  // wake up all slaves
-  slave_cv.notify_all();
-  {
+  if (splits <= 0) {
+    return;
+  }
+  // A sliced pool launches as its thread 0, which is also the launching thread
+  // of its first slice. So its launches must not overlap with those of the
+  // slices, or two threads would report the same thread id.
+  std::atomic<int> *sliced_launches = nullptr;
+  int launch_weight = 0;
+  if (parent_ != nullptr) {
+    sliced_launches = &parent_->sliced_launches_;
+    launch_weight = 1;
+  } else if (num_slices_.load() > 0) {
+    sliced_launches = &sliced_launches_;
+    launch_weight = kParentLaunchWeight;
+  }
+  if (sliced_launches != nullptr) {
+    const int previous = sliced_launches->fetch_add(launch_weight);
+    const bool overlapping = launch_weight == kParentLaunchWeight
+                                 ? previous != 0
+                                 : previous >= kParentLaunchWeight;
+    if (overlapping) {
+      sliced_launches->fetch_sub(launch_weight);
+      TI_ERROR(
+          "A thread pool and its slices cannot launch at the same time, since "
+          "they share thread id {}",
+          thread_id_base);
+    }
+  }
+  launch(splits, desired_num_threads, range_for_task_context, func);
+  if (sliced_launches != nullptr) {
+    sliced_launches->fetch_sub(launch_weight);
+  }
+}
+
+void ThreadPool::launch(int splits,
+                        int desired_num_threads,
+                        void *range_for_task_context,
+                        RangeForTaskFunc *func) {
+  // There is no point in waking up more threads than there are tasks.
+  int num_threads = std::min({desired_num_threads, max_num_threads, splits});
+  if (num_slices_.load() > 0) {
+    // The workers are lent to the slices.
+    num_threads = 1;
+  }
+  TI_ASSERT(num_threads > 0);
+  this->range_for_task_context = range_for_task_context;
+  this->func = func;
+  for (int t = 0; t < num_threads; t++) {
+    const auto begin = (uint32)((int64)splits * t / num_threads);
+    const auto end = (uint32)((int64)splits * (t + 1) / num_threads);
+    queues[t].range.store(pack_range(begin, end), std::memory_order_relaxed);
+  }
+
+  if (num_threads == 1) {
+    work(0, 1);
+    return;
+  }
+
+  running_threads.store(num_threads - 1, std::memory_order_relaxed);
+  const uint64 launch_id = (epoch.load(std::memory_order_relaxed) >> 32) + 1;
+  // Publishes the queues and the task function to the workers.
+  epoch.store((launch_id << 32) | (uint64)num_threads);
+  if (num_parked_slaves.load() > 0) {
+    {
+      // Makes sure a parking worker is either already waiting on slave_cv, or
+      // will see the new epoch before waiting.
+      std::lock_guard<std::mutex> _(mutex);
+    }
+    slave_cv.notify_all();
+  }
+
+  work(0, num_threads);
+
+  auto all_finished = [this] { return running_threads.load() == 0; };
+  if (!spin_until(spin_iterations, all_finished)) {
     std::unique_lock<std::mutex> lock(mutex);
-    // TODO: the workers may have finished before master waiting on master_cv
-    master_cv.wait(lock, [this] { return started && running_threads == 0; });
+    master_parked.store(true);
+    master_cv.wait(lock, all_finished);
+    master_parked.store(false);
   }
-  TI_ASSERT(task_head >= task_tail);
 }
 
-void ThreadPool::target() {
-  uint64 last_timestamp = 0;
-  int thread_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-    thread_id = thread_counter++;
+void ThreadPool::work(int thread_id, int num_threads) {
+  float64 begin_time = 0;
+  if (profiling) {
+    begin_time = Time::get_time();
   }
   while (true) {
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      slave_cv.wait(lock, [this, last_timestamp, thread_id] {
-        return (timestamp > last_timestamp &&
-                thread_id < desired_num_threads) ||
-               this->exiting;
-      });
-      last_timestamp = timestamp;
-      if (exiting) {
-        break;
-      } else {
-        if (last_finished >= last_timestamp) {
-          continue;
-          // This could happen when part of the desired threads wake up and
-          // finish all the task, and then this thread wake up finding nothing
-          // to do. Should skip this task directly.
-        } else {
-          started = true;
-          running_threads++;
-        }
-      }
+    int task_id;
+    while (pop_task(thread_id, task_id)) {
+      func(range_for_task_context, thread_id_base + thread_id, task_id);
+    }
+    if (!steal_tasks(thread_id, num_threads)) {
+      break;
+    }
+  }
+  if (profiling) {
+    activity_spans[thread_id].push_back({begin_time, Time::get_time()});
+  }
+}
+
+std::vector<std::vector<ThreadPool::ActivitySpan>>
+ThreadPool::fetch_activity_spans() {
+  std::vector<std::vector<ActivitySpan>> fetched(max_num_threads);
+  std::swap(fetched, activity_spans);
+  return fetched;
+}
+
+bool ThreadPool::pop_task(int thread_id, int &task_id) {
+  auto &range = queues[thread_id].range;
+  uint64 r = range.load(std::memory_order_relaxed);
+  while (true) {
+    const auto begin = range_begin(r), end = range_end(r);
+    if (begin >= end) {
+      return false;
     }
+    if (range.compare_exchange_weak(r, pack_range(begin + 1, end),
+                                    std::memory_order_relaxed)) {
+      task_id = (int)begin;
+      return true;
+    }
+  }
+}
 
+bool ThreadPool::steal_tasks(int thief_id, int num_threads) {
+  for (int victim : steal_orders[thief_id]) {
+    if (victim >= num_threads) {
+      continue;
+    }
+    auto &range = queues[victim].range;
+    uint64 r = range.load(std::memory_order_relaxed);
     while (true) {
-      // For a single parallel task
-      int task_id;
-      {
-        task_id = task_head.fetch_add(1, std::memory_order_relaxed);
-        if (task_id >= task_tail)
-          break;
+      const auto begin = range_begin(r), end = range_end(r);
+      if (begin >= end) {
+        break;
+      }
+      // Steal the back half, which the victim is going to visit last.
+      const auto mid = end - (end - begin + 1) / 2;
+      if (range.compare_exchange_weak(r, pack_range(begin, mid),
+                                      std::memory_order_relaxed)) {
+        // Only the owner refills its own (empty) queue, so a plain store is
+        // enough here.
+        queues[thief_id].range.store(pack_range(mid, end),
+                                     std::memory_order_relaxed);
+        return true;
       }
+    }
+  }
+  // Note that work may still be moving between other threads at this point.
+  // That is fine: it will be done by whoever holds it.
+  return false;
+}
+
+std::vector<std::unique_ptr<ThreadPool>> ThreadPool::make_slices(
+    int num_slices) {
+  TI_ASSERT(parent_ == nullptr);
+  TI_ASSERT(num_slices_.load() == 0);
+  // Each slice needs a thread id of its own for its launching thread, so that
+  // their thread ids are disjoint.
+  num_slices = std::clamp(num_slices, 1, max_num_threads);
+  std::vector<std::unique_ptr<ThreadPool>> slices;
+  for (int s = 0; s < num_slices; s++) {
+    const int begin = (int)((int64)max_num_threads * s / num_slices);
+    const int end = (int)((int64)max_num_threads * (s + 1) / num_slices);
+    slices.emplace_back(new ThreadPool(this, begin, end));
+    for (int t = begin + 1; t < end; t++) {
+      slices_[t].store(slices.back().get());
+    }
+  }
+  num_slices_.store(num_slices);
+  {
+    // See run().
+    std::lock_guard<std::mutex> _(mutex);
+  }
+  slave_cv.notify_all();
+  // Makes sure every worker has moved to its slice, so that none of them
+  // still looks at slices_ when a slice is destroyed.
+  for (auto &slice : slices) {
+    while (slice->num_attached_workers_.load() < slice->max_num_threads - 1) {
+      std::this_thread::yield();
+    }
+  }
+  return slices;
+}
 
-      func(this->range_for_task_context, thread_id, task_id);
+void ThreadPool::enable_numa_affinity() {
+#if defined(TI_PLATFORM_LINUX)
+  auto nodes = get_numa_node_cpus();
+  const int num_nodes = (int)nodes.size();
+  std::vector<int> num_threads_on_node(num_nodes, 0);
+  for (int t = 0; t < max_num_threads; t++) {
+    // Consecutive threads share a node, so that consecutive parts of a
+    // range-for do too.
+    const int node = (int)((int64)t * num_nodes / max_num_threads);
+    numa_nodes[t] = node;
+    auto &cpus = nodes[node];
+    const int cpu = cpus[num_threads_on_node[node]++ % cpus.size()];
+    // Thread 0 is the launching thread, e.g. the Python main thread. Pinning
+    // it would also confine every thread it creates later (compilation
+    // workers, BLAS threads, ...) to one CPU, so it is left to the scheduler.
+    // Its CPU is still reserved, i.e. no worker is pinned to it.
+    if (t > 0) {
+      pin_thread(threads[t - 1].native_handle(), cpu);
     }
+  }
+  sort_steal_orders();
+  TI_TRACE("Pinned {} worker threads to {} NUMA node(s)", max_num_threads - 1,
+           num_nodes);
+#endif
+}
 
-    bool all_finished = false;
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      running_threads--;
-      if (running_threads == 0) {
-        all_finished = true;
-        last_finished = last_timestamp;
+void ThreadPool::sort_steal_orders() {
+  for (int t = 0; t < max_num_threads; t++) {
+    // Victims on the same node first, each group in cyclic order.
+    auto &order = steal_orders[t];
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return (numa_nodes[a] != numa_nodes[t]) <
+             (numa_nodes[b] != numa_nodes[t]);
+    });
+  }
+}
+
+void ThreadPool::target(int thread_id) {
+  uint64 last_epoch = 0;
+  while (true) {
+    uint64 current_epoch = last_epoch;
+    ThreadPool *slice = nullptr;
+    auto has_new_launch = [&] {
+      current_epoch = epoch.load();
+      if (slices_ != nullptr) {
+        slice = slices_[thread_id].load();
       }
+      return current_epoch != last_epoch || exiting.load() ||
+             slice != nullptr;
+    };
+    if (!spin_until(spin_iterations, has_new_launch)) {
+      std::unique_lock<std::mutex> lock(mutex);
+      num_parked_slaves++;
+      slave_cv.wait(lock, has_new_launch);
+      num_parked_slaves--;
+    }
+    if (exiting.load()) {
+      break;
+    }
+    if (slice != nullptr) {
+      // Serves the slice until it is destroyed. This is the last access to
+      // the slice.
+      slice->num_attached_workers_++;
+      slice->target(thread_id_base + thread_id - slice->thread_id_base);
+      slice->num_attached_workers_--;
+      last_epoch = epoch.load();
+      continue;
     }
-    if (all_finished)
+    last_epoch = current_epoch;
+    const int num_threads = (int)(current_epoch & 0xFFFFFFFFULL);
+    if (thread_id >= num_threads) {
+      // Not participating in this launch.
+      continue;
+    }
+
+    work(thread_id, num_threads);
+
+    if (running_threads.fetch_sub(1) == 1 && master_parked.load()) {
+      {
+        std::lock_guard<std::mutex> _(mutex);
+      }
       master_cv.notify_one();
+    }
   }
 }
 
 ThreadPool::~ThreadPool() {
+  if (parent_ != nullptr) {
+    // Cleared first, so that the workers go back to the parent once they
+    // leave this slice.
+    const int begin = thread_id_base - parent_->thread_id_base;
+    for (int t = 1; t < max_num_threads; t++) {
+      parent_->slices_[begin + t].store(nullptr);
+    }
+  }
   {
     std::lock_guard<std::mutex> lg(mutex);
     exiting = true;
   }
   slave_cv.notify_all();
+  if (parent_ != nullptr) {
+    while (num_attached_workers_.load() > 0) {
+      std::this_thread::yield();
+    }
+    parent_->num_slices_--;
+  }
   for (auto &th : threads)
     th.join();
 }
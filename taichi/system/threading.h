@@ -11,35 +11,99 @@
 #include <condition_variable>
 #include <functional>
 #include <thread>
+#include <vector>
 
 TI_NAMESPACE_BEGIN
 
 using RangeForTaskFunc = void(void *, int thread_id, int i);
 using ParallelFor = void(int n, int num_threads, void *, RangeForTaskFunc func);
 
+// Returns the CPUs of each NUMA node of this machine, e.g. {{0, 1}, {2, 3}}.
+// Falls back to a single node with all CPUs if the topology is unknown.
+std::vector<std::vector<int>> get_numa_node_cpus();
+
+// A work-stealing thread pool for the CPU backends.
+//
+// Each ThreadPool::run() call (a "launch") executes |func| on task ids
+// [0, splits). The task ids are evenly partitioned into contiguous ranges, one
+// per participating thread. A thread pops tasks from the front of its own
+// range, and once it runs out of work it steals the back half of another
+// thread's range. Both operations are a single CAS on a packed 64-bit
+// [begin, end) word, so the launch path takes no lock as long as the workers
+// are still spinning.
+//
+// The calling (master) thread participates in the launch as thread 0, and
+// max_num_threads - 1 worker threads are spawned as threads 1, 2, ... Idle
+// workers spin for a while before parking on a condition variable, so that
+// back-to-back launches of small kernels do not pay for a futex wake-up.
+//
+// With enable_numa_affinity(), the workers are pinned to cores so that
+// consecutive thread ids share a NUMA node. Since thread t always receives the
+// t-th contiguous part of [0, splits), a range-for is then partitioned by NUMA
+// node, and its blocks keep running on the node that first touched their
+// memory. Thieves also look for work on their own node before going remote.
+//
+// Note that run() is not reentrant: launches must come from one thread at a
+// time, which is how the LLVM runtime uses the pool. To launch from several
+// threads concurrently, split the pool into slices with make_slices() and let
+// each launching thread use its own slice, see set_thread_slice(). The slices
+// borrow the workers of the pool rather than spawning threads of their own.
 class ThreadPool {
  public:
+  // Number of polling iterations before an idle thread parks itself.
+  static constexpr int kDefaultSpinIterations = 1 << 16;
+
+  struct alignas(64) WorkerQueue {
+    // Lower 32 bits: begin; higher 32 bits: end.
+    std::atomic<uint64> range{0};
+  };
+
+  // The time span (in seconds, see Time::get_time()) a thread spends working
+  // on one launch, from its first task until it finds no more work to steal.
+  struct ActivitySpan {
+    float64 begin;
+    float64 end;
+  };
+
   std::vector<std::thread> threads;
+  std::unique_ptr<WorkerQueue[]> queues;
   std::condition_variable slave_cv;
   std::condition_variable master_cv;
   std::mutex mutex;
-  std::atomic<int> task_head;
-  int task_tail;
-  int running_threads;
+  // Published by the master to start a new launch. Higher 32 bits: launch
+  // counter; lower 32 bits: number of participating threads of the launch.
+  std::atomic<uint64> epoch{0};
+  // Number of workers that have not yet finished the current launch.
+  std::atomic<int> running_threads{0};
+  std::atomic<int> num_parked_slaves{0};
+  std::atomic<bool> master_parked{false};
+  std::atomic<bool> exiting{false};
   int max_num_threads;
-  int desired_num_threads;
-  uint64 timestamp;
-  uint64 last_finished;
-  bool started;
-  bool exiting;
+  int spin_iterations;
+  // Added to the thread ids passed to |func|, so that the slices of a pool
+  // report disjoint thread ids.
+  int thread_id_base;
+  // Whether to record the activity spans of the threads. Only changed between
+  // launches.
+  bool profiling{false};
+  // activity_spans[t] is only appended to by thread t during launches, and
+  // read by the master thread between launches.
+  std::vector<std::vector<ActivitySpan>> activity_spans;
+  // steal_orders[t] lists the victims of thread t in the order they are
+  // tried. Only changed between launches.
+  std::vector<std::vector<int>> steal_orders;
+  // numa_nodes[t] is the NUMA node thread t is pinned to, or 0 if the threads
+  // are not pinned.
+  std::vector<int> numa_nodes;
   RangeForTaskFunc *func;
   void *range_for_task_context;  // Note: this is a pointer to a
                                  // range_task_helper_context defined in the
                                  // LLVM runtime, which is different from
                                  // taichi::lang::Context.
-  int thread_counter;
 
-  ThreadPool(int max_num_threads);
+  ThreadPool(int max_num_threads,
+             int spin_iterations = kDefaultSpinIterations,
+             int thread_id_base = 0);
 
   void run(int splits,
            int desired_num_threads,
@@ -51,12 +115,103 @@ class ThreadPool {
                          int desired_num_threads,
                          void *range_for_task_context,
                          RangeForTaskFunc *func) {
+    if (thread_slice_ != nullptr) {
+      pool = thread_slice_;
+    }
     return pool->run(splits, desired_num_threads, range_for_task_context, func);
   }
 
-  void target();
+  // Splits the thread ids of this pool into at most |num_slices| contiguous
+  // parts, one per returned slice. Each slice reports the thread ids of its
+  // part. The thread launching on a slice acts as the first thread of the
+  // part, and the workers of the pool that own the other ids of the part
+  // serve the slice, keeping their NUMA pinning. So no thread is spawned,
+  // and the num_slices - 1 workers owning the first id of a part other than
+  // the first one stay parked.
+  //
+  // While slices exist, launches on this pool run on the calling thread
+  // only, as thread 0, and must not overlap with the launches of the slices.
+  // The slices must be destroyed before this pool, and before slicing it
+  // again. Must not be called during a launch.
+  std::vector<std::unique_ptr<ThreadPool>> make_slices(int num_slices);
+
+  // Redirects the launches that the calling thread issues via static_run() to
+  // |slice|. Pass nullptr to launch on the original pool again.
+  static void set_thread_slice(ThreadPool *slice) {
+    thread_slice_ = slice;
+  }
+
+  void target(int thread_id);
+
+  void set_profiling(bool enabled) {
+    profiling = enabled;
+  }
+
+  // Pins the worker threads to cores, spreading them over the NUMA nodes in
+  // order of thread id, and makes thieves prefer victims on their own node.
+  // Slices made afterwards inherit the placement.
+  // The launching thread (thread 0) keeps its affinity mask, so that threads
+  // it spawns later are not confined to one CPU; the first CPU of node 0 is
+  // left free for it. Only supported on Linux; a no-op elsewhere.
+  void enable_numa_affinity();
+
+  // Returns the activity spans recorded since the last call, indexed by thread
+  // id. Must not be called during a launch.
+  std::vector<std::vector<ActivitySpan>> fetch_activity_spans();
 
   ~ThreadPool();
+
+ private:
+  // Makes a slice of |parent| owning its thread ids [begin, end).
+  ThreadPool(ThreadPool *parent, int begin, int end);
+
+  // run() without the checks against overlapping launches of slices.
+  void launch(int splits,
+              int desired_num_threads,
+              void *range_for_task_context,
+              RangeForTaskFunc *func);
+
+  // Sets up the per-thread launch state for max_num_threads threads.
+  void init_threads_state();
+
+  // Makes thieves try victims on their own NUMA node first.
+  void sort_steal_orders();
+
+  // Executes tasks of the current launch until no thread has work left.
+  void work(int thread_id, int num_threads);
+
+  bool pop_task(int thread_id, int &task_id);
+
+  bool steal_tasks(int thief_id, int num_threads);
+
+  static thread_local ThreadPool *thread_slice_;
+
+  // The pool a slice borrows its workers from, or nullptr if this is not a
+  // slice.
+  ThreadPool *parent_{nullptr};
+  // slices_[t] is the slice worker t currently serves, if any. Null for
+  // slices.
+  std::unique_ptr<std::atomic<ThreadPool *>[]> slices_;
+  // The number of slices of this pool.
+  std::atomic<int> num_slices_{0};
+  // The number of borrowed workers serving this slice.
+  std::atomic<int> num_attached_workers_{0};
+  // The number of ongoing launches of the slices of this pool, plus
+  // kParentLaunchWeight while this pool launches itself.
+  static constexpr int kParentLaunchWeight = 1 << 20;
+  std::atomic<int> sliced_launches_{0};
+
+  static uint64 pack_range(uint32 begin, uint32 end) {
+    return ((uint64)end << 32) | begin;
+  }
+
+  static uint32 range_begin(uint64 range) {
+    return (uint32)(range & 0xFFFFFFFFULL);
+  }
+
+  static uint32 range_end(uint64 range) {
+    return (uint32)(range >> 32);
+  }
 };
 
 TI_NAMESPACE_END
@@ -1,5 +1,7 @@
 #include "taichi/system/timeline.h"
 
+#include "taichi/inc/constants.h"
+
 TI_NAMESPACE_BEGIN
 
 std::string TimelineEvent::to_json() {
@@ -14,7 +16,8 @@ std::string TimelineEvent::to_json() {
   return json;
 }
 
-Timeline::Timeline() : tid_("unnamed") {
+Timeline::Timeline() : records_(std::make_unique<Record[]>(kCapacity)) {
+  set_name("unnamed");
   Timelines::get_instance().insert_timeline(this);
 }
 
@@ -24,46 +27,90 @@ Timeline &Timeline::get_this_thread_instance() {
 }
 
 Timeline::~Timeline() {
-  Timelines::get_instance().insert_events(fetch_events());
+  Timelines::get_instance().insert_records(fetch_records());
   Timelines::get_instance().remove_timeline(this);
 }
 
+void Timeline::set_name(const std::string &tid) {
+  tid_ = tid;
+  tid_id_ = Timelines::get_instance().intern(tid);
+}
+
 void Timeline::clear() {
   std::lock_guard<std::mutex> _(mut_);
-  events_.clear();
+  drain_without_locking();
+  spilled_.clear();
 }
+
 void Timeline::insert_event(const TimelineEvent &e) {
   if (!Timelines::get_instance().get_enabled())
     return;
+  const auto head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+    spill();
+  }
+  auto &rec = records_[head % kCapacity];
+  rec.timestamp = taichi_union_cast_with_different_sizes<uint64>(e.time);
+  rec.name_id = get_name_id(e.name);
+  rec.tid_id = get_name_id(e.tid);
+  rec.begin = e.begin;
+  rec.in_seconds = true;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+uint32 Timeline::get_name_id(const std::string &name) {
+  auto it = name_ids_.find(name);
+  if (it != name_ids_.end()) {
+    return it->second;
+  }
+  auto id = Timelines::get_instance().intern(name);
+  name_ids_[name] = id;
+  return id;
+}
+
+void Timeline::drain_without_locking() {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  const auto head = head_.load(std::memory_order_acquire);
+  for (; tail != head; tail++) {
+    spilled_.push_back(records_[tail % kCapacity]);
+  }
+  tail_.store(tail, std::memory_order_release);
+}
+
+void Timeline::spill() {
   std::lock_guard<std::mutex> _(mut_);
-  events_.push_back(e);
+  drain_without_locking();
 }
 
-std::vector<TimelineEvent> Timeline::fetch_events() {
+std::vector<Timeline::Record> Timeline::fetch_records() {
   std::lock_guard<std::mutex> _(mut_);
-  std::vector<TimelineEvent> fetched;
-  std::swap(fetched, events_);
+  drain_without_locking();
+  std::vector<Record> fetched;
+  std::swap(fetched, spilled_);
   return fetched;
 }
 
-Timeline::Guard::Guard(const std::string &name) : name_(name) {
-  auto &timeline = Timeline::get_this_thread_instance();
-  timeline.insert_event({name, true, Time::get_time(), timeline.tid_});
+Timeline::Guard::Guard(const std::string &name) {
+  if (!Timelines::get_instance().get_enabled())
+    return;
+  timeline_ = &Timeline::get_this_thread_instance();
+  name_id_ = timeline_->get_name_id(name);
+  timeline_->insert_record(name_id_, true);
 }
 
 Timeline::Guard::~Guard() {
-  auto &timeline = Timeline::get_this_thread_instance();
-  timeline.insert_event({name_, false, Time::get_time(), timeline.tid_});
+  if (timeline_) {
+    timeline_->insert_record(name_id_, false);
+  }
 }
 
-void Timelines::insert_events(const std::vector<TimelineEvent> &events) {
-  std::lock_guard<std::mutex> _(mut_);
-  insert_events_without_locking(events);
+Timelines::Timelines()
+    : base_time_(Time::get_time()), base_ticks_(Timeline::now()) {
 }
 
-void Timelines::insert_events_without_locking(
-    const std::vector<TimelineEvent> &events) {
-  events_.insert(events_.end(), events.begin(), events.end());
+void Timelines::insert_records(const std::vector<Timeline::Record> &records) {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.insert(records_.end(), records.begin(), records.end());
 }
 
 Timelines &taichi::Timelines::get_instance() {
@@ -71,34 +118,73 @@ Timelines &taichi::Timelines::get_instance() {
   return *instance;
 }
 
+uint32 Timelines::intern(const std::string &name) {
+  std::lock_guard<std::mutex> _(names_mut_);
+  auto it = name_ids_.find(name);
+  if (it != name_ids_.end()) {
+    return it->second;
+  }
+  const auto id = (uint32)names_.size();
+  names_.push_back(name);
+  name_ids_[name] = id;
+  return id;
+}
+
 void Timelines::clear() {
   std::lock_guard<std::mutex> _(mut_);
-  events_.clear();
+  records_.clear();
   for (auto timeline : timelines_) {
     timeline->clear();
   }
 }
 
+float64 Timelines::ticks_to_seconds(uint64 ticks,
+                                    float64 time,
+                                    uint64 ticks_now) {
+  if (ticks_now == base_ticks_) {
+    return base_time_;
+  }
+  const float64 seconds_per_tick =
+      (time - base_time_) / float64(ticks_now - base_ticks_);
+  return base_time_ + (float64(int64(ticks - base_ticks_))) * seconds_per_tick;
+}
+
 void Timelines::save(const std::string &filename) {
   std::lock_guard<std::mutex> _(mut_);
   std::sort(timelines_.begin(), timelines_.end(), [](Timeline *a, Timeline *b) {
     return a->get_name() < b->get_name();
   });
   for (auto timeline : timelines_) {
-    insert_events_without_locking(timeline->fetch_events());
+    auto records = timeline->fetch_records();
+    records_.insert(records_.end(), records.begin(), records.end());
   }
   if (!ends_with(filename, ".json")) {
     TI_WARN("Timeline filename {} should end with '.json'.", filename);
   }
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> _(names_mut_);
+    names = names_;
+  }
+  const auto time = Time::get_time();
+  const auto ticks_now = Timeline::now();
   std::ofstream fout(filename);
   fout << "[";
   bool first = true;
-  for (auto &e : events_) {
+  for (auto &rec : records_) {
     if (first) {
       first = false;
     } else {
       fout << ",";
     }
+    TimelineEvent e;
+    e.name = names[rec.name_id];
+    e.tid = names[rec.tid_id];
+    e.begin = rec.begin;
+    e.time =
+        rec.in_seconds
+            ? taichi_union_cast_with_different_sizes<float64>(rec.timestamp)
+            : ticks_to_seconds(rec.timestamp, time, ticks_now);
     fout << e.to_json() << std::endl;
   }
   fout << "]";
@@ -114,12 +200,13 @@ void Timelines::remove_timeline(Timeline *timeline) {
   trash(std::remove(timelines_.begin(), timelines_.end(), timeline));
 }
 
-bool Timelines::get_enabled() {
-  return enabled_;
-}
-
 void Timelines::set_enabled(bool enabled) {
-  enabled_ = enabled;
+  if (enabled) {
+    std::lock_guard<std::mutex> _(mut_);
+    base_time_ = Time::get_time();
+    base_ticks_ = Timeline::now();
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
 }
 
 TI_NAMESPACE_END
@@ -1,7 +1,11 @@
 #pragma once
 
-#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "taichi/common/core.h"
 #include "taichi/system/timer.h"
@@ -19,25 +23,64 @@ struct TimelineEvent {
 
 class Timeline {
  public:
+  // A fixed-size event. The name and the tid are interned by Timelines.
+  struct Record {
+    // In ticks of now(), or the bits of a float64 time in seconds if
+    // |in_seconds|.
+    uint64 timestamp;
+    uint32 name_id;
+    uint32 tid_id : 30;
+    uint32 begin : 1;
+    uint32 in_seconds : 1;
+  };
+
+  // The number of records that the ring buffer of each thread holds before
+  // they are moved to a growing list.
+  static constexpr std::size_t kCapacity = 16 * 1024;
+
   Timeline();
 
   ~Timeline();
 
   static Timeline &get_this_thread_instance();
 
-  void set_name(const std::string &tid) {
-    tid_ = tid;
+  // A monotonic tick count, which is the cycle counter where available.
+  static uint64 now() {
+#if defined(TI_ARCH_x64)
+    return Time::get_cycles();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
   }
 
+  void set_name(const std::string &tid);
+
   std::string get_name() {
     return tid_;
   }
 
   void clear();
 
+  // For events timed elsewhere, e.g. by the kernel profilers.
   void insert_event(const TimelineEvent &e);
 
-  std::vector<TimelineEvent> fetch_events();
+  // Only called by the thread that owns this timeline. Lock-free unless the
+  // ring buffer is full.
+  void insert_record(uint32 name_id, bool begin) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+      spill();
+    }
+    records_[head % kCapacity] = {now(), name_id, tid_id_, begin, false};
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  // The id of |name| in Timelines, cached per thread.
+  uint32 get_name_id(const std::string &name);
+
+  // Removes and returns the records inserted so far. Can be called from any
+  // thread.
+  std::vector<Record> fetch_records();
 
   class Guard {
    public:
@@ -46,41 +89,70 @@ class Timeline {
     ~Guard();
 
    private:
-    std::string name_;
+    Timeline *timeline_{nullptr};
+    uint32 name_id_{0};
   };
 
  private:
+  // Moves the records in the ring buffer to |spilled_|. Requires |mut_|.
+  void drain_without_locking();
+
+  void spill();
+
   std::string tid_;
+  uint32 tid_id_{0};
+  std::unordered_map<std::string, uint32> name_ids_;
+  std::unique_ptr<Record[]> records_;
+  // The number of records ever inserted and removed. Only the owning thread
+  // advances |head_|, and only the holders of |mut_| advance |tail_|.
+  std::atomic<uint64> head_{0};
+  std::atomic<uint64> tail_{0};
   std::mutex mut_;
-  std::vector<TimelineEvent> events_;
+  std::vector<Record> spilled_;
 };
 
 // A timeline system for multi-threaded applications
 class Timelines {
  public:
-  static Timelines &get_instance();
+  Timelines();
 
-  void insert_events(const std::vector<TimelineEvent> &events);
+  static Timelines &get_instance();
 
-  void insert_events_without_locking(const std::vector<TimelineEvent> &events);
+  void insert_records(const std::vector<Timeline::Record> &records);
 
   void insert_timeline(Timeline *timeline);
 
   void remove_timeline(Timeline *timeline);
 
+  // Returns the id of |name|, which is shared by all threads.
+  uint32 intern(const std::string &name);
+
   void clear();
 
+  // Converts all records so far to Chrome trace events.
   void save(const std::string &filename);
 
-  bool get_enabled();
+  bool get_enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
 
   void set_enabled(bool enabled);
 
  private:
+  // Maps the ticks of Timeline::now() to the seconds of Time::get_time(),
+  // calibrated from the last set_enabled() to |time|.
+  float64 ticks_to_seconds(uint64 ticks, float64 time, uint64 ticks_now);
+
   std::mutex mut_;
-  std::vector<TimelineEvent> events_;
+  std::vector<Timeline::Record> records_;
   std::vector<Timeline *> timelines_;
-  bool enabled_{false};
+  std::atomic<bool> enabled_{false};
+  float64 base_time_;
+  uint64 base_ticks_;
+
+  std::mutex names_mut_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32> name_ids_;
 };
 
 #define TI_TIMELINE(name) \
@@ -12,7 +12,7 @@
 
 TLANG_NAMESPACE_BEGIN
 
-UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch)
+UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch, bool huge_pages)
     : size(size), arch_(arch) {
   auto t = Time::get_time();
   if (arch_ == Arch::cuda) {
@@ -56,7 +56,7 @@ UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch)
   } else {
     TI_TRACE("Allocating virtual address space of size {} MB",
              size / 1024 / 1024);
-    cpu_vm = std::make_unique<VirtualMemoryAllocator>(size);
+    cpu_vm = std::make_unique<VirtualMemoryAllocator>(size, huge_pages);
     data = (uint8 *)cpu_vm->ptr;
   }
   TI_ASSERT(data != nullptr);
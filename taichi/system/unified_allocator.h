@@ -28,7 +28,8 @@ class UnifiedAllocator {
   std::mutex lock;
 
  public:
-  UnifiedAllocator(std::size_t size, Arch arch);
+  // |huge_pages| backs CPU memory with transparent huge pages.
+  UnifiedAllocator(std::size_t size, Arch arch, bool huge_pages = false);
 
   ~UnifiedAllocator();
 
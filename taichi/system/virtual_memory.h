@@ -14,15 +14,36 @@ TI_NAMESPACE_BEGIN
 class VirtualMemoryAllocator {
  public:
   static constexpr size_t page_size = (1 << 12);  // 4 KB page size by default
+  static constexpr size_t huge_page_size = (1 << 21);  // 2 MB
   void *ptr;
   size_t size;
-  explicit VirtualMemoryAllocator(size_t size) : size(size) {
+  // With |huge_pages|, the range is aligned to 2 MB and the kernel is asked to
+  // back it with transparent huge pages, which cuts the TLB misses of large
+  // dense fields. Huge pages are committed 2 MB at a time on first touch.
+  explicit VirtualMemoryAllocator(size_t size, bool huge_pages = false)
+      : size(size) {
 // http://pages.cs.wisc.edu/~sifakis/papers/SPGrid.pdf Sec 3.1
 #if defined(TI_PLATFORM_UNIX)
-    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
-               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
-    TI_ERROR_IF(ptr == MAP_FAILED, "Virtual memory allocation ({} B) failed.",
-                size);
+    // Reserve one more huge page so that the start can be rounded up.
+    mapped_size_ = huge_pages ? size + huge_page_size : size;
+    mapped_ptr_ = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    TI_ERROR_IF(mapped_ptr_ == MAP_FAILED,
+                "Virtual memory allocation ({} B) failed.", size);
+    ptr = mapped_ptr_;
+    if (huge_pages) {
+      ptr = (void *)((((uint64_t)mapped_ptr_) + huge_page_size - 1) /
+                     huge_page_size * huge_page_size);
+#if defined(MADV_HUGEPAGE)
+      // MAP_HUGETLB would need pages reserved in advance by the administrator,
+      // while transparent huge pages are available out of the box.
+      if (madvise(ptr, size, MADV_HUGEPAGE) != 0) {
+        TI_WARN("Transparent huge pages are not available.");
+      }
+#else
+      TI_WARN("Transparent huge pages are not supported on this platform.");
+#endif
+    }
 #else
     MEMORYSTATUSEX stat;
     stat.dwLength = sizeof(stat);
@@ -32,6 +53,9 @@ class VirtualMemoryAllocator {
       TI_P(size);
       TI_ERROR("Insufficient virtual memory space");
     }
+    if (huge_pages) {
+      TI_WARN("Huge pages are not supported on Windows.");
+    }
     ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
     TI_ERROR_IF(ptr == nullptr, "Virtual memory allocation ({} B) failed.",
                 size);
@@ -43,7 +67,7 @@ class VirtualMemoryAllocator {
 
   ~VirtualMemoryAllocator() {
 #if defined(TI_PLATFORM_UNIX)
-    if (munmap(ptr, size) != 0)
+    if (munmap(mapped_ptr_, mapped_size_) != 0)
 #else
     // https://docs.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-virtualfree
     // According to MS Doc: size must be when using MEM_RELEASE
@@ -51,8 +75,30 @@ class VirtualMemoryAllocator {
 #endif
       TI_ERROR("Failed to free virtual memory ({} B)", size);
   }
+
+ private:
+#if defined(TI_PLATFORM_UNIX)
+  void *mapped_ptr_;
+  size_t mapped_size_;
+#endif
 };
 
+// Returns the physical pages of [ptr, ptr + size), which must be page-aligned,
+// to the OS. The range stays mapped and reads as zero afterwards.
+inline void release_physical_memory(void *ptr, size_t size) {
+#if defined(TI_PLATFORM_UNIX)
+  // Unlike MADV_FREE, MADV_DONTNEED guarantees zero pages on the next access.
+  if (madvise(ptr, size, MADV_DONTNEED) == 0)
+    return;
+#else
+  // Decommitted pages are zero-filled when committed again.
+  if (VirtualFree(ptr, size, MEM_DECOMMIT) &&
+      VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr)
+    return;
+#endif
+  std::memset(ptr, 0, size);
+}
+
 float64 get_memory_usage_gb(int pid = -1);
 uint64 get_memory_usage(int pid = -1);
 
@@ -2,30 +2,82 @@
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/pass.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/program/compile_config.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
+#include "taichi/system/timer.h"
 
 TLANG_NAMESPACE_BEGIN
 
 namespace irpass {
 namespace {
 
-std::function<void(const std::string &)>
-make_pass_printer(bool verbose, const std::string &kernel_name, IRNode *ir) {
-  if (!verbose) {
-    return [](const std::string &) {};
+// Called after each pass with its name. Prints the IR in verbose mode, and
+// records the time of the passes since the last call with the PassProfiler.
+class PassObserver {
+ public:
+  PassObserver(bool verbose,
+               const std::string &kernel_name,
+               IRNode *ir,
+               const CompileConfig &config)
+      : verbose_(verbose),
+        kernel_name_(kernel_name),
+        ir_(ir),
+        config_(config),
+        profiler_scope_(kernel_name) {
+    if (PassProfiler::get_instance().get_enabled()) {
+      num_stmts_ = irpass::analysis::count_statements(ir_);
+    }
+    last_time_ = Time::get_time();
   }
-  return [ir, kernel_name](const std::string &pass) {
-    TI_INFO("[{}] {}:", kernel_name, pass);
-    std::cout << std::flush;
-    irpass::re_id(ir);
-    irpass::print(ir);
-    std::cout << std::flush;
-  };
-}
+
+  void operator()(const std::string &pass) {
+    auto &profiler = PassProfiler::get_instance();
+    if (profiler.get_enabled()) {
+      auto num_stmts = irpass::analysis::count_statements(ir_);
+      profiler.record(pass, Time::get_time() - last_time_, num_stmts_,
+                      num_stmts);
+      num_stmts_ = num_stmts;
+    }
+    if (verbose_) {
+      TI_INFO("[{}] {}:", kernel_name_, pass);
+      std::cout << std::flush;
+      irpass::re_id(ir_);
+      irpass::print(ir_);
+      std::cout << std::flush;
+    }
+    last_time_ = Time::get_time();
+  }
+
+  // Verifies the IR. Unless |config.verify_each_pass| is set, this is skipped
+  // everywhere except at the boundaries of the pipelines.
+  void verify(bool boundary = false) {
+    if (!boundary && !config_.verify_each_pass) {
+      return;
+    }
+    auto begin = Time::get_time();
+    irpass::analysis::verify(ir_);
+    auto time = Time::get_time() - begin;
+    auto &profiler = PassProfiler::get_instance();
+    if (profiler.get_enabled()) {
+      profiler.record("verify", time, num_stmts_, num_stmts_);
+    }
+    // Not part of the next pass.
+    last_time_ += time;
+  }
+
+ private:
+  bool verbose_;
+  std::string kernel_name_;
+  IRNode *ir_;
+  const CompileConfig &config_;
+  PassProfiler::Scope profiler_scope_;
+  float64 last_time_;
+  int num_stmts_{0};
+};
 
 }  // namespace
 
@@ -39,43 +91,43 @@ void compile_to_offloads(IRNode *ir,
                          bool start_from_ast) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, kernel->get_name(), ir);
-  print("Initial IR");
+  PassObserver observe(verbose, kernel->get_name(), ir, config);
+  observe("Initial IR");
 
   if (grad) {
     irpass::reverse_segments(ir);
-    print("Segment reversed (for autodiff)");
+    observe("Segment reversed (for autodiff)");
   }
 
   if (start_from_ast) {
     irpass::lower_ast(ir);
-    print("Lowered");
+    observe("Lowered");
   }
 
   irpass::type_check(ir, config);
-  print("Typechecked");
-  irpass::analysis::verify(ir);
+  observe("Typechecked");
+  observe.verify();
 
   if (kernel->is_evaluator) {
     TI_ASSERT(!grad);
 
     irpass::demote_operations(ir, config);
-    print("Operations demoted");
+    observe("Operations demoted");
 
     irpass::offload(ir, config);
-    print("Offloaded");
-    irpass::analysis::verify(ir);
+    observe("Offloaded");
+    observe.verify(/*boundary=*/true);
     return;
   }
 
   if (vectorize) {
     irpass::loop_vectorize(ir, config);
-    print("Loop Vectorized");
-    irpass::analysis::verify(ir);
+    observe("Loop Vectorized");
+    observe.verify();
 
     irpass::vector_split(ir, config.max_vector_width, config.serial_schedule);
-    print("Loop Split");
-    irpass::analysis::verify(ir);
+    observe("Loop Split");
+    observe.verify();
   }
 
   // TODO: strictly enforce bit vectorization for x86 cpu and CUDA now
@@ -83,17 +135,17 @@ void compile_to_offloads(IRNode *ir,
   if (arch_is_cpu(config.arch) || config.arch == Arch::cuda) {
     irpass::bit_loop_vectorize(ir);
     irpass::type_check(ir, config);
-    print("Bit Loop Vectorized");
-    irpass::analysis::verify(ir);
+    observe("Bit Loop Vectorized");
+    observe.verify();
   }
 
   irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified I");
-  irpass::analysis::verify(ir);
+  observe("Simplified I");
+  observe.verify();
 
   if (irpass::inlining(ir, config, {})) {
-    print("Functions inlined");
-    irpass::analysis::verify(ir);
+    observe("Functions inlined");
+    observe.verify();
   }
 
   if (grad) {
@@ -103,42 +155,42 @@ void compile_to_offloads(IRNode *ir,
     irpass::full_simplify(ir, config, {false, kernel->program});
     irpass::auto_diff(ir, config, ad_use_stack);
     irpass::full_simplify(ir, config, {false, kernel->program});
-    print("Gradient");
-    irpass::analysis::verify(ir);
+    observe("Gradient");
+    observe.verify();
   }
 
   if (config.check_out_of_bound) {
     irpass::check_out_of_bound(ir, config, {kernel->get_name()});
-    print("Bound checked");
-    irpass::analysis::verify(ir);
+    observe("Bound checked");
+    observe.verify();
   }
 
   irpass::flag_access(ir);
-  print("Access flagged I");
-  irpass::analysis::verify(ir);
+  observe("Access flagged I");
+  observe.verify();
 
   irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified II");
-  irpass::analysis::verify(ir);
+  observe("Simplified II");
+  observe.verify();
 
   irpass::offload(ir, config);
-  print("Offloaded");
-  irpass::analysis::verify(ir);
+  observe("Offloaded");
+  observe.verify();
 
   // TODO: This pass may be redundant as cfg_optimization() is already called
   //  in full_simplify().
   if (config.cfg_optimization) {
     irpass::cfg_optimization(ir, false);
-    print("Optimized by CFG");
-    irpass::analysis::verify(ir);
+    observe("Optimized by CFG");
+    observe.verify();
   }
 
   irpass::flag_access(ir);
-  print("Access flagged II");
+  observe("Access flagged II");
 
   irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified III");
-  irpass::analysis::verify(ir);
+  observe("Simplified III");
+  observe.verify(/*boundary=*/true);
 }
 
 void offload_to_executable(IRNode *ir,
@@ -151,7 +203,7 @@ void offload_to_executable(IRNode *ir,
                            bool make_block_local) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, kernel->get_name(), ir);
+  PassObserver observe(verbose, kernel->get_name(), ir, config);
 
   // TODO: This is just a proof that we can demote struct-fors after offloading.
   // Eventually we might want the order to be TLS/BLS -> demote struct-for.
@@ -160,38 +212,38 @@ void offload_to_executable(IRNode *ir,
 
   auto amgr = std::make_unique<AnalysisManager>();
 
-  print("Start offload_to_executable");
-  irpass::analysis::verify(ir);
+  observe("Start offload_to_executable");
+  observe.verify(/*boundary=*/true);
 
   if (config.detect_read_only) {
     irpass::detect_read_only(ir);
-    print("Detect read-only accesses");
+    observe("Detect read-only accesses");
   }
 
   irpass::demote_atomics(ir, config);
-  print("Atomics demoted I");
-  irpass::analysis::verify(ir);
+  observe("Atomics demoted I");
+  observe.verify();
 
   if (config.demote_dense_struct_fors) {
     irpass::demote_dense_struct_fors(ir, config.packed);
     irpass::type_check(ir, config);
-    print("Dense struct-for demoted");
-    irpass::analysis::verify(ir);
+    observe("Dense struct-for demoted");
+    observe.verify();
   }
 
   if (make_thread_local) {
     irpass::make_thread_local(ir, config);
-    print("Make thread local");
+    observe("Make thread local");
   }
 
   if (make_block_local) {
     irpass::make_block_local(ir, config, {kernel->get_name()});
-    print("Make block local");
+    observe("Make block local");
   }
 
   irpass::demote_atomics(ir, config);
-  print("Atomics demoted II");
-  irpass::analysis::verify(ir);
+  observe("Atomics demoted II");
+  observe.verify();
 
   if (is_extension_supported(config.arch, Extension::quant) &&
       ir->get_config().quant_opt_atomic_demotion) {
@@ -199,45 +251,46 @@ void offload_to_executable(IRNode *ir,
   }
 
   irpass::remove_range_assumption(ir);
-  print("Remove range assumption");
+  observe("Remove range assumption");
 
   irpass::remove_loop_unique(ir);
-  print("Remove loop_unique");
-  irpass::analysis::verify(ir);
+  observe("Remove loop_unique");
+  observe.verify();
 
   if (lower_global_access) {
     irpass::lower_access(ir, config, {kernel->no_activate, true});
-    print("Access lowered");
-    irpass::analysis::verify(ir);
+    observe("Access lowered");
+    observe.verify();
 
     irpass::die(ir);
-    print("DIE");
-    irpass::analysis::verify(ir);
+    observe("DIE");
+    observe.verify();
 
     irpass::flag_access(ir);
-    print("Access flagged III");
-    irpass::analysis::verify(ir);
+    observe("Access flagged III");
+    observe.verify();
   }
 
   irpass::demote_operations(ir, config);
-  print("Operations demoted");
+  observe("Operations demoted");
 
   irpass::full_simplify(ir, config, {lower_global_access, kernel->program});
-  print("Simplified IV");
+  observe("Simplified IV");
 
   if (determine_ad_stack_size) {
     irpass::determine_ad_stack_size(ir, config);
-    print("Autodiff stack size determined");
+    observe("Autodiff stack size determined");
   }
 
   if (is_extension_supported(config.arch, Extension::quant)) {
     irpass::optimize_bit_struct_stores(ir, config, amgr.get());
-    print("Bit struct stores optimized");
+    observe("Bit struct stores optimized");
   }
 
   // Final field registration correctness & type checking
   irpass::type_check(ir, config);
-  irpass::analysis::verify(ir);
+  observe("Typechecked");
+  observe.verify(/*boundary=*/true);
 }
 
 void compile_to_executable(IRNode *ir,
@@ -270,25 +323,25 @@ void compile_inline_function(IRNode *ir,
                              bool start_from_ast) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, func->get_name(), ir);
-  print("Initial IR");
+  PassObserver observe(verbose, func->get_name(), ir, config);
+  observe("Initial IR");
 
   if (grad) {
     irpass::reverse_segments(ir);
-    print("Segment reversed (for autodiff)");
+    observe("Segment reversed (for autodiff)");
   }
 
   if (start_from_ast) {
     irpass::lower_ast(ir);
-    print("Lowered");
+    observe("Lowered");
   }
 
   irpass::type_check(ir, config);
-  print("Typechecked");
+  observe("Typechecked");
 
   irpass::full_simplify(ir, config, {false, func->program});
-  print("Simplified");
-  irpass::analysis::verify(ir);
+  observe("Simplified");
+  observe.verify(/*boundary=*/true);
 }
 
 }  // namespace irpass
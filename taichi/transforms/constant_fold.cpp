@@ -1,8 +1,6 @@
-#include <cmath>
-#include <deque>
-#include <set>
-#include <thread>
+#include <vector>
 
+#include "taichi/analysis/arithmetic_interpretor.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/statements.h"
@@ -16,55 +14,8 @@ class ConstantFold : public BasicStmtVisitor {
  public:
   using BasicStmtVisitor::visit;
   DelayedIRModifier modifier;
-  Program *program;
 
-  explicit ConstantFold(Program *program)
-      : BasicStmtVisitor(), program(program) {
-  }
-
-  Kernel *get_jit_evaluator_kernel(JITEvaluatorId const &id) {
-    auto &cache = program->jit_evaluator_cache;
-    // Discussion:
-    // https://github.com/taichi-dev/taichi/pull/954#discussion_r423442606
-    std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-    auto it = cache.find(id);
-    if (it != cache.end())  // cached?
-      return it->second.get();
-
-    auto kernel_name = fmt::format("jit_evaluator_{}", cache.size());
-    auto func = [&id]() {
-      auto lhstmt =
-          Stmt::make<ArgLoadStmt>(/*arg_id=*/0, id.lhs, /*is_ptr=*/false);
-      auto rhstmt =
-          Stmt::make<ArgLoadStmt>(/*arg_id=*/1, id.rhs, /*is_ptr=*/false);
-      pStmt oper;
-      if (id.is_binary) {
-        oper = Stmt::make<BinaryOpStmt>(id.binary_op(), lhstmt.get(),
-                                        rhstmt.get());
-      } else {
-        oper = Stmt::make<UnaryOpStmt>(id.unary_op(), lhstmt.get());
-        if (unary_op_is_cast(id.unary_op())) {
-          oper->cast<UnaryOpStmt>()->cast_type = id.rhs;
-        }
-      }
-      auto ret = Stmt::make<ReturnStmt>(oper.get());
-      current_ast_builder().insert(std::move(lhstmt));
-      if (id.is_binary)
-        current_ast_builder().insert(std::move(rhstmt));
-      current_ast_builder().insert(std::move(oper));
-      current_ast_builder().insert(std::move(ret));
-    };
-    auto ker = std::make_unique<Kernel>(*program, func, kernel_name);
-    ker->insert_ret(id.ret);
-    ker->insert_arg(id.lhs, false);
-    if (id.is_binary)
-      ker->insert_arg(id.rhs, false);
-    ker->is_evaluator = true;
-    auto *ker_ptr = ker.get();
-    TI_TRACE("Saving JIT evaluator cache entry id={}",
-             std::hash<JITEvaluatorId>{}(id));
-    cache[id] = std::move(ker);
-    return ker_ptr;
+  ConstantFold() : BasicStmtVisitor() {
   }
 
   static bool is_good_type(DataType dt) {
@@ -82,50 +33,21 @@ class ConstantFold : public BasicStmtVisitor {
       return false;
   }
 
-  bool jit_evaluate_binary_op(TypedConstant &ret,
-                              BinaryOpStmt *stmt,
-                              const TypedConstant &lhs,
-                              const TypedConstant &rhs) {
-    if (!is_good_type(ret.dt))
-      return false;
-    JITEvaluatorId id{std::this_thread::get_id(),
-                      (int)stmt->op_type,
-                      ret.dt,
-                      lhs.dt,
-                      rhs.dt,
-                      true};
-    auto *ker = get_jit_evaluator_kernel(id);
-    auto launch_ctx = ker->make_launch_context();
-    launch_ctx.set_arg_raw(0, lhs.val_u64);
-    launch_ctx.set_arg_raw(1, rhs.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
-    return true;
-  }
-
-  bool jit_evaluate_unary_op(TypedConstant &ret,
-                             UnaryOpStmt *stmt,
-                             const TypedConstant &operand) {
-    if (!is_good_type(ret.dt))
-      return false;
-    JITEvaluatorId id{std::this_thread::get_id(),
-                      (int)stmt->op_type,
-                      ret.dt,
-                      operand.dt,
-                      stmt->cast_type,
-                      false};
-    auto *ker = get_jit_evaluator_kernel(id);
-    auto launch_ctx = ker->make_launch_context();
-    launch_ctx.set_arg_raw(0, operand.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
-    return true;
+  // Evaluates |stmt| on the host, given that all its operands are constants.
+  void fold(Stmt *stmt, const std::vector<ConstStmt *> &operands) {
+    if (stmt->width() != 1 || !is_good_type(stmt->ret_type))
+      return;
+    ArithmeticInterpretor::EvalContext ctx;
+    for (auto *operand : operands)
+      ctx.insert(operand, operand->val[0]);
+    auto result = ArithmeticInterpretor().evaluate(stmt, ctx);
+    if (!result || result->dt != stmt->ret_type)
+      return;
+    auto evaluated =
+        Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(result.value()));
+    stmt->replace_with(evaluated.get());
+    modifier.insert_before(stmt, std::move(evaluated));
+    modifier.erase(stmt);
   }
 
   void visit(BinaryOpStmt *stmt) override {
@@ -133,17 +55,7 @@ class ConstantFold : public BasicStmtVisitor {
     auto rhs = stmt->rhs->cast<ConstStmt>();
     if (!lhs || !rhs)
       return;
-    if (stmt->width() != 1)
-      return;
-    auto dst_type = stmt->ret_type;
-    TypedConstant new_constant(dst_type);
-    if (jit_evaluate_binary_op(new_constant, stmt, lhs->val[0], rhs->val[0])) {
-      auto evaluated =
-          Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(new_constant));
-      stmt->replace_with(evaluated.get());
-      modifier.insert_before(stmt, std::move(evaluated));
-      modifier.erase(stmt);
-    }
+    fold(stmt, {lhs, rhs});
   }
 
   void visit(UnaryOpStmt *stmt) override {
@@ -155,17 +67,7 @@ class ConstantFold : public BasicStmtVisitor {
     auto operand = stmt->operand->cast<ConstStmt>();
     if (!operand)
       return;
-    if (stmt->width() != 1)
-      return;
-    auto dst_type = stmt->ret_type;
-    TypedConstant new_constant(dst_type);
-    if (jit_evaluate_unary_op(new_constant, stmt, operand->val[0])) {
-      auto evaluated =
-          Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(new_constant));
-      stmt->replace_with(evaluated.get());
-      modifier.insert_before(stmt, std::move(evaluated));
-      modifier.erase(stmt);
-    }
+    fold(stmt, {operand});
   }
 
   void visit(BitExtractStmt *stmt) override {
@@ -191,8 +93,8 @@ class ConstantFold : public BasicStmtVisitor {
     modifier.erase(stmt);
   }
 
-  static bool run(IRNode *node, Program *program) {
-    ConstantFold folder(program);
+  static bool run(IRNode *node) {
+    ConstantFold folder;
     bool modified = false;
     while (true) {
       node->accept(&folder);
@@ -214,18 +116,9 @@ bool constant_fold(IRNode *root,
                    const CompileConfig &config,
                    const ConstantFoldPass::Args &args) {
   TI_AUTO_PROF;
-  // @archibate found that `debug=True` will cause JIT kernels
-  // to evaluate incorrectly (always return 0), so we simply
-  // disable constant_fold when config.debug is turned on.
-  // Discussion:
-  // https://github.com/taichi-dev/taichi/pull/839#issuecomment-626107010
-  if (config.debug) {
-    TI_TRACE("config.debug enabled, ignoring constant fold");
-    return false;
-  }
   if (!config.advanced_optimization)
     return false;
-  return ConstantFold::run(root, args.program);
+  return ConstantFold::run(root);
 }
 
 }  // namespace irpass
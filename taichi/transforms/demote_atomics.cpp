@@ -35,6 +35,11 @@ class DemoteAtomics : public BasicStmtVisitor {
       if (stmt->dest->is<ThreadLocalPtrStmt>()) {
         demote = true;
       }
+      if (stmt->dest->is<BlockLocalPtrStmt>() &&
+          arch_is_cpu(current_offloaded->device)) {
+        // A block and its BLS buffer belong to a single CPU thread.
+        demote = true;
+      }
       if (current_offloaded->task_type == OffloadedTaskType::serial) {
         demote = true;
       }
@@ -68,6 +68,80 @@ void make_block_local_offload(OffloadedStmt *offload,
             block = std::make_unique<Block>();
             block->parent_stmt = offload;
           }
+
+          // Runs |operation| on the BLS element |bls_element_id| within
+          // |element_block|.
+          auto create_element = [&](Block *element_block,
+                                    Stmt *bls_element_id) {
+            auto bls_element_offset_bytes =
+                element_block->push_back<BinaryOpStmt>(
+                    BinaryOpType::mul, bls_element_id,
+                    element_block->push_back<ConstStmt>(
+                        TypedConstant(dtype_size)));
+
+            bls_element_offset_bytes = element_block->push_back<BinaryOpStmt>(
+                BinaryOpType::add, bls_element_offset_bytes,
+                element_block->push_back<ConstStmt>(
+                    TypedConstant((int32)bls_offset_in_bytes)));
+
+            std::vector<Stmt *> global_indices(dim);
+
+            // Convert bls_element_id to global indices
+            // via a series of % and /.
+            auto bls_element_id_partial = bls_element_id;
+            for (int i = dim - 1; i >= 0; i--) {
+              auto pad_size_stmt = element_block->push_back<ConstStmt>(
+                  TypedConstant(pad.second.pad_size[i]));
+
+              auto bls_coord = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
+              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
+
+              auto global_index_this_dim =
+                  element_block->push_back<BinaryOpStmt>(
+                      BinaryOpType::add, bls_coord,
+                      element_block->push_back<ConstStmt>(
+                          TypedConstant(pad.second.bounds[i].low)));
+
+              auto block_corner =
+                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
+              if (pad.second.coefficients[i] > 1) {
+                block_corner = element_block->push_back<BinaryOpStmt>(
+                    BinaryOpType::mul, block_corner,
+                    element_block->push_back<ConstStmt>(
+                        TypedConstant(pad.second.coefficients[i])));
+              }
+
+              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::add, global_index_this_dim, block_corner);
+
+              global_indices[i] = global_index_this_dim;
+            }
+
+            operation(element_block, global_indices, bls_element_offset_bytes);
+            // TODO: do not use GlobalStore for BLS ptr.
+          };
+
+          if (arch_is_cpu(config.arch)) {
+            // On CPUs, a block is run by a single thread, which fetches the
+            // whole BLS buffer in a serial loop:
+            //
+            // for bls_element_id in range(bls_num_elements):
+            //   i, j, k = bls_to_global(bls_element_id)
+            //   ...
+            auto loop = block->push_back<RangeForStmt>(
+                block->push_back<ConstStmt>(TypedConstant(0)),
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements)),
+                std::make_unique<Block>(), /*vectorize=*/1,
+                /*bit_vectorize=*/1, /*num_cpu_threads=*/1, /*block_dim=*/1,
+                /*strictly_serialized=*/true);
+            auto loop_body = loop->as<RangeForStmt>()->body.get();
+            create_element(loop_body,
+                           loop_body->push_back<LoopIndexStmt>(loop, 0));
+            return;
+          }
+
           // Equivalent to CUDA threadIdx
           Stmt *thread_idx_stmt =
               block->push_back<LoopLinearIndexStmt>(offload);
@@ -112,15 +186,6 @@ void make_block_local_offload(OffloadedStmt *offload,
             auto bls_element_id_this_iteration = block->push_back<BinaryOpStmt>(
                 BinaryOpType::add, loop_offset_stmt, thread_idx_stmt);
 
-            auto bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::mul, bls_element_id_this_iteration,
-                block->push_back<ConstStmt>(TypedConstant(dtype_size)));
-
-            bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::add, bls_element_offset_bytes,
-                block->push_back<ConstStmt>(
-                    TypedConstant((int32)bls_offset_in_bytes)));
-
             if (loop_offset + block_dim > bls_num_elements) {
               // Need to create an IfStmt to safeguard since bls size may not be
               // a multiple of block_size, and this iteration some threads may
@@ -138,43 +203,7 @@ void make_block_local_offload(OffloadedStmt *offload,
               element_block = block.get();
             }
 
-            std::vector<Stmt *> global_indices(dim);
-
-            // Convert bls_element_id to global indices
-            // via a series of % and /.
-            auto bls_element_id_partial = bls_element_id_this_iteration;
-            for (int i = dim - 1; i >= 0; i--) {
-              auto pad_size_stmt = element_block->push_back<ConstStmt>(
-                  TypedConstant(pad.second.pad_size[i]));
-
-              auto bls_coord = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
-              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
-
-              auto global_index_this_dim =
-                  element_block->push_back<BinaryOpStmt>(
-                      BinaryOpType::add, bls_coord,
-                      element_block->push_back<ConstStmt>(
-                          TypedConstant(pad.second.bounds[i].low)));
-
-              auto block_corner =
-                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
-              if (pad.second.coefficients[i] > 1) {
-                block_corner = element_block->push_back<BinaryOpStmt>(
-                    BinaryOpType::mul, block_corner,
-                    element_block->push_back<ConstStmt>(
-                        TypedConstant(pad.second.coefficients[i])));
-              }
-
-              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::add, global_index_this_dim, block_corner);
-
-              global_indices[i] = global_index_this_dim;
-            }
-
-            operation(element_block, global_indices, bls_element_offset_bytes);
-            // TODO: do not use GlobalStore for BLS ptr.
+            create_element(element_block, bls_element_id_this_iteration);
 
             loop_offset += block_dim;
           }
@@ -81,7 +81,11 @@ class Offloader {
         // offloaded->body is an empty block now.
         offloaded->grid_dim = config.saturating_grid_dim;
         if (s->block_dim == 0) {
-          offloaded->block_dim = Program::default_block_dim(config);
+          // 0 lets cpu_parallel_range_for adapt the block size.
+          offloaded->block_dim =
+              arch_is_cpu(config.arch) && config.cpu_numa_aware
+                  ? 0
+                  : Program::default_block_dim(config);
         } else {
           offloaded->block_dim = s->block_dim;
         }
@@ -164,6 +168,8 @@ class Offloader {
             std::min(snode_child->max_num_elements(),
                      (int64)std::min(Program::default_block_dim(config),
                                      config.max_block_dim));
+        offloaded_listgen->num_cpu_threads =
+            std::min(for_stmt->num_cpu_threads, config.cpu_max_num_threads);
         root_block->insert(std::move(offloaded_listgen));
       }
     }
@@ -647,6 +653,7 @@ void insert_gc(IRNode *root, const CompileConfig &config) {
         auto gc_task = Stmt::make_typed<OffloadedStmt>(
             OffloadedStmt::TaskType::gc, config.arch);
         gc_task->snode = snode;
+        gc_task->num_cpu_threads = config.cpu_max_num_threads;
         b->insert(std::move(gc_task), i + 1);
       }
     }
@@ -2,6 +2,7 @@
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/transforms/simplify.h"
 #include "taichi/program/kernel.h"
@@ -614,36 +615,48 @@ void full_simplify(IRNode *root,
                    const CompileConfig &config,
                    const FullSimplifyPass::Args &args) {
   TI_AUTO_PROF;
+  // Records each pass with the PassProfiler, if enabled.
+  auto run = [root](const char *pass, const auto &pass_func) {
+    return PassProfiler::get_instance().run(
+        std::string("full_simplify/") + pass, root, pass_func);
+  };
   if (config.advanced_optimization) {
     bool first_iteration = true;
     while (true) {
       bool modified = false;
-      if (extract_constant(root, config))
+      if (run("extract_constant",
+              [&] { return extract_constant(root, config); }))
         modified = true;
-      if (unreachable_code_elimination(root))
+      if (run("unreachable_code_elimination",
+              [&] { return unreachable_code_elimination(root); }))
         modified = true;
-      if (binary_op_simplify(root, config))
+      if (run("binary_op_simplify",
+              [&] { return binary_op_simplify(root, config); }))
         modified = true;
-      if (constant_fold(root, config, {args.program}))
+      if (run("constant_fold",
+              [&] { return constant_fold(root, config, {args.program}); }))
         modified = true;
-      if (die(root))
+      if (run("die", [&] { return die(root); }))
         modified = true;
-      if (alg_simp(root, config))
+      if (run("alg_simp", [&] { return alg_simp(root, config); }))
         modified = true;
-      if (loop_invariant_code_motion(root, config))
+      if (run("loop_invariant_code_motion",
+              [&] { return loop_invariant_code_motion(root, config); }))
         modified = true;
-      if (die(root))
+      if (run("die", [&] { return die(root); }))
         modified = true;
-      if (simplify(root, config))
+      if (run("simplify", [&] { return simplify(root, config); }))
         modified = true;
-      if (die(root))
+      if (run("die", [&] { return die(root); }))
         modified = true;
-      if (whole_kernel_cse(root))
+      if (run("whole_kernel_cse", [&] { return whole_kernel_cse(root); }))
         modified = true;
       // Don't do this time-consuming optimization pass again if the IR is
       // not modified.
       if ((first_iteration || modified) && config.cfg_optimization &&
-          cfg_optimization(root, args.after_lower_access))
+          run("cfg_optimization", [&] {
+            return cfg_optimization(root, args.after_lower_access);
+          }))
         modified = true;
       first_iteration = false;
       if (!modified)
@@ -0,0 +1,232 @@
+#include "taichi/util/metrics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+// Replaces the characters that are not allowed in Prometheus metric names.
+std::string sanitize_metric_name(const std::string &name) {
+  std::string result = name;
+  for (int i = 0; i < (int)result.size(); i++) {
+    const auto c = (unsigned char)result[i];
+    const bool valid = std::isalpha(c) || c == '_' || c == ':' ||
+                       (i > 0 && std::isdigit(c));
+    if (!valid) {
+      result[i] = '_';
+    }
+  }
+  return result;
+}
+
+std::string escape_help(const std::string &help) {
+  std::string result;
+  for (char c : help) {
+    if (c == '\\') {
+      result += "\\\\";
+    } else if (c == '\n') {
+      result += "\\n";
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+void print_header(std::string &out,
+                  const std::string &name,
+                  const std::string &help,
+                  const std::string &type) {
+  if (!help.empty()) {
+    out += fmt::format("# HELP {} {}\n", name, escape_help(help));
+  }
+  out += fmt::format("# TYPE {} {}\n", name, type);
+}
+
+}  // namespace
+
+int get_metric_shard_id() {
+  static std::atomic<int> num_threads{0};
+  thread_local const int id =
+      num_threads.fetch_add(1, std::memory_order_relaxed) % kNumMetricShards;
+  return id;
+}
+
+Counter::Counter(const std::string &name, const std::string &help)
+    : name_(name), help_(help) {
+}
+
+int64 Counter::get() const {
+  int64 sum = 0;
+  for (auto &shard : shards_) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Counter::reset() {
+  for (auto &shard : shards_) {
+    shard.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+const std::vector<float64> &Histogram::get_bucket_bounds() {
+  static const std::vector<float64> bounds = [] {
+    std::vector<float64> bounds;
+    for (int exponent = -6; exponent < 0; exponent++) {
+      const float64 scale = std::pow(10.0, exponent);
+      bounds.push_back(scale);
+      bounds.push_back(scale * 2.5);
+      bounds.push_back(scale * 5);
+    }
+    bounds.push_back(1);
+    bounds.push_back(2.5);
+    bounds.push_back(5);
+    bounds.push_back(10);
+    return bounds;
+  }();
+  return bounds;
+}
+
+Histogram::Histogram(const std::string &name, const std::string &help)
+    : name_(name), help_(help) {
+  TI_ASSERT(get_bucket_bounds().size() < kMaxNumBuckets);
+}
+
+void Histogram::observe(float64 seconds) {
+  seconds = std::max(seconds, float64(0));
+  const auto &bounds = get_bucket_bounds();
+  const int bucket =
+      std::lower_bound(bounds.begin(), bounds.end(), seconds) - bounds.begin();
+  auto &shard = shards_[get_metric_shard_id()];
+  shard.bucket_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_ns.fetch_add(int64(seconds * 1e9), std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::get() const {
+  Snapshot snapshot;
+  const int num_buckets = get_bucket_bounds().size() + 1;
+  snapshot.bucket_counts.resize(num_buckets, 0);
+  int64 sum_ns = 0;
+  for (auto &shard : shards_) {
+    for (int i = 0; i < num_buckets; i++) {
+      snapshot.bucket_counts[i] +=
+          shard.bucket_counts[i].load(std::memory_order_relaxed);
+    }
+    sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+  }
+  for (auto count : snapshot.bucket_counts) {
+    snapshot.count += count;
+  }
+  snapshot.sum = sum_ns * 1e-9;
+  return snapshot;
+}
+
+void Histogram::reset() {
+  for (auto &shard : shards_) {
+    for (auto &count : shard.bucket_counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    shard.sum_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+Metrics &Metrics::get_instance() {
+  // Never destroyed, so that the handles held by function-local statics stay
+  // valid during static destruction.
+  static auto instance = new Metrics();
+  return *instance;
+}
+
+Counter *Metrics::counter(const std::string &name, const std::string &help) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto &counter = counters_[name];
+  if (!counter) {
+    counter = std::make_unique<Counter>(name, help);
+  }
+  return counter.get();
+}
+
+Histogram *Metrics::histogram(const std::string &name,
+                              const std::string &help) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto &histogram = histograms_[name];
+  if (!histogram) {
+    histogram = std::make_unique<Histogram>(name, help);
+  }
+  return histogram.get();
+}
+
+std::vector<Counter *> Metrics::get_counters() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::vector<Counter *> counters;
+  for (auto &[name, counter] : counters_) {
+    counters.push_back(counter.get());
+  }
+  return counters;
+}
+
+std::vector<Histogram *> Metrics::get_histograms() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::vector<Histogram *> histograms;
+  for (auto &[name, histogram] : histograms_) {
+    histograms.push_back(histogram.get());
+  }
+  return histograms;
+}
+
+std::string Metrics::to_prometheus() {
+  std::string out;
+  for (auto *counter : get_counters()) {
+    auto name = "taichi_" + sanitize_metric_name(counter->get_name());
+    if (!ends_with(name, "_total")) {
+      name += "_total";
+    }
+    print_header(out, name, counter->get_help(), "counter");
+    out += fmt::format("{} {}\n", name, counter->get());
+  }
+  const auto &bounds = Histogram::get_bucket_bounds();
+  for (auto *histogram : get_histograms()) {
+    const auto name = "taichi_" + sanitize_metric_name(histogram->get_name());
+    print_header(out, name, histogram->get_help(), "histogram");
+    const auto snapshot = histogram->get();
+    int64 cumulative_count = 0;
+    for (int i = 0; i < (int)bounds.size(); i++) {
+      cumulative_count += snapshot.bucket_counts[i];
+      out += fmt::format("{}_bucket{{le=\"{:g}\"}} {}\n", name, bounds[i],
+                         cumulative_count);
+    }
+    out += fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, snapshot.count);
+    out += fmt::format("{}_sum {}\n", name, snapshot.sum);
+    out += fmt::format("{}_count {}\n", name, snapshot.count);
+  }
+  return out;
+}
+
+void Metrics::save(const std::string &filename) {
+  const auto text = to_prometheus();
+  const auto tmp_filename = filename + ".tmp";
+  {
+    std::ofstream fout(tmp_filename);
+    TI_ERROR_UNLESS(fout, "Failed to open {}", tmp_filename);
+    fout << text;
+  }
+  TI_ERROR_IF(std::rename(tmp_filename.c_str(), filename.c_str()) != 0,
+              "Failed to write {}", filename);
+}
+
+void Metrics::clear() {
+  for (auto *counter : get_counters()) {
+    counter->reset();
+  }
+  for (auto *histogram : get_histograms()) {
+    histogram->reset();
+  }
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/timer.h"
+
+TI_NAMESPACE_BEGIN
+
+// The number of cells each metric is spread over. Threads update the cell of
+// their own shard, so that concurrent updates rarely share a cache line.
+constexpr int kNumMetricShards = 16;
+
+int get_metric_shard_id();
+
+// A monotonically increasing count. add() is wait-free and can be called from
+// any thread.
+class Counter {
+ public:
+  Counter(const std::string &name, const std::string &help);
+
+  void add(int64 value = 1) {
+    shards_[get_metric_shard_id()].value.fetch_add(value,
+                                                   std::memory_order_relaxed);
+  }
+
+  // The sum over all shards. Concurrent add() calls may or may not be
+  // included.
+  int64 get() const;
+
+  void reset();
+
+  const std::string &get_name() const {
+    return name_;
+  }
+
+  const std::string &get_help() const {
+    return help_;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64> value{0};
+  };
+
+  std::string name_;
+  std::string help_;
+  std::array<Shard, kNumMetricShards> shards_;
+};
+
+// A distribution of latencies in seconds, bucketed from 1 us to 10 s.
+class Histogram {
+ public:
+  // The upper bounds of the buckets, in seconds. Longer latencies go to an
+  // extra "+Inf" bucket.
+  static const std::vector<float64> &get_bucket_bounds();
+
+  Histogram(const std::string &name, const std::string &help);
+
+  void observe(float64 seconds);
+
+  struct Snapshot {
+    // Non-cumulative counts, one more than the bucket bounds.
+    std::vector<int64> bucket_counts;
+    int64 count{0};
+    float64 sum{0};
+  };
+
+  Snapshot get() const;
+
+  void reset();
+
+  const std::string &get_name() const {
+    return name_;
+  }
+
+  const std::string &get_help() const {
+    return help_;
+  }
+
+  // Observes the lifetime of the scope, unless |histogram| is null.
+  class Timer {
+   public:
+    explicit Timer(Histogram *histogram)
+        : histogram_(histogram),
+          start_(histogram ? Time::get_time() : float64(0)) {
+    }
+
+    ~Timer() {
+      if (histogram_) {
+        histogram_->observe(Time::get_time() - start_);
+      }
+    }
+
+   private:
+    Histogram *histogram_;
+    float64 start_;
+  };
+
+ private:
+  static constexpr int kMaxNumBuckets = 32;
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<int64>, kMaxNumBuckets> bucket_counts{};
+    std::atomic<int64> sum_ns{0};
+  };
+
+  std::string name_;
+  std::string help_;
+  std::array<Shard, kNumMetricShards> shards_;
+};
+
+// The registry of all metrics in the process. Metrics are registered once,
+// typically into a function-local static, and the returned handles are
+// updated without any lookup or locking:
+//
+//   static auto *const hits = Metrics::get_instance().counter(
+//       "offline_cache_hits", "Kernels loaded from the offline cache");
+//   hits->add();
+class Metrics {
+ public:
+  static Metrics &get_instance();
+
+  // Returns the counter registered as |name|, registering it first if
+  // needed. The handle stays valid until the process exits.
+  Counter *counter(const std::string &name, const std::string &help = "");
+
+  // Returns the histogram registered as |name|, registering it first if
+  // needed. The handle stays valid until the process exits.
+  Histogram *histogram(const std::string &name, const std::string &help = "");
+
+  std::vector<Counter *> get_counters();
+
+  std::vector<Histogram *> get_histograms();
+
+  // All metrics in the Prometheus text exposition format (version 0.0.4).
+  // Metric names are prefixed by "taichi_", and counters are suffixed by
+  // "_total".
+  std::string to_prometheus();
+
+  // Writes to_prometheus() to |filename|. The file is replaced atomically,
+  // so that a scraper polling it never reads a partial dump.
+  void save(const std::string &filename);
+
+  // Resets all values to zero. The handles stay registered.
+  void clear();
+
+ private:
+  Metrics() = default;
+
+  std::mutex mut_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+TI_NAMESPACE_END
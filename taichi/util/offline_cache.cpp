@@ -0,0 +1,60 @@
+#include "taichi/util/offline_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "taichi/system/std_filesystem.h"
+#include "taichi/util/metrics.h"
+
+TI_NAMESPACE_BEGIN
+
+void touch_offline_cache_entry(const std::string &path) {
+  std::error_code ec;
+  stdfs::last_write_time(path, stdfs::file_time_type::clock::now(), ec);
+}
+
+void evict_offline_cache_entries(const std::string &dir,
+                                 const std::string &extension,
+                                 std::size_t max_size_of_files) {
+  struct Entry {
+    stdfs::path path;
+    std::uintmax_t size;
+    stdfs::file_time_type last_used;
+  };
+  std::vector<Entry> entries;
+  std::uintmax_t total_size = 0;
+  std::error_code ec;
+  for (auto &file : stdfs::directory_iterator(dir, ec)) {
+    if (file.path().extension() != extension) {
+      continue;
+    }
+    Entry entry{file.path(), stdfs::file_size(file.path(), ec),
+                stdfs::last_write_time(file.path(), ec)};
+    if (ec) {
+      // Removed by another process in the meantime.
+      continue;
+    }
+    total_size += entry.size;
+    entries.push_back(std::move(entry));
+  }
+  if (total_size <= max_size_of_files) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.last_used < b.last_used;
+            });
+  for (auto &entry : entries) {
+    if (total_size <= max_size_of_files) {
+      break;
+    }
+    if (stdfs::remove(entry.path, ec)) {
+      total_size -= entry.size;
+      static auto *const evictions = Metrics::get_instance().counter(
+          "offline_cache_evictions", "Entries evicted from the offline cache");
+      evictions->add();
+    }
+  }
+}
+
+TI_NAMESPACE_END
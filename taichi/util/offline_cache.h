@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include "taichi/common/core.h"
+
+TI_NAMESPACE_BEGIN
+
+// Helpers for the on-disk kernel caches of the backends. An entry is a file
+// with a backend-specific extension, and its modification time is its last
+// use.
+
+// Marks the entry at |path| as just used.
+void touch_offline_cache_entry(const std::string &path);
+
+// Removes the least recently used "*<extension>" entries directly under |dir|
+// until the remaining ones take at most |max_size_of_files| bytes. Safe
+// against other processes sharing the directory.
+void evict_offline_cache_entries(const std::string &dir,
+                                 const std::string &extension,
+                                 std::size_t max_size_of_files);
+
+TI_NAMESPACE_END
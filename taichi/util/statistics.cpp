@@ -1,23 +1,24 @@
 #include "statistics.h"
 
+#include "taichi/util/metrics.h"
+
 TI_NAMESPACE_BEGIN
 
 Statistics stat;
 
 void Statistics::add(std::string key, Statistics::value_type value) {
-  counters_[key] += value;
+  Metrics::get_instance().counter(key)->add(int64(value));
 }
 
 void Statistics::print(std::string *output) {
-  std::vector<std::string> keys;
-  for (auto const &item : counters_)
-    keys.push_back(item.first);
-
-  std::sort(keys.begin(), keys.end());
-
+  // Metrics::get_counters() is sorted by name.
   std::stringstream ss;
-  for (auto const &k : keys)
-    ss << fmt::format("{:20}: {:.2f}\n", k, counters_[k]);
+  for (auto *counter : Metrics::get_instance().get_counters()) {
+    if (const auto value = counter->get(); value != 0) {
+      ss << fmt::format("{:20}: {:.2f}\n", counter->get_name(),
+                        value_type(value));
+    }
+  }
 
   if (output) {
     *output = ss.str();
@@ -27,7 +28,17 @@ void Statistics::print(std::string *output) {
 }
 
 void Statistics::clear() {
-  counters_.clear();
+  Metrics::get_instance().clear();
+}
+
+Statistics::counters_map Statistics::get_counters() {
+  counters_map counters;
+  for (auto *counter : Metrics::get_instance().get_counters()) {
+    if (const auto value = counter->get(); value != 0) {
+      counters[counter->get_name()] = value_type(value);
+    }
+  }
+  return counters;
 }
 
 TI_NAMESPACE_END
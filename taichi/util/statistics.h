@@ -1,9 +1,14 @@
+#pragma once
+
 #include <unordered_map>
 
 #include "taichi/common/core.h"
 
 TI_NAMESPACE_BEGIN
 
+// A string-keyed view of the counters in Metrics, kept for the Python API
+// (ti.get_kernel_stats()). add() looks the counter up under a lock; prefer
+// registering a Counter handle in code that runs often.
 class Statistics {
  public:
   using value_type = float64;
@@ -15,14 +20,11 @@ class Statistics {
 
   void print(std::string *output = nullptr);
 
+  // Resets all metrics, including the histograms.
   void clear();
 
-  inline const counters_map &get_counters() {
-    return counters_;
-  }
-
- private:
-  counters_map counters_;
+  // The counters that are non-zero.
+  counters_map get_counters();
 };
 
 extern Statistics stat;
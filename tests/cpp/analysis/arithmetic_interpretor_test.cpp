@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+
+#include <limits>
+
+#include "taichi/analysis/arithmetic_interpretor.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+using EvalContext = ArithmeticInterpretor::EvalContext;
+
+std::optional<TypedConstant> evaluate(Stmt *stmt) {
+  return ArithmeticInterpretor().evaluate(stmt, EvalContext());
+}
+
+std::optional<TypedConstant> evaluate(Stmt *stmt,
+                                      const std::vector<ConstStmt *> &ops) {
+  EvalContext ctx;
+  for (auto *op : ops) {
+    ctx.insert(op, op->val[0]);
+  }
+  return ArithmeticInterpretor().evaluate(stmt, ctx);
+}
+
+}  // namespace
+
+TEST(ArithmeticInterpretor, IntegerWrapAround) {
+  IRBuilder builder;
+  auto *a = builder.get_int32(std::numeric_limits<int32>::max());
+  auto *b = builder.get_int32(1);
+  auto *sum = builder.create_add(a, b);
+  auto res = evaluate(sum, {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, std::numeric_limits<int32>::min());
+
+  auto *c = builder.get_uint32(0);
+  auto *d = builder.get_uint32(1);
+  auto *diff = builder.create_sub(c, d);
+  res = evaluate(diff, {c, d});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_u32, std::numeric_limits<uint32>::max());
+}
+
+TEST(ArithmeticInterpretor, IntegerDivision) {
+  IRBuilder builder;
+  auto *a = builder.get_int32(-7);
+  auto *b = builder.get_int32(2);
+  auto *zero = builder.get_int32(0);
+  auto *min = builder.get_int32(std::numeric_limits<int32>::min());
+  auto *minus_one = builder.get_int32(-1);
+
+  auto res = evaluate(builder.create_div(a, b), {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -3);
+  res = evaluate(builder.create_mod(a, b), {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -1);
+  res = evaluate(builder.create_floordiv(a, b), {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -4);
+
+  // Undefined behaviors are not evaluated.
+  EXPECT_FALSE(evaluate(builder.create_div(a, zero), {a, zero}).has_value());
+  EXPECT_FALSE(evaluate(builder.create_mod(a, zero), {a, zero}).has_value());
+  EXPECT_FALSE(
+      evaluate(builder.create_div(min, minus_one), {min, minus_one})
+          .has_value());
+}
+
+TEST(ArithmeticInterpretor, Shifts) {
+  IRBuilder builder;
+  auto *a = builder.get_int32(-8);
+  auto *b = builder.get_int32(1);
+  auto *big = builder.get_int32(32);
+
+  auto res = evaluate(builder.create_sar(a, b), {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -4);
+  res = evaluate(builder.create_shl(a, b), {a, b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -16);
+  EXPECT_FALSE(evaluate(builder.create_shl(a, big), {a, big}).has_value());
+}
+
+TEST(ArithmeticInterpretor, Comparisons) {
+  IRBuilder builder;
+  auto *a = builder.get_float32(1.0f);
+  auto *nan = builder.get_float32(std::numeric_limits<float32>::quiet_NaN());
+
+  auto *lt = builder.create_cmp_lt(a, nan);
+  lt->ret_type = PrimitiveType::i32;
+  auto res = evaluate(lt, {a, nan});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, 0);
+
+  auto *ne = builder.create_cmp_ne(a, nan);
+  ne->ret_type = PrimitiveType::i32;
+  res = evaluate(ne, {a, nan});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, 0);
+
+  auto *u_max = builder.get_uint32(std::numeric_limits<uint32>::max());
+  auto *u_one = builder.get_uint32(1);
+  auto *gt = builder.create_cmp_gt(u_max, u_one);
+  gt->ret_type = PrimitiveType::i32;
+  res = evaluate(gt, {u_max, u_one});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -1);
+}
+
+TEST(ArithmeticInterpretor, Casts) {
+  IRBuilder builder;
+  auto *a = builder.get_float32(-2.75f);
+  auto res = evaluate(builder.create_cast(a, PrimitiveType::i32), {a});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, -2);
+
+  auto *b = builder.get_float64(1e20);
+  EXPECT_FALSE(
+      evaluate(builder.create_cast(b, PrimitiveType::i32), {b}).has_value());
+
+  auto *c = builder.get_int32(-1);
+  res = evaluate(builder.create_cast(c, PrimitiveType::u64), {c});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_u64, std::numeric_limits<uint64>::max());
+
+  auto *d = builder.get_float32(1.0f);
+  res = evaluate(builder.create_bit_cast(d, PrimitiveType::i32), {d});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, 0x3f800000);
+}
+
+TEST(ArithmeticInterpretor, UnaryOps) {
+  IRBuilder builder;
+  auto *a = builder.get_float64(-2.5);
+  auto res = evaluate(builder.create_floor(a), {a});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_f64, -3.0);
+  res = evaluate(builder.create_sgn(a), {a});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_f64, -1.0);
+
+  auto *b = builder.get_int32(5);
+  res = evaluate(builder.create_not(b), {b});
+  ASSERT_TRUE(res.has_value());
+  EXPECT_EQ(res->val_i32, ~5);
+
+  // Transcendental functions may differ between the host and the backends.
+  EXPECT_FALSE(evaluate(builder.create_sin(a), {a}).has_value());
+  // Operands must be known.
+  EXPECT_FALSE(evaluate(builder.create_neg(a)).has_value());
+}
+
+}  // namespace lang
+}  // namespace taichi
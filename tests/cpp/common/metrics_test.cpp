@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "taichi/system/std_filesystem.h"
+#include "taichi/util/metrics.h"
+#include "taichi/util/statistics.h"
+
+TI_NAMESPACE_BEGIN
+
+TEST(Metrics, CounterAddFromManyThreads) {
+  auto *counter = Metrics::get_instance().counter("test_concurrent_adds");
+  counter->reset();
+  const int num_threads = 8;
+  const int n = 100000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([counter] {
+      for (int i = 0; i < n; i++) {
+        counter->add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter->get(), num_threads * n);
+  EXPECT_EQ(Metrics::get_instance().counter("test_concurrent_adds"), counter);
+}
+
+TEST(Metrics, HistogramBuckets) {
+  auto *histogram = Metrics::get_instance().histogram("test_buckets_seconds");
+  histogram->reset();
+  const auto &bounds = Histogram::get_bucket_bounds();
+  EXPECT_DOUBLE_EQ(bounds.front(), 1e-6);
+  EXPECT_DOUBLE_EQ(bounds.back(), 10);
+  histogram->observe(1e-6);
+  histogram->observe(3e-3);
+  histogram->observe(100);
+  auto snapshot = histogram->get();
+  EXPECT_EQ(snapshot.count, 3);
+  EXPECT_NEAR(snapshot.sum, 100.003001, 1e-6);
+  ASSERT_EQ(snapshot.bucket_counts.size(), bounds.size() + 1);
+  // The upper bounds are inclusive.
+  EXPECT_EQ(snapshot.bucket_counts[0], 1);
+  const auto ms5 = std::find(bounds.begin(), bounds.end(), 5e-3);
+  ASSERT_NE(ms5, bounds.end());
+  EXPECT_EQ(snapshot.bucket_counts[ms5 - bounds.begin()], 1);
+  EXPECT_EQ(snapshot.bucket_counts.back(), 1);
+}
+
+TEST(Metrics, PrometheusText) {
+  auto &metrics = Metrics::get_instance();
+  auto *counter = metrics.counter("test.exposition", "A test\ncounter");
+  auto *histogram = metrics.histogram("test_exposition_seconds");
+  counter->reset();
+  histogram->reset();
+  counter->add(42);
+  histogram->observe(0.5);
+  histogram->observe(0.7);
+  const auto text = metrics.to_prometheus();
+  const std::string expected_counter =
+      "# HELP taichi_test_exposition_total A test\\ncounter\n"
+      "# TYPE taichi_test_exposition_total counter\n"
+      "taichi_test_exposition_total 42\n";
+  EXPECT_NE(text.find(expected_counter), std::string::npos) << text;
+  EXPECT_NE(text.find("# TYPE taichi_test_exposition_seconds histogram\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("taichi_test_exposition_seconds_bucket{le=\"0.5\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("taichi_test_exposition_seconds_bucket{le=\"1\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("taichi_test_exposition_seconds_bucket{le=\"+Inf\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("taichi_test_exposition_seconds_count 2\n"),
+            std::string::npos);
+
+  const auto path =
+      (stdfs::temp_directory_path() / "taichi_metrics_test.prom").string();
+  metrics.save(path);
+  std::ifstream fin(path);
+  std::stringstream saved;
+  saved << fin.rdbuf();
+  EXPECT_NE(saved.str().find(expected_counter), std::string::npos);
+  stdfs::remove(path);
+}
+
+TEST(Metrics, StatisticsView) {
+  stat.clear();
+  stat.add("test_statistics_view", 2);
+  Metrics::get_instance().counter("test_statistics_view")->add();
+  auto counters = stat.get_counters();
+  EXPECT_EQ(counters["test_statistics_view"], 3);
+  stat.clear();
+  EXPECT_EQ(stat.get_counters().count("test_statistics_view"), 0);
+}
+
+TI_NAMESPACE_END
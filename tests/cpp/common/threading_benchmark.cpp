@@ -0,0 +1,195 @@
+// Launch latency and scaling of ThreadPool, compared against the previous
+// single-counter pool (kept below as a reference implementation). Disabled by
+// default; run it with --gtest_also_run_disabled_tests
+// --gtest_filter=ThreadPool.DISABLED_Benchmark.
+
+#include "gtest/gtest.h"
+
+#include <mutex>
+
+#include "taichi/system/threading.h"
+#include "taichi/system/timer.h"
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+// The ThreadPool implementation prior to work stealing: all workers are woken
+// through one condition variable and grab tasks from one shared counter.
+class SharedCounterThreadPool {
+ public:
+  explicit SharedCounterThreadPool(int max_num_threads)
+      : max_num_threads(max_num_threads) {
+    threads.resize((std::size_t)max_num_threads);
+    for (int i = 0; i < max_num_threads; i++) {
+      threads[i] = std::thread([this] { this->target(); });
+    }
+  }
+
+  void run(int splits,
+           int desired_num_threads,
+           void *range_for_task_context,
+           RangeForTaskFunc *func) {
+    {
+      std::lock_guard _(mutex);
+      this->range_for_task_context = range_for_task_context;
+      this->func = func;
+      this->desired_num_threads =
+          std::min(desired_num_threads, max_num_threads);
+      started = false;
+      task_head = 0;
+      task_tail = splits;
+      timestamp++;
+    }
+    slave_cv.notify_all();
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      master_cv.wait(lock, [this] { return started && running_threads == 0; });
+    }
+  }
+
+  ~SharedCounterThreadPool() {
+    {
+      std::lock_guard<std::mutex> lg(mutex);
+      exiting = true;
+    }
+    slave_cv.notify_all();
+    for (auto &th : threads)
+      th.join();
+  }
+
+ private:
+  void target() {
+    uint64 last_timestamp = 0;
+    int thread_id;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      thread_id = thread_counter++;
+    }
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slave_cv.wait(lock, [this, last_timestamp, thread_id] {
+          return (timestamp > last_timestamp &&
+                  thread_id < desired_num_threads) ||
+                 this->exiting;
+        });
+        last_timestamp = timestamp;
+        if (exiting) {
+          break;
+        }
+        if (last_finished >= last_timestamp) {
+          continue;
+        }
+        started = true;
+        running_threads++;
+      }
+      while (true) {
+        int task_id = task_head.fetch_add(1, std::memory_order_relaxed);
+        if (task_id >= task_tail)
+          break;
+        func(this->range_for_task_context, thread_id, task_id);
+      }
+      bool all_finished = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        running_threads--;
+        if (running_threads == 0) {
+          all_finished = true;
+          last_finished = last_timestamp;
+        }
+      }
+      if (all_finished)
+        master_cv.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::condition_variable slave_cv;
+  std::condition_variable master_cv;
+  std::mutex mutex;
+  std::atomic<int> task_head{0};
+  int task_tail{0};
+  int running_threads{0};
+  int max_num_threads;
+  int desired_num_threads{0};
+  uint64 timestamp{1};
+  uint64 last_finished{0};
+  bool started{false};
+  bool exiting{false};
+  RangeForTaskFunc *func{nullptr};
+  void *range_for_task_context{nullptr};
+  int thread_counter{0};
+};
+
+void empty_task(void *, int, int) {
+}
+
+void busy_task(void *sink, int, int i) {
+  // Roughly one microsecond of work per task.
+  float64 ret = 0;
+  for (int t = 0; t < 1000; t++) {
+    ret += (t ^ i) * 1e-20;
+  }
+  if (ret < 0) {
+    *(float64 *)sink = ret;
+  }
+}
+
+// Returns the average wall time per launch, in microseconds.
+template <typename Pool>
+float64 time_launches(Pool &pool,
+                      int repeat,
+                      int splits,
+                      int num_threads,
+                      RangeForTaskFunc *func) {
+  float64 sink = 0;
+  for (int i = 0; i < std::max(repeat / 10, 1); i++) {
+    pool.run(splits, num_threads, &sink, func);
+  }
+  auto t = Time::get_time();
+  for (int i = 0; i < repeat; i++) {
+    pool.run(splits, num_threads, &sink, func);
+  }
+  return (Time::get_time() - t) / repeat * 1e6;
+}
+
+}  // namespace
+
+TEST(ThreadPool, DISABLED_Benchmark) {
+  const int max_num_threads =
+      std::max((int)std::thread::hardware_concurrency(), 1);
+  const int repeat = 10000;
+  ThreadPool work_stealing(max_num_threads);
+  SharedCounterThreadPool shared_counter(max_num_threads);
+
+  fmt::print("[ThreadPool benchmark] max_num_threads={} repeat={}\n",
+             max_num_threads, repeat);
+  fmt::print("{:>8} | {:>14} {:>14} | {:>14} {:>14}\n", "threads",
+             "launch(old)us", "launch(new)us", "1k tasks(old)",
+             "1k tasks(new)");
+  float64 base_old = 0, base_new = 0;
+  for (int n = 1;; n = std::min(n * 2, max_num_threads)) {
+    // Empty tasks: one per thread. Measures pure launch overhead.
+    auto launch_old = time_launches(shared_counter, repeat, n, n, empty_task);
+    auto launch_new = time_launches(work_stealing, repeat, n, n, empty_task);
+    // 1024 busy tasks of ~1us each. Measures scaling.
+    auto busy_old = time_launches(shared_counter, repeat / 10 + 1, 1024, n,
+                                  busy_task);
+    auto busy_new = time_launches(work_stealing, repeat / 10 + 1, 1024, n,
+                                  busy_task);
+    if (n == 1) {
+      base_old = busy_old;
+      base_new = busy_new;
+    }
+    fmt::print("{:>8} | {:>14.2f} {:>14.2f} | {:>8.1f}us x{:<4.1f} {:>8.1f}us "
+               "x{:<4.1f}\n",
+               n, launch_old, launch_new, busy_old, base_old / busy_old,
+               busy_new, base_new / busy_new);
+    if (n == max_num_threads) {
+      break;
+    }
+  }
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "taichi/system/threading.h"
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+struct TaskCounters {
+  std::vector<std::atomic<int>> hits;
+  std::vector<std::atomic<int>> thread_ids;
+
+  explicit TaskCounters(int n) : hits(n), thread_ids(n) {
+  }
+
+  static void task(void *ctx, int thread_id, int i) {
+    auto *c = (TaskCounters *)ctx;
+    c->hits[i]++;
+    c->thread_ids[i] = thread_id;
+  }
+};
+
+}  // namespace
+
+TEST(ThreadPool, EveryTaskRunsOnce) {
+  ThreadPool pool(8, /*spin_iterations=*/64);
+  for (int splits : {0, 1, 3, 8, 100, 4097}) {
+    for (int num_threads : {1, 2, 7, 8, 16}) {
+      TaskCounters counters(splits);
+      pool.run(splits, num_threads, &counters, TaskCounters::task);
+      for (int i = 0; i < splits; i++) {
+        EXPECT_EQ(counters.hits[i], 1);
+        EXPECT_LT(counters.thread_ids[i], std::min(num_threads, 8));
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, ParkedWorkersWakeUp) {
+  // With no spinning, every launch has to wake up parked workers.
+  ThreadPool pool(4, /*spin_iterations=*/0);
+  for (int j = 0; j < 200; j++) {
+    TaskCounters counters(64);
+    pool.run(64, 4, &counters, TaskCounters::task);
+    for (int i = 0; i < 64; i++) {
+      EXPECT_EQ(counters.hits[i], 1);
+    }
+  }
+}
+
+TEST(ThreadPool, SingleThread) {
+  ThreadPool pool(1);
+  TaskCounters counters(10);
+  pool.run(10, 4, &counters, TaskCounters::task);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(counters.hits[i], 1);
+    EXPECT_EQ(counters.thread_ids[i], 0);
+  }
+}
+
+TEST(ThreadPool, SlicesLaunchConcurrently) {
+  ThreadPool pool(8, /*spin_iterations=*/64);
+  EXPECT_EQ(pool.make_slices(100).size(), 8);
+  auto slices = pool.make_slices(3);
+  ASSERT_EQ(slices.size(), 3);
+  int num_threads = 0;
+  for (auto &slice : slices) {
+    EXPECT_EQ(slice->thread_id_base, num_threads);
+    num_threads += slice->max_num_threads;
+  }
+  EXPECT_EQ(num_threads, 8);
+
+  std::vector<std::thread> launchers;
+  std::vector<std::unique_ptr<TaskCounters>> counters;
+  for (auto &slice : slices) {
+    counters.push_back(std::make_unique<TaskCounters>(1000));
+    auto *c = counters.back().get();
+    launchers.emplace_back([&pool, slice = slice.get(), c] {
+      ThreadPool::set_thread_slice(slice);
+      for (int j = 0; j < 20; j++) {
+        ThreadPool::static_run(&pool, 1000, 8, c, TaskCounters::task);
+      }
+      ThreadPool::set_thread_slice(nullptr);
+    });
+  }
+  for (auto &launcher : launchers) {
+    launcher.join();
+  }
+  for (int s = 0; s < 3; s++) {
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_EQ(counters[s]->hits[i], 20);
+      EXPECT_GE(counters[s]->thread_ids[i], slices[s]->thread_id_base);
+      EXPECT_LT(counters[s]->thread_ids[i],
+                slices[s]->thread_id_base + slices[s]->max_num_threads);
+    }
+  }
+}
+
+TEST(ThreadPool, SlicedPoolDoesNotOverlapSlices) {
+  ThreadPool pool(4, /*spin_iterations=*/64);
+  auto slices = pool.make_slices(2);
+  struct Context {
+    ThreadPool *pool;
+    std::atomic<int> num_rejected{0};
+  } ctx{&pool};
+  // Launching on the pool while slice 0 launches would run two threads as
+  // thread 0.
+  slices[0]->run(1, 1, &ctx, [](void *ctx, int, int) {
+    auto *c = (Context *)ctx;
+    try {
+      c->pool->run(1, 1, nullptr, [](void *, int, int) {});
+    } catch (...) {
+      c->num_rejected++;
+    }
+  });
+  EXPECT_EQ(ctx.num_rejected, 1);
+  // Launches that do not overlap are fine.
+  TaskCounters counters(16);
+  pool.run(16, 4, &counters, TaskCounters::task);
+  slices[0]->run(16, 4, &counters, TaskCounters::task);
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(counters.hits[i], 2);
+  }
+}
+
+TEST(ThreadPool, SlicesBorrowWorkers) {
+  ThreadPool pool(8, /*spin_iterations=*/0);
+  std::set<std::thread::id> workers;
+  for (auto &thread : pool.threads) {
+    workers.insert(thread.get_id());
+  }
+  std::mutex mut;
+  std::set<std::thread::id> used;
+  auto task = [](void *ctx, int, int) {
+    auto *c = (std::pair<std::mutex *, std::set<std::thread::id> *> *)ctx;
+    std::lock_guard<std::mutex> _(*c->first);
+    c->second->insert(std::this_thread::get_id());
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  };
+  std::pair<std::mutex *, std::set<std::thread::id> *> ctx{&mut, &used};
+  {
+    auto slices = pool.make_slices(2);
+    std::thread launcher([&] { slices[1]->run(64, 4, &ctx, task); });
+    launcher.join();
+    // The parent launches on the calling thread only while it is sliced.
+    TaskCounters counters(16);
+    pool.run(16, 8, &counters, TaskCounters::task);
+    for (int i = 0; i < 16; i++) {
+      EXPECT_EQ(counters.thread_ids[i], 0);
+    }
+  }
+  // The launcher and workers 5, 6 and 7 of the pool.
+  EXPECT_LE(used.size(), 4);
+  int num_borrowed = 0;
+  for (auto id : used) {
+    num_borrowed += workers.count(id);
+  }
+  EXPECT_GE(num_borrowed, 1);
+  EXPECT_GE(num_borrowed + 1, (int)used.size());
+
+  // The workers are back.
+  TaskCounters counters(1000);
+  pool.run(1000, 8, &counters, TaskCounters::task);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(counters.hits[i], 1);
+  }
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "taichi/system/timeline.h"
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+class TimelineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Timelines::get_instance().set_enabled(true);
+    Timelines::get_instance().clear();
+  }
+
+  void TearDown() override {
+    Timelines::get_instance().clear();
+    Timelines::get_instance().set_enabled(false);
+  }
+};
+
+}  // namespace
+
+TEST_F(TimelineTest, GuardInsertsBeginAndEnd) {
+  auto &timeline = Timeline::get_this_thread_instance();
+  {
+    TI_TIMELINE("outer");
+    { TI_TIMELINE("inner"); }
+  }
+  auto records = timeline.fetch_records();
+  ASSERT_EQ(records.size(), 4);
+  const auto outer = Timelines::get_instance().intern("outer");
+  const auto inner = Timelines::get_instance().intern("inner");
+  EXPECT_EQ(records[0].name_id, outer);
+  EXPECT_EQ(records[1].name_id, inner);
+  EXPECT_EQ(records[2].name_id, inner);
+  EXPECT_EQ(records[3].name_id, outer);
+  EXPECT_TRUE(records[0].begin && records[1].begin);
+  EXPECT_FALSE(records[2].begin || records[3].begin);
+  for (int i = 1; i < 4; i++) {
+    EXPECT_LE(records[i - 1].timestamp, records[i].timestamp);
+  }
+  EXPECT_TRUE(timeline.fetch_records().empty());
+}
+
+TEST_F(TimelineTest, Disabled) {
+  Timelines::get_instance().set_enabled(false);
+  { TI_TIMELINE("disabled"); }
+  EXPECT_TRUE(Timeline::get_this_thread_instance().fetch_records().empty());
+}
+
+TEST_F(TimelineTest, FullRingBufferSpills) {
+  auto &timeline = Timeline::get_this_thread_instance();
+  const int n = Timeline::kCapacity * 3 + 5;
+  for (int i = 0; i < n; i++) {
+    timeline.insert_record(/*name_id=*/i, /*begin=*/true);
+  }
+  auto records = timeline.fetch_records();
+  ASSERT_EQ(records.size(), n);
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(records[i].name_id, i);
+  }
+}
+
+TEST_F(TimelineTest, FetchWhileInserting) {
+  const int n = 1000000;
+  Timeline *timeline = nullptr;
+  std::atomic<bool> started{false};
+  std::atomic<bool> done{false};
+  std::thread producer([&] {
+    timeline = &Timeline::get_this_thread_instance();
+    started = true;
+    for (int i = 0; i < n; i++) {
+      timeline->insert_record(/*name_id=*/i, /*begin=*/i % 2 == 0);
+    }
+    done = true;
+    while (done) {
+      // Keeps |timeline| alive until the records are fetched.
+    }
+  });
+  while (!started) {
+  }
+  std::vector<Timeline::Record> records;
+  while (true) {
+    const bool finished = done;
+    auto fetched = timeline->fetch_records();
+    records.insert(records.end(), fetched.begin(), fetched.end());
+    if (finished) {
+      break;
+    }
+  }
+  done = false;
+  producer.join();
+  ASSERT_EQ(records.size(), n);
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(records[i].name_id, i);
+  }
+}
+
+// A microbenchmark of the overhead of TI_TIMELINE.
+TEST_F(TimelineTest, Overhead) {
+  const std::string name = "benchmark_kernel_name";
+  const int n = 200000;
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto t = Time::get_time();
+  for (int i = 0; i < n; i++) {
+    TI_TIMELINE(name);
+  }
+  const auto ns_per_event = (Time::get_time() - t) * 1e9 / (2 * n);
+  fmt::print("TI_TIMELINE: {:.1f} ns per event\n", ns_per_event);
+  EXPECT_EQ(timeline.fetch_records().size(), 2 * n);
+}
+
+TI_NAMESPACE_END
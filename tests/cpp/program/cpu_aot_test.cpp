@@ -0,0 +1,69 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "taichi/backends/cpu/aot_module_loader_impl.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/math/arithmetic.h"
+#include "taichi/program/aot_module_builder.h"
+#include "taichi/system/std_filesystem.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(CpuAot, LaunchWithoutJit) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  const int n = 100;
+  auto root = std::make_unique<SNode>(/*depth=*/0, SNodeType::root);
+  auto &x = root->dense(Axis(0), n, false).insert_children(SNodeType::place);
+  x.dt = PrimitiveType::i32;
+  auto *tree = prog->add_snode_tree(std::move(root));
+
+  // for i in range(n): x[i] = i * k
+  IRBuilder builder;
+  auto *k = builder.create_arg_load(/*arg_id=*/0, PrimitiveType::i32,
+                                    /*is_ptr=*/false);
+  auto *loop =
+      builder.create_range_for(builder.get_int32(0), builder.get_int32(n));
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *i = builder.get_loop_index(loop);
+    builder.create_global_store(builder.create_global_ptr(&x, {i}),
+                                builder.create_mul(i, k));
+  }
+  auto ker = std::make_unique<Kernel>(*prog, builder.extract_ir());
+  ker->insert_arg(PrimitiveType::i32, /*is_external_array=*/false);
+
+  const auto dir = stdfs::temp_directory_path().string();
+  auto aot_builder = prog->make_aot_module_builder(Arch::x64);
+  aot_builder->add("fill", ker.get());
+  aot_builder->dump(dir, "cpu_aot_test");
+
+  cpu::AotModuleLoaderImpl loader(dir, "cpu_aot_test", /*num_threads=*/2);
+#if defined(TI_ARCH_x64)
+  // Not the host CPU, so that the module runs on other x64 machines.
+  EXPECT_EQ(loader.get_aot_data().target_cpu, "x86-64");
+#endif
+  const auto size = loader.get_min_buffer_size() + (1 << 20);
+  auto *buffer = (char *)std::aligned_alloc(taichi_page_size,
+                                            iroundup(size, taichi_page_size));
+  std::memset(buffer, 0, loader.get_root_buffer_size());
+  loader.bind(buffer, size);
+  loader.set_arg<int32>(0, 3);
+  loader.launch("fill");
+
+  auto *data = (int32 *)loader.get_snode_tree_root(tree->id());
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(data[i], i * 3);
+  }
+  std::free(buffer);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+
+#include "taichi/llvm/llvm_context.h"
+#include "taichi/llvm/llvm_program.h"
+#include "taichi/program/context.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+std::atomic<int> num_blocks{0};
+
+// Called once per block of iterations.
+void count_block(Context *, char *) {
+  num_blocks++;
+}
+
+// An item that costs well over range_for_target_block_cycles.
+void expensive_item(Context *, const char *, int) {
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start <
+         std::chrono::microseconds(50)) {
+  }
+}
+
+}  // namespace
+
+#if defined(TI_ARCH_x64)
+TEST(RangeForSchedule, AdaptsBlockSizeToMeasuredCost) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *llvm_prog = test_prog.prog()->get_llvm_program_impl();
+  auto *tlctx = llvm_prog->get_llvm_context(Arch::x64);
+  // The runtime JIT module only keeps the runtime_* entry points, so the
+  // range-for launcher is called from a fresh copy of the runtime.
+  auto *runtime = tlctx->add_module(tlctx->clone_runtime_module());
+
+  Context context{};
+  context.runtime = llvm_prog->get_llvm_runtime();
+  const int num_threads = 2;
+  const int n = 1024;
+  // The RangeForSchedule of the launches below.
+  float64 cycles_per_item = 0;
+  auto launch = [&] {
+    num_blocks = 0;
+    runtime->call<Context *, int, int, int, int, int, void *, void *, void *,
+                  std::size_t, void *>(
+        "cpu_parallel_range_for", &context, num_threads, /*begin=*/0,
+        /*end=*/n, /*step=*/1, /*block_dim=*/0, (void *)count_block,
+        (void *)expensive_item, /*epilogue=*/nullptr, /*tls_size=*/1,
+        (void *)&cycles_per_item);
+    return num_blocks.load();
+  };
+
+  // Without a measurement, each thread gets 32 blocks.
+  EXPECT_EQ(launch(), n / (n / (num_threads * 32)));
+  EXPECT_GT(cycles_per_item, 0);
+  // Each item is worth more than a block now.
+  EXPECT_EQ(launch(), n);
+}
+#endif
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "taichi/program/sparse_parallel.h"
+
+namespace taichi {
+namespace lang {
+namespace sparse_parallel {
+
+TEST(SparseParallel, ReusesCappedPool) {
+  set_max_num_threads(2);
+  EXPECT_EQ(num_threads_for(kMinGrainSize * 100), 2);
+
+  std::mutex mut;
+  std::set<std::thread::id> thread_ids;
+  const int64 n = 1000;
+  for (int i = 0; i < 100; i++) {
+    std::vector<int> visited(n, 0);
+    for_each_range(n, 4, [&](int64 t, int64 begin, int64 end) {
+      EXPECT_EQ(begin, n * t / 4);
+      EXPECT_EQ(end, n * (t + 1) / 4);
+      for (int64 j = begin; j < end; j++) {
+        visited[j]++;
+      }
+      std::lock_guard<std::mutex> _(mut);
+      thread_ids.insert(std::this_thread::get_id());
+    });
+    for (int64 j = 0; j < n; j++) {
+      ASSERT_EQ(visited[j], 1);
+    }
+  }
+  // The calling thread and one worker of the pool.
+  EXPECT_LE(thread_ids.size(), 2);
+
+  set_max_num_threads(std::thread::hardware_concurrency());
+}
+
+}  // namespace sparse_parallel
+}  // namespace lang
+}  // namespace taichi
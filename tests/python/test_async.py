@@ -53,3 +53,68 @@ def test_listgen_opt_with_offsets():
 
     ti.sync()
     assert ti.get_kernel_stats().get_counters()['launched_tasks_list_gen'] <= 2
+
+
+@ti.test(arch=ti.cpu, async_mode=True, async_max_parallel_launches=4)
+def test_parallel_launch():
+    n = 1024
+    m = 8
+    fields = [ti.field(dtype=ti.i32, shape=n) for _ in range(m)]
+    total = ti.field(dtype=ti.i32, shape=())
+
+    @ti.kernel
+    def inc(x: ti.template(), k: ti.i32):
+        for i in x:
+            x[i] += i * k
+
+    @ti.kernel
+    def accumulate(x: ti.template()):
+        for i in x:
+            total[None] += x[i]
+
+    for _ in range(5):
+        # Independent chains of tasks, one per field.
+        for k, x in enumerate(fields):
+            inc(x, k)
+        for x in fields:
+            accumulate(x)
+
+    ti.sync()
+    for k, x in enumerate(fields):
+        assert np.all(x.to_numpy() == np.arange(n) * k * 5)
+    # Each round adds the current values of all the fields.
+    expected = sum(n * (n - 1) // 2 * k * r for k in range(m)
+                   for r in range(1, 6))
+    assert total[None] == expected
+
+
+@ti.test(arch=ti.cpu, async_mode=True, async_max_parallel_launches=4)
+def test_parallel_launch_sparse():
+    n = 64
+    xs = [ti.field(dtype=ti.i32) for _ in range(4)]
+    for x in xs:
+        ti.root.pointer(ti.i, n).dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def activate(x: ti.template(), k: ti.i32):
+        for i in range(n * 4):
+            if i % (k + 2) == 0:
+                x[i] = 1
+
+    @ti.kernel
+    def inc(x: ti.template()):
+        for i in x:
+            x[i] += 1
+
+    for k, x in enumerate(xs):
+        activate(x, k)
+    for _ in range(3):
+        for x in xs:
+            inc(x)
+
+    ti.sync()
+    for k, x in enumerate(xs):
+        a = x.to_numpy()
+        for i in range(n * 4):
+            if i % (k + 2) == 0:
+                assert a[i] == 4
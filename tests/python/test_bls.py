@@ -195,6 +195,34 @@ def test_bls_large_block():
     foo()
 
 
-# TODO: BLS on CPU
 # TODO: BLS boundary out of bound
 # TODO: BLS with TLS
+
+
+@ti.test(arch=ti.cpu, dynamic_index=False)
+def test_laplacian_3d_bitmasked_cpu():
+    N = 32
+    bs = 8
+    x, y, z = ti.field(ti.f32), ti.field(ti.f32), ti.field(ti.f32)
+    for f in [x, y, z]:
+        ti.root.pointer(ti.ijk, N // bs).bitmasked(ti.ijk, bs).place(f)
+
+    @ti.kernel
+    def populate():
+        for i, j, k in ti.ndrange((1, N - 1), (1, N - 1), (1, N - 1)):
+            if (i + j * 3 + k * 7) % 5 != 0:
+                x[i, j, k] = i - j * 2 + k * 3
+
+    @ti.kernel
+    def laplacian(use_bls: ti.template(), y: ti.template()):
+        if ti.static(use_bls):
+            ti.block_local(x)
+        for i, j, k in x:
+            y[i, j, k] = (x[i - 1, j, k] + x[i + 1, j, k] + x[i, j - 1, k] +
+                          x[i, j + 1, k] + x[i, j, k - 1] + x[i, j, k + 1] -
+                          6 * x[i, j, k])
+
+    populate()
+    laplacian(False, y)
+    laplacian(True, z)
+    assert (y.to_numpy() == z.to_numpy()).all()
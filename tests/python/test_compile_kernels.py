@@ -0,0 +1,91 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=4)
+def test_compile_kernels():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+
+    def make_kernel(k):
+        @ti.kernel
+        def func():
+            for i in x:
+                x[i] += i * k
+
+        return func
+
+    @ti.kernel
+    def scale(y: ti.template(), k: ti.i32):
+        for i in y:
+            y[i] *= k
+
+    kernels = [make_kernel(k) for k in range(8)]
+    ti.compile_kernels(*kernels, (scale, x, 2))
+    assert ti.core.stat().find('parallel_compiled_kernels') != -1
+
+    for func in kernels:
+        func()
+    scale(x, 2)
+    for i in range(n):
+        assert x[i] == i * sum(range(8)) * 2
+
+
+@ti.test(arch=ti.cpu)
+def test_compile_kernels_data_oriented():
+    @ti.data_oriented
+    class Counter:
+        def __init__(self):
+            self.c = ti.field(ti.i32, shape=())
+
+        @ti.kernel
+        def inc(self):
+            self.c[None] += 1
+
+    counter = Counter()
+    ti.compile_kernels(counter.inc)
+    counter.inc()
+    counter.inc()
+    assert counter.c[None] == 2
+
+
+@ti.test(arch=ti.cpu)
+def test_compile_kernels_only_given():
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += 1
+
+    @ti.kernel
+    def dec():
+        for i in x:
+            x[i] -= 1
+
+    # Materialized, but left for its first launch to compile.
+    dec._primal.ensure_compiled()
+    ti.compile_kernels(inc)
+    assert inc._primal.kernel_cpp.is_compiled()
+    assert not dec._primal.kernel_cpp.is_compiled()
+
+
+@ti.test(arch=ti.cc, num_compile_threads=4)
+def test_compile_kernels_cc():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+
+    def make_kernel(k):
+        @ti.kernel
+        def func():
+            for i in x:
+                x[i] += i * k
+
+        return func
+
+    kernels = [make_kernel(k) for k in range(8)]
+    ti.compile_kernels(*kernels)
+    for func in kernels:
+        func()
+    assert ti.core.stat().find('cc_kernel_cache_misses') != -1
+    for i in range(n):
+        assert x[i] == i * sum(range(8))
@@ -16,3 +16,27 @@ def test_constant_fold():
     # \sum_{i=1}^n (i^2) = n * (n + 1) * (2n + 1) / 6
     expected = n * (n + 1) * (2 * n + 1) // 6
     assert series() == expected
+
+
+@ti.test()
+def test_constant_fold_matches_runtime():
+    @ti.kernel
+    def folded() -> ti.i32:
+        a = ti.cast(-7, ti.i32)
+        b = ti.cast(2, ti.i32)
+        return (a // b) * 1000 + (a % b) * 100 + (-8 >> 1)
+
+    @ti.kernel
+    def unfolded(a: ti.i32, b: ti.i32, c: ti.i32) -> ti.i32:
+        return (a // b) * 1000 + (a % b) * 100 + (c >> 1)
+
+    assert folded() == unfolded(-7, 2, -8)
+
+
+@ti.test(debug=True)
+def test_constant_fold_debug():
+    @ti.kernel
+    def func() -> ti.f32:
+        return ti.sqrt(4.0) + ti.floor(2.5)
+
+    assert func() == 4.0
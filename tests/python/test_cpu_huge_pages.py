@@ -0,0 +1,25 @@
+import numpy as np
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_huge_pages=True, cpu_first_touch=True)
+def test_huge_pages_first_touch():
+    n = 1024 * 1024
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] += i
+
+    fill()
+    assert (x.to_numpy() == np.arange(n)).all()
+
+    # Another SNode tree materialized after the first launch
+    fb = ti.FieldsBuilder()
+    y = ti.field(ti.f32)
+    fb.dense(ti.i, n).place(y)
+    fb.finalize()
+    assert (y.to_numpy() == 0).all()
+    assert (x.to_numpy() == np.arange(n)).all()
@@ -160,3 +160,17 @@ def test_fields_builder_destroy():
         A(5)
     B(2)
     A(4)
+
+
+@ti.test(arch=ti.cpu)
+def test_fields_builder_destroy_and_reuse():
+    n = 1024 * 1024
+    for i in range(3):
+        fb = ti.FieldsBuilder()
+        a = ti.field(ti.i32)
+        fb.dense(ti.i, n).place(a)
+        c = fb.finalize()
+        # The memory of destroyed trees is reused, and must read as zero.
+        assert a.to_numpy().sum() == 0
+        a.fill(i + 1)
+        c.destroy()
@@ -132,3 +132,38 @@ def test_fuse_allocator_state():
     for i, y in enumerate(ys):
         expected = N if i == N else 0
         assert y == expected
+
+
+@ti.test(require=ti.extension.sparse)
+def test_recycled_blocks_are_zero():
+    # Blocks of 16 KB, whose pages are returned to the OS on CPUs.
+    n = 64
+    x = ti.field(dtype=ti.f32)
+    block = ti.root.pointer(ti.i, n)
+    block.dense(ti.i, 4096).place(x)
+
+    @ti.kernel
+    def fill(begin: ti.i32, end: ti.i32):
+        for i in range(begin * 4096, end * 4096):
+            x[i] = 1
+
+    @ti.kernel
+    def deactivate(begin: ti.i32, end: ti.i32):
+        for i in range(begin, end):
+            ti.deactivate(block, [i])
+
+    @ti.kernel
+    def total() -> ti.f32:
+        s = 0.0
+        for i in x:
+            s += x[i]
+        return s
+
+    for frame in range(4):
+        fill(frame * 8, frame * 8 + 32)
+        deactivate(frame * 8, frame * 8 + 32)
+        ti.sync()
+        # Reactivated blocks must start from zero.
+        fill(frame * 8, frame * 8 + 1)
+        assert total() == 4096
+        block.deactivate_all()
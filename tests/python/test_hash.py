@@ -0,0 +1,142 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1024
+
+    ti.root.hash(ti.i, n).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(0, n, 7):
+            x[i] = i
+
+    @ti.kernel
+    def func():
+        for i in x:
+            s[None] += x[i] - i + 1
+
+    activate()
+    func()
+    assert s[None] == len(range(0, n, 7))
+    assert x[7] == 7
+    assert x[8] == 0
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_dense_child():
+    x = ti.field(ti.f32)
+    s = ti.field(ti.i32)
+
+    ti.root.hash(ti.ij, (64, 64)).dense(ti.ij, 4).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def func():
+        for i, j in x:
+            s[None] += 1
+
+    @ti.kernel
+    def is_active(i: ti.i32, j: ti.i32) -> ti.i32:
+        return ti.is_active(x.parent().parent(), [i, j])
+
+    x[0, 0] = 1
+    x[5, 9] = 1
+    x[255, 255] = 1
+
+    func()
+    assert s[None] == 3 * 16
+    assert is_active(1, 2)
+    assert not is_active(8, 1)
+    assert not is_active(63, 0)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_deactivate():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 256
+
+    ti.root.hash(ti.i, n).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate(k: ti.i32):
+        for i in range(n):
+            if i % k == 0:
+                x[i] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in x:
+            if i % 2 == 0:
+                ti.deactivate(x.parent(), i)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        s[None] = 0
+        for i in x:
+            s[None] += x[i]
+        return s[None]
+
+    # Repeatedly filling and draining the table exercises the reclamation of
+    # the slots of deactivated keys.
+    for _ in range(4):
+        activate(1)
+        assert count() == n
+        deactivate()
+        assert count() == n // 2
+        x.parent().deactivate_all()
+        assert count() == 0
+        activate(3)
+        assert count() == len(range(0, n, 3))
+        x.parent().deactivate_all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_grow():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    # The table starts with 4096 slots and grows by levels to hold 20000 keys.
+    n = 1 << 16
+    m = 20000
+
+    ti.root.hash(ti.i, n).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(m):
+            x[i * 3] = i * 3
+
+    @ti.kernel
+    def deactivate():
+        for i in x:
+            if i % 2 == 0:
+                ti.deactivate(x.parent(), i)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        s[None] = 0
+        for i in x:
+            s[None] += x[i] - i + 1
+        return s[None]
+
+    for _ in range(2):
+        activate()
+        assert count() == m
+        assert x[3 * (m - 1)] == 3 * (m - 1)
+        assert x[3 * m] == 0
+        deactivate()
+        assert count() == m // 2
+        activate()
+        assert count() == m
+        x.parent().deactivate_all()
+        assert count() == 0
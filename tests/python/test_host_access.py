@@ -0,0 +1,72 @@
+import numpy as np
+
+import taichi as ti
+
+
+def _fill_and_check(x):
+    @ti.kernel
+    def fill():
+        for I in ti.grouped(x):
+            x[I] = I.sum() * 3 + 1
+
+    fill()
+    for i in range(x.shape[0]):
+        for j in range(x.shape[1]):
+            assert x[i, j] == (i + j) * 3 + 1
+    x[1, 2] = 100
+    assert x[1, 2] == 100
+
+
+@ti.test(arch=ti.cpu)
+def test_host_access_no_launch():
+    x = ti.field(ti.f32)
+    ti.root.dense(ti.ij, (3, 2)).dense(ti.ij, (2, 3)).place(x)
+    _fill_and_check(x)
+
+    stats = ti.get_kernel_stats()
+    stats.clear()
+    x[0, 0] = 5
+    assert x[0, 0] == 5
+    assert 'launched_tasks' not in stats.get_counters()
+
+
+@ti.test(arch=ti.cpu, packed=True)
+def test_host_access_packed():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i16)
+    ti.root.dense(ti.i, 5).dense(ti.j, 3).place(x, y)
+    _fill_and_check(x)
+    _fill_and_check(y)
+
+
+@ti.test(arch=ti.cpu)
+def test_host_access_offset():
+    x = ti.field(ti.i32, shape=(4, 4), offset=(-2, 3))
+    x[-2, 3] = 1
+    x[1, 6] = 2
+    assert x[-2, 3] == 1
+    assert x[1, 6] == 2
+    assert x.to_numpy()[3, 3] == 2
+
+
+@ti.test(arch=ti.cpu)
+def test_host_access_sparse_fallback():
+    x = ti.field(ti.f64)
+    ti.root.pointer(ti.ij, 2).dense(ti.ij, 4).place(x)
+    x[5, 6] = 1.5
+    assert x[5, 6] == 1.5
+    assert x[0, 0] == 0
+
+
+@ti.test()
+def test_gather_scatter():
+    n = 16
+    x = ti.field(ti.f32, shape=(n, n))
+    indices = np.array([[i, (i * 7) % n] for i in range(n)])
+    values = np.arange(n, dtype=np.float32) * 0.5
+    x.scatter(indices, values)
+    assert np.all(x.gather(indices) == values)
+
+    arr = x.to_numpy()
+    for (i, j), v in zip(indices, values):
+        assert arr[i, j] == v
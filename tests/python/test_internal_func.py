@@ -62,6 +62,15 @@ def test_node_manager_gc():
     test_cpu()
 
 
+@ti.test(arch=ti.cpu)
+def test_node_manager_thread_cache():
+    @ti.kernel
+    def test_cpu():
+        ti.call_internal("test_node_allocator_thread_cache_cpu")
+
+    test_cpu()
+
+
 @ti.test(arch=[ti.cpu, ti.cuda], debug=True)
 def test_return():
     @ti.kernel
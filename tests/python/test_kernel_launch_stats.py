@@ -0,0 +1,43 @@
+import taichi as ti
+
+
+def _launch_range_fors(times):
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def two_range_fors(k: ti.i32):
+        for i in range(8):
+            x[i] = k
+        for i in range(8):
+            x[i] += i
+
+    stats = ti.get_kernel_stats()
+    stats.clear()
+    for k in range(times):
+        two_range_fors(k)
+    ti.sync()
+    assert x[3] == times - 1 + 3
+    return stats.get_counters()
+
+
+@ti.test(arch=ti.cpu)
+def test_kernel_launch_stats():
+    counters = _launch_range_fors(3)
+    assert int(counters['launched_tasks']) == 6
+    assert int(counters['launched_tasks_range_for']) == 6
+
+
+@ti.test(arch=ti.cpu)
+def test_dump_metrics():
+    _launch_range_fors(3)
+    text = ti.dump_metrics()
+    assert 'taichi_launched_tasks_total 6\n' in text
+    assert 'taichi_kernel_launch_seconds_count 3\n' in text
+    assert 'taichi_kernel_launch_seconds_bucket{le="+Inf"} 3\n' in text
+    assert '# TYPE taichi_kernel_compile_seconds histogram\n' in text
+
+
+@ti.test(arch=ti.cpu, kernel_launch_stats=False)
+def test_kernel_launch_stats_disabled():
+    counters = _launch_range_fors(3)
+    assert 'launched_tasks' not in counters
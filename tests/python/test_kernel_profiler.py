@@ -0,0 +1,49 @@
+import json
+import os
+import tempfile
+
+import taichi as ti
+
+
+def _run_sparse_kernels(n):
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 64).dense(ti.i, 16).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(1024):
+            x[i] = i
+
+    @ti.kernel
+    def double():
+        for i in x:
+            x[i] *= 2
+
+    fill()
+    for _ in range(n):
+        double()
+    ti.sync()
+    return double
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def test_kernel_profiler_offloaded_tasks():
+    double = _run_sparse_kernels(3)
+    # The listgen and struct_for tasks of |double| are all launched 3 times.
+    result = ti.query_kernel_profile_info(double.__name__)
+    assert result.counter == 3
+    assert result.min <= result.avg <= result.max
+    ti.print_kernel_profile_info()
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True, timeline=True)
+def test_kernel_profiler_timeline():
+    _run_sparse_kernels(1)
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filename = os.path.join(tmp_dir, 'timeline.json')
+        ti.timeline_save(filename)
+        with open(filename) as f:
+            events = json.load(f)
+    tids = set(e['tid'] for e in events)
+    assert 'cpu' in tids
+    assert 'cpu_thread_0' in tids
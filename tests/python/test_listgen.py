@@ -59,3 +59,34 @@ def test_nested_3d():
     for _ in range(1000):
         i, j, k = randrange(n), randrange(n), randrange(n)
         assert x[i, j, k] == (i * n + j) * n + k
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_sparse_many_blocks():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    n = 256
+
+    ti.root.pointer(ti.ij, n).pointer(ti.ij, 4).dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n * 16, n * 16):
+            if (i // 4 + j // 4) % 3 == 0:
+                x[i, j] = i * n * 16 + j
+
+    @ti.kernel
+    def count() -> ti.i32:
+        s[None] = 0
+        for i, j in x:
+            if x[i, j] == i * n * 16 + j:
+                s[None] += 1
+        return s[None]
+
+    activate()
+    expected = 0
+    for bi in range(n * 4):
+        for bj in range(n * 4):
+            if (bi + bj) % 3 == 0:
+                expected += 16
+    assert count() == expected
@@ -0,0 +1,98 @@
+import os
+import tempfile
+
+import pytest
+
+import taichi as ti
+
+
+def _run_kernels():
+    x = ti.field(ti.i32, shape=16)
+
+    @ti.kernel
+    def fill(k: ti.i32):
+        for i in x:
+            x[i] = i * k
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill(3)
+    return total()
+
+
+def test_offline_cache_cpu():
+    with tempfile.TemporaryDirectory() as cache_path:
+        ti.init(arch=ti.cpu,
+                offline_cache=True,
+                offline_cache_file_path=cache_path)
+        assert _run_kernels() == 3 * 120
+        entries = [
+            f for f in os.listdir(os.path.join(cache_path, 'llvm'))
+            if f.endswith('.o')
+        ]
+        assert len(entries) > 0
+
+        # A new program loads the runtime module (and any kernel with an
+        # identical IR) from the cache.
+        ti.init(arch=ti.cpu,
+                offline_cache=True,
+                offline_cache_file_path=cache_path)
+        assert _run_kernels() == 3 * 120
+        assert 'offline_cache_hits' in ti.core.stat()
+        ti.reset()
+
+
+def test_offline_cache_eviction():
+    with tempfile.TemporaryDirectory() as cache_path:
+        # Every new entry evicts all the others.
+        ti.init(arch=ti.cpu,
+                offline_cache=True,
+                offline_cache_file_path=cache_path,
+                offline_cache_max_size_of_files=1)
+        assert _run_kernels() == 3 * 120
+        entries = [
+            f for f in os.listdir(os.path.join(cache_path, 'llvm'))
+            if f.endswith('.o')
+        ]
+        assert len(entries) <= 1
+        ti.reset()
+
+
+@pytest.mark.skipif(not ti.core.with_cc(), reason='requires the cc backend')
+def test_offline_cache_cc():
+    with tempfile.TemporaryDirectory() as cache_path:
+        ti.init(arch=ti.cc,
+                offline_cache=True,
+                offline_cache_file_path=cache_path)
+        assert _run_kernels() == 3 * 120
+        entries = [
+            f for f in os.listdir(os.path.join(cache_path, 'cc'))
+            if f.endswith('.so')
+        ]
+        assert len(entries) > 0
+
+        # Every new entry evicts all the others.
+        ti.init(arch=ti.cc,
+                offline_cache=True,
+                offline_cache_file_path=cache_path,
+                offline_cache_max_size_of_files=1)
+        x = ti.field(ti.i32, shape=4)
+
+        @ti.kernel
+        def other():
+            for i in x:
+                x[i] = i + 7
+
+        other()
+        assert x[3] == 10
+        entries = [
+            f for f in os.listdir(os.path.join(cache_path, 'cc'))
+            if f.endswith('.so')
+        ]
+        assert len(entries) <= 1
+        ti.reset()
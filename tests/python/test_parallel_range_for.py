@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 
 
@@ -19,3 +21,87 @@ def test_parallel_range_for():
     val_np = val.to_numpy()
     for i in range(n):
         assert val_np[i] == i
+
+
+@ti.test(arch=ti.cpu, cpu_numa_aware=True)
+def test_parallel_range_for_numa_aware():
+    n = 1024 * 1024
+    val = ti.field(ti.i32, shape=(n))
+
+    @ti.kernel
+    def fill(k: ti.i32):
+        for i in range(n):
+            val[i] = i + k
+
+    # The block size adapts across the launches.
+    for k in range(5):
+        fill(k)
+        val_np = val.to_numpy()
+        assert (val_np == np.arange(n) + k).all()
+
+
+@ti.test(arch=ti.cpu, cpu_block_range_for=True)
+def test_parallel_range_for_block_function():
+    n = 100003
+    a = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            if i % 3 == 0:
+                continue
+            a[i] = i
+
+    @ti.kernel
+    def total():
+        for i in range(10, n):
+            s[None] += a[i] % 7
+
+    fill()
+    total()
+    a_np = a.to_numpy()
+    expected = np.where(np.arange(n) % 3 == 0, 0, np.arange(n))
+    assert (a_np == expected).all()
+    assert s[None] == (expected[10:] % 7).sum()
+
+
+@ti.test(arch=ti.cc)
+def test_parallel_range_for_cc_atomics():
+    n = 100000
+    a = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i64, shape=())
+    m = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            a[i] = i % 1001
+
+    @ti.kernel
+    def reduce(k: ti.i32):
+        for i in range(k, n):
+            s[None] += a[i]
+            ti.atomic_max(m[None], a[i] - i % 7)
+
+    fill()
+    reduce(10)
+    a_np = np.arange(n) % 1001
+    assert s[None] == a_np[10:].sum()
+    assert m[None] == (a_np[10:] - np.arange(10, n) % 7).max()
+
+
+@ti.test(arch=ti.cc)
+def test_serialized_range_for_cc():
+    n = 100000
+    a = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def prefix_sum():
+        ti.serialize()
+        for i in range(1, n):
+            a[i] += a[i - 1]
+
+    a.fill(1)
+    prefix_sum()
+    assert (a.to_numpy() == np.arange(1, n + 1)).all()
@@ -0,0 +1,50 @@
+import json
+import os
+import tempfile
+
+import taichi as ti
+
+
+def _compile_kernel():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def saxpy(a: ti.f32):
+        for i in x:
+            x[i] = a * x[i] + 1
+
+    saxpy(2)
+
+
+@ti.test(arch=ti.cpu, pass_profiler=True)
+def test_pass_profiler():
+    _compile_kernel()
+    records = ti.query_pass_profile_info()
+    kernels = set(rec['kernel'] for rec in records)
+    assert any(k.startswith('saxpy') for k in kernels)
+    passes = set(rec['pass'] for rec in records)
+    assert 'Offloaded' in passes
+    assert 'full_simplify/die' in passes
+    for rec in records:
+        assert rec['time'] >= 0
+        assert rec['num_stmts_before'] >= 0
+        assert rec['num_stmts_after'] >= 0
+    ti.print_pass_profile_info()
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filename = os.path.join(tmp_dir, 'passes.json')
+        ti.export_pass_profile_info(filename)
+        with open(filename) as f:
+            assert json.load(f) == records
+
+    ti.clear_pass_profile_info()
+    assert ti.query_pass_profile_info() == []
+
+
+@ti.test(arch=ti.cpu, pass_profiler=True, verify_each_pass=True)
+def test_pass_profiler_verify_each_pass():
+    _compile_kernel()
+    records = ti.query_pass_profile_info()
+    num_verified = sum(rec['pass'] == 'verify' for rec in records)
+    # More than the boundaries of the pipelines.
+    assert num_verified > 3
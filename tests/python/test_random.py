@@ -107,6 +107,33 @@ def test_random_seed_per_launch():
     assert count <= n * 0.15
 
 
+@ti.test(exclude=ti.metal)
+def test_random_independent_kernels():
+    n = 10
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    # Different kernels draw from the same random states, so they do not
+    # repeat each other's numbers.
+    @ti.kernel
+    def gen_x():
+        for i in range(n):
+            x[i] = ti.random()
+
+    @ti.kernel
+    def gen_y():
+        for i in range(n):
+            y[i] = ti.random()
+
+    gen_x()
+    gen_y()
+    count = 0
+    for i in range(n):
+        count += 1 if x[i] == y[i] else 0
+
+    assert count <= n * 0.15
+
+
 @ti.test(arch=[ti.cpu, ti.cuda])
 def test_random_seed_per_program():
     import numpy as np
@@ -52,3 +52,69 @@ def test_sparse_LLT_solver(solver_type):
     x = solver.solve(b)
     for i in range(n):
         assert x[i] == ti.approx(res[i])
+
+
+def _fill_spd_matrix(dtype):
+    n = 4
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=100, dtype=dtype)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), InputArray: ti.ext_arr()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+
+    fill(Abuilder, Aarray)
+    return Abuilder.build()
+
+
+@pytest.mark.parametrize("solver_type", ["CG", "BICGSTAB"])
+@pytest.mark.parametrize("preconditioner", ["none", "jacobi", "ic"])
+@ti.test(arch=ti.cpu)
+def test_sparse_iterative_solver(solver_type, preconditioner):
+    A = _fill_spd_matrix(ti.f32)
+    b = np.array([1, 2, 3, 4], dtype=np.float32)
+    solver = ti.SparseSolver(solver_type=solver_type,
+                             preconditioner=preconditioner)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+    assert solver.error() <= 1e-6
+    for i in range(4):
+        assert x[i] == ti.approx(res[i])
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_iterative_solver_f64_warm_start():
+    A = _fill_spd_matrix(ti.f64)
+    b = np.array([1, 2, 3, 4], dtype=np.float64)
+    solver = ti.SparseSolver(solver_type="CG", dtype=ti.f64, tolerance=1e-12)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+    assert solver.iterations() > 0
+    for i in range(4):
+        assert x[i] == ti.approx(res[i], rel=1e-10)
+
+    x = solver.solve(b, x0=x)
+    assert solver.info()
+    assert solver.iterations() <= 1
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_iterative_solver_custom_preconditioner():
+    A = _fill_spd_matrix(ti.f32)
+    b = np.array([1, 2, 3, 4], dtype=np.float32)
+    inv_diag = 1 / np.diag(Aarray).astype(np.float32)
+    num_calls = [0]
+
+    def jacobi(r):
+        num_calls[0] += 1
+        return inv_diag * r
+
+    solver = ti.SparseSolver(solver_type="CG", preconditioner=jacobi)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+    assert num_calls[0] > 0
+    for i in range(4):
+        assert x[i] == ti.approx(res[i])
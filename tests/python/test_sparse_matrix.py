@@ -1,3 +1,5 @@
+import pytest
+
 import taichi as ti
 
 
@@ -181,3 +183,81 @@ def test_sparse_matrix_nonsymmetric_multiplication():
     for i in range(n):
         for j in range(m):
             assert C[i, j] == GT[i][j]
+
+
+@ti.test(arch=ti.cpu, default_fp=ti.f64)
+def test_sparse_matrix_f64():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n,
+                                      n,
+                                      max_num_triplets=100,
+                                      dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i in range(n):
+            Abuilder[i, i] += 1e-10 * i + 1
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    for i in range(n):
+        assert A[i, i] == 1e-10 * i + 1
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_duplicated_triplets():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=1000)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i, j, k in ti.ndrange(n, n, 4):
+            if (i + j) % 3 == 0:
+                Abuilder[i, j] += k
+        for i in range(n):
+            Abuilder[i, i] -= 1
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    for i in range(n):
+        for j in range(n):
+            expected = 6 if (i + j) % 3 == 0 else 0
+            if i == j:
+                expected -= 1
+            assert A[i, j] == expected
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_rebuild():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=100)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), k: ti.i32):
+        for i in range(n):
+            Abuilder[i, (i + k) % n] += i + k
+            Abuilder[i, i] += 1
+
+    for k in [1, 1, 2]:
+        Abuilder.clear()
+        fill(Abuilder, k)
+        A = Abuilder.build()
+        for i in range(n):
+            for j in range(n):
+                expected = (i + k) * (j == (i + k) % n) + (i == j)
+                assert A[i, j] == expected
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_overflow():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=4)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i in range(n):
+            Abuilder[i, i] += 1
+
+    fill(Abuilder)
+    with pytest.raises(RuntimeError):
+        Abuilder.build()